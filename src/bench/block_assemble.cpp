@@ -3,9 +3,16 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include <bench/bench.h>
+#include <bench/contracts.h>
 #include <chainparams.h>
 #include <consensus/validation.h>
 #include <crypto/sha256.h>
+#include <key.h>
+#include <miner.h>
+#include <random.h>
+#include <script/sign.h>
+#include <script/signingprovider.h>
+#include <script/standard.h>
 #include <test/util/mining.h>
 #include <test/util/setup_common.h>
 #include <test/util/wallet.h>
@@ -13,7 +20,6 @@
 #include <validation.h>
 #include <util/convert.h>
 
-
 #include <vector>
 
 static void AssembleBlock(benchmark::State& state)
@@ -55,3 +61,113 @@ static void AssembleBlock(benchmark::State& state)
 }
 
 BENCHMARK(AssembleBlock, 700);
+
+static const size_t CONTRACT_MEMPOOL_TXS = 600;
+static const CAmount CONTRACT_BENCH_COIN = 100 * COIN;
+
+static void Sign(const FillableSigningProvider& keystore, const CScript& script_pub, CMutableTransaction& tx, CAmount amount)
+{
+    bool ret{SignSignature(keystore, script_pub, tx, 0, amount, SIGHASH_ALL)};
+    assert(ret);
+}
+
+static void AcceptTx(const CMutableTransaction& tx)
+{
+    LOCK(::cs_main);
+    TxValidationState state;
+    bool ret{::AcceptToMemoryPool(::mempool, state, MakeTransactionRef(tx), nullptr /* plTxnReplaced */, false /* bypass_limits */, /* nAbsurdFee */ 0)};
+    assert(ret);
+}
+
+/**
+ * Fill the mempool with CONTRACT_MEMPOOL_TXS transactions, contract_percent of
+ * them calls to a storage writer contract with varying gas limit and gas price,
+ * the others plain value transfers with varying fees.
+ */
+static void FillContractMempool(unsigned int contract_percent)
+{
+    CKey key;
+    key.MakeNewKey(true);
+    FillableSigningProvider keystore;
+    keystore.AddKey(key);
+    const CScript SCRIPT_PUB{GetScriptForDestination(PKHash(key.GetPubKey()))};
+
+    // The block 2 coinbase carries the premine, mature it and split it into coins for the mempool
+    CTxIn premine;
+    for (int height = 1; height <= ::Params().GetConsensus().CoinbaseMaturity(0) + 2; ++height) {
+        CTxIn coin{MineBlock(g_testing_setup->m_node, SCRIPT_PUB)};
+        if (height == 2) premine = coin;
+    }
+    CAmount premine_value;
+    {
+        LOCK(::cs_main);
+        premine_value = ::ChainstateActive().CoinsTip().AccessCoin(premine.prevout).out.nValue;
+    }
+    CMutableTransaction split;
+    split.vin.push_back(premine);
+    for (size_t i = 0; i <= CONTRACT_MEMPOOL_TXS; ++i) {
+        split.vout.emplace_back(CONTRACT_BENCH_COIN, SCRIPT_PUB);
+    }
+    split.vout.emplace_back(premine_value - (CONTRACT_MEMPOOL_TXS + 1) * CONTRACT_BENCH_COIN - COIN, SCRIPT_PUB);
+    Sign(keystore, SCRIPT_PUB, split, premine_value);
+    AcceptTx(split);
+    MineBlock(g_testing_setup->m_node, SCRIPT_PUB);
+    const uint256 split_hash{split.GetHash()};
+
+    const CScriptNum version(VersionVM::GetEVMDefault().toRaw());
+    CMutableTransaction create;
+    create.vin.emplace_back(COutPoint(split_hash, 0));
+    create.vout.emplace_back(0, CScript() << version << CScriptNum(500000) << CScriptNum(40) << ParseHex(STORAGE_WRITER_CODE) << OP_CREATE);
+    create.vout.emplace_back(CONTRACT_BENCH_COIN - COIN, SCRIPT_PUB);
+    Sign(keystore, SCRIPT_PUB, create, CONTRACT_BENCH_COIN);
+    AcceptTx(create);
+    MineBlock(g_testing_setup->m_node, SCRIPT_PUB);
+    const dev::Address writer{QtumState::createQtumAddress(uintToh256(create.GetHash()), 0)};
+
+    FastRandomContext rand{/* fDeterministic */ true};
+    for (size_t i = 1; i <= CONTRACT_MEMPOOL_TXS; ++i) {
+        CMutableTransaction tx;
+        tx.vin.emplace_back(COutPoint(split_hash, i));
+        CAmount fee;
+        if (rand.randrange(100) < contract_percent) {
+            const uint64_t writes{1 + rand.randrange(20)};
+            const uint64_t gas_limit{30000 + writes * 25000};
+            const uint64_t gas_price{40 + rand.randrange(160)};
+            valtype data = dev::h256(dev::u256(writes)).asBytes();
+            valtype seed = dev::h256(dev::u256(i)).asBytes();
+            data.insert(data.end(), seed.begin(), seed.end());
+            tx.vout.emplace_back(0, CScript() << version << CScriptNum(gas_limit) << CScriptNum(gas_price) << data << writer.asBytes() << OP_CALL);
+            fee = gas_limit * gas_price + 100000;
+        } else {
+            fee = 10000 + rand.randrange(100000);
+        }
+        tx.vout.emplace_back(CONTRACT_BENCH_COIN - fee, SCRIPT_PUB);
+        Sign(keystore, SCRIPT_PUB, tx, CONTRACT_BENCH_COIN);
+        AcceptTx(tx);
+    }
+}
+
+static void AssembleContractBlock(benchmark::State& state, unsigned int contract_percent, bool proof_of_stake, bool time_limit)
+{
+    FillContractMempool(contract_percent);
+    const CScript SCRIPT_PUB{CScript() << OP_TRUE};
+
+    while (state.KeepRunning()) {
+        // With the time limit set, contracts are cut off right away as in a
+        // staker running out of its bytecode time buffer, and only value
+        // transfers are added
+        int32_t nTimeLimit = time_limit ? GetAdjustedTime() + BYTECODE_TIME_BUFFER : 0;
+        std::unique_ptr<CBlockTemplate> block_template{BlockAssembler{::mempool, ::Params()}.CreateNewBlock(SCRIPT_PUB, true, proof_of_stake, nullptr, 0, nTimeLimit)};
+        assert(block_template);
+    }
+}
+
+static void AssembleContractBlockPoW(benchmark::State& state) { AssembleContractBlock(state, 50, false, false); }
+static void AssembleContractBlockPoS(benchmark::State& state) { AssembleContractBlock(state, 50, true, false); }
+static void AssembleContractBlockHeavy(benchmark::State& state) { AssembleContractBlock(state, 90, false, false); }
+static void AssembleContractBlockTimeLimit(benchmark::State& state) { AssembleContractBlock(state, 50, true, true); }
+
+BENCHMARK(AssembleContractBlockPoW, 5);
+BENCHMARK(AssembleContractBlockPoS, 5);
+BENCHMARK(AssembleContractBlockHeavy, 5);
+BENCHMARK(AssembleContractBlockTimeLimit, 50);
@@ -0,0 +1,114 @@
+// Copyright (c) 2020 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <bench/data.h>
+
+#include <amount.h>
+#include <clientversion.h>
+#include <primitives/block.h>
+#include <random.h>
+#include <script/script.h>
+#include <streams.h>
+#include <util/strencodings.h>
+#include <validation.h>
+
+#include <assert.h>
+
+//! A block of QRC20 transfer() calls to a few tokens, like the blocks of a busy contract chain
+static std::vector<unsigned char> ContractBlock()
+{
+    FastRandomContext rng(true);
+    std::vector<std::vector<unsigned char>> tokens;
+    for (int i = 0; i < 8; i++) tokens.push_back(rng.randbytes(20));
+
+    CBlock block;
+    CMutableTransaction coinbase;
+    coinbase.vin.emplace_back(COutPoint(), CScript() << 100000 << OP_0);
+    coinbase.vout.emplace_back(0, CScript());
+    block.vtx.push_back(MakeTransactionRef(coinbase));
+    for (int i = 0; i < 1000; i++) {
+        CMutableTransaction tx;
+        tx.vin.emplace_back(COutPoint(rng.rand256(), rng.randrange(4)), CScript() << rng.randbytes(72) << rng.randbytes(33));
+
+        // transfer(address,uint256), with the arguments zero padded to 32 bytes
+        std::vector<unsigned char> data = ParseHex("a9059cbb");
+        data.resize(data.size() + 12);
+        std::vector<unsigned char> to = rng.randbytes(20);
+        data.insert(data.end(), to.begin(), to.end());
+        data.resize(data.size() + 24);
+        std::vector<unsigned char> amount = rng.randbytes(8);
+        data.insert(data.end(), amount.begin(), amount.end());
+
+        tx.vout.emplace_back(0, CScript() << 4 << 250000 << 40 << data << tokens[rng.randrange(tokens.size())] << OP_CALL);
+        tx.vout.emplace_back(rng.randrange(COIN), CScript() << OP_DUP << OP_HASH160 << rng.randbytes(20) << OP_EQUALVERIFY << OP_CHECKSIG);
+        block.vtx.push_back(MakeTransactionRef(tx));
+    }
+
+    std::vector<unsigned char> raw;
+    CVectorWriter(SER_DISK, CLIENT_VERSION, raw, 0, block);
+    return raw;
+}
+
+static void CompressBlock(benchmark::State& state, const std::vector<unsigned char>& raw)
+{
+    std::vector<unsigned char> frame;
+    while (state.KeepRunning()) {
+        bool compressed = CompressBlockFrame(raw, frame);
+        assert(compressed);
+    }
+}
+
+static void ReadCompressedBlock(benchmark::State& state, const std::vector<unsigned char>& raw)
+{
+    std::vector<unsigned char> frame;
+    bool compressed = CompressBlockFrame(raw, frame);
+    assert(compressed);
+    std::vector<unsigned char> decompressed;
+    while (state.KeepRunning()) {
+        bool ok = DecompressBlockFrame(frame, decompressed);
+        assert(ok);
+        CBlock block;
+        VectorReader(SER_DISK, CLIENT_VERSION, decompressed, 0) >> block;
+    }
+}
+
+static void ReadBlock(benchmark::State& state, const std::vector<unsigned char>& raw)
+{
+    while (state.KeepRunning()) {
+        CBlock block;
+        VectorReader(SER_DISK, CLIENT_VERSION, raw, 0) >> block;
+    }
+}
+
+static void BlockFrameCompress(benchmark::State& state)
+{
+    CompressBlock(state, benchmark::data::blockbench);
+}
+
+static void BlockFrameRead(benchmark::State& state)
+{
+    ReadCompressedBlock(state, benchmark::data::blockbench);
+}
+
+static void ContractBlockFrameCompress(benchmark::State& state)
+{
+    CompressBlock(state, ContractBlock());
+}
+
+static void ContractBlockFrameRead(benchmark::State& state)
+{
+    ReadCompressedBlock(state, ContractBlock());
+}
+
+static void ContractBlockRawRead(benchmark::State& state)
+{
+    ReadBlock(state, ContractBlock());
+}
+
+BENCHMARK(BlockFrameCompress, 20000);
+BENCHMARK(BlockFrameRead, 20000);
+BENCHMARK(ContractBlockFrameCompress, 200);
+BENCHMARK(ContractBlockFrameRead, 200);
+BENCHMARK(ContractBlockRawRead, 200);
@@ -20,7 +20,7 @@ static const unsigned int QUEUE_BATCH_SIZE = 128;
 // This Benchmark tests the CheckQueue with a slightly realistic workload,
 // where checks all contain a prevector that is indirect 50% of the time
 // and there is a little bit of work done between calls to Add.
-static void CCheckQueueSpeedPrevectorJob(benchmark::State& state)
+static void RunCheckQueuePrevectorJob(benchmark::State& state, int threads)
 {
     struct PrevectorJob {
         prevector<PREVECTOR_SIZE, uint8_t> p;
@@ -37,7 +37,7 @@ static void CCheckQueueSpeedPrevectorJob(benchmark::State& state)
     };
     CCheckQueue<PrevectorJob> queue {QUEUE_BATCH_SIZE};
     boost::thread_group tg;
-    for (auto x = 0; x < std::max(MIN_CORES, GetNumCores()); ++x) {
+    for (auto x = 0; x < threads; ++x) {
        tg.create_thread([&]{queue.Thread();});
     }
     while (state.KeepRunning()) {
@@ -58,4 +58,18 @@ static void CCheckQueueSpeedPrevectorJob(benchmark::State& state)
     tg.interrupt_all();
     tg.join_all();
 }
+
+static void CCheckQueueSpeedPrevectorJob(benchmark::State& state)
+{
+    RunCheckQueuePrevectorJob(state, std::max(MIN_CORES, GetNumCores()));
+}
+
+// Fixed worker counts, to compare how work distribution scales independently of the machine
+static void CCheckQueueSpeedPrevectorJob4Threads(benchmark::State& state) { RunCheckQueuePrevectorJob(state, 4); }
+static void CCheckQueueSpeedPrevectorJob16Threads(benchmark::State& state) { RunCheckQueuePrevectorJob(state, 16); }
+static void CCheckQueueSpeedPrevectorJob64Threads(benchmark::State& state) { RunCheckQueuePrevectorJob(state, 64); }
+
 BENCHMARK(CCheckQueueSpeedPrevectorJob, 1400);
+BENCHMARK(CCheckQueueSpeedPrevectorJob4Threads, 1400);
+BENCHMARK(CCheckQueueSpeedPrevectorJob16Threads, 1400);
+BENCHMARK(CCheckQueueSpeedPrevectorJob64Threads, 1400);
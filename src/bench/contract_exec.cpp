@@ -0,0 +1,264 @@
+// Copyright (c) 2020 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <bench/contracts.h>
+#include <arith_uint256.h>
+#include <chainparams.h>
+#include <qtum/qtumdelegation.h>
+#include <qtum/trienodecache.h>
+#include <test/qtumtests/test_utils.h>
+#include <validation.h>
+
+#include <vector>
+
+// The contract layer benchmarks run against the regtest genesis state of the
+// bench testing setup. Every iteration restores the state roots, so each run
+// repeats the same work.
+
+/** QRC20 token from the qtum_qrc20 functional test; the constructor credits the whole supply to the sender */
+static const std::string TOKEN_CODE = "6080604052600860ff16600a620000179190620000f7565b7af316271c7fc3908a8bef464e3945ef7a25360a00000000000000006200003f919062000234565b6000553480156200004f57600080fd5b50600054600160003373ffffffffffffffffffffffffffffffffffffffff1673ffffffffffffffffffffffffffffffffffffffff16815260200190815260200160002081905550620002db565b6000808291508390505b6001851115620000ee57808604811115620000c657620000c56200029f565b5b6001851615620000d65780820291505b8081029050620000e685620002ce565b9450620000a6565b94509492505050565b6000620001048262000295565b9150620001118362000295565b9250620001407fffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffff848462000148565b905092915050565b6000826200015a57600190506200022d565b816200016a57600090506200022d565b81600181146200018357600281146200018e57620001c4565b60019150506200022d565b60ff841115620001a357620001a26200029f565b5b8360020a915084821115620001bd57620001bc6200029f565b5b506200022d565b5060208310610133831016604e8410600b8410161715620001fe5782820a905083811115620001f857620001f76200029f565b5b6200022d565b6200020d84848460016200009c565b925090508184048111156200022757620002266200029f565b5b81810290505b9392505050565b6000620002418262000295565b91506200024e8362000295565b9250817fffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffff04831182151516156200028a57620002896200029f565b5b828202905092915050565b6000819050919050565b7f4e487b7100000000000000000000000000000000000000000000000000000000600052601160045260246000fd5b60008160011c9050919050565b610f5380620002eb6000396000f3fe608060405234801561001057600080fd5b506004361061009e5760003560e01c80635a3b7e42116100665780635a3b7e421461015d57806370a082311461017b57806395d89b41146101ab578063a9059cbb146101c9578063dd62ed3e146101f95761009e565b806306fdde03146100a3578063095ea7b3146100c157806318160ddd146100f157806323b872dd1461010f578063313ce5671461013f575b600080fd5b6100ab610229565b6040516100b89190610ce0565b60405180910390f35b6100db60048036038101906100d69190610c00565b610262565b6040516100e89190610cc5565b60405180910390f35b6100f961045a565b6040516101069190610d22565b60405180910390f35b61012960048036038101906101249190610bb1565b610460565b6040516101369190610cc5565b60405180910390f35b6101476107d4565b6040516101549190610d3d565b60405180910390f35b6101656107d9565b6040516101729190610ce0565b60405180910390f35b61019560048036038101906101909190610b4c565b610812565b6040516101a29190610d22565b60405180910390f35b6101b361082a565b6040516101c09190610ce0565b60405180910390f35b6101e360048036038101906101de9190610c00565b610863565b6040516101f09190610cc5565b60405180910390f35b610213600480360381019061020e9190610b75565b610a5e565b6040516102209190610d22565b60405180910390f35b6040518060400160405280600881526020017f515243205445535400000000000000000000000000000000000000000000000081525081565b600082600073ffffffffffffffffffffffffffffffffffffffff168173ffffffffffffffffffffffffffffffffffffffff1614156102d5576040517f08c379a00000000000000000000000000000000000000000000000000000000081526004016102cc90610d02565b60405180910390fd5b600083148061036057506000600260003373ffffffffffffffffffffffffffffffffffffffff1673ffffffffffffffffffffffffffffffffffffffff16815260200190815260200160002060008673ffffffffffffffffffffffffffffffffffffffff1673ffffffffffffffffffffffffffffffffffffffff16815260200190815260200160002054145b61036957600080fd5b82600260003373ffffffffffffffffffffffffffffffffffffffff1673ffffffffffffffffffffffffffffffffffffffff16815260200190815260200160002060008673ffffffffffffffffffffffffffffffffffffffff1673ffffffffffffffffffffffffffffffffffffffff168152602001908152602001600020819055508373ffffffffffffffffffffffffffffffffffffffff163373ffffffffffffffffffffffffffffffffffffffff167f8c5be1e5ebec7d5bd14f71427d1e84f3dd0314c0f7b2291e5b200ac8c7c3b925856040516104479190610d22565b60405180910390a3600191505092915050565b60005481565b600083600073ffffffffffffffffffffffffffffffffffffffff168173ffffffffffffffffffffffffffffffffffffffff1614156104d3576040517f08c379a00000000000000000000000000000000000000000000000000000000081526004016104ca90610d02565b60405180910390fd5b83600073ffffffffffffffffffffffffffffffffffffffff168173ffffffffffffffffffffffffffffffffffffffff161415610544576040517f08c379a000000000000000000000000000000000000000000000000000000000815260040161053b90610d02565b60405180910390fd5b6105ca600260008873ffffffffffffffffffffffffffffffffffffffff1673ffffffffffffffffffffffffffffffffffffffff16815260200190815260200160002060003373ffffffffffffffffffffffffffffffffffffffff1673ffffffffffffffffffffffffffffffffffffffff1681526020019081526020016000205485610a83565b600260008873ffffffffffffffffffffffffffffffffffffffff1673ffffffffffffffffffffffffffffffffffffffff16815260200190815260200160002060003373ffffffffffffffffffffffffffffffffffffffff1673ffffffffffffffffffffffffffffffffffffffff16815260200190815260200160002081905550610693600160008873ffffffffffffffffffffffffffffffffffffffff1673ffffffffffffffffffffffffffffffffffffffff1681526020019081526020016000205485610a83565b600160008873ffffffffffffffffffffffffffffffffffffffff1673ffffffffffffffffffffffffffffffffffffffff1681526020019081526020016000208190555061071f600160008773ffffffffffffffffffffffffffffffffffffffff1673ffffffffffffffffffffffffffffffffffffffff1681526020019081526020016000205485610ad0565b600160008773ffffffffffffffffffffffffffffffffffffffff1673ffffffffffffffffffffffffffffffffffffffff168152602001908152602001600020819055508473ffffffffffffffffffffffffffffffffffffffff168673ffffffffffffffffffffffffffffffffffffffff167fddf252ad1be2c89b69c2b068fc378daa952ba7f163c4a11628f55a4df523b3ef866040516107bf9190610d22565b60405180910390a36001925050509392505050565b600881565b6040518060400160405280600981526020017f546f6b656e20302e31000000000000000000000000000000000000000000000081525081565b60016020528060005260406000206000915090505481565b6040518060400160405280600381526020017f515443000000000000000000000000000000000000000000000000000000000081525081565b600082600073ffffffffffffffffffffffffffffffffffffffff168173ffffffffffffffffffffffffffffffffffffffff1614156108d6576040517f08c379a00000000000000000000000000000000000000000000000000000000081526004016108cd90610d02565b60405180910390fd5b61091f600160003373ffffffffffffffffffffffffffffffffffffffff1673ffffffffffffffffffffffffffffffffffffffff1681526020019081526020016000205484610a83565b600160003373ffffffffffffffffffffffffffffffffffffffff1673ffffffffffffffffffffffffffffffffffffffff168152602001908152602001600020819055506109ab600160008673ffffffffffffffffffffffffffffffffffffffff1673ffffffffffffffffffffffffffffffffffffffff1681526020019081526020016000205484610ad0565b600160008673ffffffffffffffffffffffffffffffffffffffff1673ffffffffffffffffffffffffffffffffffffffff168152602001908152602001600020819055508373ffffffffffffffffffffffffffffffffffffffff163373ffffffffffffffffffffffffffffffffffffffff167fddf252ad1be2c89b69c2b068fc378daa952ba7f163c4a11628f55a4df523b3ef85604051610a4b9190610d22565b60405180910390a3600191505092915050565b6002602052816000526040600020602052806000526040600020600091509150505481565b600081831015610abc577f4e487b7100000000000000000000000000000000000000000000000000000000600052600160045260246000fd5b8183610ac89190610dca565b905092915050565b6000808284610adf9190610d74565b905083811015610b18577f4e487b7100000000000000000000000000000000000000000000000000000000600052600160045260246000fd5b8091505092915050565b600081359050610b3181610eef565b92915050565b600081359050610b4681610f06565b92915050565b600060208284031215610b5e57600080fd5b6000610b6c84828501610b22565b91505092915050565b60008060408385031215610b8857600080fd5b6000610b9685828601610b22565b9250506020610ba785828601610b22565b9150509250929050565b600080600060608486031215610bc657600080fd5b6000610bd486828701610b22565b9350506020610be586828701610b22565b9250506040610bf686828701610b37565b9150509250925092565b60008060408385031215610c1357600080fd5b6000610c2185828601610b22565b9250506020610c3285828601610b37565b9150509250929050565b610c4581610e10565b82525050565b6000610c5682610d58565b610c608185610d63565b9350610c70818560208601610e53565b610c7981610eb5565b840191505092915050565b6000610c91600f83610d63565b9150610c9c82610ec6565b602082019050919050565b610cb081610e3c565b82525050565b610cbf81610e46565b82525050565b6000602082019050610cda6000830184610c3c565b92915050565b60006020820190508181036000830152610cfa8184610c4b565b905092915050565b60006020820190508181036000830152610d1b81610c84565b9050919050565b6000602082019050610d376000830184610ca7565b92915050565b6000602082019050610d526000830184610cb6565b92915050565b600081519050919050565b600082825260208201905092915050565b6000610d7f82610e3c565b9150610d8a83610e3c565b9250827fffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffff03821115610dbf57610dbe610e86565b5b828201905092915050565b6000610dd582610e3c565b9150610de083610e3c565b925082821015610df357610df2610e86565b5b828203905092915050565b6000610e0982610e1c565b9050919050565b60008115159050919050565b600073ffffffffffffffffffffffffffffffffffffffff82169050919050565b6000819050919050565b600060ff82169050919050565b60005b83811015610e71578082015181840152602081019050610e56565b83811115610e80576000848401525b50505050565b7f4e487b7100000000000000000000000000000000000000000000000000000000600052601160045260246000fd5b6000601f19601f8301169050919050565b7f41646472657373206973204e554c4c0000000000000000000000000000000000600082015250565b610ef881610dfe565b8114610f0357600080fd5b50565b610f0f81610e3c565b8114610f1a57600080fd5b5056fea2646970667358221220428f0675eabb8d19af3d0c2868ed3d1faf18c135df79935059e8f6da0fba00e864736f6c63430008020033";
+
+/** Delegation to a staker signed by the delegate, as in delegations_tests */
+static const std::string DELEGATE_ADDRESS_HEX = "df329c86d2d31139b2e882df0a83312a8d567d62";
+static const std::string STAKER_ADDRESS_HEX = "a2330f4221f31b7d5648eae85e505d73bb852b48";
+static const std::string POD_HEX = "1f8507f6bc4eded301b61be5dde24923d6eecfe96aae2f3d3cd50e657171e0e13a6c0e114491c3e5699481c6ad45d3c358728fca5821c6aa9487254b1a3725673d";
+
+static const dev::u256 GAS_LIMIT = dev::u256(2500000);
+static const dev::u256 GAS_PRICE = dev::u256(40);
+static const size_t CONTRACT_TXS = 20;
+static const size_t STORAGE_WRITES = 100;
+
+static dev::h256 BenchTxHash(uint64_t n)
+{
+    return uintToh256(ArithToUint256(arith_uint256(n + 1)));
+}
+
+static valtype Word(const dev::u256& value)
+{
+    return dev::h256(value).asBytes();
+}
+
+static dev::Address DeployContract(const std::string& code, uint64_t n)
+{
+    std::vector<QtumTransaction> txs{createQtumTransaction(ParseHex(code), 0, GAS_LIMIT, GAS_PRICE, BenchTxHash(n), dev::Address())};
+    std::pair<std::vector<ResultExecute>, ByteCodeExecResult> res = executeBC(txs);
+    assert(res.first[0].execRes.excepted == dev::eth::TransactionException::None);
+    return res.first[0].execRes.newAddress;
+}
+
+/** Run the contract transactions through ByteCodeExec as ConnectBlock does, including the db commit */
+static void ExecContractTxs(benchmark::State& state, const std::vector<QtumTransaction>& txs)
+{
+    while (state.KeepRunning()) {
+        TemporaryState ts(globalState);
+        std::pair<std::vector<ResultExecute>, ByteCodeExecResult> res = executeBC(txs);
+        assert(res.first.size() == txs.size());
+    }
+}
+
+static void ContractTokenTransfer(benchmark::State& state)
+{
+    LOCK(cs_main);
+    TemporaryState ts(globalState);
+    dev::Address token = DeployContract(TOKEN_CODE, 0);
+
+    std::vector<QtumTransaction> txs;
+    for (size_t i = 0; i < CONTRACT_TXS; i++) {
+        // transfer(address,uint256) to a different recipient each time
+        valtype data = ParseHex("a9059cbb");
+        valtype to = Word(dev::u256(0x1000 + i));
+        valtype amount = Word(dev::u256(1));
+        data.insert(data.end(), to.begin(), to.end());
+        data.insert(data.end(), amount.begin(), amount.end());
+        txs.push_back(createQtumTransaction(data, 0, GAS_LIMIT, GAS_PRICE, BenchTxHash(1 + i), token));
+    }
+    ExecContractTxs(state, txs);
+}
+
+static void ContractStorageWrites(benchmark::State& state)
+{
+    LOCK(cs_main);
+    TemporaryState ts(globalState);
+    dev::Address writer = DeployContract(STORAGE_WRITER_CODE, 0);
+
+    std::vector<QtumTransaction> txs;
+    for (size_t i = 0; i < CONTRACT_TXS; i++) {
+        valtype data = Word(dev::u256(STORAGE_WRITES));
+        valtype seed = Word(dev::u256(i));
+        data.insert(data.end(), seed.begin(), seed.end());
+        txs.push_back(createQtumTransaction(data, 0, GAS_LIMIT, GAS_PRICE, BenchTxHash(1 + i), writer));
+    }
+    ExecContractTxs(state, txs);
+}
+
+static void ContractDelegationAdd(benchmark::State& state)
+{
+    LOCK(cs_main);
+    TemporaryState ts(globalState);
+    globalState->deployDelegationsContract();
+
+    std::string datahex, errorMessage;
+    bool ret = QtumDelegation::BytecodeAdd(STAKER_ADDRESS_HEX, 10, ParseHex(POD_HEX), datahex, errorMessage);
+    assert(ret);
+    QtumTransaction tx = createQtumTransaction(ParseHex(datahex), 0, GAS_LIMIT, GAS_PRICE, BenchTxHash(0), uintToh160(Params().GetConsensus().delegationsAddress));
+    tx.forceSender(dev::Address(DELEGATE_ADDRESS_HEX));
+    ExecContractTxs(state, {tx});
+}
+
+static void ContractDGPReads(benchmark::State& state)
+{
+    LOCK(cs_main);
+    const unsigned int height = ChainActive().Height() + 1;
+    while (state.KeepRunning()) {
+        // ConnectBlock reads the parameters with a fresh QtumDGP for every block
+        QtumDGP qtumDGP(globalState.get(), fGettingValuesDGP);
+        qtumDGP.getGasSchedule(height);
+        qtumDGP.getBlockSize(height);
+        qtumDGP.getMinGasPrice(height);
+        qtumDGP.getBlockGasLimit(height);
+    }
+}
+
+static void ContractCondensingTX(benchmark::State& state)
+{
+    LOCK(cs_main);
+    TemporaryState ts(globalState);
+
+    // A chain of value transfers between contracts holding one UTXO each
+    const size_t contracts = 50;
+    std::vector<dev::Address> addresses;
+    for (size_t i = 0; i < contracts; i++) {
+        addresses.push_back(createQtumAddress(BenchTxHash(i), 0));
+        globalState->setCacheUTXO(addresses.back(), Vin{BenchTxHash(i), 0, dev::u256(COIN), 1});
+    }
+    std::vector<TransferInfo> transfers;
+    for (size_t i = 0; i < contracts; i++) {
+        transfers.push_back(TransferInfo{addresses[i], addresses[(i + 1) % contracts], dev::u256(COIN / 2)});
+    }
+    QtumTransaction tx = createQtumTransaction(valtype(), 0, GAS_LIMIT, GAS_PRICE, BenchTxHash(contracts), addresses[0]);
+
+    while (state.KeepRunning()) {
+        CondensingTX ctx(globalState.get(), transfers, tx);
+        CTransaction condensed = ctx.createCondensingTX();
+        assert(condensed.vout.size() == contracts);
+        ctx.createVin(condensed);
+    }
+}
+
+static void ContractTxConverter(benchmark::State& state)
+{
+    const valtype sender(ParseHex("abababababababababababababababababababab"));
+    CMutableTransaction parent;
+    parent.vin.resize(1);
+    parent.vout.push_back(CTxOut(COIN, CScript() << OP_DUP << OP_HASH160 << sender << OP_EQUALVERIFY << OP_CHECKSIG));
+    std::vector<CTransactionRef> blockTxs{MakeTransactionRef(parent)};
+
+    CMutableTransaction tx;
+    tx.vin.push_back(CTxIn(blockTxs[0]->GetHash(), 0, CScript() << OP_1));
+    valtype data = ParseHex("a9059cbb");
+    valtype to = Word(dev::u256(0x1000));
+    valtype amount = Word(dev::u256(1));
+    data.insert(data.end(), to.begin(), to.end());
+    data.insert(data.end(), amount.begin(), amount.end());
+    for (size_t i = 0; i < CONTRACT_TXS; i++) {
+        CScript script = CScript() << CScriptNum(VersionVM::GetEVMDefault().toRaw()) << CScriptNum(int64_t(GAS_LIMIT)) << CScriptNum(int64_t(GAS_PRICE)) << data << sender << OP_CALL;
+        tx.vout.push_back(CTxOut(0, script));
+    }
+    const CTransaction transaction(tx);
+
+    while (state.KeepRunning()) {
+        QtumTxConverter converter(transaction, nullptr, &blockTxs);
+        ExtractQtumTX qtumTx;
+        bool ret = converter.extractionQtumTransactions(qtumTx);
+        assert(ret && qtumTx.first.size() == CONTRACT_TXS);
+    }
+}
+
+static void ContractStateCommit(benchmark::State& state)
+{
+    LOCK(cs_main);
+    TemporaryState ts(globalState);
+    dev::Address writer = DeployContract(STORAGE_WRITER_CODE, 0);
+
+    uint64_t round = 0;
+    while (state.KeepRunning()) {
+        TemporaryState tsRound(globalState);
+        for (size_t i = 0; i < STORAGE_WRITES; i++) {
+            globalState->setStorage(writer, dev::u256(i), dev::u256(++round));
+        }
+        globalState->commit(dev::eth::State::CommitBehaviour::KeepEmptyAccounts);
+        globalState->db().commit();
+    }
+}
+
+static QtumTransaction TokenTransfer(const dev::Address& token, uint64_t to, uint64_t n)
+{
+    valtype data = ParseHex("a9059cbb");
+    valtype recipient = Word(dev::u256(to));
+    valtype amount = Word(dev::u256(1));
+    data.insert(data.end(), recipient.begin(), recipient.end());
+    data.insert(data.end(), amount.begin(), amount.end());
+    return createQtumTransaction(data, 0, GAS_LIMIT, GAS_PRICE, BenchTxHash(n), token);
+}
+
+/**
+ * Token transfers run on top of each of a few consecutive state roots in turn,
+ * as block assembly, callcontract and reorgs move the global state around.
+ * The roots share most of their trie nodes.
+ */
+static void ContractRootSwitch(benchmark::State& state, size_t cache_size)
+{
+    LOCK(cs_main);
+    TemporaryState ts(globalState);
+    dev::Address token = DeployContract(TOKEN_CODE, 0);
+
+    const size_t roots = 8;
+    std::vector<std::pair<dev::h256, dev::h256>> stateRoots;
+    for (size_t i = 0; i < roots; i++) {
+        std::vector<QtumTransaction> txs;
+        for (size_t j = 0; j < CONTRACT_TXS; j++) {
+            txs.push_back(TokenTransfer(token, 0x1000 + i * CONTRACT_TXS + j, 1 + i * CONTRACT_TXS + j));
+        }
+        executeBC(txs);
+        stateRoots.emplace_back(globalState->rootHash(), globalState->rootHashUTXO());
+    }
+
+    std::vector<QtumTransaction> txs;
+    for (size_t j = 0; j < CONTRACT_TXS; j++) {
+        txs.push_back(TokenTransfer(token, 0x1000 + j, 1 + roots * CONTRACT_TXS + j));
+    }
+
+    const TrieNodeCache::Stats stats = g_trie_node_cache.GetStats();
+    g_trie_node_cache.SetMaxUsage(cache_size);
+    while (state.KeepRunning()) {
+        for (const auto& root : stateRoots) {
+            TemporaryState tsRoot(globalState);
+            tsRoot.SetRoot(root.first, root.second);
+            std::pair<std::vector<ResultExecute>, ByteCodeExecResult> res = executeBC(txs);
+            assert(res.first.size() == txs.size());
+        }
+    }
+    g_trie_node_cache.SetMaxUsage(stats.max_usage);
+}
+
+static void ContractRootSwitchCached(benchmark::State& state)
+{
+    ContractRootSwitch(state, DEFAULT_TRIE_NODE_CACHE_SIZE << 20);
+}
+
+static void ContractRootSwitchUncached(benchmark::State& state)
+{
+    ContractRootSwitch(state, 0);
+}
+
+BENCHMARK(ContractTokenTransfer, 20);
+BENCHMARK(ContractStorageWrites, 5);
+BENCHMARK(ContractDelegationAdd, 200);
+BENCHMARK(ContractDGPReads, 2000);
+BENCHMARK(ContractCondensingTX, 2000);
+BENCHMARK(ContractTxConverter, 20000);
+BENCHMARK(ContractStateCommit, 200);
+BENCHMARK(ContractRootSwitchCached, 5);
+BENCHMARK(ContractRootSwitchUncached, 5);
@@ -0,0 +1,17 @@
+// Copyright (c) 2020 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_BENCH_CONTRACTS_H
+#define BITCOIN_BENCH_CONTRACTS_H
+
+#include <string>
+
+/**
+ * Hand written contract that writes n fresh slots, taking n and a seed as call data:
+ *   for (i = 0; i < n; i++) storage[sha3(i, seed)] = i + 1;
+ * The gas of a call grows with n.
+ */
+static const std::string STORAGE_WRITER_CODE = "602980600b6000396000f360003560005b8181101560275780600052602035602052806001016040600020556001016005565b00";
+
+#endif // BITCOIN_BENCH_CONTRACTS_H
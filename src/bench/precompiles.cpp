@@ -0,0 +1,103 @@
+// Copyright (c) 2020 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <key.h>
+#include <qtum/precompiles.h>
+#include <uint256.h>
+#include <util/strencodings.h>
+
+#include <libethcore/Precompiled.h>
+
+#include <assert.h>
+
+// e(G1, G2) * e(-G1, G2) == 1
+static const std::string PAIRING_INPUT =
+    "0000000000000000000000000000000000000000000000000000000000000001"
+    "0000000000000000000000000000000000000000000000000000000000000002"
+    "198e9393920d483a7260bfb731fb5d25f1aa493335a9e71297e485b7aef312c2"
+    "1800deef121f1e76426a00665e5c4479674322d4f75edadd46debd5cd992f6ed"
+    "090689d0585ff075ec9e99ad690c3395bc4b313370b38ef355acdadcd122975b"
+    "12c85ea5db8c6deb4aab71808dcb408fe3d1e7690c43d37b4ce6cc0166fa7daa"
+    "0000000000000000000000000000000000000000000000000000000000000001"
+    "30644e72e131a029b85045b68181585d97816a916871ca8d3c208c16d87cfd45"
+    "198e9393920d483a7260bfb731fb5d25f1aa493335a9e71297e485b7aef312c2"
+    "1800deef121f1e76426a00665e5c4479674322d4f75edadd46debd5cd992f6ed"
+    "090689d0585ff075ec9e99ad690c3395bc4b313370b38ef355acdadcd122975b"
+    "12c85ea5db8c6deb4aab71808dcb408fe3d1e7690c43d37b4ce6cc0166fa7daa";
+
+// The G1 generator (1, 2)
+static const std::string G1_INPUT =
+    "0000000000000000000000000000000000000000000000000000000000000001"
+    "0000000000000000000000000000000000000000000000000000000000000002";
+
+static void RunPrecompile(benchmark::State& state, const std::string& name, const dev::bytes& input)
+{
+    dev::eth::PrecompiledExecutor exec = dev::eth::PrecompiledRegistrar::executor(name);
+    while (state.KeepRunning()) {
+        std::pair<bool, dev::bytes> result = exec(dev::bytesConstRef(&input));
+        assert(result.first);
+    }
+}
+
+static void EVMEcrecover(benchmark::State& state)
+{
+    CKey key;
+    key.MakeNewKey(false);
+    const uint256 hash = uint256S("0x52a5ba9c6e2d2b1e0aed08b5e3c5f7d6f1d0c2b3a4958677a8b9cadbecfd0e1f");
+    std::vector<unsigned char> sig;
+    bool signed_ok = key.SignCompact(hash, sig);
+    assert(signed_ok);
+
+    dev::bytes input(128, 0);
+    std::copy(hash.begin(), hash.end(), input.begin());
+    input[63] = sig[0];
+    std::copy(sig.begin() + 1, sig.end(), input.begin() + 64);
+    RunPrecompile(state, "ecrecover", input);
+}
+
+static void EVMSha256(benchmark::State& state)
+{
+    RunPrecompile(state, "sha256", dev::bytes(1024, 0));
+}
+
+static void EVMRipemd160(benchmark::State& state)
+{
+    RunPrecompile(state, "ripemd160", dev::bytes(1024, 0));
+}
+
+static void EVMBn128Add(benchmark::State& state)
+{
+    RunPrecompile(state, "alt_bn128_G1_add", ParseHex(G1_INPUT + G1_INPUT));
+}
+
+static void EVMBn128Mul(benchmark::State& state)
+{
+    RunPrecompile(state, "alt_bn128_G1_mul", ParseHex(G1_INPUT + std::string(64, 'f')));
+}
+
+static void EVMBn128PairingCached(benchmark::State& state)
+{
+    g_pairing_cache.Clear();
+    RunPrecompile(state, "alt_bn128_pairing_product", ParseHex(PAIRING_INPUT));
+}
+
+static void EVMBn128PairingUncached(benchmark::State& state)
+{
+    const dev::bytes input = ParseHex(PAIRING_INPUT);
+    dev::eth::PrecompiledExecutor exec = dev::eth::PrecompiledRegistrar::executor("alt_bn128_pairing_product");
+    while (state.KeepRunning()) {
+        g_pairing_cache.Clear();
+        std::pair<bool, dev::bytes> result = exec(dev::bytesConstRef(&input));
+        assert(result.first && result.second.back() == 1);
+    }
+}
+
+BENCHMARK(EVMEcrecover, 5000);
+BENCHMARK(EVMSha256, 50000);
+BENCHMARK(EVMRipemd160, 20000);
+BENCHMARK(EVMBn128Add, 20000);
+BENCHMARK(EVMBn128Mul, 1000);
+BENCHMARK(EVMBn128PairingCached, 50000);
+BENCHMARK(EVMBn128PairingUncached, 20);
@@ -15,11 +15,8 @@ static void AddTx(const CTransactionRef& tx, const CAmount& fee, CTxMemPool& poo
     pool.addUnchecked(CTxMemPoolEntry(tx, fee, /* time */ 0, /* height */ 1, /* spendsCoinbase */ false, /* sigOpCost */ 4, lp));
 }
 
-static void RpcMempool(benchmark::State& state)
+static void FillPool(CTxMemPool& pool) EXCLUSIVE_LOCKS_REQUIRED(cs_main, pool.cs)
 {
-    CTxMemPool pool;
-    LOCK2(cs_main, pool.cs);
-
     for (int i = 0; i < 1000; ++i) {
         CMutableTransaction tx = CMutableTransaction();
         tx.vin.resize(1);
@@ -31,10 +28,35 @@ static void RpcMempool(benchmark::State& state)
         const CTransactionRef tx_r{MakeTransactionRef(tx)};
         AddTx(tx_r, /* fee */ i, pool);
     }
+}
+
+static void RpcMempool(benchmark::State& state)
+{
+    CTxMemPool pool;
+    LOCK2(cs_main, pool.cs);
+    FillPool(pool);
+    const uint256 txid = pool.mapTx.begin()->GetTx().GetHash();
+
+    // Change the mempool every time, so the snapshot is built again and not only encoded
+    CAmount delta = 1;
+    while (state.KeepRunning()) {
+        pool.PrioritiseTransaction(txid, delta);
+        delta = -delta;
+        (void)MempoolToJSON(pool, /*verbose*/ true);
+    }
+}
+
+static void RpcMempoolCached(benchmark::State& state)
+{
+    CTxMemPool pool;
+    LOCK2(cs_main, pool.cs);
+    FillPool(pool);
 
+    // The mempool does not change, so only the first call builds the snapshot
     while (state.KeepRunning()) {
         (void)MempoolToJSON(pool, /*verbose*/ true);
     }
 }
 
 BENCHMARK(RpcMempool, 40);
+BENCHMARK(RpcMempoolCached, 40);
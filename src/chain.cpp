@@ -116,8 +116,22 @@ CBlockIndex* CBlockIndex::GetAncestor(int height)
 
 void CBlockIndex::BuildSkip()
 {
-    if (pprev)
-        pskip = pprev->GetAncestor(GetSkipHeight(nHeight));
+    if (!pprev)
+        return;
+    pskip = pprev->GetAncestor(GetSkipHeight(nHeight));
+
+    // The genesis block never takes part in retargeting, so the proof links stop short of it.
+    if (!pprev->pprev) {
+        pprevSameProof = nullptr;
+        pprevOtherProof = nullptr;
+    } else if (pprev->IsProofOfStake() == IsProofOfStake()) {
+        pprevSameProof = pprev;
+        pprevOtherProof = pprev->pprevOtherProof;
+    } else {
+        pprevSameProof = pprev->pprevOtherProof;
+        pprevOtherProof = pprev;
+    }
+    nChainStakeCount = pprev->nChainStakeCount + (IsProofOfStake() ? 1 : 0);
 }
 
 arith_uint256 GetBlockProof(const CBlockIndex& block)
@@ -149,6 +149,12 @@ public:
     //! pointer to the index of some further predecessor of this block
     CBlockIndex* pskip{nullptr};
 
+    //! (memory only) pointer to the closest non-genesis predecessor with the same proof type as this block
+    CBlockIndex* pprevSameProof{nullptr};
+
+    //! (memory only) pointer to the closest non-genesis predecessor with the other proof type
+    CBlockIndex* pprevOtherProof{nullptr};
+
     //! height of the entry in the chain. The genesis block has height 0
     int nHeight{0};
 
@@ -198,6 +204,9 @@ public:
     //! (memory only) Maximum nTime in the chain up to and including this block.
     unsigned int nTimeMax{0};
 
+    //! (memory only) Number of proof-of-stake blocks in the chain up to and including this block.
+    int nChainStakeCount{0};
+
     CBlockIndex()
     {
     }
@@ -337,7 +346,7 @@ public:
         return false;
     }
 
-    //! Build the skiplist pointer for this entry.
+    //! Build the skiplist and same-proof pointers for this entry.
     void BuildSkip();
 
     //! Efficiently find an ancestor of this block.
@@ -8,10 +8,14 @@
 #include <sync.h>
 
 #include <algorithm>
+#include <atomic>
+#include <memory>
+#include <thread>
 #include <vector>
 
 #include <boost/thread/condition_variable.hpp>
 #include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
 
 template <typename T>
 class CCheckQueueControl;
@@ -25,101 +29,125 @@ class CCheckQueueControl;
   * onto the queue, where they are processed by N-1 worker threads. When
   * the master is done adding work, it temporarily joins the worker pool
   * as an N'th worker, until all jobs are done.
+  *
+  * Handing out work takes no lock: checks are swapped into storage that is
+  * kept across blocks, and threads claim ranges of them by advancing a
+  * shared position with a compare-and-swap. Threads that run out of work
+  * poll for a short while before going to sleep, so the mutex and condition
+  * variables are only touched when a thread actually parks.
   */
 template <typename T>
 class CCheckQueue
 {
 private:
-    //! Mutex to protect the inner state
+    //! Checks are stored in chunks of this many elements, allocated on first use and reused afterwards
+    static constexpr size_t CHUNK_SIZE = 1024;
+
+    //! Maximum number of chunks. Checks that do not fit are run by the master in Add.
+    static constexpr size_t MAX_CHUNKS = 4096;
+
+    //! Number of times an idle thread polls for work before it sleeps
+    static constexpr int SPIN_ROUNDS = 1000;
+
+    //! Mutex used only to sleep and to wake sleeping threads
     boost::mutex mutex;
 
     //! Worker threads block on this when out of work
     boost::condition_variable condWorker;
 
-    //! Master thread blocks on this when out of work
+    //! Master thread blocks on this when waiting for workers to finish
     boost::condition_variable condMaster;
 
-    //! The queue of elements to be processed.
-    //! As the order of booleans doesn't matter, it is used as a LIFO (stack)
-    std::vector<T> queue;
+    //! Storage for the checks of the current block, only ever grown by the master
+    std::unique_ptr<std::unique_ptr<T[]>[]> m_chunks;
+    size_t m_num_chunks{0};
 
-    //! The number of workers (including the master) that are idle.
-    int nIdle;
-
-    //! The total number of workers (including the master).
-    int nTotal;
+    /**
+     * Checks are numbered by positions that only ever increase. Checks before
+     * m_published have been added, checks before m_claimed have been taken by
+     * a thread, and m_done checks have completed (including their cleanup).
+     * m_start is the position of the first check of the current block, which
+     * is stored at the start of m_chunks.
+     */
+    std::atomic<uint64_t> m_published{0};
+    std::atomic<uint64_t> m_claimed{0};
+    std::atomic<uint64_t> m_done{0};
+    std::atomic<uint64_t> m_start{0};
 
     //! The temporary evaluation result.
-    bool fAllOk;
+    std::atomic<bool> m_all_ok{true};
 
-    /**
-     * Number of verifications that haven't completed yet.
-     * This includes elements that are no longer queued, but still in the
-     * worker's own batches.
-     */
-    unsigned int nTodo;
+    //! The number of threads (including the master while it waits) taking work.
+    std::atomic<int> m_total{0};
+
+    //! Number of workers sleeping on condWorker.
+    std::atomic<int> m_sleeping_workers{0};
+
+    //! Whether the master is sleeping on condMaster.
+    std::atomic<bool> m_master_sleeping{false};
 
     //! The maximum number of elements to be processed in one batch
-    unsigned int nBatchSize;
+    const unsigned int nBatchSize;
 
-    /** Internal function that does bulk of the verification work. */
-    bool Loop(bool fMaster = false)
+    T& Slot(uint64_t pos)
     {
-        boost::condition_variable& cond = fMaster ? condMaster : condWorker;
-        std::vector<T> vChecks;
-        vChecks.reserve(nBatchSize);
-        unsigned int nNow = 0;
-        bool fOk = true;
-        do {
-            {
-                boost::unique_lock<boost::mutex> lock(mutex);
-                // first do the clean-up of the previous loop run (allowing us to do it in the same critsect)
-                if (nNow) {
-                    fAllOk &= fOk;
-                    nTodo -= nNow;
-                    if (nTodo == 0 && !fMaster)
-                        // We processed the last element; inform the master it can exit and return the result
-                        condMaster.notify_one();
-                } else {
-                    // first iteration
-                    nTotal++;
-                }
-                // logically, the do loop starts here
-                while (queue.empty()) {
-                    if (fMaster && nTodo == 0) {
-                        nTotal--;
-                        bool fRet = fAllOk;
-                        // reset the status for new work later
-                        fAllOk = true;
-                        // return the current status
-                        return fRet;
-                    }
-                    nIdle++;
-                    cond.wait(lock); // wait
-                    nIdle--;
-                }
-                // Decide how many work units to process now.
-                // * Do not try to do everything at once, but aim for increasingly smaller batches so
-                //   all workers finish approximately simultaneously.
-                // * Try to account for idle jobs which will instantly start helping.
-                // * Don't do batches smaller than 1 (duh), or larger than nBatchSize.
-                nNow = std::max(1U, std::min(nBatchSize, (unsigned int)queue.size() / (nTotal + nIdle + 1)));
-                vChecks.resize(nNow);
-                for (unsigned int i = 0; i < nNow; i++) {
-                    // We want the lock on the mutex to be as short as possible, so swap jobs from the global
-                    // queue to the local batch vector instead of copying.
-                    vChecks[i].swap(queue.back());
-                    queue.pop_back();
-                }
-                // Check whether we need to do work at all
-                fOk = fAllOk;
+        const size_t index = pos - m_start.load(std::memory_order_relaxed);
+        return m_chunks[index / CHUNK_SIZE][index % CHUNK_SIZE];
+    }
+
+    bool HasWork() const
+    {
+        return m_claimed.load() < m_published.load();
+    }
+
+    /** Take a range of checks nobody has claimed yet. Returns false if there is none. */
+    bool Claim(uint64_t& begin, uint64_t& end)
+    {
+        uint64_t claimed = m_claimed.load(std::memory_order_acquire);
+        while (true) {
+            const uint64_t published = m_published.load(std::memory_order_acquire);
+            if (claimed >= published) return false;
+            // Aim for increasingly smaller batches so all threads finish approximately
+            // simultaneously, but don't do batches smaller than 1 or larger than nBatchSize.
+            const uint64_t threads = std::max(1, m_total.load(std::memory_order_relaxed));
+            const uint64_t n = std::max<uint64_t>(1, std::min<uint64_t>(nBatchSize, (published - claimed) / (2 * threads)));
+            if (m_claimed.compare_exchange_weak(claimed, claimed + n, std::memory_order_acq_rel, std::memory_order_acquire)) {
+                begin = claimed;
+                end = claimed + n;
+                return true;
             }
-            // execute work
-            for (T& check : vChecks)
-                if (fOk)
-                    fOk = check();
-            vChecks.clear();
-        } while (true);
+        }
+    }
+
+    /** Run a claimed range of checks and release their resources. */
+    void Run(uint64_t begin, uint64_t end)
+    {
+        // Check whether we need to do work at all
+        bool fOk = m_all_ok.load(std::memory_order_relaxed);
+        for (uint64_t pos = begin; pos < end; ++pos) {
+            T& check = Slot(pos);
+            if (fOk) fOk = check();
+            // Free the check right away rather than when its slot is reused
+            T().swap(check);
+        }
+        if (!fOk) m_all_ok.store(false, std::memory_order_relaxed);
+
+        const uint64_t done = m_done.fetch_add(end - begin) + (end - begin);
+        if (m_master_sleeping.load() && done == m_published.load()) {
+            // We processed the last element; inform the master it can exit and return the result
+            boost::lock_guard<boost::mutex> lock(mutex);
+            condMaster.notify_one();
+        }
+    }
+
+    /** Poll for new work for a while. Returns whether there is some. */
+    bool Spin() const
+    {
+        for (int i = 0; i < SPIN_ROUNDS; ++i) {
+            if (HasWork()) return true;
+            std::this_thread::yield();
+        }
+        return HasWork();
     }
 
 public:
@@ -127,33 +155,103 @@ public:
     boost::mutex ControlMutex;
 
     //! Create a new check queue
-    explicit CCheckQueue(unsigned int nBatchSizeIn) : nIdle(0), nTotal(0), fAllOk(true), nTodo(0), nBatchSize(nBatchSizeIn) {}
+    explicit CCheckQueue(unsigned int nBatchSizeIn) : m_chunks(new std::unique_ptr<T[]>[MAX_CHUNKS]), nBatchSize(nBatchSizeIn) {}
 
     //! Worker thread
     void Thread()
     {
-        Loop();
+        m_total++;
+        try {
+            while (true) {
+                uint64_t begin, end;
+                if (Claim(begin, end)) {
+                    Run(begin, end);
+                    continue;
+                }
+                if (Spin()) continue;
+
+                boost::this_thread::interruption_point();
+                boost::unique_lock<boost::mutex> lock(mutex);
+                m_sleeping_workers++;
+                try {
+                    while (!HasWork()) {
+                        condWorker.wait(lock);
+                    }
+                } catch (...) {
+                    m_sleeping_workers--;
+                    throw;
+                }
+                m_sleeping_workers--;
+            }
+        } catch (...) {
+            m_total--;
+            throw;
+        }
     }
 
     //! Wait until execution finishes, and return whether all evaluations were successful.
     bool Wait()
     {
-        return Loop(true);
+        m_total++;
+        uint64_t begin, end;
+        while (Claim(begin, end)) {
+            Run(begin, end);
+        }
+        m_total--;
+
+        // Everything is claimed, wait for the workers still running checks
+        const uint64_t published = m_published.load(std::memory_order_relaxed);
+        for (int i = 0; i < SPIN_ROUNDS && m_done.load(std::memory_order_acquire) != published; ++i) {
+            std::this_thread::yield();
+        }
+        if (m_done.load(std::memory_order_acquire) != published) {
+            boost::unique_lock<boost::mutex> lock(mutex);
+            m_master_sleeping = true;
+            while (m_done.load() != published) {
+                condMaster.wait(lock);
+            }
+            m_master_sleeping = false;
+        }
+
+        const bool fRet = m_all_ok.load(std::memory_order_relaxed);
+        // reset the status for new work later
+        m_all_ok.store(true, std::memory_order_relaxed);
+        m_start.store(published, std::memory_order_relaxed);
+        return fRet;
     }
 
     //! Add a batch of checks to the queue
     void Add(std::vector<T>& vChecks)
     {
-        boost::unique_lock<boost::mutex> lock(mutex);
-        for (T& check : vChecks) {
-            queue.push_back(T());
-            check.swap(queue.back());
+        if (vChecks.empty()) return;
+
+        const uint64_t published = m_published.load(std::memory_order_relaxed);
+        size_t index = published - m_start.load(std::memory_order_relaxed);
+        size_t n = 0;
+        for (; n < vChecks.size() && index < MAX_CHUNKS * CHUNK_SIZE; ++n, ++index) {
+            if (index / CHUNK_SIZE == m_num_chunks) {
+                m_chunks[m_num_chunks++].reset(new T[CHUNK_SIZE]);
+            }
+            // Swap jobs into the storage instead of copying.
+            vChecks[n].swap(m_chunks[index / CHUNK_SIZE][index % CHUNK_SIZE]);
+        }
+        m_published.store(published + n);
+
+        if (m_sleeping_workers.load() > 0) {
+            boost::lock_guard<boost::mutex> lock(mutex);
+            if (n == 1)
+                condWorker.notify_one();
+            else
+                condWorker.notify_all();
+        }
+
+        // Out of storage, verify the remainder here
+        for (; n < vChecks.size(); ++n) {
+            if (m_all_ok.load(std::memory_order_relaxed) && !vChecks[n]()) {
+                m_all_ok.store(false, std::memory_order_relaxed);
+            }
+            T().swap(vChecks[n]);
         }
-        nTodo += vChecks.size();
-        if (vChecks.size() == 1)
-            condWorker.notify_one();
-        else if (vChecks.size() > 1)
-            condWorker.notify_all();
     }
 
     ~CCheckQueue()
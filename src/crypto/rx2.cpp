@@ -3,9 +3,101 @@
 #include "sync.h"
 #include "rx2.h"
 #include "RandomX/randomx.h"
+#include "RandomX/configuration.h"
+#include "crypto/sha256.h"
+#include "memusage.h"
+
+#include <atomic>
+#include <list>
+#include <map>
 
 static RecursiveMutex cs_randomx;
 
+/**
+ * Validation hashes of recently seen headers. The same header is checked
+ * from several places (header sync, block connection, RPC), usually from
+ * different threads, and each RandomX evaluation takes milliseconds.
+ * Entries are keyed by a SHA256 of everything the hash depends on, the
+ * hashed bytes and the seed, and evicted least recently used first.
+ */
+class RandomXHashCache
+{
+    Mutex cs;
+    std::list<std::pair<uint256, uint256>> m_lru GUARDED_BY(cs);
+    std::map<uint256, std::list<std::pair<uint256, uint256>>::iterator> m_entries GUARDED_BY(cs);
+    uint64_t m_hits GUARDED_BY(cs){0};
+    uint64_t m_misses GUARDED_BY(cs){0};
+
+public:
+    static uint256 Key(const char* data, int length, const uint256& seedhash)
+    {
+        uint256 key;
+        CSHA256().Write((const unsigned char*)data, length).Write(seedhash.begin(), seedhash.size()).Finalize(key.begin());
+        return key;
+    }
+
+    bool Get(const uint256& key, char* hash)
+    {
+        LOCK(cs);
+        auto it = m_entries.find(key);
+        if (it == m_entries.end()) {
+            ++m_misses;
+            return false;
+        }
+        ++m_hits;
+        m_lru.splice(m_lru.begin(), m_lru, it->second);
+        memcpy(hash, it->second->second.begin(), 32);
+        return true;
+    }
+
+    void Insert(const uint256& key, const char* hash)
+    {
+        LOCK(cs);
+        if (m_entries.count(key)) return;
+        uint256 value;
+        memcpy(value.begin(), hash, 32);
+        m_lru.emplace_front(key, value);
+        m_entries.emplace(key, m_lru.begin());
+        if (m_entries.size() > RANDOMX_HASH_CACHE_ENTRIES) {
+            m_entries.erase(m_lru.back().first);
+            m_lru.pop_back();
+        }
+    }
+
+    RandomXHashCacheStats GetStats()
+    {
+        LOCK(cs);
+        RandomXHashCacheStats stats;
+        stats.entries = m_entries.size();
+        stats.hits = m_hits;
+        stats.misses = m_misses;
+        return stats;
+    }
+
+    size_t DynamicMemoryUsage()
+    {
+        LOCK(cs);
+        // List nodes hold the entry and two links
+        return memusage::DynamicUsage(m_entries) + m_lru.size() * memusage::MallocUsage(sizeof(std::pair<uint256, uint256>) + 2 * sizeof(void*));
+    }
+};
+
+static RandomXHashCache g_hash_cache;
+
+//! Light caches allocated by rx_slow_hash and rx_slow_hash2, each with a VM
+static std::atomic<size_t> g_randomx_instances{0};
+
+RandomXHashCacheStats GetRandomXHashCacheStats()
+{
+    return g_hash_cache.GetStats();
+}
+
+size_t GetRandomXMemoryUsage()
+{
+    const size_t instance = (size_t)RANDOMX_ARGON_MEMORY * 1024 + RANDOMX_SCRATCHPAD_L3;
+    return g_randomx_instances * instance + g_hash_cache.DynamicMemoryUsage();
+}
+
 
 void rx_slow_hash(const char* data, char* hash, int length, uint256 seedhash)
 {
@@ -25,6 +117,7 @@ void rx_slow_hash(const char* data, char* hash, int length, uint256 seedhash)
     if (!cache) {
         flags = randomx_get_flags();
         cache = randomx_alloc_cache(flags);
+        ++g_randomx_instances;
        
         randomx_init_cache(cache, randomx_seed2.GetHex().c_str(), randomx_seed2.GetHex().size());
     }
@@ -53,6 +146,10 @@ void rx_slow_hash(const char* data, char* hash, int length, uint256 seedhash)
 
 void rx_slow_hash2(const char* data, char* hash, int length, uint256 seedhash)
 {
+    // Cache hits don't wait for other threads' RandomX evaluations
+    const uint256 key = RandomXHashCache::Key(data, length, seedhash);
+    if (g_hash_cache.Get(key, hash)) return;
+
         ENTER_CRITICAL_SECTION(cs_randomx) 
 
     static bool is_init; // = false;
@@ -61,8 +158,6 @@ void rx_slow_hash2(const char* data, char* hash, int length, uint256 seedhash)
     static randomx_flags flags;
     static randomx_vm *rx_vm; // = nullptr;
     static randomx_cache *cache; // = nullptr;
-    static char old_data[288];
-    static char old_hash[64];
 
  
     if (!is_init) {
@@ -70,6 +165,7 @@ void rx_slow_hash2(const char* data, char* hash, int length, uint256 seedhash)
     if (!cache) {
         flags = randomx_get_flags();
         cache = randomx_alloc_cache(flags);
+        ++g_randomx_instances;
        
         randomx_init_cache(cache, randomx_seed2.GetHex().c_str(), randomx_seed2.GetHex().size());
         is_init = true;
@@ -93,15 +189,10 @@ void rx_slow_hash2(const char* data, char* hash, int length, uint256 seedhash)
 
     }   
 
-    if (memcmp(data,old_data,144)==0) {            
-    memcpy(hash,old_hash,32);
-    }
-    else { 
     randomx_calculate_hash(rx_vm, data, length, hash);
-    memcpy(old_data,data,144);
-    memcpy(old_hash,hash,32);
-    }
         LEAVE_CRITICAL_SECTION(cs_randomx) 
+
+    g_hash_cache.Insert(key, hash);
 }
 
 
@@ -8,4 +8,19 @@ extern CChain chainActive;
 //void randomx_init();
 //void randomx_reinit();
 void rx_slow_hash(const char* data, char* hash, int length, uint256 seedhash);
+/** Hash for validation; results are kept in a cache shared by all threads */
 void rx_slow_hash2(const char* data, char* hash, int length, uint256 seedhash);
+
+/** Number of validation hashes to keep, a few days of headers */
+static const size_t RANDOMX_HASH_CACHE_ENTRIES = 4096;
+
+struct RandomXHashCacheStats {
+    size_t entries;
+    uint64_t hits;
+    uint64_t misses;
+};
+
+RandomXHashCacheStats GetRandomXHashCacheStats();
+
+/** Memory held by the RandomX light caches, their VMs and the validation hash cache */
+size_t GetRandomXMemoryUsage();
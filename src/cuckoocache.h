@@ -477,6 +477,22 @@ public:
             }
         return false;
     }
+
+    /** get_elements appends the elements which have not been collected to
+     * out, those of the current epoch first. Inserting them in reverse order
+     * into a fresh cache approximately restores this one.
+     *
+     * @param out the vector to append the elements to
+     */
+    void get_elements(std::vector<Element>& out) const
+    {
+        for (const bool recent : {true, false}) {
+            for (uint32_t i = 0; i < size; ++i) {
+                if (epoch_flags[i] == recent && !collection_flags.bit_is_set(i))
+                    out.push_back(table[i]);
+            }
+        }
+    }
 };
 } // namespace CuckooCache
 
@@ -11,10 +11,14 @@
 #include <validation.h>
 #include <warnings.h>
 
+#include <condition_variable>
+#include <deque>
+
 constexpr char DB_BEST_BLOCK = 'B';
 
 constexpr int64_t SYNC_LOG_INTERVAL = 30; // seconds
 constexpr int64_t SYNC_LOCATOR_WRITE_INTERVAL = 30; // seconds
+constexpr size_t SYNC_BLOCKS_PER_THREAD = 4; // blocks read ahead per sync worker
 
 template<typename... Args>
 static void FatalError(const char* fmt, const Args&... args)
@@ -85,11 +89,147 @@ static const CBlockIndex* NextSyncBlock(const CBlockIndex* pindex_prev) EXCLUSIV
     return ::ChainActive().Next(::ChainActive().FindFork(pindex_prev));
 }
 
+/**
+ * Reads blocks ahead of the index sync thread and runs PrepareBlock on them.
+ *
+ * Blocks are added in chain order and handed back in the same order, so the
+ * sync thread can keep writing them one at a time while the workers read
+ * and prepare the ones that follow.
+ */
+class BaseIndex::SyncWorkers
+{
+public:
+    struct Job {
+        const CBlockIndex* const pindex;
+        CBlock block;
+        std::unique_ptr<PreparedBlock> prepared;
+        bool done{false};
+        bool read_ok{false};
+        bool prepare_ok{false};
+
+        explicit Job(const CBlockIndex* pindex_in) : pindex(pindex_in) {}
+    };
+
+    SyncWorkers(BaseIndex& index, int n_threads) : m_index(index)
+    {
+        for (int i = 0; i < n_threads; ++i) {
+            m_threads.emplace_back([this, name = strprintf("%s.%d", m_index.GetName(), i)] {
+                TraceThread(name.c_str(), [this] { ThreadWork(); });
+            });
+        }
+    }
+
+    ~SyncWorkers()
+    {
+        {
+            LOCK(m_mutex);
+            m_stop = true;
+        }
+        m_work_cond.notify_all();
+        for (std::thread& thread : m_threads) {
+            thread.join();
+        }
+    }
+
+    size_t Size()
+    {
+        LOCK(m_mutex);
+        return m_jobs.size();
+    }
+
+    const CBlockIndex* Front()
+    {
+        LOCK(m_mutex);
+        return m_jobs.empty() ? nullptr : m_jobs.front()->pindex;
+    }
+
+    const CBlockIndex* Back()
+    {
+        LOCK(m_mutex);
+        return m_jobs.empty() ? nullptr : m_jobs.back()->pindex;
+    }
+
+    void Add(const CBlockIndex* pindex)
+    {
+        {
+            LOCK(m_mutex);
+            m_jobs.push_back(std::make_shared<Job>(pindex));
+            m_pending.push_back(m_jobs.back());
+        }
+        m_work_cond.notify_one();
+    }
+
+    /// Drop all queued blocks. Jobs already picked up by a worker are finished and discarded.
+    void Clear()
+    {
+        LOCK(m_mutex);
+        m_jobs.clear();
+        m_pending.clear();
+    }
+
+    /// Wait until the oldest queued block is prepared and remove it from the queue.
+    /// Returns nullptr if interrupted first.
+    std::shared_ptr<Job> PopFront(const CThreadInterrupt& interrupt)
+    {
+        WAIT_LOCK(m_mutex, lock);
+        assert(!m_jobs.empty());
+        while (!m_jobs.front()->done) {
+            if (interrupt) return nullptr;
+            m_done_cond.wait_for(lock, std::chrono::milliseconds(100));
+        }
+        std::shared_ptr<Job> job = std::move(m_jobs.front());
+        m_jobs.pop_front();
+        return job;
+    }
+
+private:
+    void ThreadWork()
+    {
+        const Consensus::Params& consensus_params = Params().GetConsensus();
+        while (true) {
+            std::shared_ptr<Job> job;
+            {
+                WAIT_LOCK(m_mutex, lock);
+                m_work_cond.wait(lock, [this] { return m_stop || !m_pending.empty(); });
+                if (m_stop) return;
+                job = std::move(m_pending.front());
+                m_pending.pop_front();
+            }
+
+            job->read_ok = ReadBlockFromDisk(job->block, job->pindex, consensus_params);
+            job->prepare_ok = job->read_ok && m_index.PrepareBlock(job->block, job->pindex, job->prepared);
+
+            {
+                LOCK(m_mutex);
+                job->done = true;
+            }
+            m_done_cond.notify_all();
+        }
+    }
+
+    BaseIndex& m_index;
+    Mutex m_mutex;
+    std::condition_variable m_work_cond;
+    std::condition_variable m_done_cond;
+    //! Blocks handed out to the workers and not yet taken by the sync thread, in chain order
+    std::deque<std::shared_ptr<Job>> m_jobs GUARDED_BY(m_mutex);
+    //! Blocks not yet picked up by a worker
+    std::deque<std::shared_ptr<Job>> m_pending GUARDED_BY(m_mutex);
+    bool m_stop GUARDED_BY(m_mutex){false};
+    std::vector<std::thread> m_threads;
+};
+
 void BaseIndex::ThreadSync()
 {
     const CBlockIndex* pindex = m_best_block_index.load();
     if (!m_synced) {
-        auto& consensus_params = Params().GetConsensus();
+        int n_threads = gArgs.GetArg("-indexsyncthreads", DEFAULT_INDEX_SYNC_THREADS);
+        if (n_threads <= 0) {
+            n_threads = GetNumCores();
+        }
+        n_threads = std::max(1, std::min(n_threads, MAX_INDEX_SYNC_THREADS));
+        const size_t max_blocks_ahead = n_threads * SYNC_BLOCKS_PER_THREAD;
+        SyncWorkers workers(*this, n_threads);
 
         int64_t last_log_time = 0;
         int64_t last_locator_write_time = 0;
@@ -103,9 +243,10 @@ void BaseIndex::ThreadSync()
                 return;
             }
 
+            const CBlockIndex* pindex_next;
             {
                 LOCK(cs_main);
-                const CBlockIndex* pindex_next = NextSyncBlock(pindex);
+                pindex_next = NextSyncBlock(pindex);
                 if (!pindex_next) {
                     m_best_block_index = pindex;
                     m_synced = true;
@@ -118,8 +259,35 @@ void BaseIndex::ThreadSync()
                                __func__, GetName());
                     return;
                 }
-                pindex = pindex_next;
+
+                // Keep the workers busy with the blocks that follow on the active chain. After a
+                // reorg the blocks read ahead are not the ones needed anymore, so start over.
+                if (workers.Front() != pindex_next) {
+                    workers.Clear();
+                }
+                const CBlockIndex* pindex_ahead = workers.Size() ? ::ChainActive().Next(workers.Back()) : pindex_next;
+                while (pindex_ahead && workers.Size() < max_blocks_ahead) {
+                    workers.Add(pindex_ahead);
+                    pindex_ahead = ::ChainActive().Next(pindex_ahead);
+                }
+            }
+
+            std::shared_ptr<SyncWorkers::Job> job = workers.PopFront(m_interrupt);
+            if (!job) {
+                // Interrupted, handled at the top of the loop
+                continue;
             }
+            if (!job->read_ok) {
+                FatalError("%s: Failed to read block %s from disk",
+                           __func__, pindex_next->GetBlockHash().ToString());
+                return;
+            }
+            if (!job->prepare_ok || !WritePreparedBlock(job->block, pindex_next, job->prepared.get())) {
+                FatalError("%s: Failed to write block %s to index database",
+                           __func__, pindex_next->GetBlockHash().ToString());
+                return;
+            }
+            pindex = pindex_next;
 
             int64_t current_time = GetTime();
             if (last_log_time + SYNC_LOG_INTERVAL < current_time) {
@@ -134,18 +302,6 @@ void BaseIndex::ThreadSync()
                 // No need to handle errors in Commit. See rationale above.
                 Commit();
             }
-
-            CBlock block;
-            if (!ReadBlockFromDisk(block, pindex, consensus_params)) {
-                FatalError("%s: Failed to read block %s from disk",
-                           __func__, pindex->GetBlockHash().ToString());
-                return;
-            }
-            if (!WriteBlock(block, pindex)) {
-                FatalError("%s: Failed to write block %s to index database",
-                           __func__, pindex->GetBlockHash().ToString());
-                return;
-            }
         }
     }
 
@@ -156,6 +312,12 @@ void BaseIndex::ThreadSync()
     }
 }
 
+bool BaseIndex::WriteBlock(const CBlock& block, const CBlockIndex* pindex)
+{
+    std::unique_ptr<PreparedBlock> prepared;
+    return PrepareBlock(block, pindex, prepared) && WritePreparedBlock(block, pindex, prepared.get());
+}
+
 bool BaseIndex::Commit()
 {
     CDBBatch batch(GetDB());
@@ -13,6 +13,11 @@
 
 class CBlockIndex;
 
+/** Number of threads preparing blocks during index catch-up sync, 0 = one per core */
+static const int DEFAULT_INDEX_SYNC_THREADS = 0;
+/** Maximum number of index catch-up sync threads */
+static const int MAX_INDEX_SYNC_THREADS = 8;
+
 /**
  * Base class for indices of blockchain data. This implements
  * CValidationInterface and ensures blocks are indexed sequentially according
@@ -46,11 +51,18 @@ private:
     std::thread m_thread_sync;
     CThreadInterrupt m_interrupt;
 
+    /// Pool of threads reading and preparing blocks ahead of ThreadSync.
+    class SyncWorkers;
+
     /// Sync the index with the block index starting from the current best block.
     /// Intended to be run in its own thread, m_thread_sync, and can be
     /// interrupted with m_interrupt. Once the index gets in sync, the m_synced
     /// flag is set and the BlockConnected ValidationInterface callback takes
     /// over and the sync thread exits.
+    ///
+    /// Blocks ahead of the best block are read and passed through PrepareBlock
+    /// by a pool of worker threads, while this thread writes them to the index
+    /// strictly in chain order.
     void ThreadSync();
 
     /// Write the current index state (eg. chain block locator and subclass-specific items) to disk.
@@ -71,8 +83,24 @@ protected:
     /// Initialize internal state from the database and block index.
     virtual bool Init();
 
+    /// Output of PrepareBlock, handed back to WritePreparedBlock.
+    struct PreparedBlock {
+        virtual ~PreparedBlock() {}
+    };
+
+    /// Do the part of indexing a block that does not depend on the index
+    /// state, such as reading undo data or building a filter. During catch-up
+    /// sync this runs on worker threads, concurrently for several blocks and
+    /// ahead of the block being written, so it must not touch the index
+    /// database or any other state shared with WritePreparedBlock.
+    virtual bool PrepareBlock(const CBlock& block, const CBlockIndex* pindex, std::unique_ptr<PreparedBlock>& prepared) { return true; }
+
+    /// Write update index entries for a newly connected block, given the
+    /// result of PrepareBlock for it. Blocks are always written in chain order.
+    virtual bool WritePreparedBlock(const CBlock& block, const CBlockIndex* pindex, const PreparedBlock* prepared) { return true; }
+
     /// Write update index entries for a newly connected block.
-    virtual bool WriteBlock(const CBlock& block, const CBlockIndex* pindex) { return true; }
+    bool WriteBlock(const CBlock& block, const CBlockIndex* pindex);
 
     /// Virtual method called internally by Commit that can be overridden to atomically
     /// commit more index state.
@@ -106,6 +134,8 @@ public:
 
     /// Stops the instance from staying in sync with blockchain updates.
     void Stop();
+
+    std::string GetValidationQueueName() const override { return GetName(); }
 };
 
 #endif // BITCOIN_INDEX_BASE_H
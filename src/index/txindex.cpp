@@ -3,6 +3,8 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include <index/txindex.h>
+
+#include <chainparams.h>
 #include <shutdown.h>
 #include <ui_interface.h>
 #include <util/system.h>
@@ -219,18 +221,33 @@ bool TxIndex::Init()
     return BaseIndex::Init();
 }
 
-bool TxIndex::WriteBlock(const CBlock& block, const CBlockIndex* pindex)
+struct TxIndex::PreparedTxs : public BaseIndex::PreparedBlock {
+    std::vector<std::pair<uint256, CDiskTxPos>> vPos;
+};
+
+bool TxIndex::PrepareBlock(const CBlock& block, const CBlockIndex* pindex, std::unique_ptr<PreparedBlock>& prepared)
 {
-    // Exclude genesis block transaction because outputs are not spendable.
-    if (pindex->nHeight == 0) return true;
+    auto prepared_txs = MakeUnique<PreparedTxs>();
 
-    CDiskTxPos pos(pindex->GetBlockPos(), GetSizeOfCompactSize(block.vtx.size()));
-    std::vector<std::pair<uint256, CDiskTxPos>> vPos;
-    vPos.reserve(block.vtx.size());
-    for (const auto& tx : block.vtx) {
-        vPos.emplace_back(tx->GetHash(), pos);
-        pos.nTxOffset += ::GetSerializeSize(*tx, CLIENT_VERSION);
+    // Exclude genesis block transaction because outputs are not spendable.
+    if (pindex->nHeight > 0) {
+        CDiskTxPos pos(pindex->GetBlockPos(), GetSizeOfCompactSize(block.vtx.size()));
+        std::vector<std::pair<uint256, CDiskTxPos>>& vPos = prepared_txs->vPos;
+        vPos.reserve(block.vtx.size());
+        for (const auto& tx : block.vtx) {
+            vPos.emplace_back(tx->GetHash(), pos);
+            pos.nTxOffset += ::GetSerializeSize(*tx, CLIENT_VERSION);
+        }
     }
+
+    prepared = std::move(prepared_txs);
+    return true;
+}
+
+bool TxIndex::WritePreparedBlock(const CBlock& block, const CBlockIndex* pindex, const PreparedBlock* prepared)
+{
+    const auto& vPos = static_cast<const PreparedTxs*>(prepared)->vPos;
+    if (vPos.empty()) return true;
     return m_db->WriteTxs(vPos);
 }
 
@@ -243,17 +260,33 @@ bool TxIndex::FindTx(const uint256& tx_hash, uint256& block_hash, CTransactionRe
         return false;
     }
 
-    CAutoFile file(OpenBlockFile(postx, true), SER_DISK, CLIENT_VERSION);
+    // Open at the record header, to tell compressed frames apart
+    FlatFilePos hpos = postx;
+    hpos.nPos -= 8;
+    CAutoFile file(OpenBlockFile(hpos, true), SER_DISK, CLIENT_VERSION);
     if (file.IsNull()) {
         return error("%s: OpenBlockFile failed", __func__);
     }
     CBlockHeader header;
     try {
-        file >> header;
-        if (fseek(file.Get(), postx.nTxOffset, SEEK_CUR)) {
-            return error("%s: fseek(...) failed", __func__);
+        CMessageHeader::MessageStartChars start;
+        unsigned int nSize;
+        file >> start >> nSize;
+        if (nSize & BLOCK_FRAME_COMPRESSED) {
+            // Compressed blocks can only be read whole
+            std::vector<uint8_t> block;
+            if (!ReadRawBlockFromDisk(block, postx, Params().MessageStart())) {
+                return false;
+            }
+            VectorReader(SER_DISK, CLIENT_VERSION, block, 0) >> header;
+            VectorReader(SER_DISK, CLIENT_VERSION, block, ::GetSerializeSize(header, CLIENT_VERSION) + postx.nTxOffset) >> tx;
+        } else {
+            file >> header;
+            if (fseek(file.Get(), postx.nTxOffset, SEEK_CUR)) {
+                return error("%s: fseek(...) failed", __func__);
+            }
+            file >> tx;
         }
-        file >> tx;
     } catch (const std::exception& e) {
         return error("%s: Deserialize or I/O error - %s", __func__, e.what());
     }
@@ -22,11 +22,15 @@ protected:
 private:
     const std::unique_ptr<DB> m_db;
 
+    struct PreparedTxs;
+
 protected:
     /// Override base class init to migrate from old database.
     bool Init() override;
 
-    bool WriteBlock(const CBlock& block, const CBlockIndex* pindex) override;
+    bool PrepareBlock(const CBlock& block, const CBlockIndex* pindex, std::unique_ptr<PreparedBlock>& prepared) override;
+
+    bool WritePreparedBlock(const CBlock& block, const CBlockIndex* pindex, const PreparedBlock* prepared) override;
 
     BaseIndex::DB& GetDB() const override;
 
@@ -17,6 +17,7 @@
 #include <chainparams.h>
 #include <compat/sanity.h>
 #include <consensus/validation.h>
+#include <crypto/rx2.h>
 #include <fs.h>
 #include <httprpc.h>
 #include <httpserver.h>
@@ -25,6 +26,7 @@
 #include <interfaces/chain.h>
 #include <key.h>
 #include <logging.h>
+#include <memusage.h>
 #include <miner.h>
 #include <net.h>
 #include <net_permissions.h>
@@ -43,6 +45,7 @@
 #include <script/sigcache.h>
 #include <script/standard.h>
 #include <shutdown.h>
+#include <stratum.h>
 #include <timedata.h>
 #include <torcontrol.h>
 #include <txdb.h>
@@ -50,6 +53,7 @@
 #include <ui_interface.h>
 #include <util/asmap.h>
 #include <util/convert.h>
+#include <util/memoryusage.h>
 #include <util/moneystr.h>
 #include <util/system.h>
 #include <util/threadnames.h>
@@ -59,6 +63,10 @@
 
 
 #include <validationinterface.h>
+#include <validationprofile.h>
+#include <qtum/contractprofile.h>
+#include <qtum/precompiles.h>
+#include <qtum/trienodecache.h>
 #ifdef ENABLE_WALLET
 #include <wallet/wallet.h>
 #endif
@@ -92,6 +100,8 @@ static bool fFeeEstimatesInitialized = false;
 static const bool DEFAULT_PROXYRANDOMIZE = true;
 static const bool DEFAULT_REST_ENABLE = false;
 static const bool DEFAULT_STOPAFTERBLOCKIMPORT = false;
+static const int DEFAULT_SCHEDULER_THREADS = 2;
+static const int MAX_SCHEDULER_THREADS = 16;
 
 #ifdef WIN32
 // Win32 LevelDB doesn't use filedescriptors, and the ones used for
@@ -167,6 +177,7 @@ void Interrupt(NodeContext& node)
     InterruptRPC();
     InterruptREST();
     InterruptTorControl();
+    InterruptStratumServer();
     InterruptMapPort();
     if (node.connman)
         node.connman->Interrupt();
@@ -228,6 +239,7 @@ void Shutdown(NodeContext& node)
     }
 
     StopTorControl();
+    StopStratumServer();
 
     // After everything has been shut down, but before things get flushed, stop the
     // CScheduler/checkqueue threadGroup
@@ -243,6 +255,7 @@ void Shutdown(NodeContext& node)
 
     if (::mempool.IsLoaded() && gArgs.GetArg("-persistmempool", DEFAULT_PERSIST_MEMPOOL)) {
         DumpMempool(::mempool);
+        DumpValidationCaches();
     }
 
     if (fFeeEstimatesInitialized)
@@ -326,6 +339,7 @@ void Shutdown(NodeContext& node)
     }
 
     LogPrintf("%s: done\n", __func__);
+    LogInstance().StopAsyncLogging();
 }
 
 /**
@@ -404,6 +418,7 @@ void SetupServerArgs()
 #if HAVE_SYSTEM
     gArgs.AddArg("-blocknotify=<cmd>", "Execute command when the best block changes (%s in cmd is replaced by block hash)", ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
 #endif
+    gArgs.AddArg("-blockcompression", strprintf("Compress new blocks and undo data on disk where that saves space. Block files written with this can not be read by earlier versions (default: %u)", DEFAULT_BLOCK_COMPRESSION), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     gArgs.AddArg("-blockreconstructionextratxn=<n>", strprintf("Extra transactions to keep in memory for compact block reconstructions (default: %u)", DEFAULT_BLOCK_RECONSTRUCTION_EXTRA_TXN), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     gArgs.AddArg("-blocksonly", strprintf("Whether to reject transactions from network peers. Automatic broadcast and rebroadcast of any transactions from inbound peers is disabled, unless '-whitelistforcerelay' is '1', in which case whitelisted peers' transactions will be relayed. RPC transactions are not affected. (default: %u)", DEFAULT_BLOCKSONLY), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     gArgs.AddArg("-conf=<file>", strprintf("Specify configuration file. Relative paths will be prefixed by datadir location. (default: %s)", BITCOIN_CONF_FILENAME), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
@@ -412,15 +427,18 @@ void SetupServerArgs()
     gArgs.AddArg("-dbcache=<n>", strprintf("Maximum database cache size <n> MiB (%d to %d, default: %d). In addition, unused mempool memory is shared for this cache (see -maxmempool).", nMinDbCache, nMaxDbCache, nDefaultDbCache), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     gArgs.AddArg("-debuglogfile=<file>", strprintf("Specify location of debug log file. Relative paths will be prefixed by a net-specific datadir location. (-nodebuglogfile to disable; default: %s)", DEFAULT_DEBUGLOGFILE), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     gArgs.AddArg("-feefilter", strprintf("Tell other nodes to filter invs to us by our mempool min fee (default: %u)", DEFAULT_FEEFILTER), ArgsManager::ALLOW_ANY | ArgsManager::DEBUG_ONLY, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-importbuffer=<n>", strprintf("Memory in MiB for blocks read ahead by -reindex and -loadblock, and as much again for blocks they find out of order (default: %u)", DEFAULT_IMPORT_BUFFER), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     gArgs.AddArg("-includeconf=<file>", "Specify additional configuration file, relative to the -datadir path (only useable from configuration file, not command line)", ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-indexsyncthreads=<n>", strprintf("Set the number of threads reading and preparing blocks while -txindex or -blockfilterindex catch up with the block chain (0 = one per core, up to %d, default: %d)", MAX_INDEX_SYNC_THREADS, DEFAULT_INDEX_SYNC_THREADS), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     gArgs.AddArg("-loadblock=<file>", "Imports blocks from external file on startup", ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     gArgs.AddArg("-maxmempool=<n>", strprintf("Keep the transaction memory pool below <n> megabytes (default: %u)", DEFAULT_MAX_MEMPOOL_SIZE), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     gArgs.AddArg("-maxorphantx=<n>", strprintf("Keep at most <n> unconnectable transactions in memory (default: %u)", DEFAULT_MAX_ORPHAN_TRANSACTIONS), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-mempoolchangelog=<n>", strprintf("Keep the last <n> mempool additions and removals for getmempooldelta, about 48 bytes each (default: %u)", DEFAULT_MEMPOOL_CHANGE_LOG), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     gArgs.AddArg("-mempoolexpiry=<n>", strprintf("Do not keep transactions in the mempool longer than <n> hours (default: %u)", DEFAULT_MEMPOOL_EXPIRY), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     gArgs.AddArg("-minimumchainwork=<hex>", strprintf("Minimum work assumed to exist on a valid chain in hex (default: %s, testnet: %s)", defaultChainParams->GetConsensus().nMinimumChainWork.GetHex(), testnetChainParams->GetConsensus().nMinimumChainWork.GetHex()), ArgsManager::ALLOW_ANY | ArgsManager::DEBUG_ONLY, OptionsCategory::OPTIONS);
     gArgs.AddArg("-par=<n>", strprintf("Set the number of script verification threads (%u to %d, 0 = auto, <0 = leave that many cores free, default: %d)",
         -GetNumCores(), MAX_SCRIPTCHECK_THREADS, DEFAULT_SCRIPTCHECK_THREADS), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
-    gArgs.AddArg("-persistmempool", strprintf("Whether to save the mempool on shutdown and load on restart (default: %u)", DEFAULT_PERSIST_MEMPOOL), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-persistmempool", strprintf("Whether to save the mempool and the signature caches on shutdown and load them on restart (default: %u)", DEFAULT_PERSIST_MEMPOOL), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     gArgs.AddArg("-pid=<file>", strprintf("Specify pid file. Relative paths will be prefixed by a net-specific datadir location. (default: %s)", BITCOIN_PID_FILENAME), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     gArgs.AddArg("-prune=<n>", strprintf("Reduce storage requirements by enabling pruning (deleting) of old blocks. This allows the pruneblockchain RPC to be called to delete specific blocks, and enables automatic pruning of old blocks if a target size in MiB is provided. This mode is incompatible with -txindex and -rescan. "
             "Warning: Reverting this setting requires re-downloading the entire blockchain. "
@@ -428,18 +446,23 @@ void SetupServerArgs()
     gArgs.AddArg("-reindex", "Rebuild chain state and block index from the blk*.dat files on disk", ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     gArgs.AddArg("-reindex-chainstate", "Rebuild chain state from the currently indexed blocks. When in pruning mode or if blocks on disk might be corrupted, use full -reindex instead.", ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     gArgs.AddArg("-record-log-opcodes", "Logs all EVM LOG opcode operations to the file vmExecLogs.json", ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-schedulerthreads=<n>", strprintf("Set the number of background scheduler threads that run validation notifications for wallets, indexes and zmq in parallel (1 to %d, default: %d)", MAX_SCHEDULER_THREADS, DEFAULT_SCHEDULER_THREADS), ArgsManager::ALLOW_ANY | ArgsManager::DEBUG_ONLY, OptionsCategory::OPTIONS);
 #ifndef WIN32
     gArgs.AddArg("-sysperms", "Create new files with system default permissions, instead of umask 077 (only effective with disabled wallet functionality)", ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
 #else
     hidden_args.emplace_back("-sysperms");
 #endif
+    gArgs.AddArg("-trienodecache=<n>", strprintf("Maximum size of the cache of EVM state and contract UTXO trie nodes in MiB, kept across state root changes (0 to disable, default: %d)", DEFAULT_TRIE_NODE_CACHE_SIZE), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     gArgs.AddArg("-txindex", strprintf("Maintain a full transaction index, used by the getrawtransaction rpc call (default: %u)", DEFAULT_TXINDEX), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     gArgs.AddArg("-blockfilterindex=<type>",
                  strprintf("Maintain an index of compact filters by block (default: %s, values: %s).", DEFAULT_BLOCKFILTERINDEX, ListBlockFilterTypes()) +
                  " If <type> is not supplied or if <type> = 1, indexes for all known types are enabled.",
                  ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     gArgs.AddArg("-logevents", strprintf("Maintain a full EVM log index, used by searchlogs and gettransactionreceipt rpc calls (default: %u)", DEFAULT_LOGEVENTS), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-logeventsretain=<n>", strprintf("With -logevents, keep the receipts and log events of only the last <n> blocks and delete older ones in the background (default: %u = keep all, minimum %u otherwise). Incompatible with -superstaking", DEFAULT_LOGEVENTS_RETAIN, MIN_BLOCKS_TO_KEEP), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-logeventsretainheight=<n>", "With -logevents, delete the receipts and log events of the blocks below height <n> in the background (default: 0 = keep all). Incompatible with -superstaking", ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     gArgs.AddArg("-addrindex", strprintf("Maintain a full address index (default: %u)", DEFAULT_ADDRINDEX), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-contractindex", strprintf("Maintain an index of deployed contracts, used by the listcontracts and getaccountinfo rpc calls (default: %u)", DEFAULT_CONTRACTINDEX), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     gArgs.AddArg("-deleteblockchaindata", "Delete the local copy of the block chain data", ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     gArgs.AddArg("-forceinitialblocksdownloadmode", strprintf("Force initial blocks download mode for the node (default: %u)", DEFAULT_FORCE_INITIAL_BLOCKS_DOWNLOAD_MODE), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
 
@@ -520,7 +543,10 @@ void SetupServerArgs()
     hidden_args.emplace_back("-zmqpubrawtxhwm=<n>");
 #endif
 
+    gArgs.AddArg("-blockprofilesize=<n>", strprintf("Keep per-phase validation timings of the last <n> connected blocks for getblockprofile and getvalidationprofile (default: %u, 0 = disabled)", DEFAULT_BLOCK_PROFILE_SIZE), ArgsManager::ALLOW_ANY | ArgsManager::DEBUG_ONLY, OptionsCategory::DEBUG_TEST);
+    gArgs.AddArg("-contractprofile=<n>", strprintf("Profile gas, execution time and storage access of one in <n> contract executions for getcontractprofile (default: %u, 0 = disabled)", DEFAULT_CONTRACT_PROFILE_RATE), ArgsManager::ALLOW_ANY | ArgsManager::DEBUG_ONLY, OptionsCategory::DEBUG_TEST);
     gArgs.AddArg("-checkblocks=<n>", strprintf("How many blocks to check at startup (default: %u, 0 = all)", DEFAULT_CHECKBLOCKS), ArgsManager::ALLOW_ANY | ArgsManager::DEBUG_ONLY, OptionsCategory::DEBUG_TEST);
+    gArgs.AddArg("-backgroundverifydb", strprintf("Run the -checkblocks verification in a low-priority background thread against a snapshot of the chain tip instead of blocking startup (default: %u)", DEFAULT_BACKGROUND_VERIFYDB), ArgsManager::ALLOW_ANY | ArgsManager::DEBUG_ONLY, OptionsCategory::DEBUG_TEST);
     gArgs.AddArg("-checklevel=<n>", strprintf("How thorough the block verification of -checkblocks is: "
         "level 0 reads the blocks from disk, "
         "level 1 verifies block validity, "
@@ -544,7 +570,11 @@ void SetupServerArgs()
     gArgs.AddArg("-debug=<category>", "Output debugging information (default: -nodebug, supplying <category> is optional). "
         "If <category> is not supplied or if <category> = 1, output all debugging information. <category> can be: " + ListLogCategories() + ".", ArgsManager::ALLOW_ANY, OptionsCategory::DEBUG_TEST);
     gArgs.AddArg("-debugexclude=<category>", strprintf("Exclude debugging information for a category. Can be used in conjunction with -debug=1 to output debug logs for all categories except one or more specified categories."), ArgsManager::ALLOW_ANY, OptionsCategory::DEBUG_TEST);
+    gArgs.AddArg("-lockstats", strprintf("Collect lock contention statistics, see the getlockstats RPC (default: %u)", DEFAULT_LOCK_STATS), ArgsManager::ALLOW_ANY | ArgsManager::DEBUG_ONLY, OptionsCategory::DEBUG_TEST);
     gArgs.AddArg("-logips", strprintf("Include IP addresses in debug output (default: %u)", DEFAULT_LOGIPS), ArgsManager::ALLOW_ANY, OptionsCategory::DEBUG_TEST);
+    gArgs.AddArg("-logasync", strprintf("Write the debug log files from a background thread through a bounded queue; messages are dropped and counted when it is full (default: %u)", DEFAULT_LOGASYNC), ArgsManager::ALLOW_ANY | ArgsManager::DEBUG_ONLY, OptionsCategory::DEBUG_TEST);
+    gArgs.AddArg("-logasyncbuffer=<n>", strprintf("Number of messages the -logasync queue can hold (default: %u)", DEFAULT_LOGASYNC_BUFFER), ArgsManager::ALLOW_ANY | ArgsManager::DEBUG_ONLY, OptionsCategory::DEBUG_TEST);
+    gArgs.AddArg("-logfsync=<n>", strprintf("With -logasync, flush the debug log files to disk at most every <n> seconds (0 = leave it to the OS, default: %u)", DEFAULT_LOGFSYNC_INTERVAL), ArgsManager::ALLOW_ANY | ArgsManager::DEBUG_ONLY, OptionsCategory::DEBUG_TEST);
     gArgs.AddArg("-logtimestamps", strprintf("Prepend debug output with timestamp (default: %u)", DEFAULT_LOGTIMESTAMPS), ArgsManager::ALLOW_ANY, OptionsCategory::DEBUG_TEST);
 #ifdef HAVE_THREAD_LOCAL
     gArgs.AddArg("-logthreadnames", strprintf("Prepend debug output with name of the originating thread (only available on platforms supporting thread_local) (default: %u)", DEFAULT_LOGTHREADNAMES), ArgsManager::ALLOW_ANY, OptionsCategory::DEBUG_TEST);
@@ -597,6 +627,11 @@ void SetupServerArgs()
     gArgs.AddArg("-staker-soft-block-gas-limit=<n>", "After this amount of gas is surpassed in a block, no more contract executions will be added to the block (defaults to consensus-critical maximum block gas limit)", ArgsManager::ALLOW_ANY, OptionsCategory::BLOCK_CREATION);
     gArgs.AddArg("-aggressive-staking", "Check more often to publish immediately when valid block is found.", ArgsManager::ALLOW_ANY, OptionsCategory::BLOCK_CREATION);
     gArgs.AddArg("-emergencystaking", "Emergency staking without blockchain synchronization.", ArgsManager::ALLOW_ANY, OptionsCategory::BLOCK_CREATION);
+    gArgs.AddArg("-stratum", strprintf("Accept Stratum connections from proof-of-work miners (default: %u)", DEFAULT_STRATUM_ENABLE), ArgsManager::ALLOW_ANY, OptionsCategory::BLOCK_CREATION);
+    gArgs.AddArg("-stratumaddress=<address>", "Address the blocks found by Stratum miners pay to (required with -stratum)", ArgsManager::ALLOW_ANY, OptionsCategory::BLOCK_CREATION);
+    gArgs.AddArg("-stratumbind=<addr>[:port]", strprintf("Bind to given address to listen for Stratum connections. Port is optional and overrides -stratumport. Use [host]:port notation for IPv6. Do not expose the Stratum server to untrusted networks (default: %s)", DEFAULT_STRATUM_BIND), ArgsManager::ALLOW_ANY, OptionsCategory::BLOCK_CREATION);
+    gArgs.AddArg("-stratumdifficulty=<n>", strprintf("Share difficulty for Stratum miners, the expected number of hashes per share (default: %u)", DEFAULT_STRATUM_DIFFICULTY), ArgsManager::ALLOW_ANY, OptionsCategory::BLOCK_CREATION);
+    gArgs.AddArg("-stratumport=<port>", strprintf("Listen for Stratum connections on <port> (default: %u)", DEFAULT_STRATUM_PORT), ArgsManager::ALLOW_ANY, OptionsCategory::BLOCK_CREATION);
 
     gArgs.AddArg("-rest", strprintf("Accept public REST requests (default: %u)", DEFAULT_REST_ENABLE), ArgsManager::ALLOW_ANY, OptionsCategory::RPC);
     gArgs.AddArg("-rpcallowip=<ip>", "Allow JSON-RPC connections from specified source. Valid for <ip> are a single IP (e.g. 1.2.3.4), a network/netmask (e.g. 1.2.3.4/255.255.255.0) or a network/CIDR (e.g. 1.2.3.4/24). This option can be specified multiple times", ArgsManager::ALLOW_ANY, OptionsCategory::RPC);
@@ -748,6 +783,12 @@ void DeleteBlockChainData()
     fs::remove(GetDataDir() / "mempool.dat");
 }
 
+static void ThreadVerifyDB(int nCheckLevel, int nCheckDepth)
+{
+    ScheduleBatchPriority();
+    BackgroundVerifyDB(Params(), nCheckLevel, nCheckDepth);
+}
+
 static void ThreadImport(std::vector<fs::path> vImportFiles)
 {
     const CChainParams& chainparams = Params();
@@ -757,20 +798,18 @@ static void ThreadImport(std::vector<fs::path> vImportFiles)
     {
     CImportingNow imp;
 
+    const size_t import_buffer = std::max<int64_t>(0, gArgs.GetArg("-importbuffer", DEFAULT_IMPORT_BUFFER)) << 20;
+
     // -reindex
     if (fReindex) {
-        int nFile = 0;
-        while (true) {
+        std::vector<ExternalBlockFile> files;
+        for (int nFile = 0; ; nFile++) {
             FlatFilePos pos(nFile, 0);
             if (!fs::exists(GetBlockPosFilename(pos)))
                 break; // No block files left to reindex
-            FILE *file = OpenBlockFile(pos, true);
-            if (!file)
-                break; // This error is logged in OpenBlockFile
-            LogPrintf("Reindexing block file blk%05u.dat...\n", (unsigned int)nFile);
-            LoadExternalBlockFile(chainparams, file, &pos);
-            nFile++;
+            files.push_back({GetBlockPosFilename(pos), pos});
         }
+        LoadExternalBlockFiles(chainparams, files, import_buffer);
         pblocktree->WriteReindexing(false);
         fReindex = false;
         LogPrintf("Reindexing finished\n");
@@ -786,15 +825,11 @@ static void ThreadImport(std::vector<fs::path> vImportFiles)
     }
 
     // -loadblock=
+    std::vector<ExternalBlockFile> files;
     for (const fs::path& path : vImportFiles) {
-        FILE *file = fsbridge::fopen(path, "rb");
-        if (file) {
-            LogPrintf("Importing blocks file %s...\n", path.string());
-            LoadExternalBlockFile(chainparams, file);
-        } else {
-            LogPrintf("Warning: Could not open blocks file %s\n", path.string());
-        }
+        files.push_back({path, FlatFilePos()});
     }
+    LoadExternalBlockFiles(chainparams, files, import_buffer);
 
     // scan for better chains in the block chain database, that are not yet connected in the active best chain
     BlockValidationState state;
@@ -816,6 +851,52 @@ static void ThreadImport(std::vector<fs::path> vImportFiles)
     ::mempool.SetIsLoaded(!ShutdownRequested());
 }
 
+//! Cuckoo caches hold their entries and two flag bits per entry
+static size_t CuckooCacheMemoryUsage(size_t entries)
+{
+    return entries * sizeof(uint256) + entries / 4;
+}
+
+/**
+ * Register the node's subsystems for getmemoryinfo "subsystems". The usage
+ * functions check for themselves what is set up, so they are safe to call
+ * before the chainstate is loaded and after it is torn down.
+ */
+static void RegisterNodeMemoryUsage()
+{
+    RegisterMemoryUsage("coins_cache", [] {
+        LOCK(cs_main);
+        return g_chainstate && g_chainstate->CanFlushToDisk() ? g_chainstate->CoinsTip().DynamicMemoryUsage() : 0;
+    });
+    RegisterMemoryUsage("coins_db", [] {
+        LOCK(cs_main);
+        return g_chainstate && g_chainstate->CanFlushToDisk() ? g_chainstate->CoinsDB().DynamicMemoryUsage() : 0;
+    });
+    RegisterMemoryUsage("block_index", [] {
+        LOCK(cs_main);
+        size_t usage = memusage::DynamicUsage(::BlockIndex()) + ::BlockIndex().size() * memusage::MallocUsage(sizeof(CBlockIndex));
+        if (g_chainstate) {
+            usage += memusage::DynamicUsage(g_chainstate->setBlockIndexCandidates) + memusage::DynamicUsage(g_chainstate->setStakeSeen);
+        }
+        return usage;
+    });
+    RegisterMemoryUsage("block_tree_db", [] {
+        LOCK(cs_main);
+        return pblocktree ? pblocktree->DynamicMemoryUsage() : 0;
+    });
+    RegisterMemoryUsage("orphan_blocks", OrphanBlocksMemoryUsage);
+    RegisterMemoryUsage("mempool", [] { return ::mempool.DynamicMemoryUsage(); });
+    RegisterMemoryUsage("mempool_indexes", [] { return ::mempool.IndexDynamicMemoryUsage(); });
+    RegisterMemoryUsage("contract_receipts", [] {
+        LOCK(cs_main);
+        return pstorageresult ? pstorageresult->DynamicMemoryUsage() : 0;
+    });
+    RegisterMemoryUsage("trie_node_cache", [] { return g_trie_node_cache.GetStats().usage; });
+    RegisterMemoryUsage("randomx", GetRandomXMemoryUsage);
+    RegisterMemoryUsage("signature_cache", [] { return CuckooCacheMemoryUsage(GetSignatureCacheCapacity()); });
+    RegisterMemoryUsage("script_execution_cache", [] { return CuckooCacheMemoryUsage(GetScriptExecutionCacheCapacity()); });
+}
+
 /** Sanity checks
  *  Ensure that Bitcoin is running in a usable environment with all
  *  necessary library support.
@@ -947,6 +1028,9 @@ void InitLogging()
     LogInstance().m_log_threadnames = gArgs.GetBoolArg("-logthreadnames", DEFAULT_LOGTHREADNAMES);
 #endif
     LogInstance().m_show_evm_logs = gArgs.GetBoolArg("-showevmlogs", DEFAULT_SHOWEVMLOGS);
+    LogInstance().m_async = gArgs.GetBoolArg("-logasync", DEFAULT_LOGASYNC);
+    LogInstance().m_async_buffer = std::max<int64_t>(1, gArgs.GetArg("-logasyncbuffer", DEFAULT_LOGASYNC_BUFFER));
+    LogInstance().m_fsync_interval = std::max<int64_t>(0, gArgs.GetArg("-logfsync", DEFAULT_LOGFSYNC_INTERVAL));
     dev::g_logPost = [&](std::string const& s, char const* c){ LogInstance().LogPrintStr(s + '\n', true); };
 
     fLogIPs = gArgs.GetBoolArg("-logips", DEFAULT_LOGIPS);
@@ -1127,8 +1211,13 @@ bool AppInitParameterInteraction()
     if (ratio != 0) {
         mempool.setSanityCheck(1.0 / ratio);
     }
+    mempool.SetChangeLogSize(std::max<int64_t>(0, gArgs.GetArg("-mempoolchangelog", DEFAULT_MEMPOOL_CHANGE_LOG)));
     fCheckBlockIndex = gArgs.GetBoolArg("-checkblockindex", chainparams.DefaultConsistencyChecks());
+    g_lock_stats_enabled = gArgs.GetBoolArg("-lockstats", DEFAULT_LOCK_STATS);
+    g_block_profiler.SetCapacity(std::max<int64_t>(0, gArgs.GetArg("-blockprofilesize", DEFAULT_BLOCK_PROFILE_SIZE)));
+    g_contract_profiler.SetSampleRate(std::max<int64_t>(0, gArgs.GetArg("-contractprofile", DEFAULT_CONTRACT_PROFILE_RATE)));
     fCheckpointsEnabled = gArgs.GetBoolArg("-checkpoints", DEFAULT_CHECKPOINTS_ENABLED);
+    fBlockCompression = gArgs.GetBoolArg("-blockcompression", DEFAULT_BLOCK_COMPRESSION);
 
     hashAssumeValid = uint256S(gArgs.GetArg("-assumevalid", chainparams.GetConsensus().defaultAssumeValid.GetHex()));
     if (!hashAssumeValid.IsNull())
@@ -1183,6 +1272,27 @@ bool AppInitParameterInteraction()
         fPruneMode = true;
     }
 
+    // receipt and log event pruning
+    nLogEventsRetain = gArgs.GetArg("-logeventsretain", DEFAULT_LOGEVENTS_RETAIN);
+    nLogEventsRetainHeight = gArgs.GetArg("-logeventsretainheight", 0);
+    if (nLogEventsRetain < 0 || nLogEventsRetainHeight < 0) {
+        return InitError(_("Receipt and log event retention cannot be configured with a negative value.").translated);
+    }
+    if (nLogEventsRetain > 0 && nLogEventsRetain < (int)MIN_BLOCKS_TO_KEEP) {
+        return InitError(strprintf(_("-logeventsretain configured below the minimum of %d blocks.").translated, MIN_BLOCKS_TO_KEEP));
+    }
+    if (nLogEventsRetain > 0 || nLogEventsRetainHeight > 0) {
+        if (!gArgs.GetBoolArg("-logevents", DEFAULT_LOGEVENTS)) {
+            return InitError(_("-logeventsretain and -logeventsretainheight require -logevents.").translated);
+        }
+#ifdef ENABLE_WALLET
+        // Super staking reads the delegation events from the start of the chain
+        if (gArgs.GetBoolArg("-superstaking", DEFAULT_SUPER_STAKE)) {
+            return InitError(_("-logeventsretain and -logeventsretainheight are incompatible with -superstaking.").translated);
+        }
+#endif
+    }
+
     nConnectTimeout = gArgs.GetArg("-timeout", DEFAULT_CONNECT_TIMEOUT);
     if (nConnectTimeout <= 0) {
         nConnectTimeout = DEFAULT_CONNECT_TIMEOUT;
@@ -1457,6 +1567,7 @@ bool AppInitSanityChecks()
     RandomInit();
     ECC_Start();
     globalVerifyHandle.reset(new ECCVerifyHandle());
+    RegisterNativePrecompiles();
 
     // Sanity check
     if (!InitSanityCheck())
@@ -1542,6 +1653,12 @@ bool AppInitMain(NodeContext& node)
 
     InitSignatureCache();
     InitScriptExecutionCache();
+    RegisterNodeMemoryUsage();
+    // Restore the caches saved with the mempool, so the first blocks after a
+    // restart need not verify again what the mempool had already checked
+    if (gArgs.GetArg("-persistmempool", DEFAULT_PERSIST_MEMPOOL)) {
+        LoadValidationCaches();
+    }
 
     int script_threads = gArgs.GetArg("-par", DEFAULT_SCRIPTCHECK_THREADS);
     if (script_threads <= 0) {
@@ -1567,9 +1684,13 @@ bool AppInitMain(NodeContext& node)
     assert(!node.scheduler);
     node.scheduler = MakeUnique<CScheduler>();
 
-    // Start the lightweight task scheduler thread
+    // Start the lightweight task scheduler threads. Validation interface
+    // subscribers each have their own queue and run in parallel on these.
     CScheduler::Function serviceLoop = [&node]{ node.scheduler->serviceQueue(); };
-    threadGroup.create_thread(std::bind(&TraceThread<CScheduler::Function>, "scheduler", serviceLoop));
+    const int scheduler_threads = std::max(1, std::min((int)gArgs.GetArg("-schedulerthreads", DEFAULT_SCHEDULER_THREADS), MAX_SCHEDULER_THREADS));
+    for (int i = 0; i < scheduler_threads; ++i) {
+        threadGroup.create_thread(std::bind(&TraceThread<CScheduler::Function>, "scheduler", serviceLoop));
+    }
 
     // Gather some entropy once per minute.
     node.scheduler->scheduleEvery([]{
@@ -1802,8 +1923,12 @@ bool AppInitMain(NodeContext& node)
     }
     LogPrintf("* Using %.1f MiB for chain state database\n", nCoinDBCache * (1.0 / 1024 / 1024));
     LogPrintf("* Using %.1f MiB for in-memory UTXO set (plus up to %.1f MiB of unused mempool space)\n", nCoinCacheUsage * (1.0 / 1024 / 1024), nMempoolSizeMax * (1.0 / 1024 / 1024));
+    int64_t nTrieNodeCache = std::max<int64_t>(0, gArgs.GetArg("-trienodecache", DEFAULT_TRIE_NODE_CACHE_SIZE)) << 20;
+    g_trie_node_cache.SetMaxUsage(nTrieNodeCache);
+    LogPrintf("* Using %.1f MiB for EVM trie node cache\n", nTrieNodeCache * (1.0 / 1024 / 1024));
 
     bool fLoaded = false;
+    bool fVerifyDBInBackground = false;
     while (!fLoaded && !ShutdownRequested()) {
         bool fReset = fReindex;
         std::string strLoadError;
@@ -1959,6 +2084,10 @@ bool AppInitMain(NodeContext& node)
                     strLoadError = _("You need to rebuild the database using -reindex to change -addrindex").translated;
                     break;
                 }
+                if (fContractIndex != gArgs.GetBoolArg("-contractindex", DEFAULT_CONTRACTINDEX)) {
+                    strLoadError = _("You need to rebuild the database using -reindex to change -contractindex").translated;
+                    break;
+                }
                 ///////////////////////////////////////////////////////////////
                 // Check for changed -logevents state
                 if (fLogEvents != gArgs.GetBoolArg("-logevents", DEFAULT_LOGEVENTS) && !fLogEvents) {
@@ -1973,6 +2102,11 @@ bool AppInitMain(NodeContext& node)
                     fLogEvents = false;
                     pblocktree->WriteFlag("logevents", fLogEvents);
                 }
+                else if (fReindexChainState)
+                {
+                    // Reconnecting the chain writes the receipts of the pruned blocks again
+                    pblocktree->WriteHeightIndexPruned(0);
+                }
 
             if (!fReset) {
                 // Note that RewindBlockIndex MUST run even if we're about to -reindex-chainstate.
@@ -2007,7 +2141,10 @@ bool AppInitMain(NodeContext& node)
                         break;
                     }
 
-                    if (!CVerifyDB().VerifyDB(chainparams, &::ChainstateActive().CoinsDB(), gArgs.GetArg("-checklevel", DEFAULT_CHECKLEVEL),
+                    if (gArgs.GetBoolArg("-backgroundverifydb", DEFAULT_BACKGROUND_VERIFYDB)) {
+                        // Started together with the import thread once loading is done
+                        fVerifyDBInBackground = true;
+                    } else if (!CVerifyDB().VerifyDB(chainparams, &::ChainstateActive().CoinsDB(), gArgs.GetArg("-checklevel", DEFAULT_CHECKLEVEL),
                                   gArgs.GetArg("-checkblocks", DEFAULT_CHECKBLOCKS))) {
                         strLoadError = _("Corrupted block database detected").translated;
                         break;
@@ -2127,6 +2264,12 @@ bool AppInitMain(NodeContext& node)
 
     threadGroup.create_thread(std::bind(&ThreadImport, vImportFiles));
 
+    if (fVerifyDBInBackground) {
+        const int check_level = gArgs.GetArg("-checklevel", DEFAULT_CHECKLEVEL);
+        const int check_depth = gArgs.GetArg("-checkblocks", DEFAULT_CHECKBLOCKS);
+        threadGroup.create_thread(std::bind(&TraceThread<std::function<void()>>, "verifydb", [check_level, check_depth] { ThreadVerifyDB(check_level, check_depth); }));
+    }
+
     if(gArgs.GetBoolArg("-cleanblockindex", DEFAULT_CLEANBLOCKINDEX))
         threadGroup.create_thread(std::bind(&CleanBlockIndex));
 
@@ -2222,6 +2365,10 @@ bool AppInitMain(NodeContext& node)
         return false;
     }
 
+    if (gArgs.GetBoolArg("-stratum", DEFAULT_STRATUM_ENABLE) && !StartStratumServer(*node.mempool)) {
+        return false;
+    }
+
     // ********************************************************* Step 13: finished
 
     SetRPCWarmupFinished();
@@ -2236,6 +2383,12 @@ bool AppInitMain(NodeContext& node)
         banman->DumpBanlist();
     }, DUMP_BANS_INTERVAL);
 
+    if (nLogEventsRetain > 0 || nLogEventsRetainHeight > 0) {
+        node.scheduler->scheduleEvery([]{
+            PruneLogEvents(LOGEVENTS_PRUNE_TIME_MICROS);
+        }, LOGEVENTS_PRUNE_INTERVAL);
+    }
+
     return true;
 }
 
@@ -231,6 +231,8 @@ public:
         virtual void blockDisconnected(const CBlock& block, int height) {}
         virtual void updatedBlockTip() {}
         virtual void chainStateFlushed(const CBlockLocator& locator) {}
+        //! Name of the notification queue in logs and getvalidationqueueinfo
+        virtual std::string notificationsName() const { return "chain notifications"; }
     };
 
     //! Register handler for notifications.
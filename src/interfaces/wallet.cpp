@@ -61,6 +61,7 @@ WalletTx MakeWalletTx(CWallet& wallet, const CWalletTx& wtx)
     result.is_coinbase = wtx.IsCoinBase();
     result.is_coinstake = wtx.IsCoinStake();
     result.is_in_main_chain = wtx.IsInMainChain();
+    result.order_pos = wtx.nOrderPos;
     result.has_create_or_call = wtx.tx->HasCreateOrCall();
     if(result.has_create_or_call)
     {
@@ -533,6 +534,19 @@ public:
         }
         return result;
     }
+    std::vector<WalletTx> getWalletTxsBefore(int64_t order_pos, size_t count) override
+    {
+        auto locked_chain = m_wallet->chain().lock();
+        LOCK(m_wallet->cs_wallet);
+        std::vector<WalletTx> result;
+        result.reserve(std::min(count, m_wallet->wtxOrdered.size()));
+        auto it = m_wallet->wtxOrdered.lower_bound(order_pos);
+        while (it != m_wallet->wtxOrdered.begin() && result.size() < count) {
+            --it;
+            result.emplace_back(MakeWalletTx(*m_wallet, *it->second));
+        }
+        return result;
+    }
     bool tryGetTxStatus(const uint256& txid,
         interfaces::WalletTxStatus& tx_status,
         int& num_blocks,
@@ -859,6 +873,19 @@ public:
         }
         return result;
     }
+    std::vector<TokenTx> getTokenTxsBefore(int64_t time, const uint256& hash, size_t count) override
+    {
+        auto locked_chain = m_wallet->chain().lock();
+        LOCK(m_wallet->cs_wallet);
+        std::vector<TokenTx> result;
+        result.reserve(std::min(count, m_wallet->setTokenTxByTime.size()));
+        auto it = m_wallet->setTokenTxByTime.lower_bound(std::make_pair(time, hash));
+        while (it != m_wallet->setTokenTxByTime.begin() && result.size() < count) {
+            --it;
+            result.emplace_back(MakeWalletTokenTx(m_wallet->mapTokenTx.at(it->second)));
+        }
+        return result;
+    }
     TokenInfo getToken(const uint256& id) override
     {
         auto locked_chain = m_wallet->chain().lock();
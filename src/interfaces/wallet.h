@@ -187,6 +187,9 @@ public:
     //! Get list of all wallet transactions.
     virtual std::vector<WalletTx> getWalletTxs() = 0;
 
+    //! Get up to count wallet transactions ordered before order_pos, newest first.
+    virtual std::vector<WalletTx> getWalletTxsBefore(int64_t order_pos, size_t count) = 0;
+
     //! Try to get updated status for a particular transaction, if possible without blocking.
     virtual bool tryGetTxStatus(const uint256& txid,
         WalletTxStatus& tx_status,
@@ -305,6 +308,9 @@ public:
     //! Get list of all wallet token transactions.
     virtual std::vector<TokenTx> getTokenTxs() = 0;
 
+    //! Get up to count wallet token transactions ordered before (time, hash), newest first.
+    virtual std::vector<TokenTx> getTokenTxsBefore(int64_t time, const uint256& hash, size_t count) = 0;
+
     //! Get token information.
     virtual TokenInfo getToken(const uint256& id) = 0;
 
@@ -552,6 +558,7 @@ struct WalletTx
     bool is_coinbase;
     bool is_coinstake;
     bool is_in_main_chain;
+    int64_t order_pos;
 
     // Contract tx params
     bool has_create_or_call;
@@ -4,6 +4,7 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include <logging.h>
+#include <util/system.h>
 #include <util/threadnames.h>
 #include <util/time.h>
 
@@ -92,11 +93,90 @@ bool BCLog::Logger::StartLogging()
     /////////////////////////////////////////////
     if (m_print_to_console) fflush(stdout);
 
+    if (m_async && m_fileout) {
+        m_async_queue.reset(new RingBuffer<LogMsg>(m_async_buffer));
+        m_async_stop = false;
+        m_async_running = true;
+        m_async_thread = std::thread(&BCLog::Logger::AsyncWriterThread, this);
+    }
+
     return true;
 }
 
+void BCLog::Logger::StopAsyncLogging()
+{
+    if (!m_async_running) return;
+
+    // New messages go through the synchronous path from here on. Wait for
+    // callers that already chose the asynchronous path, so their messages
+    // are in the queue before the final drain.
+    m_async_running = false;
+    while (m_async_pushers.load() != 0) {
+        std::this_thread::yield();
+    }
+    m_async_stop = true;
+    m_async_cond.notify_one();
+    m_async_thread.join();
+
+    // A message pushed while stopping may have missed the writer's last pass.
+    // Nothing can be pushed any more.
+    std::lock_guard<std::mutex> scoped_lock(m_cs);
+    LogMsg logmsg;
+    while (m_async_queue->Pop(logmsg)) {
+        WriteToFile(logmsg.msg, logmsg.useVMLog);
+    }
+}
+
+void BCLog::Logger::AsyncWriterThread()
+{
+    util::ThreadRename("logwriter");
+
+    // Upper bound for one batched write, so a backlog is written in chunks
+    constexpr size_t MAX_BATCH_SIZE = 1 << 20;
+
+    std::string batch;
+    std::string batch_vm;
+    LogMsg logmsg;
+    uint64_t dropped_reported = 0;
+    int64_t last_fsync = GetTime();
+    while (true) {
+        const bool stop = m_async_stop;
+        batch.clear();
+        batch_vm.clear();
+        while (batch.size() + batch_vm.size() < MAX_BATCH_SIZE && m_async_queue->Pop(logmsg)) {
+            (logmsg.useVMLog ? batch_vm : batch) += logmsg.msg;
+        }
+        const uint64_t dropped = m_async_dropped;
+        if (dropped != dropped_reported) {
+            batch += strprintf("%s %u log messages dropped, asynchronous log queue full\n", FormatISO8601DateTime(GetTime()), dropped - dropped_reported);
+            dropped_reported = dropped;
+        }
+
+        if (!batch.empty() || !batch_vm.empty()) {
+            {
+                std::lock_guard<std::mutex> scoped_lock(m_cs);
+                if (!batch.empty()) WriteToFile(batch, false);
+                if (!batch_vm.empty()) WriteToFile(batch_vm, true);
+            }
+            // Only this thread writes the files while asynchronous logging
+            // runs, and FileCommit may log, so sync outside of m_cs.
+            if (m_fsync_interval > 0 && GetTime() - last_fsync >= m_fsync_interval) {
+                if (m_fileout) FileCommit(m_fileout);
+                if (m_fileoutVM) FileCommit(m_fileoutVM);
+                last_fsync = GetTime();
+            }
+            continue;
+        }
+        if (stop) break;
+
+        std::unique_lock<std::mutex> lock(m_async_mutex);
+        m_async_cond.wait_for(lock, std::chrono::milliseconds(100), [this] { return m_async_stop || !m_async_queue->Empty(); });
+    }
+}
+
 void BCLog::Logger::DisconnectTestLogger()
 {
+    StopAsyncLogging();
     std::lock_guard<std::mutex> scoped_lock(m_cs);
     m_buffering = true;
     if (m_fileout != nullptr) fclose(m_fileout);
@@ -185,6 +265,7 @@ const CLogCategoryDesc LogCategories[] =
     {BCLog::COINSTAKE, "coinstake"},
     {BCLog::HTTPPOLL, "http-poll"},
     {BCLog::INDEX, "index"},
+    {BCLog::STRATUM, "stratum"},
     {BCLog::ALL, "1"},
     {BCLog::ALL, "all"},
 };
@@ -234,14 +315,14 @@ std::vector<CLogCategoryActive> ListActiveLogCategories()
     return ret;
 }
 
-std::string BCLog::Logger::LogTimestampStr(const std::string& str)
+std::string BCLog::Logger::LogTimestampStr(const std::string& str, bool started_new_line) const
 {
     std::string strStamped;
 
     if (!m_log_timestamps)
         return str;
 
-    if (m_started_new_line) {
+    if (started_new_line) {
         int64_t nTimeMicros = GetTimeMicros();
         strStamped = FormatISO8601DateTime(nTimeMicros/1000000);
         if (m_log_time_micros) {
@@ -281,18 +362,91 @@ namespace BCLog {
     }
 }
 
-void BCLog::Logger::LogPrintStr(const std::string& str, bool useVMLog)
+std::string BCLog::Logger::FormatLogStr(const std::string& str, bool& started_new_line) const
 {
-    std::lock_guard<std::mutex> scoped_lock(m_cs);
     std::string str_prefixed = LogEscapeMessage(str);
 
-    if (m_log_threadnames && m_started_new_line) {
+    if (m_log_threadnames && started_new_line) {
         str_prefixed.insert(0, "[" + util::ThreadGetInternalName() + "] ");
     }
 
-    str_prefixed = LogTimestampStr(str_prefixed);
+    str_prefixed = LogTimestampStr(str_prefixed, started_new_line);
+
+    started_new_line = !str.empty() && str[str.size()-1] == '\n';
+
+    return str_prefixed;
+}
+
+void BCLog::Logger::WriteToFile(const std::string& str, bool useVMLog)
+{
+    // reopen the log files, if requested
+    if (m_reopen_file) {
+        m_reopen_file = false;
+        FILE* new_fileout = fsbridge::fopen(m_file_path, "a");
+        if (new_fileout) {
+            setbuf(new_fileout, nullptr); // unbuffered
+            fclose(m_fileout);
+            m_fileout = new_fileout;
+        }
+        //////////////////////////////// // lux
+        FILE* new_fileoutVM = fsbridge::fopen(m_file_pathVM, "a");
+        if (new_fileoutVM) {
+            setbuf(new_fileoutVM, nullptr); // unbuffered
+            fclose(m_fileoutVM);
+            m_fileoutVM = new_fileoutVM;
+        }
+        ////////////////////////////////
+    }
+
+    //////////////////////////////// // lux
+    FILE* file = m_fileout;
+    if(useVMLog){
+        file = m_fileoutVM;
+    }
+    ////////////////////////////////
+    assert(file != nullptr);
+    FileWriteStr(str, file);
+}
+
+void BCLog::Logger::LogPrintStr(const std::string& str, bool useVMLog)
+{
+    bool print_to_console = m_print_to_console;
+    if(print_to_console && useVMLog && !m_show_evm_logs) print_to_console = false;
+
+    // Registering as a pusher before checking m_async_running pairs with
+    // StopAsyncLogging clearing it before waiting for the pushers: either the
+    // stop waits for this push, or this call sees the stop and writes
+    // synchronously.
+    ++m_async_pushers;
+    if (m_async_running.load()) {
+        // Format on the calling thread so timestamps and thread names are
+        // those of the caller, and hand the file write to the writer thread.
+        // Without m_cs, whether a message continues a line can only be
+        // tracked per thread.
+        static thread_local bool t_started_new_line = true;
+        LogMsg logmsg(FormatLogStr(str, t_started_new_line), useVMLog);
+        if (print_to_console || m_num_print_callbacks) {
+            std::lock_guard<std::mutex> scoped_lock(m_cs);
+            if (print_to_console) {
+                fwrite(logmsg.msg.data(), 1, logmsg.msg.size(), stdout);
+                fflush(stdout);
+            }
+            for (const auto& cb : m_print_callbacks) {
+                cb(logmsg.msg);
+            }
+        }
+        if (m_async_queue->Push(logmsg)) {
+            m_async_cond.notify_one();
+        } else {
+            ++m_async_dropped;
+        }
+        --m_async_pushers;
+        return;
+    }
+    --m_async_pushers;
 
-    m_started_new_line = !str.empty() && str[str.size()-1] == '\n';
+    std::lock_guard<std::mutex> scoped_lock(m_cs);
+    std::string str_prefixed = FormatLogStr(str, m_started_new_line);
 
     if (m_buffering) {
         // buffer if we haven't started logging yet
@@ -301,9 +455,6 @@ void BCLog::Logger::LogPrintStr(const std::string& str, bool useVMLog)
         return;
     }
 
-    bool print_to_console = m_print_to_console;
-    if(print_to_console && useVMLog && !m_show_evm_logs) print_to_console = false;
-
     if (print_to_console) {
         // print to console
         fwrite(str_prefixed.data(), 1, str_prefixed.size(), stdout);
@@ -313,28 +464,7 @@ void BCLog::Logger::LogPrintStr(const std::string& str, bool useVMLog)
         cb(str_prefixed);
     }
     if (m_print_to_file) {
-        //////////////////////////////// // lux
-        FILE* file = m_fileout;
-        if(useVMLog){
-            file = m_fileoutVM;
-        }
-        ////////////////////////////////
-        assert(file != nullptr);
-
-        // reopen the log file, if requested
-        if (m_reopen_file) {
-            m_reopen_file = false;
-                fs::path file_path = m_file_path;
-                if(useVMLog)
-                    file_path = m_file_pathVM;
-            FILE* new_fileout = fsbridge::fopen(file_path, "a");
-            if (new_fileout) {
-                setbuf(new_fileout, nullptr); // unbuffered
-                fclose(file);
-                file = new_fileout;
-            }
-        }
-        FileWriteStr(str_prefixed, file);
+        WriteToFile(str_prefixed, useVMLog);
     }
 }
 
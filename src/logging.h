@@ -7,13 +7,17 @@
 #define BITCOIN_LOGGING_H
 
 #include <fs.h>
+#include <logging/ringbuffer.h>
 #include <tinyformat.h>
 
 #include <atomic>
+#include <condition_variable>
 #include <cstdint>
 #include <list>
+#include <memory>
 #include <mutex>
 #include <string>
+#include <thread>
 #include <vector>
 
 static const bool DEFAULT_LOGTIMEMICROS = false;
@@ -21,6 +25,9 @@ static const bool DEFAULT_LOGIPS        = false;
 static const bool DEFAULT_LOGTIMESTAMPS = true;
 static const bool DEFAULT_LOGTHREADNAMES = false;
 static const bool DEFAULT_SHOWEVMLOGS   = false;
+static const bool DEFAULT_LOGASYNC      = false;
+static const unsigned int DEFAULT_LOGASYNC_BUFFER = 16384;
+static const int64_t DEFAULT_LOGFSYNC_INTERVAL = 0;
 extern const char * const DEFAULT_DEBUGLOGFILE;
 extern const char * const DEFAULT_DEBUGVMLOGFILE;
 
@@ -60,11 +67,13 @@ namespace BCLog {
         COINSTAKE   = (1 << 22),
         HTTPPOLL    = (1 << 23),
         INDEX       = (1 << 24),
+        STRATUM     = (1 << 25),
         ALL         = ~(uint32_t)0,
     };
 
     struct LogMsg
     {
+        LogMsg() : useVMLog(false) {}
         LogMsg(const std::string& _msg, bool _useVMLog) :
             msg(_msg),
             useVMLog(_useVMLog)
@@ -86,17 +95,45 @@ namespace BCLog {
         /**
          * m_started_new_line is a state variable that will suppress printing of
          * the timestamp when multiple calls are made that don't end in a
-         * newline.
+         * newline. It is used by the synchronous path; the asynchronous path
+         * formats without m_cs and keeps this state per thread instead.
          */
-        std::atomic_bool m_started_new_line{true};
+        bool m_started_new_line{true}; // GUARDED_BY(m_cs)
 
         /** Log categories bitfield. */
         std::atomic<uint32_t> m_categories{0};
 
-        std::string LogTimestampStr(const std::string& str);
+        std::string LogTimestampStr(const std::string& str, bool started_new_line) const;
+        /**
+         * Escape, and prefix with thread name and timestamp if started_new_line.
+         * started_new_line is then updated for the next message.
+         */
+        std::string FormatLogStr(const std::string& str, bool& started_new_line) const;
 
         /** Slots that connect to the print signal */
         std::list<std::function<void(const std::string&)>> m_print_callbacks /* GUARDED_BY(m_cs) */ {};
+        /** Lets the asynchronous path skip m_cs when there are no callbacks */
+        std::atomic<size_t> m_num_print_callbacks{0};
+
+        /**
+         * Asynchronous file output. When running, LogPrintStr formats the
+         * message on the calling thread and pushes it to m_async_queue without
+         * taking m_cs; m_async_thread writes the queued messages to the log
+         * files in batches.
+         */
+        std::unique_ptr<RingBuffer<LogMsg>> m_async_queue;
+        std::thread m_async_thread;
+        std::atomic<bool> m_async_running{false};
+        /** Callers of LogPrintStr that may still push to m_async_queue */
+        std::atomic<int> m_async_pushers{0};
+        std::atomic<bool> m_async_stop{false};
+        std::atomic<uint64_t> m_async_dropped{0};
+        std::mutex m_async_mutex;
+        std::condition_variable m_async_cond;
+
+        void AsyncWriterThread();
+        /** Write a batch of messages to the log file(s). Caller must hold m_cs. */
+        void WriteToFile(const std::string& str, bool useVMLog);
 
     public:
         bool m_print_to_console = false;
@@ -111,6 +148,13 @@ namespace BCLog {
         fs::path m_file_pathVM;
         std::atomic<bool> m_reopen_file{false};
 
+        /** Write log files from a background thread (set before StartLogging) */
+        bool m_async = DEFAULT_LOGASYNC;
+        /** Number of messages the asynchronous queue can hold before dropping */
+        size_t m_async_buffer = DEFAULT_LOGASYNC_BUFFER;
+        /** fsync the log files at most every this many seconds when writing asynchronously (0 = never) */
+        int64_t m_fsync_interval = DEFAULT_LOGFSYNC_INTERVAL;
+
         /** Send a string to the log output */
         void LogPrintStr(const std::string& str, bool useVMLog = false);
 
@@ -126,6 +170,7 @@ namespace BCLog {
         {
             std::lock_guard<std::mutex> scoped_lock(m_cs);
             m_print_callbacks.push_back(std::move(fun));
+            ++m_num_print_callbacks;
             return --m_print_callbacks.end();
         }
 
@@ -134,10 +179,15 @@ namespace BCLog {
         {
             std::lock_guard<std::mutex> scoped_lock(m_cs);
             m_print_callbacks.erase(it);
+            --m_num_print_callbacks;
         }
 
         /** Start logging (and flush all buffered messages) */
         bool StartLogging();
+        /** Write out everything queued for the asynchronous writer and go back to synchronous writes */
+        void StopAsyncLogging();
+        /** Number of messages dropped because the asynchronous queue was full */
+        uint64_t GetDroppedMessages() const { return m_async_dropped.load(); }
         /** Only for testing */
         void DisconnectTestLogger();
 
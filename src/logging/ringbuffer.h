@@ -0,0 +1,113 @@
+// Copyright (c) 2020 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_LOGGING_RINGBUFFER_H
+#define BITCOIN_LOGGING_RINGBUFFER_H
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+namespace BCLog {
+
+/**
+ * Bounded lock-free multi-producer queue used by the asynchronous logger.
+ *
+ * This is the sequence-numbered array queue described by Dmitry Vyukov: every
+ * slot carries a sequence number telling producers and consumers whose turn
+ * it is, so pushes and pops only need one compare-and-swap on the shared
+ * position and never block. Push() fails instead of waiting when the queue is
+ * full; it is up to the caller to count the drop.
+ *
+ * The capacity is rounded up to a power of two. Slots are constructed once
+ * and reused, so with std::string elements the storage of drained messages
+ * is recycled by later ones.
+ */
+template <typename T>
+class RingBuffer
+{
+public:
+    explicit RingBuffer(size_t capacity)
+    {
+        size_t size = 2;
+        while (size < capacity) size <<= 1;
+        m_mask = size - 1;
+        m_slots.reset(new Slot[size]);
+        for (size_t i = 0; i < size; ++i) {
+            m_slots[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    RingBuffer(const RingBuffer&) = delete;
+    RingBuffer& operator=(const RingBuffer&) = delete;
+
+    /** Append an element. Returns false, leaving value untouched, if the queue is full. */
+    bool Push(T& value)
+    {
+        size_t pos = m_push_pos.load(std::memory_order_relaxed);
+        Slot* slot;
+        while (true) {
+            slot = &m_slots[pos & m_mask];
+            const size_t seq = slot->sequence.load(std::memory_order_acquire);
+            const intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+            if (diff == 0) {
+                if (m_push_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+            } else if (diff < 0) {
+                return false; // full
+            } else {
+                pos = m_push_pos.load(std::memory_order_relaxed);
+            }
+        }
+        std::swap(slot->value, value);
+        slot->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    /** Remove the oldest element into value. Returns false if the queue is empty. */
+    bool Pop(T& value)
+    {
+        size_t pos = m_pop_pos.load(std::memory_order_relaxed);
+        Slot* slot;
+        while (true) {
+            slot = &m_slots[pos & m_mask];
+            const size_t seq = slot->sequence.load(std::memory_order_acquire);
+            const intptr_t diff = (intptr_t)seq - (intptr_t)(pos + 1);
+            if (diff == 0) {
+                if (m_pop_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+            } else if (diff < 0) {
+                return false; // empty
+            } else {
+                pos = m_pop_pos.load(std::memory_order_relaxed);
+            }
+        }
+        std::swap(value, slot->value);
+        slot->sequence.store(pos + m_mask + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool Empty() const
+    {
+        return m_pop_pos.load(std::memory_order_acquire) == m_push_pos.load(std::memory_order_acquire);
+    }
+
+    size_t Capacity() const { return m_mask + 1; }
+
+private:
+    struct Slot {
+        std::atomic<size_t> sequence;
+        T value;
+    };
+
+    std::unique_ptr<Slot[]> m_slots;
+    size_t m_mask;
+    // Keep producer and consumer positions on separate cache lines
+    alignas(64) std::atomic<size_t> m_push_pos{0};
+    alignas(64) std::atomic<size_t> m_pop_pos{0};
+};
+
+} // namespace BCLog
+
+#endif // BITCOIN_LOGGING_RINGBUFFER_H
@@ -12,6 +12,7 @@
 #include <consensus/validation.h>
 #include <hash.h>
 #include <validation.h>
+#include <memusage.h>
 #include <merkleblock.h>
 #include <netmessagemaker.h>
 #include <netbase.h>
@@ -2712,6 +2713,12 @@ bool ProcessMessage(CNode* pfrom, const std::string& msg_type, CDataStream& vRec
         CInv inv(MSG_TX, tx.GetHash());
         pfrom->AddInventoryKnown(inv);
 
+        // Each accepted transaction, and any orphans it resolves, queues a
+        // notification for every subscriber. Wait for the subscribers that
+        // fell behind to get back within their limit first; lossy ones such
+        // as zmq miss the notifications instead.
+        LimitValidationInterfaceQueue();
+
         LOCK2(cs_main, g_cs_orphans);
 
         TxValidationState state;
@@ -4364,6 +4371,17 @@ void static PruneOrphanBlocks()
     }
 }
 
+size_t OrphanBlocksMemoryUsage()
+{
+    LOCK(cs_main);
+    size_t usage = memusage::DynamicUsage(mapOrphanBlocks) + memusage::DynamicUsage(setStakeSeenOrphan);
+    usage += mapOrphanBlocksByPrev.size() * memusage::MallocUsage(sizeof(memusage::stl_tree_node<std::pair<const uint256, COrphanBlock*>>));
+    for (const auto& entry : mapOrphanBlocks) {
+        usage += memusage::MallocUsage(sizeof(COrphanBlock)) + memusage::DynamicUsage(entry.second->vchBlock);
+    }
+    return usage;
+}
+
 bool ProcessNetBlock(const CChainParams& chainparams, const std::shared_ptr<const CBlock> pblock, bool fForceProcessing, bool* fNewBlock, CNode* pfrom, CConnman& connman)
 {
     {
@@ -51,6 +51,8 @@ private:
 public:
     PeerLogicValidation(CConnman* connman, BanMan* banman, CScheduler& scheduler, CTxMemPool& pool);
 
+    std::string GetValidationQueueName() const override { return "net"; }
+
     /**
      * Overridden from CValidationInterface.
      */
@@ -115,6 +117,9 @@ void RelayTransaction(const uint256&, const CConnman& connman);
 /** Process network block received from a given node */
 bool ProcessNetBlock(const CChainParams& chainparams, const std::shared_ptr<const CBlock> pblock, bool fForceProcessing, bool* fNewBlock, CNode* pfrom, CConnman& connman);
 
+/** Memory used by the orphan blocks, including their serialized data */
+size_t OrphanBlocksMemoryUsage();
+
 /** Clean block index */
 void CleanBlockIndex();
 
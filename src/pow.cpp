@@ -31,50 +31,28 @@ namespace {
     }
 }
 
-// Function which returns the last PoS CBlockIndex when fProofOfStake is true, or last PoW CBlockIndex otherwise.
-const CBlockIndex* GetLastBlockIndex(const CBlockIndex* pindex, bool fProofOfStake)
+// Returns the most recent non-genesis block at or before pindex with the requested proof type, or nullptr if there is none.
+static const CBlockIndex* GetLastBlockIndexOfProof(const CBlockIndex* pindex, bool fProofOfStake)
 {
-    while (pindex && pindex->pprev && (pindex->IsProofOfStake() != fProofOfStake))
-        pindex = pindex->pprev;
-    return pindex;
+    if (!pindex || !pindex->pprev)
+        return nullptr;
+    return pindex->IsProofOfStake() == fProofOfStake ? pindex : pindex->pprevOtherProof;
 }
 
-// Function which counts the last PoS CBlockIndex-es we have over nHeightScan.
-int CountPoS(const CBlockIndex* pindex, int nHeightScan)
+// Returns the number of non-genesis blocks with the requested proof type up to and including pindex.
+static int CountBlocksOfProof(const CBlockIndex* pindex, bool fProofOfStake)
 {
-    int nFound = 0;
-    while (pindex && pindex->pprev && (pindex->nHeight > nHeightScan)) {
-        if (pindex->IsProofOfStake()) {
-            nFound++;
-        }
-        pindex = pindex->pprev;
-    }
-    return nFound;
+    return fProofOfStake ? pindex->nChainStakeCount : pindex->nHeight - pindex->nChainStakeCount;
 }
 
-// Function which counts the last fProofOfStake blocks 
-// if the index IsProofOfStake == true, or fProofOfWork blocks if
-// the index is IsProofOfStake == false, over a specified  
-// nHeightScan; subsequently, a map is built containing the sorted heights of all PoS or PoW blocks.
-std::map<int, int> GetContextLWMA(const CBlockIndex* pindex, int nContextScope, bool fProofOfStake)
+// Function which returns the last PoS CBlockIndex when fProofOfStake is true, or last PoW CBlockIndex otherwise.
+// Falls back to the genesis block if the chain has no block of the requested type.
+const CBlockIndex* GetLastBlockIndex(const CBlockIndex* pindex, bool fProofOfStake)
 {
-    std::map<int, int> mapRet;
-    int nIdx = 0;
-    while (fProofOfStake && pindex && pindex->pprev && nIdx <= nContextScope) {
-        if (pindex->IsProofOfStake()) {
-            nIdx++;
-            mapRet.insert(std::pair<int, int>(nIdx, pindex->nHeight));
-        }
-        pindex = pindex->pprev;
-    }
-    while (!fProofOfStake && pindex && pindex->pprev && nIdx <= nContextScope) {
-        if (pindex->IsProofOfWork()) {
-            nIdx++;
-            mapRet.insert(std::pair<int, int>(nIdx, pindex->nHeight));
-        }
-        pindex = pindex->pprev;
-    }
-    return mapRet;
+    if (!pindex || !pindex->pprev)
+        return pindex;
+    const CBlockIndex* pindexLastOfProof = GetLastBlockIndexOfProof(pindex, fProofOfStake);
+    return pindexLastOfProof ? pindexLastOfProof : pindex->GetAncestor(0);
 }
 
 // LWMA-1 for BTC/Zcash clones
@@ -104,8 +82,6 @@ unsigned int Lwma3CalculateNextWorkRequired(const CBlockIndex* pindexLast, const
         return noRetIdx->nBits;
     }
 
-    int nPoSBlocksCounter = 0;
-    
     const int64_t T = params.nPowTargetSpacing;
 
    // For T=600, 300, 150 use approximately N=60, 90, 120
@@ -120,56 +96,67 @@ unsigned int Lwma3CalculateNextWorkRequired(const CBlockIndex* pindexLast, const
     // New coins should just give away first N blocks before using this algorithm.
     if (height < N + 1) { return ProofLimit.GetCompact(); }
 
-    // Since we have hybrid consensus, lookup the last N blocks of the same proof, and index them as a context for diff calculations.
-    std::map<int, int> mapContext = GetContextLWMA(pindexLast, N + 1, fProofOfStake);
+    // Since we have hybrid consensus, the window is made of the last N + 1 blocks of the same proof,
+    // which are reached through the same-proof links rather than by walking every block in between.
+    const CBlockIndex* pindexLastOfProof = GetLastBlockIndexOfProof(pindexLast, fProofOfStake);
 
     // Special rule for PoS activation, make sure we use LWMA only after ~300 (lwmaAveragingWindow) PoS blocks have been found
-    if (fProofOfStake && mapContext.size() < (N + 1)) { // Check for this rule only if we don't have enough PoS blocks for LWMA.
-        nPoSBlocksCounter = CountPoS(pindexLast, 0);
+    if (CountBlocksOfProof(pindexLast, fProofOfStake) < N + 1) {
+        if (!fProofOfStake) {
+            return ProofLimit.GetCompact();
+        }
         // Let the first N + 1 PoS blocks use ppcoin EMA
-        if (nPoSBlocksCounter <= N + 1) { 
-            const CBlockIndex* pindexPrev = GetLastBlockIndex(pindexLast, fProofOfStake);
-            if (pindexPrev->pprev == nullptr) {
-                return ProofLimit.GetCompact(); // first block
-            }
-            const CBlockIndex* pindexPrevPrev = GetLastBlockIndex(pindexPrev->pprev, fProofOfStake);
-            if (pindexPrevPrev->pprev == nullptr) {
-                return ProofLimit.GetCompact(); // second block
-            }
+        const CBlockIndex* pindexPrev = pindexLastOfProof;
+        if (pindexPrev == nullptr) {
+            return ProofLimit.GetCompact(); // first block
+        }
+        const CBlockIndex* pindexPrevPrev = pindexPrev->pprevSameProof;
+        if (pindexPrevPrev == nullptr) {
+            return ProofLimit.GetCompact(); // second block
+        }
+
+        int64_t nActualSpacing = pindexPrev->GetBlockTime() - pindexPrevPrev->GetBlockTime();
+        if (nActualSpacing < 0)
+            nActualSpacing = 1;
+        if (nActualSpacing > T * 10)
+            nActualSpacing = T * 10;
 
-            int64_t nActualSpacing = pindexPrev->GetBlockTime() - pindexPrevPrev->GetBlockTime();
-            if (nActualSpacing < 0)
-                nActualSpacing = 1;
-            if (nActualSpacing > T * 10)
-                nActualSpacing = T * 10;
+        // ppcoin: target change every block
+        // ppcoin: retarget with exponential moving toward target spacing
+        arith_uint256 bnNew;
+        bnNew.SetCompact(pindexLast->nBits);
 
-            // ppcoin: target change every block
-            // ppcoin: retarget with exponential moving toward target spacing
-            arith_uint256 bnNew;
-            bnNew.SetCompact(pindexLast->nBits);
+        int64_t nInterval = params.nPowTargetSpacing / T;
+        bnNew *= ((nInterval - 1) * T + nActualSpacing + nActualSpacing);
+        bnNew /= ((nInterval + 1) * T);
 
-            int64_t nInterval = params.nPowTargetSpacing / T;
-            bnNew *= ((nInterval - 1) * T + nActualSpacing + nActualSpacing);
-            bnNew /= ((nInterval + 1) * T);
+        if (bnNew <= 0 || bnNew > ProofLimit)
+            bnNew = ProofLimit;
 
-            if (bnNew <= 0 || bnNew > ProofLimit)
-                bnNew = ProofLimit;
+        return bnNew.GetCompact();
+    }
 
-            return bnNew.GetCompact();
+    // Context of the N + 1 most recent blocks of the same proof type, oldest first.
+    std::vector<const CBlockIndex*> vContext(N + 1);
+    const CBlockIndex* pindexContext = pindexLastOfProof;
+    for (int64_t i = N; i >= 0; i--) {
+        if (pindexContext == nullptr) {
+            return ProofLimit.GetCompact();
         }
+        vContext[i] = pindexContext;
+        pindexContext = pindexContext->pprevSameProof;
     }
 
     arith_uint256 avgTarget, nextTarget;
     int64_t thisTimestamp, previousTimestamp;
     int64_t sumWeightedSolvetimes = 0, j = 0;
 
-    const CBlockIndex* blockPreviousTimestamp = pindexLast->GetAncestor(mapContext.at(N + 1));
-    previousTimestamp = blockPreviousTimestamp->GetBlockTime();
+    previousTimestamp = vContext[0]->GetBlockTime();
 
     // Loop through N most recent blocks of the same proof type.
     // This means we may need more than N blocks, as we index proofs together.
-    for (int64_t i = N; i > 0; i--) {
-        const CBlockIndex* block = pindexLast->GetAncestor(mapContext.at(i));
+    for (int64_t i = 1; i <= N; i++) {
+        const CBlockIndex* block = vContext[i];
 
         // Prevent solvetimes from being negative in a safe way. It must be done like this.
         // In particular, do not attempt anything like  if(solvetime < 0) {solvetime=0;}
@@ -201,15 +188,6 @@ unsigned int Lwma3CalculateNextWorkRequired(const CBlockIndex* pindexLast, const
     return nextTarget.GetCompact();
 }
 
-// ppcoin: find last block index up to pindex
-const CBlockIndex* GetLastBlockIndexQtum(const CBlockIndex* pindex, bool fProofOfStake)
-{
-    //CBlockIndex will be updated with information about the proof type later
-    while (pindex && pindex->pprev && (pindex->IsProofOfStake() != fProofOfStake))
-        pindex = pindex->pprev;
-    return pindex;
-}
-
 inline arith_uint256 GetLimit(int nHeight, const Consensus::Params& params, bool fProofOfStake)
 {
     if(fProofOfStake) {
@@ -235,13 +213,13 @@ unsigned int GetNextWorkRequired(const CBlockIndex* pindexLast, const CBlockHead
         return nTargetLimit;
 
     // first block
-    const CBlockIndex* pindexPrev = GetLastBlockIndexQtum(pindexLast, fProofOfStake);
-    if (pindexPrev->pprev == NULL)
+    const CBlockIndex* pindexPrev = GetLastBlockIndexOfProof(pindexLast, fProofOfStake);
+    if (pindexPrev == nullptr)
         return nTargetLimit;
 
     // second block
-    const CBlockIndex* pindexPrevPrev = GetLastBlockIndexQtum(pindexPrev->pprev, fProofOfStake);
-    if (pindexPrevPrev->pprev == NULL)
+    const CBlockIndex* pindexPrevPrev = pindexPrev->pprevSameProof;
+    if (pindexPrevPrev == nullptr)
         return nTargetLimit;
 
     // min difficulty
@@ -140,6 +140,7 @@ public:
 
     // memory only
     mutable bool fChecked;
+    mutable bool fCheckedContextFree;
 
     CBlock()
     {
@@ -165,6 +166,7 @@ public:
         CBlockHeader::SetNull();
         vtx.clear();
         fChecked = false;
+        fCheckedContextFree = false;
     }
 
     std::pair<COutPoint, unsigned int> GetProofOfStake() const //lux
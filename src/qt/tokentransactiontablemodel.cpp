@@ -19,6 +19,8 @@
 #include <interfaces/handler.h>
 #include <interfaces/node.h>
 
+#include <limits>
+
 #include <QColor>
 #include <QDateTime>
 #include <QDebug>
@@ -35,6 +37,9 @@ static int column_alignments[] = {
         Qt::AlignRight|Qt::AlignVCenter /* amount */
     };
 
+// Number of token transactions read from the core per fetch
+static size_t fetchChunk = 1000;
+
 // Comparison operator for sort/binary search of model tx list
 struct TokenTxLessThan
 {
@@ -63,32 +68,84 @@ public:
 
     TokenTransactionTableModel *parent;
 
-    /* Local cache of wallet.
-     * As it is in the same order as the CWallet, by definition
-     * this is sorted by sha256.
+    /* Local cache of the part of the wallet fetched so far, sorted by sha256.
+     * Token transactions are fetched newest first, in windows, as the view scrolls.
      */
     QList<TokenTransactionRecord> cachedWallet;
 
-    /* Query entire wallet anew from core.
+    /* All token transactions at or after this (time, hash) are in the cache.
+     */
+    int64_t fetchedTime = std::numeric_limits<int64_t>::max();
+    uint256 fetchedHash;
+    bool fetchedAll = false;
+
+    /* Query the newest part of the wallet anew from core.
      */
     void refreshWallet(interfaces::Node& node, interfaces::Wallet& wallet)
     {
         qDebug() << "TokenTransactionTablePriv::refreshWallet";
         cachedWallet.clear();
+        fetchedTime = std::numeric_limits<int64_t>::max();
+        fetchedHash.SetNull();
+        fetchedAll = false;
+        fetchMore(node, wallet, false);
+    }
+
+    bool canFetchMore() const
+    {
+        return !fetchedAll;
+    }
+
+    bool isFetched(const interfaces::TokenTx& wtokenTx) const
+    {
+        return fetchedAll || !(std::make_pair(wtokenTx.time, wtokenTx.hash) < std::make_pair(fetchedTime, fetchedHash));
+    }
+
+    /* Fetch the next window of older token transactions from core.
+     */
+    void fetchMore(interfaces::Node& node, interfaces::Wallet& wallet, bool notify)
+    {
+        std::vector<interfaces::TokenTx> wtokenTxs = wallet.getTokenTxsBefore(fetchedTime, fetchedHash, fetchChunk);
+        // The cursor is where core had the window, before the time fix-ups below move entries
+        if(wtokenTxs.size() < fetchChunk)
+        {
+            fetchedAll = true;
+        }
+        else
         {
-            for(interfaces::TokenTx wtokenTx : wallet.getTokenTxs())
+            fetchedTime = wtokenTxs.back().time;
+            fetchedHash = wtokenTxs.back().hash;
+        }
+
+        for(interfaces::TokenTx& wtokenTx : wtokenTxs)
+        {
+            // An entry whose time was fixed up below the cursor comes back with the next window
+            QList<TokenTransactionRecord>::iterator lower = qLowerBound(cachedWallet.begin(), cachedWallet.end(), wtokenTx.hash, TokenTxLessThan());
+            if(lower != cachedWallet.end() && lower->hash == wtokenTx.hash)
+                continue;
+
+            // Update token transaction time if the block time is changed
+            int64_t time = node.getBlockTime(wtokenTx.block_number);
+            if(time && time != wtokenTx.time)
             {
-                // Update token transaction time if the block time is changed
-                int64_t time = node.getBlockTime(wtokenTx.block_number);
-                if(time && time != wtokenTx.time)
-                {
-                    wtokenTx.time = time;
-                    wallet.addTokenTxEntry(wtokenTx, false);
-                }
+                wtokenTx.time = time;
+                wallet.addTokenTxEntry(wtokenTx, false);
+            }
 
-                // Add token tx to the cache
-                cachedWallet.append(TokenTransactionRecord::decomposeTransaction(wallet, wtokenTx));
+            // Add token tx to the cache
+            QList<TokenTransactionRecord> toInsert = TokenTransactionRecord::decomposeTransaction(wallet, wtokenTx);
+            if(toInsert.isEmpty())
+                continue;
+            int insert_idx = lower - cachedWallet.begin();
+            if(notify)
+                parent->beginInsertRows(QModelIndex(), insert_idx, insert_idx+toInsert.size()-1);
+            Q_FOREACH(const TokenTransactionRecord &rec, toInsert)
+            {
+                cachedWallet.insert(insert_idx, rec);
+                insert_idx += 1;
             }
+            if(notify)
+                parent->endInsertRows();
         }
     }
 
@@ -121,6 +178,12 @@ public:
             showTransaction = false;
         }
 
+        if(!inModel && wtokenTx.hash == hash && !isFetched(wtokenTx))
+        {
+            // Not fetched yet, it is picked up with its window
+            return;
+        }
+
         if(status == CT_UPDATED)
         {
             if(showTransaction && !inModel)
@@ -304,6 +367,24 @@ int TokenTransactionTableModel::rowCount(const QModelIndex &parent) const
     return priv->size();
 }
 
+bool TokenTransactionTableModel::canFetchMore(const QModelIndex &parent) const
+{
+    if (parent.isValid())
+        return false;
+    return priv->canFetchMore();
+}
+
+void TokenTransactionTableModel::fetchMore(const QModelIndex &parent)
+{
+    if (parent.isValid())
+        return;
+    // Rows inserted by a fetch are history, not incoming transactions
+    bool processing = fProcessingQueuedTransactions;
+    fProcessingQueuedTransactions = true;
+    priv->fetchMore(walletModel->node(), walletModel->wallet(), true);
+    fProcessingQueuedTransactions = processing;
+}
+
 int TokenTransactionTableModel::columnCount(const QModelIndex &parent) const
 {
     Q_UNUSED(parent);
@@ -20,6 +20,7 @@
 #include <uint256.h>
 
 #include <algorithm>
+#include <limits>
 
 #include <QColor>
 #include <QDateTime>
@@ -40,6 +41,8 @@ static int column_alignments[] = {
         Qt::AlignRight|Qt::AlignVCenter /* amount */
     };
 static int dataChangedChunk = 500;
+// Number of wallet transactions read from the core per fetch
+static size_t fetchChunk = 1000;
 
 // Comparison operator for sort/binary search of model tx list
 struct TxLessThan
@@ -69,25 +72,54 @@ public:
 
     TransactionTableModel *parent;
 
-    /* Local cache of wallet.
-     * As it is in the same order as the CWallet, by definition
-     * this is sorted by sha256.
+    /* Local cache of the part of the wallet fetched so far, sorted by sha256.
+     * Transactions are fetched newest first, in windows, as the view scrolls.
      */
     QList<TransactionRecord> cachedWallet;
     bool isDataLoading = true;
 
-    /* Query entire wallet anew from core.
+    /* All wallet transactions at or after this order position are in the cache.
+     */
+    int64_t fetchedFrom = std::numeric_limits<int64_t>::max();
+
+    /* Query the newest part of the wallet anew from core.
      */
     void refreshWallet(interfaces::Wallet& wallet)
     {
         qDebug() << "TransactionTablePriv::refreshWallet";
         cachedWallet.clear();
-        {
-            for (const auto& wtx : wallet.getWalletTxs()) {
-                if (TransactionRecord::showTransaction(wtx)) {
-                    cachedWallet.append(TransactionRecord::decomposeTransaction(wtx));
-                }
+        fetchedFrom = std::numeric_limits<int64_t>::max();
+        fetchMore(wallet, false);
+    }
+
+    bool canFetchMore() const
+    {
+        return fetchedFrom != std::numeric_limits<int64_t>::min();
+    }
+
+    /* Fetch the next window of older transactions from core.
+     */
+    void fetchMore(interfaces::Wallet& wallet, bool notify)
+    {
+        std::vector<interfaces::WalletTx> wtxs = wallet.getWalletTxsBefore(fetchedFrom, fetchChunk);
+        fetchedFrom = wtxs.size() < fetchChunk ? std::numeric_limits<int64_t>::min() : wtxs.back().order_pos;
+
+        for (const auto& wtx : wtxs) {
+            if (!TransactionRecord::showTransaction(wtx))
+                continue;
+            QList<TransactionRecord> toInsert = TransactionRecord::decomposeTransaction(wtx);
+            if (toInsert.isEmpty())
+                continue;
+            int insert_idx = std::lower_bound(cachedWallet.begin(), cachedWallet.end(), wtx.tx->GetHash(), TxLessThan()) - cachedWallet.begin();
+            if (notify)
+                parent->beginInsertRows(QModelIndex(), insert_idx, insert_idx+toInsert.size()-1);
+            for (const TransactionRecord &rec : toInsert)
+            {
+                cachedWallet.insert(insert_idx, rec);
+                insert_idx += 1;
             }
+            if (notify)
+                parent->endInsertRows();
         }
     }
 
@@ -114,6 +146,12 @@ public:
         int upperIndex = (upper - cachedWallet.begin());
         bool inModel = (lower != upper);
 
+        if(!inModel && wtx.tx && wtx.order_pos < fetchedFrom)
+        {
+            // Not fetched yet, it is picked up with its window
+            return;
+        }
+
         if(status == CT_UPDATED)
         {
             if(showTransaction && !inModel)
@@ -289,6 +327,24 @@ int TransactionTableModel::rowCount(const QModelIndex &parent) const
     return priv->size();
 }
 
+bool TransactionTableModel::canFetchMore(const QModelIndex &parent) const
+{
+    if (parent.isValid())
+        return false;
+    return priv->canFetchMore();
+}
+
+void TransactionTableModel::fetchMore(const QModelIndex &parent)
+{
+    if (parent.isValid())
+        return;
+    // Rows inserted by a fetch are history, not incoming transactions
+    bool processing = fProcessingQueuedTransactions;
+    fProcessingQueuedTransactions = true;
+    priv->fetchMore(walletModel->wallet(), true);
+    fProcessingQueuedTransactions = processing;
+}
+
 int TransactionTableModel::columnCount(const QModelIndex &parent) const
 {
     Q_UNUSED(parent);
@@ -363,6 +363,10 @@ void TransactionView::exportClicked()
     if (filename.isNull())
         return;
 
+    // The model only holds the part of the history scrolled to so far
+    while (transactionProxyModel->canFetchMore(QModelIndex()))
+        transactionProxyModel->fetchMore(QModelIndex());
+
     CSVModelWriter writer(filename);
 
     // name, column, role
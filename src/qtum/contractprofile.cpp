@@ -0,0 +1,152 @@
+// Copyright (c) 2020 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <qtum/contractprofile.h>
+
+#include <util/time.h>
+
+#include <algorithm>
+#include <assert.h>
+
+ContractProfiler g_contract_profiler;
+
+OnOpFunc ContractOpTracer::Func()
+{
+    return [this](uint64_t, uint64_t, dev::eth::Instruction inst, dev::bigint, dev::bigint gas_cost,
+                  dev::bigint, dev::eth::VMFace const*, dev::eth::ExtVMFace const* ext) {
+        Step(inst, gas_cost, ext);
+    };
+}
+
+void ContractOpTracer::Step(dev::eth::Instruction inst, const dev::bigint& gas_cost, const dev::eth::ExtVMFace* ext)
+{
+    if (!ext) return;
+    // Consecutive instructions almost always run in the same contract
+    if (!m_last || m_last_address != ext->myAddress) {
+        m_last_address = ext->myAddress;
+        m_last = &m_counters[m_last_address];
+    }
+    m_last->self_gas += (uint64_t)gas_cost;
+    if (inst == dev::eth::Instruction::SLOAD) ++m_last->sloads;
+    else if (inst == dev::eth::Instruction::SSTORE) ++m_last->sstores;
+    m_last->max_depth = std::max(m_last->max_depth, ext->depth);
+}
+
+bool ContractProfiler::ShouldSample()
+{
+    const unsigned int rate = m_rate.load(std::memory_order_relaxed);
+    if (rate == 0) return false;
+    if (rate == 1) return true;
+    return m_counter.fetch_add(1, std::memory_order_relaxed) % rate == 0;
+}
+
+void ContractProfiler::Add(const QtumTransaction& tx, const ResultExecute& result, int64_t time_us, const ContractOpTracer& tracer)
+{
+    const dev::eth::ExecutionResult& res = result.execRes;
+    const bool excepted = res.excepted != dev::eth::TransactionException::None;
+    const uint64_t gas = (uint64_t)res.gasUsed;
+    if (tx.isCreation()) {
+        // Failed creations have no address to account them to
+        if (res.newAddress) Add(res.newAddress, nullptr, excepted, gas, time_us);
+    } else {
+        const dev::bytes& data = tx.data();
+        if (data.size() >= 4) {
+            const uint32_t selector = ((uint32_t)data[0] << 24) | ((uint32_t)data[1] << 16) | ((uint32_t)data[2] << 8) | data[3];
+            Add(tx.receiveAddress(), &selector, excepted, gas, time_us);
+        } else {
+            Add(tx.receiveAddress(), nullptr, excepted, gas, time_us);
+        }
+    }
+    AddOps(tracer.Counters());
+}
+
+ContractProfile& ContractProfiler::Entry(const dev::Address& address)
+{
+    auto it = m_contracts.find(address);
+    if (it != m_contracts.end()) return it->second;
+    if (m_contracts.size() >= m_max_entries && !m_contracts.empty()) {
+        auto least = std::min_element(m_contracts.begin(), m_contracts.end(), [](const std::pair<const dev::Address, ContractProfile>& a, const std::pair<const dev::Address, ContractProfile>& b) {
+            return a.second.exec.gas_used + a.second.ops.self_gas < b.second.exec.gas_used + b.second.ops.self_gas;
+        });
+        m_contracts.erase(least);
+    }
+    ContractProfile& profile = m_contracts[address];
+    profile.address = address;
+    return profile;
+}
+
+void ContractProfiler::Add(const dev::Address& address, const uint32_t* selector, bool excepted, uint64_t gas, int64_t time_us)
+{
+    LOCK(m_mutex);
+    if (m_executions++ == 0 && m_since == 0) m_since = GetTime();
+    ContractProfile& profile = Entry(address);
+    profile.exec.Add(excepted, gas, time_us);
+    if (!selector) return;
+    auto it = profile.selectors.find(*selector);
+    if (it == profile.selectors.end()) {
+        if (profile.selectors.size() >= MAX_CONTRACT_PROFILE_SELECTORS) return;
+        it = profile.selectors.emplace(*selector, ContractExecStats()).first;
+    }
+    it->second.Add(excepted, gas, time_us);
+}
+
+void ContractProfiler::AddOps(const std::map<dev::Address, ContractOpCounters>& counters)
+{
+    LOCK(m_mutex);
+    for (const auto& item : counters) {
+        ContractProfile& profile = Entry(item.first);
+        profile.ops.self_gas += item.second.self_gas;
+        profile.ops.sloads += item.second.sloads;
+        profile.ops.sstores += item.second.sstores;
+        profile.ops.max_depth = std::max(profile.ops.max_depth, item.second.max_depth);
+    }
+}
+
+static uint64_t SortKey(const ContractProfile& profile, ContractProfiler::SortBy sort_by)
+{
+    switch (sort_by) {
+    case ContractProfiler::SortBy::GAS: return profile.exec.gas_used;
+    case ContractProfiler::SortBy::SELF_GAS: return profile.ops.self_gas;
+    case ContractProfiler::SortBy::TIME: return profile.exec.time_us;
+    case ContractProfiler::SortBy::CALLS: return profile.exec.calls;
+    case ContractProfiler::SortBy::SLOADS: return profile.ops.sloads;
+    case ContractProfiler::SortBy::SSTORES: return profile.ops.sstores;
+    } // no default case, so the compiler can warn about missing cases
+    assert(false);
+}
+
+std::vector<ContractProfile> ContractProfiler::GetTop(size_t count, SortBy sort_by) const
+{
+    std::vector<ContractProfile> ret;
+    {
+        LOCK(m_mutex);
+        ret.reserve(m_contracts.size());
+        for (const auto& item : m_contracts) ret.push_back(item.second);
+    }
+    auto cmp = [sort_by](const ContractProfile& a, const ContractProfile& b) {
+        return SortKey(a, sort_by) > SortKey(b, sort_by);
+    };
+    if (count < ret.size()) {
+        std::partial_sort(ret.begin(), ret.begin() + count, ret.end(), cmp);
+        ret.resize(count);
+    } else {
+        std::sort(ret.begin(), ret.end(), cmp);
+    }
+    return ret;
+}
+
+void ContractProfiler::GetTotals(uint64_t& executions, int64_t& since) const
+{
+    LOCK(m_mutex);
+    executions = m_executions;
+    since = m_since;
+}
+
+void ContractProfiler::Reset()
+{
+    LOCK(m_mutex);
+    m_contracts.clear();
+    m_executions = 0;
+    m_since = GetTime();
+}
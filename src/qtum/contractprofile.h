@@ -0,0 +1,112 @@
+// Copyright (c) 2020 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_QTUM_CONTRACTPROFILE_H
+#define BITCOIN_QTUM_CONTRACTPROFILE_H
+
+#include <qtum/qtumstate.h>
+#include <sync.h>
+
+#include <atomic>
+#include <map>
+#include <stdint.h>
+#include <vector>
+
+/** Default sample rate of the contract profiler (0 = disabled) */
+static const unsigned int DEFAULT_CONTRACT_PROFILE_RATE = 0;
+/** Function selectors tracked per contract, further selectors are not broken out */
+static const size_t MAX_CONTRACT_PROFILE_SELECTORS = 256;
+/** Contracts tracked by the profiler, the one with the least gas is evicted to make room */
+static const size_t MAX_CONTRACT_PROFILE_ENTRIES = 10000;
+
+/** Opcode counters of the code running in one contract during a sampled execution */
+struct ContractOpCounters {
+    uint64_t self_gas{0};
+    uint64_t sloads{0};
+    uint64_t sstores{0};
+    unsigned int max_depth{0};
+};
+
+/** Counters of the executions of one contract, or of one of its functions */
+struct ContractExecStats {
+    uint64_t calls{0};
+    uint64_t errors{0};
+    uint64_t gas_used{0};
+    int64_t time_us{0};
+
+    void Add(bool excepted, uint64_t gas, int64_t us)
+    {
+        ++calls;
+        if (excepted) ++errors;
+        gas_used += gas;
+        time_us += us;
+    }
+};
+
+struct ContractProfile {
+    dev::Address address;
+    /** Executions of transactions sent to the contract */
+    ContractExecStats exec;
+    /** Opcodes executed in the contract's code, including when reached through an inner call */
+    ContractOpCounters ops;
+    std::map<uint32_t, ContractExecStats> selectors;
+};
+
+/** Per-instruction tracer collecting the opcode counters of each contract run by one transaction */
+class ContractOpTracer
+{
+public:
+    OnOpFunc Func();
+    const std::map<dev::Address, ContractOpCounters>& Counters() const { return m_counters; }
+
+private:
+    void Step(dev::eth::Instruction inst, const dev::bigint& gas_cost, const dev::eth::ExtVMFace* ext);
+
+    std::map<dev::Address, ContractOpCounters> m_counters;
+    dev::Address m_last_address;
+    ContractOpCounters* m_last{nullptr};
+};
+
+/**
+ * Aggregates gas, wall time and storage access of sampled contract executions
+ * per contract address and function selector. With a sample rate of n, one in
+ * n executions is traced; when disabled the only cost is one atomic load per
+ * execution. At most max_entries contracts are kept.
+ */
+class ContractProfiler
+{
+public:
+    explicit ContractProfiler(size_t max_entries = MAX_CONTRACT_PROFILE_ENTRIES) : m_max_entries(max_entries) {}
+
+    void SetSampleRate(unsigned int rate) { m_rate = rate; }
+    unsigned int SampleRate() const { return m_rate.load(std::memory_order_relaxed); }
+    bool ShouldSample();
+
+    void Add(const QtumTransaction& tx, const ResultExecute& result, int64_t time_us, const ContractOpTracer& tracer);
+    void Add(const dev::Address& address, const uint32_t* selector, bool excepted, uint64_t gas, int64_t time_us);
+    void AddOps(const std::map<dev::Address, ContractOpCounters>& counters);
+
+    enum class SortBy { GAS, SELF_GAS, TIME, CALLS, SLOADS, SSTORES };
+    /** The count contracts with the highest value of the sort key */
+    std::vector<ContractProfile> GetTop(size_t count, SortBy sort_by) const;
+    /** Number of sampled executions and start time of the current profile */
+    void GetTotals(uint64_t& executions, int64_t& since) const;
+    void Reset();
+
+private:
+    /** The profile of a contract, evicting the one with the least gas used if there is no room */
+    ContractProfile& Entry(const dev::Address& address) EXCLUSIVE_LOCKS_REQUIRED(m_mutex);
+
+    const size_t m_max_entries;
+    mutable Mutex m_mutex;
+    std::atomic<unsigned int> m_rate{DEFAULT_CONTRACT_PROFILE_RATE};
+    std::atomic<uint64_t> m_counter{0};
+    std::map<dev::Address, ContractProfile> m_contracts GUARDED_BY(m_mutex);
+    uint64_t m_executions GUARDED_BY(m_mutex){0};
+    int64_t m_since GUARDED_BY(m_mutex){0};
+};
+
+extern ContractProfiler g_contract_profiler;
+
+#endif // BITCOIN_QTUM_CONTRACTPROFILE_H
@@ -0,0 +1,134 @@
+// Copyright (c) 2020 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <qtum/precompiles.h>
+
+#include <crypto/ripemd160.h>
+#include <crypto/sha256.h>
+#include <pubkey.h>
+
+#include <libdevcore/SHA3.h>
+
+#include <algorithm>
+#include <mutex>
+#include <string.h>
+
+PairingCache g_pairing_cache;
+
+//! Executors replaced by RegisterNativePrecompiles, by name
+static std::map<std::string, dev::eth::PrecompiledExecutor> g_generic_precompiles;
+
+bool PairingCache::Get(const uint256& key, Result& result)
+{
+    LOCK(m_mutex);
+    auto it = m_map.find(key);
+    if (it == m_map.end()) {
+        ++m_misses;
+        return false;
+    }
+    m_lru.splice(m_lru.begin(), m_lru, it->second);
+    result = it->second->second;
+    ++m_hits;
+    return true;
+}
+
+void PairingCache::Put(const uint256& key, Result result)
+{
+    LOCK(m_mutex);
+    if (m_max_entries == 0 || m_map.count(key)) return;
+    m_lru.emplace_front(key, std::move(result));
+    m_map.emplace(key, m_lru.begin());
+    if (m_lru.size() > m_max_entries) {
+        m_map.erase(m_lru.back().first);
+        m_lru.pop_back();
+    }
+}
+
+void PairingCache::Clear()
+{
+    LOCK(m_mutex);
+    m_lru.clear();
+    m_map.clear();
+}
+
+uint64_t PairingCache::Hits() const
+{
+    LOCK(m_mutex);
+    return m_hits;
+}
+
+uint64_t PairingCache::Misses() const
+{
+    LOCK(m_mutex);
+    return m_misses;
+}
+
+std::pair<bool, dev::bytes> PrecompileEcrecover(dev::bytesConstRef _in)
+{
+    // hash, v, r and s as 32 byte words, zero padded when the input is short
+    unsigned char in[128] = {0};
+    memcpy(in, _in.data(), std::min(_in.size(), sizeof(in)));
+
+    // v is 27 or 28; r and s are checked to be in [1, n) by the parsing and the recovery
+    if (std::any_of(in + 32, in + 63, [](unsigned char c) { return c != 0; }) || (in[63] != 27 && in[63] != 28)) {
+        return {true, {}};
+    }
+    std::vector<unsigned char> sig(CPubKey::COMPACT_SIGNATURE_SIZE);
+    sig[0] = in[63];
+    memcpy(sig.data() + 1, in + 64, 64);
+    CPubKey pubkey;
+    if (!pubkey.RecoverCompact(uint256(std::vector<unsigned char>(in, in + 32)), sig)) {
+        return {true, {}};
+    }
+
+    // The address is the low 20 bytes of the keccak256 of the uncompressed key, without its prefix
+    dev::h256 hash = dev::sha3(dev::bytesConstRef(pubkey.begin() + 1, 64));
+    memset(hash.data(), 0, 12);
+    return {true, hash.asBytes()};
+}
+
+std::pair<bool, dev::bytes> PrecompileSha256(dev::bytesConstRef _in)
+{
+    dev::bytes out(CSHA256::OUTPUT_SIZE);
+    CSHA256().Write(_in.data(), _in.size()).Finalize(out.data());
+    return {true, out};
+}
+
+std::pair<bool, dev::bytes> PrecompileRipemd160(dev::bytesConstRef _in)
+{
+    dev::bytes out(32);
+    CRIPEMD160().Write(_in.data(), _in.size()).Finalize(out.data() + 32 - CRIPEMD160::OUTPUT_SIZE);
+    return {true, out};
+}
+
+void RegisterNativePrecompiles()
+{
+    // The test fixtures call this once per test case; only wrap the pairing check once
+    static std::once_flag registered;
+    std::call_once(registered, [] {
+        for (const char* name : {"ecrecover", "sha256", "ripemd160"}) {
+            g_generic_precompiles[name] = dev::eth::PrecompiledRegistrar::executor(name);
+        }
+        dev::eth::PrecompiledRegistrar::registerExecutor("ecrecover", PrecompileEcrecover);
+        dev::eth::PrecompiledRegistrar::registerExecutor("sha256", PrecompileSha256);
+        dev::eth::PrecompiledRegistrar::registerExecutor("ripemd160", PrecompileRipemd160);
+
+        dev::eth::PrecompiledExecutor pairing = dev::eth::PrecompiledRegistrar::executor("alt_bn128_pairing_product");
+        dev::eth::PrecompiledRegistrar::registerExecutor("alt_bn128_pairing_product", [pairing](dev::bytesConstRef _in) {
+            uint256 key;
+            CSHA256().Write(_in.data(), _in.size()).Finalize(key.begin());
+            PairingCache::Result result;
+            if (g_pairing_cache.Get(key, result)) return result;
+            // Invalid inputs fail the same way every time, so failures are cached too
+            result = pairing(_in);
+            g_pairing_cache.Put(key, result);
+            return result;
+        });
+    });
+}
+
+dev::eth::PrecompiledExecutor GenericPrecompile(const std::string& name)
+{
+    return g_generic_precompiles.at(name);
+}
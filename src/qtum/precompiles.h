@@ -0,0 +1,80 @@
+// Copyright (c) 2020 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_QTUM_PRECOMPILES_H
+#define BITCOIN_QTUM_PRECOMPILES_H
+
+#include <sync.h>
+#include <uint256.h>
+
+#include <libdevcore/Common.h>
+#include <libethcore/Precompiled.h>
+
+#include <list>
+#include <map>
+#include <stdint.h>
+#include <string>
+#include <utility>
+
+/** Number of alt_bn128 pairing check results kept in g_pairing_cache */
+static const size_t DEFAULT_PAIRING_CACHE_ENTRIES = 1024;
+
+/**
+ * Least recently used cache of alt_bn128 pairing check results, keyed by the
+ * SHA256 of the precompile input.
+ *
+ * The pairing check is by far the most expensive precompile, and the same
+ * proofs are checked again when a transaction is validated for the mempool,
+ * included in a block template and connected in a block, or replayed by
+ * callcontract. The check is a pure function of its input, so a cached result
+ * is always valid.
+ */
+class PairingCache
+{
+public:
+    using Result = std::pair<bool, dev::bytes>;
+
+    explicit PairingCache(size_t max_entries = DEFAULT_PAIRING_CACHE_ENTRIES) : m_max_entries(max_entries) {}
+
+    bool Get(const uint256& key, Result& result);
+    void Put(const uint256& key, Result result);
+    void Clear();
+
+    uint64_t Hits() const;
+    uint64_t Misses() const;
+
+private:
+    using Entry = std::pair<uint256, Result>;
+
+    mutable Mutex m_mutex;
+    //! Most recently used first
+    std::list<Entry> m_lru GUARDED_BY(m_mutex);
+    std::map<uint256, std::list<Entry>::iterator> m_map GUARDED_BY(m_mutex);
+    const size_t m_max_entries;
+    uint64_t m_hits GUARDED_BY(m_mutex){0};
+    uint64_t m_misses GUARDED_BY(m_mutex){0};
+};
+
+extern PairingCache g_pairing_cache;
+
+/** ecrecover with libsecp256k1, with the same results as the generic precompile */
+std::pair<bool, dev::bytes> PrecompileEcrecover(dev::bytesConstRef _in);
+/** sha256 with the SHA256 implementation picked by SHA256AutoDetect() */
+std::pair<bool, dev::bytes> PrecompileSha256(dev::bytesConstRef _in);
+/** ripemd160, left padded to 32 bytes */
+std::pair<bool, dev::bytes> PrecompileRipemd160(dev::bytesConstRef _in);
+
+/**
+ * Replace the generic ecrecover, sha256 and ripemd160 executors of the EVM
+ * with the ones above, and put g_pairing_cache in front of the alt_bn128
+ * pairing check. Requires ECC_Start() and SHA256AutoDetect() to have run, and
+ * must be called before the first dev::eth::ChainParams is built, as that
+ * copies the executors.
+ */
+void RegisterNativePrecompiles();
+
+/** The generic executor that RegisterNativePrecompiles replaced for name, to check the native one against */
+dev::eth::PrecompiledExecutor GenericPrecompile(const std::string& name);
+
+#endif // BITCOIN_QTUM_PRECOMPILES_H
@@ -4,7 +4,9 @@
 #include <chainparams.h>
 #include <script/script.h>
 #include <qtum/qtumstate.h>
+#include <qtum/trienodecache.h>
 #include <libevm/VMFace.h>
+#include <libdevcore/DBFactory.h>
 
 using namespace std;
 using namespace dev;
@@ -21,6 +23,23 @@ QtumState::QtumState() : dev::eth::State(dev::Invalid256, dev::OverlayDB(), dev:
     stateUTXO = SecureTrieDB<Address, OverlayDB>(&dbUTXO);
 }
 
+OverlayDB QtumState::openDB(std::string const& _path, h256 const& _genesisHash, WithExisting _we){
+    // Same layout as State::openDB, so existing state directories are found
+    boost::filesystem::path path(_path);
+    if (db::isDiskDatabase() && _we == WithExisting::Kill)
+        boost::filesystem::remove_all(path / boost::filesystem::path("state"));
+
+    path /= boost::filesystem::path(toHex(_genesisHash.ref().cropped(0, 4))) / boost::filesystem::path(toString(c_databaseVersion));
+    if (db::isDiskDatabase())
+    {
+        boost::filesystem::create_directories(path);
+        DEV_IGNORE_EXCEPTIONS(boost::filesystem::permissions(path, boost::filesystem::owner_all));
+    }
+
+    std::unique_ptr<db::DatabaseFace> stateDB = db::DBFactory::create(path / boost::filesystem::path("state"));
+    return OverlayDB(std::unique_ptr<db::DatabaseFace>(new CachedStateDB(std::move(stateDB), g_trie_node_cache)));
+}
+
 ResultExecute QtumState::execute(EnvInfo const& _envInfo, SealEngineFace const& _sealEngine, QtumTransaction const& _t, Permanence _p, OnOpFunc const& _onOp){
 
     assert(_t.getVersion().toRaw() == VersionVM::GetEVMDefault().toRaw());
@@ -33,6 +52,7 @@ ResultExecute QtumState::execute(EnvInfo const& _envInfo, SealEngineFace const&
     h256 oldStateRoot = rootHash();
     h256 oldUTXORoot = rootHashUTXO();
     bool voutLimit = false;
+    std::set<dev::Address> createdContracts, destroyedAccounts;
 
 	auto onOp = _onOp;
 #if ETH_VMTRACE
@@ -84,6 +104,7 @@ ResultExecute QtumState::execute(EnvInfo const& _envInfo, SealEngineFace const&
                 printfErrorLog(res.excepted);
             }
 
+            changedContracts(_sealEngine.deleteAddresses, createdContracts, destroyedAccounts);
             qtum::commit(cacheUTXO, stateUTXO, m_cache);
             cacheUTXO.clear();
             bool removeEmptyAccounts = _envInfo.number() >= _sealEngine.chainParams().EIP158ForkBlock;
@@ -91,6 +112,8 @@ ResultExecute QtumState::execute(EnvInfo const& _envInfo, SealEngineFace const&
         }
     }
     catch(Exception const& _e){
+        createdContracts.clear();
+        destroyedAccounts.clear();
         printfErrorLog(dev::eth::toTransactionException(_e));
         res.excepted = dev::eth::toTransactionException(_e);
         res.gasUsed = _t.gas();
@@ -126,7 +149,21 @@ ResultExecute QtumState::execute(EnvInfo const& _envInfo, SealEngineFace const&
         //make sure to use empty transaction if no vouts made
         return ResultExecute{ex, QtumTransactionReceipt(oldStateRoot, oldUTXORoot, gas, e.logs()), refund.vout.empty() ? CTransaction() : CTransaction(refund)};
     }else{
-        return ResultExecute{res, QtumTransactionReceipt(rootHash(), rootHashUTXO(), startGasUsed + e.gasUsed(), e.logs()), tx ? *tx : CTransaction()};
+        return ResultExecute{res, QtumTransactionReceipt(rootHash(), rootHashUTXO(), startGasUsed + e.gasUsed(), e.logs()), tx ? *tx : CTransaction(), createdContracts, destroyedAccounts};
+    }
+}
+
+void QtumState::changedContracts(std::set<dev::Address> const& _deleteAddresses, std::set<dev::Address>& _created, std::set<dev::Address>& _destroyed) const
+{
+    // Reverted calls have already been rolled back from the change log, so
+    // every account created there still exists unless it self destructed
+    for (auto const& change : m_changeLog) {
+        if (change.kind == dev::eth::Change::Create && addressHasCode(change.address))
+            _created.insert(change.address);
+    }
+    for (auto const& entry : m_cache) {
+        if (!entry.second.isAlive() && !_deleteAddresses.count(entry.first))
+            _destroyed.insert(entry.first);
     }
 }
 
@@ -175,6 +212,34 @@ Vin* QtumState::vin(dev::Address const& _addr)
     return &it->second;
 }
 
+bool QtumState::storageRange(dev::h256 const& _root, dev::Address const& _id, dev::h256 const& _begin, size_t _maxResults,
+                             std::vector<StorageEntry>& _entries, dev::h256& _next) const
+{
+    _entries.clear();
+    _next = dev::h256();
+
+    // The tries are only read from, the overlay is never written through them
+    OverlayDB* db = const_cast<OverlayDB*>(&this->db());
+    SecureTrieDB<Address, OverlayDB> state(db, _root);
+    std::string stateBack = state.at(_id);
+    if (stateBack.empty())
+        return false;
+
+    // Account RLP: nonce, balance, storage root, code hash
+    dev::RLP account(stateBack);
+    SecureTrieDB<h256, OverlayDB> storage(db, account[2].toHash<dev::h256>());
+    for (auto it = storage.hashedLowerBound(_begin); it != storage.hashedEnd(); ++it)
+    {
+        dev::h256 hashedKey(it.hashedKey());
+        if (_entries.size() >= _maxResults) {
+            _next = hashedKey;
+            break;
+        }
+        _entries.push_back(StorageEntry{hashedKey, dev::u256(dev::h256(it.key())), dev::RLP((*it).second).toInt<dev::u256>()});
+    }
+    return true;
+}
+
 // void QtumState::commit(CommitBehaviour _commitBehaviour)
 // {
 //     if (_commitBehaviour == CommitBehaviour::RemoveEmptyAccounts)
@@ -13,6 +13,8 @@
 #include <libethereum/Executive.h>
 #include <libethcore/SealEngine.h>
 
+#include <set>
+
 using OnOpFunc = std::function<void(uint64_t, uint64_t, dev::eth::Instruction, dev::bigint, dev::bigint, 
     dev::bigint, dev::eth::VMFace const*, dev::eth::ExtVMFace const*)>;
 using plusAndMinus = std::pair<dev::u256, dev::u256>;
@@ -42,10 +44,20 @@ private:
     dev::h256 m_utxoRoot;
 };
 
+struct StorageEntry{
+    dev::h256 hashedKey;
+    dev::u256 key;
+    dev::u256 value;
+};
+
 struct ResultExecute{
     dev::eth::ExecutionResult execRes;
     QtumTransactionReceipt txRec;
     CTransaction tx;
+    //! Contracts created by the transaction, by its own CREATE or by the contracts it called
+    std::set<dev::Address> createdContracts;
+    //! Accounts that self destructed, without the ones removed after every execution such as the sender's
+    std::set<dev::Address> destroyedAccounts;
 };
 
 namespace qtum{
@@ -77,6 +89,13 @@ public:
 
     QtumState(dev::u256 const& _accountStartNonce, dev::OverlayDB const& _db, const std::string& _path, dev::eth::BaseState _bs = dev::eth::BaseState::PreExisting);
 
+    /**
+     * Open a state database like State::openDB, with the trie node lookups
+     * going through g_trie_node_cache. Used for both the EVM state and the
+     * contract UTXO database.
+     */
+    static dev::OverlayDB openDB(std::string const& _path, dev::h256 const& _genesisHash, dev::WithExisting _we = dev::WithExisting::Trust);
+
     ResultExecute execute(dev::eth::EnvInfo const& _envInfo, dev::eth::SealEngineFace const& _sealEngine, QtumTransaction const& _t, dev::eth::Permanence _p = dev::eth::Permanence::Committed, dev::eth::OnOpFunc const& _onOp = OnOpFunc());
 
     void setRootUTXO(dev::h256 const& _r) { cacheUTXO.clear(); stateUTXO.setRoot(_r); }
@@ -91,6 +110,19 @@ public:
 
     dev::OverlayDB& dbUtxo() { return dbUTXO; }
 
+    /**
+     * Walk the storage trie of _id as of state root _root, without moving the
+     * state to that root and without loading the whole storage.
+     *
+     * Slots are visited in hashed key order starting at _begin. At most
+     * _maxResults slots are collected into _entries; _next is set to the hashed
+     * key to resume from, or zero when the storage is exhausted.
+     *
+     * @return false if the account does not exist at _root.
+     */
+    bool storageRange(dev::h256 const& _root, dev::Address const& _id, dev::h256 const& _begin, size_t _maxResults,
+                      std::vector<StorageEntry>& _entries, dev::h256& _next) const;
+
     static const dev::Address createQtumAddress(dev::h256 hashTx, uint32_t voutNumber){
         uint256 hashTXid(h256Touint(hashTx));
         std::vector<unsigned char> txIdAndVout(hashTXid.begin(), hashTXid.end());
@@ -134,6 +166,9 @@ private:
 
     void printfErrorLog(const dev::eth::TransactionException er);
 
+    /** Contracts created and accounts destroyed by the transaction, read before the changes are committed */
+    void changedContracts(std::set<dev::Address> const& _deleteAddresses, std::set<dev::Address>& _created, std::set<dev::Address>& _destroyed) const;
+
     dev::Address newAddress;
 
     std::vector<TransferInfo> transfers;
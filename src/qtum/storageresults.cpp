@@ -1,4 +1,5 @@
 #include <qtum/storageresults.h>
+#include <memusage.h>
 #include <util/convert.h>
 
 StorageResults::StorageResults(std::string const& _path){
@@ -24,6 +25,21 @@ void StorageResults::clearCacheResult(){
     m_cache_result.clear();
 }
 
+size_t StorageResults::DynamicMemoryUsage() const
+{
+    size_t usage = memusage::DynamicUsage(m_cache_result);
+    for (const auto& entry : m_cache_result) {
+        usage += memusage::DynamicUsage(entry.second);
+        for (const TransactionReceiptInfo& receipt : entry.second) {
+            usage += memusage::DynamicUsage(receipt.logs);
+            for (const dev::eth::LogEntry& log : receipt.logs) {
+                usage += memusage::DynamicUsage(log.topics) + memusage::DynamicUsage(log.data);
+            }
+        }
+    }
+    return usage;
+}
+
 void StorageResults::wipeResults(){
     LogPrintf("Wiping LevelDB in %s\n", path);
     bool opened = db;
@@ -52,6 +68,18 @@ void StorageResults::deleteResults(std::vector<CTransactionRef> const& txs){
     }
 }
 
+void StorageResults::deleteResults(std::vector<uint256> const& hashes){
+
+    leveldb::WriteBatch batch;
+    for(uint256 const& hash : hashes){
+        dev::h256 hashTx = uintToh256(hash);
+        m_cache_result.erase(hashTx);
+        batch.Delete(hashTx.hex());
+    }
+    leveldb::Status status = db->Write(leveldb::WriteOptions(), &batch);
+    assert(status.ok());
+}
+
 std::vector<TransactionReceiptInfo> StorageResults::getResult(dev::h256 const& hashTx){
     std::vector<TransactionReceiptInfo> result;
 	auto it = m_cache_result.find(hashTx);
@@ -3,6 +3,7 @@
 #include <libethereum/State.h>
 #include <libethereum/Transaction.h>
 #include <leveldb/db.h>
+#include <leveldb/write_batch.h>
 #include <util/system.h>
 
 using logEntriesSerialize = std::vector<std::pair<dev::Address, std::pair<dev::h256s, dev::bytes>>>;
@@ -56,6 +57,8 @@ public:
 
     void deleteResults(std::vector<CTransactionRef> const& txs);
 
+    void deleteResults(std::vector<uint256> const& hashes);
+
     std::vector<TransactionReceiptInfo> getResult(dev::h256 const& hashTx);
 
 	void commitResults();
@@ -64,6 +67,9 @@ public:
 
     void wipeResults();
 
+    /** Memory used by the results not yet committed */
+    size_t DynamicMemoryUsage() const;
+
 private:
 
 	bool readResult(dev::h256 const& _key, std::vector<TransactionReceiptInfo>& _result);
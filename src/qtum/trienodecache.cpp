@@ -0,0 +1,195 @@
+// Copyright (c) 2020 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <qtum/trienodecache.h>
+
+#include <memusage.h>
+
+TrieNodeCache g_trie_node_cache;
+
+size_t TrieNodeCache::EntryUsage(const std::string& value)
+{
+    // list node, hash map node and bucket, and the encoded node itself
+    return memusage::MallocUsage(sizeof(Entry) + 2 * sizeof(void*)) +
+           memusage::MallocUsage(sizeof(memusage::unordered_node<std::pair<const dev::h256, std::list<Entry>::iterator>>)) +
+           sizeof(void*) + memusage::MallocUsage(value.size());
+}
+
+void TrieNodeCache::Evict()
+{
+    while (m_usage > m_max_usage && !m_lru.empty()) {
+        const Entry& entry = m_lru.back();
+        m_usage -= EntryUsage(entry.second);
+        m_map.erase(entry.first);
+        m_lru.pop_back();
+        ++m_stats.evictions;
+    }
+}
+
+void TrieNodeCache::SetMaxUsage(size_t max_usage)
+{
+    LOCK(m_mutex);
+    m_max_usage = max_usage;
+    Evict();
+}
+
+bool TrieNodeCache::Get(const dev::h256& hash, std::string& value)
+{
+    LOCK(m_mutex);
+    if (m_max_usage == 0) return false;
+    auto it = m_map.find(hash);
+    if (it == m_map.end()) {
+        ++m_stats.misses;
+        return false;
+    }
+    m_lru.splice(m_lru.begin(), m_lru, it->second);
+    value = it->second->second;
+    ++m_stats.hits;
+    return true;
+}
+
+void TrieNodeCache::Put(const dev::h256& hash, std::string value)
+{
+    LOCK(m_mutex);
+    if (m_max_usage == 0 || value.empty()) return;
+    auto it = m_map.find(hash);
+    if (it != m_map.end()) {
+        // Same hash, same node: only refresh its position
+        m_lru.splice(m_lru.begin(), m_lru, it->second);
+        return;
+    }
+    m_usage += EntryUsage(value);
+    m_lru.emplace_front(hash, std::move(value));
+    m_map.emplace(hash, m_lru.begin());
+    ++m_stats.inserts;
+    Evict();
+}
+
+void TrieNodeCache::Erase(const dev::h256& hash)
+{
+    LOCK(m_mutex);
+    auto it = m_map.find(hash);
+    if (it == m_map.end()) return;
+    m_usage -= EntryUsage(it->second->second);
+    m_lru.erase(it->second);
+    m_map.erase(it);
+}
+
+void TrieNodeCache::Clear()
+{
+    LOCK(m_mutex);
+    m_lru.clear();
+    m_map.clear();
+    m_usage = 0;
+}
+
+TrieNodeCache::Stats TrieNodeCache::GetStats() const
+{
+    LOCK(m_mutex);
+    Stats stats = m_stats;
+    stats.entries = m_map.size();
+    stats.usage = m_usage;
+    stats.max_usage = m_max_usage;
+    return stats;
+}
+
+void TrieNodeCache::ResetStats()
+{
+    LOCK(m_mutex);
+    m_stats = Stats();
+}
+
+namespace {
+
+/** Write batch recording the nodes it writes, so they can be cached once the batch is committed */
+class CachedWriteBatch : public dev::db::WriteBatchFace
+{
+public:
+    explicit CachedWriteBatch(std::unique_ptr<dev::db::WriteBatchFace> batch) : m_batch(std::move(batch)) {}
+
+    void insert(dev::db::Slice _key, dev::db::Slice _value) override
+    {
+        m_batch->insert(_key, _value);
+        if (_key.size() == dev::h256::size) {
+            m_nodes.emplace_back(dev::h256((const dev::byte*)_key.data(), dev::h256::ConstructFromPointer), _value.toString());
+        }
+    }
+
+    void kill(dev::db::Slice _key) override
+    {
+        m_batch->kill(_key);
+        if (_key.size() == dev::h256::size) {
+            m_killed.emplace_back((const dev::byte*)_key.data(), dev::h256::ConstructFromPointer);
+        }
+    }
+
+    std::unique_ptr<dev::db::WriteBatchFace> m_batch;
+    std::vector<std::pair<dev::h256, std::string>> m_nodes;
+    std::vector<dev::h256> m_killed;
+};
+
+} // namespace
+
+std::string CachedStateDB::lookup(dev::db::Slice _key) const
+{
+    if (_key.size() != dev::h256::size) return m_db->lookup(_key);
+    const dev::h256 hash((const dev::byte*)_key.data(), dev::h256::ConstructFromPointer);
+    std::string value;
+    if (m_cache.Get(hash, value)) return value;
+    value = m_db->lookup(_key);
+    m_cache.Put(hash, value);
+    return value;
+}
+
+bool CachedStateDB::exists(dev::db::Slice _key) const
+{
+    if (_key.size() == dev::h256::size) {
+        std::string value;
+        if (m_cache.Get(dev::h256((const dev::byte*)_key.data(), dev::h256::ConstructFromPointer), value)) return true;
+    }
+    return m_db->exists(_key);
+}
+
+void CachedStateDB::insert(dev::db::Slice _key, dev::db::Slice _value)
+{
+    m_db->insert(_key, _value);
+    if (_key.size() == dev::h256::size) {
+        m_cache.Put(dev::h256((const dev::byte*)_key.data(), dev::h256::ConstructFromPointer), _value.toString());
+    }
+}
+
+void CachedStateDB::kill(dev::db::Slice _key)
+{
+    if (_key.size() == dev::h256::size) {
+        m_cache.Erase(dev::h256((const dev::byte*)_key.data(), dev::h256::ConstructFromPointer));
+    }
+    m_db->kill(_key);
+}
+
+std::unique_ptr<dev::db::WriteBatchFace> CachedStateDB::createWriteBatch() const
+{
+    return std::unique_ptr<dev::db::WriteBatchFace>(new CachedWriteBatch(m_db->createWriteBatch()));
+}
+
+void CachedStateDB::commit(std::unique_ptr<dev::db::WriteBatchFace> _batch)
+{
+    CachedWriteBatch* batch = dynamic_cast<CachedWriteBatch*>(_batch.get());
+    if (!batch) {
+        m_db->commit(std::move(_batch));
+        return;
+    }
+    for (const dev::h256& hash : batch->m_killed) {
+        m_cache.Erase(hash);
+    }
+    m_db->commit(std::move(batch->m_batch));
+    // Only cache what made it to disk
+    for (auto& node : batch->m_nodes) {
+        m_cache.Put(node.first, std::move(node.second));
+    }
+}
+
+void CachedStateDB::forEach(std::function<bool(dev::db::Slice, dev::db::Slice)> _f) const
+{
+    m_db->forEach(_f);
+}
@@ -0,0 +1,103 @@
+// Copyright (c) 2020 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_QTUM_TRIENODECACHE_H
+#define BITCOIN_QTUM_TRIENODECACHE_H
+
+#include <sync.h>
+
+#include <libdevcore/FixedHash.h>
+#include <libdevcore/db.h>
+
+#include <list>
+#include <memory>
+#include <stdint.h>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/** Default for -trienodecache, in MiB */
+static const int64_t DEFAULT_TRIE_NODE_CACHE_SIZE = 64;
+
+/**
+ * Least recently used cache of the RLP encoded trie nodes read from or written
+ * to the EVM state databases, keyed by node hash.
+ *
+ * Trie nodes are stored under the hash of their encoding, so an entry is valid
+ * for any state root that reaches it, and one cache can serve the state trie,
+ * the storage tries and the contract UTXO trie at once. It lives below the
+ * OverlayDB, so unlike the account and vin caches of QtumState it survives
+ * setRoot() and setRootUTXO(): moving between nearby roots, as TemporaryState,
+ * contract calls and reorgs do, finds the shared part of the tries here
+ * instead of in LevelDB.
+ */
+class TrieNodeCache
+{
+public:
+    struct Stats {
+        uint64_t hits{0};
+        uint64_t misses{0};
+        uint64_t inserts{0};
+        uint64_t evictions{0};
+        size_t entries{0};
+        size_t usage{0};
+        size_t max_usage{0};
+    };
+
+    explicit TrieNodeCache(size_t max_usage = DEFAULT_TRIE_NODE_CACHE_SIZE << 20) : m_max_usage(max_usage) {}
+
+    /** A size of zero disables the cache */
+    void SetMaxUsage(size_t max_usage);
+
+    bool Get(const dev::h256& hash, std::string& value);
+    void Put(const dev::h256& hash, std::string value);
+    void Erase(const dev::h256& hash);
+    void Clear();
+
+    Stats GetStats() const;
+    void ResetStats();
+
+private:
+    using Entry = std::pair<dev::h256, std::string>;
+
+    static size_t EntryUsage(const std::string& value);
+    void Evict() EXCLUSIVE_LOCKS_REQUIRED(m_mutex);
+
+    mutable Mutex m_mutex;
+    //! Most recently used first
+    std::list<Entry> m_lru GUARDED_BY(m_mutex);
+    std::unordered_map<dev::h256, std::list<Entry>::iterator> m_map GUARDED_BY(m_mutex);
+    size_t m_usage GUARDED_BY(m_mutex){0};
+    size_t m_max_usage GUARDED_BY(m_mutex);
+    Stats m_stats GUARDED_BY(m_mutex);
+};
+
+extern TrieNodeCache g_trie_node_cache;
+
+/**
+ * Database decorator that serves the trie node lookups of an EVM state
+ * database from a TrieNodeCache, and adds the nodes it commits to the cache.
+ * Only 32 byte keys are cached: those are node and code hashes, while the
+ * auxiliary entries of the OverlayDB use longer keys.
+ */
+class CachedStateDB : public dev::db::DatabaseFace
+{
+public:
+    CachedStateDB(std::unique_ptr<dev::db::DatabaseFace> db, TrieNodeCache& cache) : m_db(std::move(db)), m_cache(cache) {}
+
+    std::string lookup(dev::db::Slice _key) const override;
+    bool exists(dev::db::Slice _key) const override;
+    void insert(dev::db::Slice _key, dev::db::Slice _value) override;
+    void kill(dev::db::Slice _key) override;
+    std::unique_ptr<dev::db::WriteBatchFace> createWriteBatch() const override;
+    void commit(std::unique_ptr<dev::db::WriteBatchFace> _batch) override;
+    void forEach(std::function<bool(dev::db::Slice, dev::db::Slice)> _f) const override;
+
+private:
+    std::unique_ptr<dev::db::DatabaseFace> m_db;
+    TrieNodeCache& m_cache;
+};
+
+#endif // BITCOIN_QTUM_TRIENODECACHE_H
@@ -20,7 +20,6 @@
 #include <key_io.h>
 #include <policy/feerate.h>
 #include <policy/policy.h>
-#include <policy/rbf.h>
 #include <primitives/transaction.h>
 #include <rpc/server.h>
 #include <rpc/util.h>
@@ -34,6 +33,7 @@
 #include <util/system.h>
 #include <validation.h>
 #include <validationinterface.h>
+#include <validationprofile.h>
 #include <warnings.h>
 #include <libdevcore/CommonData.h>
 #include <pow.h>
@@ -41,6 +41,8 @@
 #include <txdb.h>
 #include <util/convert.h>
 #include <qtum/qtumdelegation.h>
+#include <qtum/contractprofile.h>
+#include <qtum/trienodecache.h>
 #include <util/tokenstr.h>
 #include <rpc/contract_util.h>
 
@@ -554,37 +556,33 @@ static std::vector<RPCResult> MempoolEntryDescription() { return {
     RPCResult{RPCResult::Type::BOOL, "bip125-replaceable", "Whether this transaction could be replaced due to BIP125 (replace-by-fee)"},
 };}
 
-static void entryToJSON(const CTxMemPool& pool, UniValue& info, const CTxMemPoolEntry& e) EXCLUSIVE_LOCKS_REQUIRED(pool.cs)
+static void entryToJSON(UniValue& info, const MempoolEntryInfo& e)
 {
-    AssertLockHeld(pool.cs);
-
     UniValue fees(UniValue::VOBJ);
-    fees.pushKV("base", ValueFromAmount(e.GetFee()));
-    fees.pushKV("modified", ValueFromAmount(e.GetModifiedFee()));
-    fees.pushKV("ancestor", ValueFromAmount(e.GetModFeesWithAncestors()));
-    fees.pushKV("descendant", ValueFromAmount(e.GetModFeesWithDescendants()));
+    fees.pushKV("base", ValueFromAmount(e.fee));
+    fees.pushKV("modified", ValueFromAmount(e.modified_fee));
+    fees.pushKV("ancestor", ValueFromAmount(e.mod_fees_with_ancestors));
+    fees.pushKV("descendant", ValueFromAmount(e.mod_fees_with_descendants));
     info.pushKV("fees", fees);
 
-    info.pushKV("vsize", (int)e.GetTxSize());
-    if (IsDeprecatedRPCEnabled("size")) info.pushKV("size", (int)e.GetTxSize());
-    info.pushKV("weight", (int)e.GetTxWeight());
-    info.pushKV("fee", ValueFromAmount(e.GetFee()));
-    info.pushKV("modifiedfee", ValueFromAmount(e.GetModifiedFee()));
-    info.pushKV("time", count_seconds(e.GetTime()));
-    info.pushKV("height", (int)e.GetHeight());
-    info.pushKV("descendantcount", e.GetCountWithDescendants());
-    info.pushKV("descendantsize", e.GetSizeWithDescendants());
-    info.pushKV("descendantfees", e.GetModFeesWithDescendants());
-    info.pushKV("ancestorcount", e.GetCountWithAncestors());
-    info.pushKV("ancestorsize", e.GetSizeWithAncestors());
-    info.pushKV("ancestorfees", e.GetModFeesWithAncestors());
-    info.pushKV("wtxid", pool.vTxHashes[e.vTxHashesIdx].first.ToString());
-    const CTransaction& tx = e.GetTx();
+    info.pushKV("vsize", (int)e.vsize);
+    if (IsDeprecatedRPCEnabled("size")) info.pushKV("size", (int)e.vsize);
+    info.pushKV("weight", (int)e.weight);
+    info.pushKV("fee", ValueFromAmount(e.fee));
+    info.pushKV("modifiedfee", ValueFromAmount(e.modified_fee));
+    info.pushKV("time", count_seconds(e.time));
+    info.pushKV("height", (int)e.height);
+    info.pushKV("descendantcount", e.count_with_descendants);
+    info.pushKV("descendantsize", e.size_with_descendants);
+    info.pushKV("descendantfees", e.mod_fees_with_descendants);
+    info.pushKV("ancestorcount", e.count_with_ancestors);
+    info.pushKV("ancestorsize", e.size_with_ancestors);
+    info.pushKV("ancestorfees", e.mod_fees_with_ancestors);
+    info.pushKV("wtxid", e.wtxid.ToString());
     std::set<std::string> setDepends;
-    for (const CTxIn& txin : tx.vin)
+    for (const uint256& parent : e.depends)
     {
-        if (pool.exists(txin.prevout.hash))
-            setDepends.insert(txin.prevout.hash.ToString());
+        setDepends.insert(parent.ToString());
     }
 
     UniValue depends(UniValue::VARR);
@@ -596,50 +594,54 @@ static void entryToJSON(const CTxMemPool& pool, UniValue& info, const CTxMemPool
     info.pushKV("depends", depends);
 
     UniValue spent(UniValue::VARR);
-    const CTxMemPool::txiter& it = pool.mapTx.find(tx.GetHash());
-    const CTxMemPool::setEntries& setChildren = pool.GetMemPoolChildren(it);
-    for (CTxMemPool::txiter childiter : setChildren) {
-        spent.push_back(childiter->GetTx().GetHash().ToString());
+    for (const uint256& child : e.spent_by) {
+        spent.push_back(child.ToString());
     }
 
     info.pushKV("spentby", spent);
 
     // Add opt-in RBF status
-    bool rbfStatus = false;
-    RBFTransactionState rbfState = IsRBFOptIn(tx, pool);
-    if (rbfState == RBFTransactionState::UNKNOWN) {
-        throw JSONRPCError(RPC_MISC_ERROR, "Transaction is not in mempool");
-    } else if (rbfState == RBFTransactionState::REPLACEABLE_BIP125) {
-        rbfStatus = true;
-    }
-
-    info.pushKV("bip125-replaceable", rbfStatus);
+    info.pushKV("bip125-replaceable", e.bip125_replaceable);
 }
 
-UniValue MempoolToJSON(const CTxMemPool& pool, bool verbose)
+UniValue MempoolToJSON(const CTxMemPool& pool, bool verbose, bool include_mempool_sequence)
 {
     if (verbose) {
-        LOCK(pool.cs);
+        // The snapshot is shared and immutable, so it is encoded without holding pool.cs
+        std::shared_ptr<const MempoolSnapshot> snapshot = pool.GetSnapshot();
         UniValue o(UniValue::VOBJ);
-        for (const CTxMemPoolEntry& e : pool.mapTx) {
-            const uint256& hash = e.GetTx().GetHash();
+        for (const MempoolEntryInfo& e : snapshot->entries) {
             UniValue info(UniValue::VOBJ);
-            entryToJSON(pool, info, e);
+            entryToJSON(info, e);
             // Mempool has unique entries so there is no advantage in using
             // UniValue::pushKV, which checks if the key already exists in O(N).
             // UniValue::__pushKV is used instead which currently is O(1).
-            o.__pushKV(hash.ToString(), info);
+            o.__pushKV(e.tx->GetHash().ToString(), info);
         }
-        return o;
+        if (!include_mempool_sequence) return o;
+
+        UniValue ret(UniValue::VOBJ);
+        ret.pushKV("entries", o);
+        ret.pushKV("mempool_sequence", snapshot->sequence);
+        return ret;
     } else {
         std::vector<uint256> vtxid;
-        pool.queryHashes(vtxid);
+        uint64_t mempool_sequence;
+        {
+            LOCK(pool.cs);
+            pool.queryHashes(vtxid);
+            mempool_sequence = pool.GetSequence();
+        }
 
         UniValue a(UniValue::VARR);
         for (const uint256& hash : vtxid)
             a.push_back(hash.ToString());
+        if (!include_mempool_sequence) return a;
 
-        return a;
+        UniValue ret(UniValue::VOBJ);
+        ret.pushKV("txids", a);
+        ret.pushKV("mempool_sequence", mempool_sequence);
+        return ret;
     }
 }
 
@@ -650,6 +652,7 @@ static UniValue getrawmempool(const JSONRPCRequest& request)
                 "\nHint: use getmempoolentry to fetch a specific transaction from the mempool.\n",
                 {
                     {"verbose", RPCArg::Type::BOOL, /* default */ "false", "True for a json object, false for array of transaction ids"},
+                    {"mempool_sequence", RPCArg::Type::BOOL, /* default */ "false", "If true, also return the mempool sequence the result was taken at, to follow with getmempooldelta"},
                 },
                 {
                     RPCResult{"for verbose = false",
@@ -662,9 +665,28 @@ static UniValue getrawmempool(const JSONRPCRequest& request)
                         {
                             {RPCResult::Type::OBJ_DYN, "transactionid", "", MempoolEntryDescription()},
                         }},
+                    RPCResult{"for verbose = false and mempool_sequence = true",
+                        RPCResult::Type::OBJ, "", "",
+                        {
+                            {RPCResult::Type::ARR, "txids", "",
+                            {
+                                {RPCResult::Type::STR_HEX, "", "The transaction id"},
+                            }},
+                            {RPCResult::Type::NUM, "mempool_sequence", "The mempool sequence of this result"},
+                        }},
+                    RPCResult{"for verbose = true and mempool_sequence = true",
+                        RPCResult::Type::OBJ, "", "",
+                        {
+                            {RPCResult::Type::OBJ, "entries", "",
+                            {
+                                {RPCResult::Type::OBJ_DYN, "transactionid", "", MempoolEntryDescription()},
+                            }},
+                            {RPCResult::Type::NUM, "mempool_sequence", "The mempool sequence of this result"},
+                        }},
                 },
                 RPCExamples{
                     HelpExampleCli("getrawmempool", "true")
+            + HelpExampleCli("getrawmempool", "false true")
             + HelpExampleRpc("getrawmempool", "true")
                 },
             }.Check(request);
@@ -673,7 +695,11 @@ static UniValue getrawmempool(const JSONRPCRequest& request)
     if (!request.params[0].isNull())
         fVerbose = request.params[0].get_bool();
 
-    return MempoolToJSON(EnsureMemPool(), fVerbose);
+    bool include_mempool_sequence = false;
+    if (!request.params[1].isNull())
+        include_mempool_sequence = request.params[1].get_bool();
+
+    return MempoolToJSON(EnsureMemPool(), fVerbose, include_mempool_sequence);
 }
 
 static UniValue getmempoolancestors(const JSONRPCRequest& request)
@@ -726,10 +752,9 @@ static UniValue getmempoolancestors(const JSONRPCRequest& request)
     } else {
         UniValue o(UniValue::VOBJ);
         for (CTxMemPool::txiter ancestorIt : setAncestors) {
-            const CTxMemPoolEntry &e = *ancestorIt;
-            const uint256& _hash = e.GetTx().GetHash();
+            const uint256& _hash = ancestorIt->GetTx().GetHash();
             UniValue info(UniValue::VOBJ);
-            entryToJSON(mempool, info, e);
+            entryToJSON(info, mempool.GetEntryInfo(ancestorIt));
             o.pushKV(_hash.ToString(), info);
         }
         return o;
@@ -789,10 +814,9 @@ static UniValue getmempooldescendants(const JSONRPCRequest& request)
     } else {
         UniValue o(UniValue::VOBJ);
         for (CTxMemPool::txiter descendantIt : setDescendants) {
-            const CTxMemPoolEntry &e = *descendantIt;
-            const uint256& _hash = e.GetTx().GetHash();
+            const uint256& _hash = descendantIt->GetTx().GetHash();
             UniValue info(UniValue::VOBJ);
-            entryToJSON(mempool, info, e);
+            entryToJSON(info, mempool.GetEntryInfo(descendantIt));
             o.pushKV(_hash.ToString(), info);
         }
         return o;
@@ -824,12 +848,129 @@ static UniValue getmempoolentry(const JSONRPCRequest& request)
         throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Transaction not in mempool");
     }
 
-    const CTxMemPoolEntry &e = *it;
     UniValue info(UniValue::VOBJ);
-    entryToJSON(mempool, info, e);
+    entryToJSON(info, mempool.GetEntryInfo(it));
     return info;
 }
 
+static UniValue getmempooldelta(const JSONRPCRequest& request)
+{
+            RPCHelpMan{"getmempooldelta",
+                "\nReturns the transactions added to and removed from the mempool after the given mempool sequence.\n"
+                "Transactions that were added and removed again in between are left out. Take the starting sequence\n"
+                "from getrawmempool with mempool_sequence set, then keep following with the returned mempool_sequence.\n"
+                "Fails if the changes are no longer in the change log (see -mempoolchangelog), in which case a new\n"
+                "getrawmempool has to be taken.\n",
+                {
+                    {"since", RPCArg::Type::NUM, RPCArg::Optional::NO, "The mempool sequence to return the changes after"},
+                    {"verbose", RPCArg::Type::BOOL, /* default */ "false", "True to return the added transactions as json objects, false for transaction ids"},
+                },
+                {
+                    RPCResult{"for verbose = false",
+                        RPCResult::Type::OBJ, "", "",
+                        {
+                            {RPCResult::Type::NUM, "mempool_sequence", "The mempool sequence of this result"},
+                            {RPCResult::Type::ARR, "removed", "Transactions removed from the mempool",
+                            {
+                                {RPCResult::Type::STR_HEX, "", "The transaction id"},
+                            }},
+                            {RPCResult::Type::ARR, "added", "Transactions added to the mempool",
+                            {
+                                {RPCResult::Type::STR_HEX, "", "The transaction id"},
+                            }},
+                        }},
+                    RPCResult{"for verbose = true",
+                        RPCResult::Type::OBJ, "", "",
+                        {
+                            {RPCResult::Type::NUM, "mempool_sequence", "The mempool sequence of this result"},
+                            {RPCResult::Type::ARR, "removed", "Transactions removed from the mempool",
+                            {
+                                {RPCResult::Type::STR_HEX, "", "The transaction id"},
+                            }},
+                            {RPCResult::Type::OBJ, "added", "Transactions added to the mempool",
+                            {
+                                {RPCResult::Type::OBJ_DYN, "transactionid", "", MempoolEntryDescription()},
+                            }},
+                        }},
+                },
+                RPCExamples{
+                    HelpExampleCli("getmempooldelta", "1000")
+            + HelpExampleRpc("getmempooldelta", "1000, true")
+                },
+            }.Check(request);
+
+    const int64_t since = request.params[0].get_int64();
+    if (since < 0) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Negative mempool sequence");
+    }
+
+    bool fVerbose = false;
+    if (!request.params[1].isNull())
+        fVerbose = request.params[1].get_bool();
+
+    const CTxMemPool& mempool = EnsureMemPool();
+    uint64_t mempool_sequence;
+    std::vector<uint256> removed;
+    std::vector<uint256> added;
+    std::vector<MempoolEntryInfo> added_info;
+    {
+        LOCK(mempool.cs);
+        std::vector<MempoolChange> changes;
+        if (!mempool.GetChangesSince(since, changes)) {
+            throw JSONRPCError(RPC_MISC_ERROR, strprintf("Mempool changes after sequence %d are not available (current sequence %d), take a new snapshot with getrawmempool", since, mempool.GetSequence()));
+        }
+        mempool_sequence = mempool.GetSequence();
+
+        // Only the first and last change of each transaction matter: it was
+        // there before if it was first removed, and is there now if it was last added
+        std::map<uint256, std::pair<bool, bool>> first_last;
+        for (const MempoolChange& change : changes) {
+            auto it = first_last.emplace(change.txid, std::make_pair(change.added, change.added)).first;
+            it->second.second = change.added;
+        }
+        for (const MempoolChange& change : changes) {
+            auto it = first_last.find(change.txid);
+            if (it == first_last.end()) continue;
+            const bool was_in = !it->second.first;
+            const bool is_in = it->second.second;
+            first_last.erase(it);
+            if (was_in && !is_in) {
+                removed.push_back(change.txid);
+            } else if (!was_in && is_in) {
+                if (fVerbose) {
+                    added_info.push_back(mempool.GetEntryInfo(mempool.mapTx.find(change.txid)));
+                } else {
+                    added.push_back(change.txid);
+                }
+            }
+        }
+    }
+
+    UniValue ret(UniValue::VOBJ);
+    ret.pushKV("mempool_sequence", mempool_sequence);
+    UniValue removed_json(UniValue::VARR);
+    for (const uint256& hash : removed) {
+        removed_json.push_back(hash.ToString());
+    }
+    ret.pushKV("removed", removed_json);
+    if (fVerbose) {
+        UniValue o(UniValue::VOBJ);
+        for (const MempoolEntryInfo& e : added_info) {
+            UniValue info(UniValue::VOBJ);
+            entryToJSON(info, e);
+            o.__pushKV(e.tx->GetHash().ToString(), info);
+        }
+        ret.pushKV("added", o);
+    } else {
+        UniValue a(UniValue::VARR);
+        for (const uint256& hash : added) {
+            a.push_back(hash.ToString());
+        }
+        ret.pushKV("added", a);
+    }
+    return ret;
+}
+
 static UniValue getblockhash(const JSONRPCRequest& request)
 {
             RPCHelpMan{"getblockhash",
@@ -855,6 +996,16 @@ static UniValue getblockhash(const JSONRPCRequest& request)
     return pblockindex->GetBlockHash().GetHex();
 }
 
+static void ContractIndexToJSON(const CContractIndexValue& value, UniValue& entry)
+{
+    entry.pushKV("creationheight", value.creationHeight);
+    entry.pushKV("creationtxid", value.creationTxid.GetHex());
+    entry.pushKV("creator", uintToh160(value.creator).hex());
+    entry.pushKV("codehash", uintToh256(value.codeHash).hex());
+    entry.pushKV("codesize", (uint64_t)value.codeSize);
+    entry.pushKV("lasttouchedheight", value.lastTouchedHeight);
+}
+
 static UniValue getaccountinfo(const JSONRPCRequest& request)
 {
             RPCHelpMan{"getaccountinfo",
@@ -869,6 +1020,12 @@ static UniValue getaccountinfo(const JSONRPCRequest& request)
                         {RPCResult::Type::STR_AMOUNT, "balance", "The balance of the contract"},
                         {RPCResult::Type::STR, "storage", "The storage data of the contract"},
                         {RPCResult::Type::STR_HEX, "code", "The bytecode of the contract"},
+                        {RPCResult::Type::NUM, "creationheight", /* optional */ true, "The height of the block that created the contract (only with -contractindex)"},
+                        {RPCResult::Type::STR_HEX, "creationtxid", /* optional */ true, "The transaction that created the contract (only with -contractindex)"},
+                        {RPCResult::Type::STR_HEX, "creator", /* optional */ true, "The sender that created the contract (only with -contractindex)"},
+                        {RPCResult::Type::STR_HEX, "codehash", /* optional */ true, "The hash of the contract code (only with -contractindex)"},
+                        {RPCResult::Type::NUM, "codesize", /* optional */ true, "The size of the contract code (only with -contractindex)"},
+                        {RPCResult::Type::NUM, "lasttouchedheight", /* optional */ true, "The last height the contract was called or emitted a log (only with -contractindex)"},
                     }},
                 RPCExamples{
                     HelpExampleCli("getaccountinfo", "eb23c0b3e6042821da281a2e2364feb22dd543e3")
@@ -905,6 +1062,10 @@ static UniValue getaccountinfo(const JSONRPCRequest& request)
 
     result.pushKV("code", HexStr(code.begin(), code.end()));
 
+    CContractIndexValue contractIndex;
+    if (fContractIndex && pblocktree->ReadContractIndex(h160Touint(addrAccount), contractIndex))
+        ContractIndexToJSON(contractIndex, result);
+
     std::unordered_map<dev::Address, Vin> vins = globalState->vins();
     if(vins.count(addrAccount)){
         UniValue vin(UniValue::VOBJ);
@@ -920,76 +1081,139 @@ static UniValue getaccountinfo(const JSONRPCRequest& request)
 static UniValue getstorage(const JSONRPCRequest& request)
 {
             RPCHelpMan{"getstorage",
-                "\nGet contract storage data.\n",
+                "\nGet contract storage data.\n"
+                "\nPassing options returns one page of the storage together with a cursor for the next page,\n"
+                "so large contracts can be read without loading their whole storage.\n",
                 {
                     {"address", RPCArg::Type::STR_HEX, RPCArg::Optional::NO, "The contract address"},
                     {"blockNum", RPCArg::Type::NUM,  /* default */ "latest", "Number of block to get state from."},
                     {"index", RPCArg::Type::NUM, RPCArg::Optional::OMITTED_NAMED_ARG, "Zero-based index position of the storage"},
+                    {"options", RPCArg::Type::OBJ, RPCArg::Optional::OMITTED, "Paging options, index must be null when set",
+                        {
+                            {"cursor", RPCArg::Type::STR_HEX, /* default */ "", "Opaque cursor returned in \"next\" by the previous call"},
+                            {"key", RPCArg::Type::STR_HEX, /* default */ "", "Start at this storage key (ignored when cursor is set)"},
+                            {"limit", RPCArg::Type::NUM, /* default */ "100", "Max storage slots to return"},
+                        },
+                    },
+                },
+                {
+                    RPCResult{"without options",
+                        RPCResult::Type::STR, "", "The storage data of the contract"},
+                    RPCResult{"with options",
+                        RPCResult::Type::OBJ, "", "",
+                        {
+                            {RPCResult::Type::OBJ, "storage", "The storage slots of the page, keyed by hashed storage key"},
+                            {RPCResult::Type::STR_HEX, "next", /* optional */ true, "The cursor for the next page, if there are more slots"},
+                        }},
                 },
-                RPCResult{
-                    RPCResult::Type::STR, "", "The storage data of the contract"},
                 RPCExamples{
                     HelpExampleCli("getstorage", "eb23c0b3e6042821da281a2e2364feb22dd543e3")
+            + HelpExampleCli("getstorage", "eb23c0b3e6042821da281a2e2364feb22dd543e3 -1 null '{\"limit\": 1000}'")
             + HelpExampleRpc("getstorage", "eb23c0b3e6042821da281a2e2364feb22dd543e3")
                 },
             }.Check(request);
 
-    LOCK(cs_main);
-
     std::string strAddr = request.params[0].get_str();
     if(strAddr.size() != 40 || !CheckHex(strAddr))
         throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Incorrect address"); 
 
-    TemporaryState ts(globalState);
-    if (request.params.size() > 1)
-    {
-        if (request.params[1].isNum())
-        {
-            auto blockNum = request.params[1].get_int();
-            if((blockNum < 0 && blockNum != -1) || blockNum > ::ChainActive().Height())
-                throw JSONRPCError(RPC_INVALID_PARAMS, "Incorrect block number");
+    bool paged = request.params.size() > 3 && !request.params[3].isNull();
+    bool onlyIndex = request.params.size() > 2 && !request.params[2].isNull();
+    if (paged && onlyIndex)
+        throw JSONRPCError(RPC_INVALID_PARAMS, "index and options cannot be used together");
 
-            if(blockNum != -1)
-                ts.SetRoot(uintToh256(::ChainActive()[blockNum]->hashStateRoot), uintToh256(::ChainActive()[blockNum]->hashUTXORoot));
-                
-        } else {
-            throw JSONRPCError(RPC_INVALID_PARAMS, "Incorrect block number");
+    unsigned index = 0;
+    if (onlyIndex)
+        index = request.params[2].get_int();
+
+    dev::h256 begin;
+    size_t limit = std::numeric_limits<size_t>::max();
+    if (paged)
+    {
+        const UniValue& options = request.params[3].get_obj();
+        RPCTypeCheckObj(options,
+            {
+                {"cursor", UniValueType(UniValue::VSTR)},
+                {"key", UniValueType(UniValue::VSTR)},
+                {"limit", UniValueType(UniValue::VNUM)},
+            }, true, true);
+        if (options.exists("cursor")) {
+            std::string cursor = options["cursor"].get_str();
+            if (cursor.size() != 64 || !CheckHex(cursor))
+                throw JSONRPCError(RPC_INVALID_PARAMS, "Incorrect cursor");
+            begin = dev::h256(cursor);
+        } else if (options.exists("key")) {
+            std::string key = options["key"].get_str();
+            if (key.size() != 64 || !CheckHex(key))
+                throw JSONRPCError(RPC_INVALID_PARAMS, "Incorrect key");
+            begin = dev::sha3(dev::h256(key));
         }
+        int n = options.exists("limit") ? options["limit"].get_int() : 100;
+        if (n <= 0)
+            throw JSONRPCError(RPC_INVALID_PARAMS, "Invalid limit");
+        limit = n;
+    }
+    else if (onlyIndex)
+    {
+        limit = (size_t)index + 1;
     }
 
     dev::Address addrAccount(strAddr);
-    if(!globalState->addressInUse(addrAccount))
-        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Address does not exist");
-    
-    UniValue result(UniValue::VOBJ);
+    std::vector<StorageEntry> storage;
+    dev::h256 next;
+    {
+        LOCK(cs_main);
 
-    bool onlyIndex = request.params.size() > 2;
-    unsigned index = 0;
-    if (onlyIndex)
-        index = request.params[2].get_int();
+        // Read the trie at the requested root directly instead of moving globalState there
+        dev::h256 root = globalState->rootHash();
+        if (request.params.size() > 1 && !request.params[1].isNull())
+        {
+            if (request.params[1].isNum())
+            {
+                auto blockNum = request.params[1].get_int();
+                if((blockNum < 0 && blockNum != -1) || blockNum > ::ChainActive().Height())
+                    throw JSONRPCError(RPC_INVALID_PARAMS, "Incorrect block number");
 
-    auto storage(globalState->storage(addrAccount));
+                if(blockNum != -1)
+                    root = uintToh256(::ChainActive()[blockNum]->hashStateRoot);
+            } else {
+                throw JSONRPCError(RPC_INVALID_PARAMS, "Incorrect block number");
+            }
+        }
 
-    if (onlyIndex)
-    {
-        if (index >= storage.size())
+        if (!globalState->storageRange(root, addrAccount, begin, limit, storage, next))
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Address does not exist");
+
+        if (onlyIndex && index >= storage.size())
         {
+            // Report the size of the whole storage, not of the part read for the index
+            std::vector<StorageEntry> all;
+            globalState->storageRange(root, addrAccount, dev::h256(), std::numeric_limits<size_t>::max(), all, next);
             std::ostringstream stringStream;
-            stringStream << "Storage size: " << storage.size() << " got index: " << index;
+            stringStream << "Storage size: " << all.size() << " got index: " << index;
             throw JSONRPCError(RPC_INVALID_PARAMS, stringStream.str());
         }
-        auto elem = std::next(storage.begin(), index);
-        UniValue e(UniValue::VOBJ);
+    }
+
+    if (onlyIndex)
+        storage = {storage.back()};
 
-        storage = {{elem->first, {elem->second.first, elem->second.second}}};
-    } 
+    UniValue result(UniValue::VOBJ);
     for (const auto& j: storage)
     {
         UniValue e(UniValue::VOBJ);
-        e.pushKV(dev::toHex(dev::h256(j.second.first)), dev::toHex(dev::h256(j.second.second)));
-        result.pushKV(j.first.hex(), e);
+        e.pushKV(dev::toHex(dev::h256(j.key)), dev::toHex(dev::h256(j.value)));
+        result.pushKV(j.hashedKey.hex(), e);
     }
-    return result;
+
+    if (!paged)
+        return result;
+
+    UniValue page(UniValue::VOBJ);
+    page.pushKV("storage", result);
+    if (next != dev::h256())
+        page.pushKV("next", next.hex());
+    return page;
 }
 
 static UniValue getblockheader(const JSONRPCRequest& request)
@@ -1317,6 +1541,13 @@ UniValue waitforlogs(const JSONRPCRequest& request_) {
 
     WaitForLogsParams params(request.params);
 
+    {
+        LOCK(cs_main);
+        const int prune_height = GetLogEventsPruneHeight();
+        if (params.fromBlock < prune_height)
+            throw JSONRPCError(RPC_MISC_ERROR, strprintf("Log events below height %d are not available (pruned data)", prune_height));
+    }
+
     request.PollStart();
 
     std::vector<std::vector<uint256>> hashesToBlock;
@@ -1714,24 +1945,56 @@ UniValue getdelegationsforstaker(const JSONRPCRequest& request)
 UniValue listcontracts(const JSONRPCRequest& request)
 {
             RPCHelpMan{"listcontracts",
-                "\nGet the contracts list.\n",
+                "\nGet the contracts list.\n"
+                "\nWith -contractindex, the list is read from the contract index, in address order. Passing options\n"
+                "also returns the contract details together with a cursor for the next page.\n",
                 {
-                    {"start", RPCArg::Type::NUM, /* default */ "1", "The starting account index"},
+                    {"start", RPCArg::Type::NUM, /* default */ "1", "The starting account index, must be 1 with options (page with the cursor instead)"},
                     {"maxDisplay", RPCArg::Type::NUM, /* default */ "20", "Max accounts to list"},
+                    {"options", RPCArg::Type::OBJ, RPCArg::Optional::OMITTED, "Cursor and filters, requires -contractindex",
+                        {
+                            {"cursor", RPCArg::Type::STR_HEX, /* default */ "", "Start listing at this contract address, as returned in \"next\" by the previous call"},
+                            {"creator", RPCArg::Type::STR_HEX, /* default */ "", "Only list contracts created by this sender (hex pubkeyhash)"},
+                            {"minheight", RPCArg::Type::NUM, /* default */ "0", "Only list contracts created at or above this height"},
+                            {"maxheight", RPCArg::Type::NUM, /* default */ "tip", "Only list contracts created at or below this height"},
+                            {"touchedsince", RPCArg::Type::NUM, /* default */ "0", "Only list contracts called or logged at or above this height"},
+                        },
+                    },
+                },
+                {
+                    RPCResult{"without options",
+                        RPCResult::Type::OBJ, "", "",
+                        {
+                            {RPCResult::Type::NUM, "account", "The balance for the account"},
+                        }},
+                    RPCResult{"with options",
+                        RPCResult::Type::OBJ, "", "",
+                        {
+                            {RPCResult::Type::ARR, "contracts", "",
+                            {
+                                {RPCResult::Type::OBJ, "", "",
+                                {
+                                    {RPCResult::Type::STR_HEX, "address", "The contract address"},
+                                    {RPCResult::Type::STR_AMOUNT, "balance", "The balance of the contract"},
+                                    {RPCResult::Type::NUM, "creationheight", "The height of the block that created the contract"},
+                                    {RPCResult::Type::STR_HEX, "creationtxid", "The transaction that created the contract"},
+                                    {RPCResult::Type::STR_HEX, "creator", "The sender that created the contract"},
+                                    {RPCResult::Type::STR_HEX, "codehash", "The hash of the contract code"},
+                                    {RPCResult::Type::NUM, "codesize", "The size of the contract code"},
+                                    {RPCResult::Type::NUM, "lasttouchedheight", "The last height the contract was called or emitted a log"},
+                                }},
+                            }},
+                            {RPCResult::Type::STR_HEX, "next", /* optional */ true, "The cursor for the next page, if there are more contracts"},
+                        }},
                 },
-                RPCResult{
-                    RPCResult::Type::OBJ, "", "",
-                    {
-                        {RPCResult::Type::NUM, "account", "The balance for the account"},
-                    }},
                 RPCExamples{
                     HelpExampleCli("listcontracts", "")
+            + HelpExampleCli("listcontracts", "1 100 '{\"minheight\": 500000}'")
+            + HelpExampleCli("listcontracts", "1 100 '{\"cursor\": \"<next>\"}'")
             + HelpExampleRpc("listcontracts", "")
                 },
             }.Check(request);
 
-	LOCK(cs_main);
-
 	int start=1;
 	if (request.params.size() > 0){
 		start = request.params[0].get_int();
@@ -1746,26 +2009,395 @@ UniValue listcontracts(const JSONRPCRequest& request)
 			throw JSONRPCError(RPC_TYPE_ERROR, "Invalid maxDisplay");
 	}
 
-	UniValue result(UniValue::VOBJ);
+	const bool fOptions = request.params.size() > 2 && !request.params[2].isNull();
+	if (!fOptions && !fContractIndex) {
+		LOCK(cs_main);
+
+		UniValue result(UniValue::VOBJ);
+
+		auto map = globalState->addresses();
+		int contractsCount=(int)map.size();
+
+		if (contractsCount>0 && start > contractsCount)
+			throw JSONRPCError(RPC_TYPE_ERROR, "start greater than max index "+ i64tostr(contractsCount));
+
+		int itStartPos=std::min(start-1,contractsCount);
+		int i=0;
+		for (auto it = std::next(map.begin(),itStartPos); it!=map.end(); it++)
+		{
+			result.pushKV(it->first.hex(),ValueFromAmount(CAmount(globalState->balance(it->first))));
+			i++;
+			if(i==maxDisplay)break;
+		}
+
+		return result;
+	}
 
-	auto map = globalState->addresses();
-	int contractsCount=(int)map.size();
+	if (!fContractIndex)
+		throw JSONRPCError(RPC_MISC_ERROR, "Contract index not enabled, restart with -contractindex and -reindex");
+
+	uint160 cursor;
+	bool fCreator = false;
+	uint160 creator;
+	int minHeight = 0;
+	int maxHeight = std::numeric_limits<int>::max();
+	int touchedSince = 0;
+	if (fOptions) {
+		if (start != 1)
+			throw JSONRPCError(RPC_INVALID_PARAMETER, "start is not supported with options, page with the cursor option instead");
+
+		const UniValue& options = request.params[2].get_obj();
+		RPCTypeCheckObj(options,
+			{
+				{"cursor", UniValueType(UniValue::VSTR)},
+				{"creator", UniValueType(UniValue::VSTR)},
+				{"minheight", UniValueType(UniValue::VNUM)},
+				{"maxheight", UniValueType(UniValue::VNUM)},
+				{"touchedsince", UniValueType(UniValue::VNUM)},
+			}, true, true);
+		auto parseAddress = [](const UniValue& v, const std::string& name) {
+			std::string str = v.get_str();
+			if (str.size() != 40 || !CheckHex(str))
+				throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Incorrect " + name);
+			return h160Touint(dev::Address(str));
+		};
+		if (options.exists("cursor"))
+			cursor = parseAddress(options["cursor"], "cursor");
+		if (options.exists("creator")) {
+			creator = parseAddress(options["creator"], "creator");
+			fCreator = true;
+		}
+		if (options.exists("minheight"))
+			minHeight = options["minheight"].get_int();
+		if (options.exists("maxheight"))
+			maxHeight = options["maxheight"].get_int();
+		if (options.exists("touchedsince"))
+			touchedSince = options["touchedsince"].get_int();
+	}
 
-	if (contractsCount>0 && start > contractsCount)
+	// Without options, start counts contracts from the beginning of the index
+	int skip = start - 1;
+	auto filter = [&](const uint160& address, const CContractIndexValue& value) {
+		if (fCreator && value.creator != creator)
+			return false;
+		if (value.creationHeight < minHeight || value.creationHeight > maxHeight)
+			return false;
+		if (value.lastTouchedHeight < touchedSince)
+			return false;
+		if (skip > 0) {
+			skip--;
+			return false;
+		}
+		return true;
+	};
+
+	// The index is walked without cs_main, its iterator reads a consistent
+	// snapshot of the database
+	std::vector<std::pair<uint160, CContractIndexValue> > contracts;
+	uint160 next;
+	if (!pblocktree->ReadContractIndex(cursor, maxDisplay, filter, contracts, next))
+		throw JSONRPCError(RPC_DATABASE_ERROR, "Unable to read contract index");
+
+	int contractsCount = start - 1 - skip;
+	if (contracts.empty() && contractsCount>0 && start > contractsCount)
 		throw JSONRPCError(RPC_TYPE_ERROR, "start greater than max index "+ i64tostr(contractsCount));
 
-	int itStartPos=std::min(start-1,contractsCount);
-	int i=0;
-	for (auto it = std::next(map.begin(),itStartPos); it!=map.end(); it++)
+	// Only the balances of the page are read under cs_main
+	std::vector<CAmount> balances;
 	{
-		result.pushKV(it->first.hex(),ValueFromAmount(CAmount(globalState->balance(it->first))));
-		i++;
-		if(i==maxDisplay)break;
+		LOCK(cs_main);
+		for (const auto& it : contracts)
+			balances.push_back(CAmount(globalState->balance(uintToh160(it.first))));
+	}
+
+	if (!fOptions) {
+		UniValue result(UniValue::VOBJ);
+		for (size_t i = 0; i < contracts.size(); i++)
+			result.pushKV(uintToh160(contracts[i].first).hex(), ValueFromAmount(balances[i]));
+		return result;
+	}
+
+	UniValue list(UniValue::VARR);
+	for (size_t i = 0; i < contracts.size(); i++) {
+		UniValue entry(UniValue::VOBJ);
+		entry.pushKV("address", uintToh160(contracts[i].first).hex());
+		entry.pushKV("balance", ValueFromAmount(balances[i]));
+		ContractIndexToJSON(contracts[i].second, entry);
+		list.push_back(entry);
 	}
 
+	UniValue result(UniValue::VOBJ);
+	result.pushKV("contracts", list);
+	if (!next.IsNull())
+		result.pushKV("next", uintToh160(next).hex());
 	return result;
 }
 
+static const std::vector<RPCResult> BLOCK_PROFILE_RESULT{
+    {RPCResult::Type::STR_HEX, "hash", "The block hash"},
+    {RPCResult::Type::NUM, "height", "The block height"},
+    {RPCResult::Type::NUM_TIME, "time", "The time the block was connected, in " + UNIX_EPOCH_TIME},
+    {RPCResult::Type::NUM, "txs", "The number of transactions"},
+    {RPCResult::Type::NUM, "inputs", "The number of inputs"},
+    {RPCResult::Type::NUM, "total_us", "The time to connect the block to the tip, in microseconds"},
+    {RPCResult::Type::OBJ_DYN, "phases_us", "The time spent in each validation phase, in microseconds",
+    {
+        {RPCResult::Type::NUM, "phase", "loadblock, checks, inputs, scriptchecks, contractexec, statecommit, receipts, index, flush, chainstate or postconnect"},
+    }},
+    {RPCResult::Type::ARR, "contract_execs", /* optional */ true, "The contract executions of the block (verbose only)",
+    {
+        {RPCResult::Type::OBJ, "", "",
+        {
+            {RPCResult::Type::STR_HEX, "txid", "The contract transaction"},
+            {RPCResult::Type::NUM, "outputs", "The number of contract outputs executed"},
+            {RPCResult::Type::NUM, "gas_used", "The gas used"},
+            {RPCResult::Type::NUM, "exec_us", "The EVM execution time, in microseconds"},
+            {RPCResult::Type::NUM, "commit_us", "The state trie commit time, in microseconds"},
+        }},
+    }},
+};
+
+static UniValue getblockprofile(const JSONRPCRequest& request)
+{
+            RPCHelpMan{"getblockprofile",
+                "\nReturns the validation phase timings recorded when the block was connected to the tip.\n"
+                "Only the last -blockprofilesize connected blocks are kept.\n",
+                {
+                    {"blockhash", RPCArg::Type::STR_HEX, RPCArg::Optional::NO, "The block hash"},
+                    {"verbose", RPCArg::Type::BOOL, /* default */ "true", "Include the contract executions of the block"},
+                },
+                RPCResult{RPCResult::Type::OBJ, "", "", BLOCK_PROFILE_RESULT},
+                RPCExamples{
+                    HelpExampleCli("getblockprofile", "\"00000000c937983704a73af28acdec37b049d214adbda81d7e2a3dd146f6ed09\"")
+            + HelpExampleRpc("getblockprofile", "\"00000000c937983704a73af28acdec37b049d214adbda81d7e2a3dd146f6ed09\"")
+                },
+            }.Check(request);
+
+    uint256 hash(ParseHashV(request.params[0], "blockhash"));
+    bool verbose = request.params[1].isNull() ? true : request.params[1].get_bool();
+
+    BlockProfile profile;
+    if (!g_block_profiler.Find(hash, profile))
+        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No profile for this block, it was not connected recently or -blockprofilesize is 0");
+
+    return profile.ToJSON(verbose);
+}
+
+static UniValue getvalidationprofile(const JSONRPCRequest& request)
+{
+            RPCHelpMan{"getvalidationprofile",
+                "\nReturns the validation phase timings of the most recently connected blocks, newest first,\n"
+                "together with the totals per phase.\n",
+                {
+                    {"count", RPCArg::Type::NUM, /* default */ "10", "The number of blocks to return"},
+                    {"verbose", RPCArg::Type::BOOL, /* default */ "false", "Include the contract executions of each block"},
+                },
+                RPCResult{
+                    RPCResult::Type::OBJ, "", "",
+                    {
+                        {RPCResult::Type::NUM, "total_us", "The time to connect the returned blocks, in microseconds"},
+                        {RPCResult::Type::OBJ_DYN, "phases_us", "The time spent in each validation phase over the returned blocks, in microseconds",
+                        {
+                            {RPCResult::Type::NUM, "phase", "The phase total"},
+                        }},
+                        {RPCResult::Type::ARR, "blocks", "",
+                        {
+                            {RPCResult::Type::OBJ, "", "", BLOCK_PROFILE_RESULT},
+                        }},
+                    }},
+                RPCExamples{
+                    HelpExampleCli("getvalidationprofile", "100")
+            + HelpExampleRpc("getvalidationprofile", "100")
+                },
+            }.Check(request);
+
+    int count = request.params[0].isNull() ? 10 : request.params[0].get_int();
+    if (count < 0)
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Negative count");
+    bool verbose = request.params[1].isNull() ? false : request.params[1].get_bool();
+
+    int64_t total_us = 0;
+    std::array<int64_t, (size_t)BlockPhase::COUNT> phase_us{};
+    UniValue blocks(UniValue::VARR);
+    for (const BlockProfile& profile : g_block_profiler.GetRecent(count)) {
+        total_us += profile.total_us;
+        for (size_t i = 0; i < phase_us.size(); ++i) {
+            phase_us[i] += profile.phase_us[i];
+        }
+        blocks.push_back(profile.ToJSON(verbose));
+    }
+
+    UniValue phases(UniValue::VOBJ);
+    for (size_t i = 0; i < phase_us.size(); ++i) {
+        phases.pushKV(BlockPhaseName((BlockPhase)i), phase_us[i]);
+    }
+
+    UniValue result(UniValue::VOBJ);
+    result.pushKV("total_us", total_us);
+    result.pushKV("phases_us", phases);
+    result.pushKV("blocks", blocks);
+    return result;
+}
+
+static void ContractExecStatsToJSON(const ContractExecStats& stats, UniValue& entry)
+{
+    entry.pushKV("calls", stats.calls);
+    entry.pushKV("errors", stats.errors);
+    entry.pushKV("gas_used", stats.gas_used);
+    entry.pushKV("time_us", stats.time_us);
+    entry.pushKV("avg_time_us", stats.calls ? stats.time_us / (int64_t)stats.calls : 0);
+}
+
+static UniValue getcontractprofile(const JSONRPCRequest& request)
+{
+            RPCHelpMan{"getcontractprofile",
+                "\nReturns the contracts with the highest cost among the executions sampled by -contractprofile,\n"
+                "covering both block validation and callcontract.\n",
+                {
+                    {"count", RPCArg::Type::NUM, /* default */ "20", "The number of contracts to return"},
+                    {"sort", RPCArg::Type::STR, /* default */ "gas", "Sort by gas, selfgas, time, calls, sloads or sstores"},
+                    {"reset", RPCArg::Type::BOOL, /* default */ "false", "Clear the profile after returning it"},
+                },
+                RPCResult{
+                    RPCResult::Type::OBJ, "", "",
+                    {
+                        {RPCResult::Type::NUM, "samplerate", "One in samplerate executions is profiled, 0 if profiling is disabled"},
+                        {RPCResult::Type::NUM_TIME, "since", "The time the profile was started or last reset, in " + UNIX_EPOCH_TIME},
+                        {RPCResult::Type::NUM, "executions", "The number of sampled executions"},
+                        {RPCResult::Type::ARR, "contracts", "",
+                        {
+                            {RPCResult::Type::OBJ, "", "",
+                            {
+                                {RPCResult::Type::STR_HEX, "address", "The contract address"},
+                                {RPCResult::Type::NUM, "calls", "The sampled transactions sent to the contract"},
+                                {RPCResult::Type::NUM, "errors", "The number of those that raised an exception"},
+                                {RPCResult::Type::NUM, "gas_used", "The gas used by those transactions"},
+                                {RPCResult::Type::NUM, "time_us", "The execution time of those transactions, in microseconds"},
+                                {RPCResult::Type::NUM, "avg_time_us", "The average execution time, in microseconds"},
+                                {RPCResult::Type::NUM, "self_gas", "The gas of the instructions run in the contract's own code, including inner calls to it"},
+                                {RPCResult::Type::NUM, "sloads", "The SLOAD instructions run in the contract's code"},
+                                {RPCResult::Type::NUM, "sstores", "The SSTORE instructions run in the contract's code"},
+                                {RPCResult::Type::NUM, "max_depth", "The deepest call depth the contract's code ran at"},
+                                {RPCResult::Type::ARR, "selectors", "The functions called, by gas used",
+                                {
+                                    {RPCResult::Type::OBJ, "", "",
+                                    {
+                                        {RPCResult::Type::STR_HEX, "selector", "The function selector"},
+                                        {RPCResult::Type::NUM, "calls", "The sampled calls"},
+                                        {RPCResult::Type::NUM, "errors", "The number of those that raised an exception"},
+                                        {RPCResult::Type::NUM, "gas_used", "The gas used"},
+                                        {RPCResult::Type::NUM, "time_us", "The execution time, in microseconds"},
+                                        {RPCResult::Type::NUM, "avg_time_us", "The average execution time, in microseconds"},
+                                    }},
+                                }},
+                            }},
+                        }},
+                    }},
+                RPCExamples{
+                    HelpExampleCli("getcontractprofile", "10 \"time\"")
+            + HelpExampleRpc("getcontractprofile", "10, \"time\"")
+                },
+            }.Check(request);
+
+    int count = request.params[0].isNull() ? 20 : request.params[0].get_int();
+    if (count < 0)
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Negative count");
+
+    ContractProfiler::SortBy sort_by = ContractProfiler::SortBy::GAS;
+    if (!request.params[1].isNull()) {
+        const std::string& sort = request.params[1].get_str();
+        if (sort == "gas") sort_by = ContractProfiler::SortBy::GAS;
+        else if (sort == "selfgas") sort_by = ContractProfiler::SortBy::SELF_GAS;
+        else if (sort == "time") sort_by = ContractProfiler::SortBy::TIME;
+        else if (sort == "calls") sort_by = ContractProfiler::SortBy::CALLS;
+        else if (sort == "sloads") sort_by = ContractProfiler::SortBy::SLOADS;
+        else if (sort == "sstores") sort_by = ContractProfiler::SortBy::SSTORES;
+        else throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid sort key: " + sort);
+    }
+    bool reset = request.params[2].isNull() ? false : request.params[2].get_bool();
+
+    uint64_t executions;
+    int64_t since;
+    g_contract_profiler.GetTotals(executions, since);
+    std::vector<ContractProfile> top = g_contract_profiler.GetTop(count, sort_by);
+    if (reset)
+        g_contract_profiler.Reset();
+
+    UniValue contracts(UniValue::VARR);
+    for (const ContractProfile& profile : top) {
+        UniValue entry(UniValue::VOBJ);
+        entry.pushKV("address", profile.address.hex());
+        ContractExecStatsToJSON(profile.exec, entry);
+        entry.pushKV("self_gas", profile.ops.self_gas);
+        entry.pushKV("sloads", profile.ops.sloads);
+        entry.pushKV("sstores", profile.ops.sstores);
+        entry.pushKV("max_depth", (int)profile.ops.max_depth);
+
+        std::vector<std::pair<uint32_t, ContractExecStats>> selectors(profile.selectors.begin(), profile.selectors.end());
+        std::sort(selectors.begin(), selectors.end(), [](const std::pair<uint32_t, ContractExecStats>& a, const std::pair<uint32_t, ContractExecStats>& b) {
+            return a.second.gas_used > b.second.gas_used;
+        });
+        UniValue selectorList(UniValue::VARR);
+        for (const auto& selector : selectors) {
+            UniValue selectorEntry(UniValue::VOBJ);
+            selectorEntry.pushKV("selector", strprintf("%08x", selector.first));
+            ContractExecStatsToJSON(selector.second, selectorEntry);
+            selectorList.push_back(selectorEntry);
+        }
+        entry.pushKV("selectors", selectorList);
+        contracts.push_back(entry);
+    }
+
+    UniValue result(UniValue::VOBJ);
+    result.pushKV("samplerate", (int64_t)g_contract_profiler.SampleRate());
+    result.pushKV("since", since);
+    result.pushKV("executions", executions);
+    result.pushKV("contracts", contracts);
+    return result;
+}
+
+static UniValue gettrienodecacheinfo(const JSONRPCRequest& request)
+{
+            RPCHelpMan{"gettrienodecacheinfo",
+                "\nReturns the state and hit rate of the cache of EVM state and contract UTXO trie nodes (see -trienodecache).\n",
+                {
+                    {"reset", RPCArg::Type::BOOL, /* default */ "false", "Clear the hit and miss counters after returning them"},
+                },
+                RPCResult{
+                    RPCResult::Type::OBJ, "", "",
+                    {
+                        {RPCResult::Type::NUM, "entries", "The number of cached trie nodes"},
+                        {RPCResult::Type::NUM, "usage", "The memory used by the cache, in bytes"},
+                        {RPCResult::Type::NUM, "maxusage", "The maximum memory of the cache, in bytes"},
+                        {RPCResult::Type::NUM, "hits", "The lookups served from the cache"},
+                        {RPCResult::Type::NUM, "misses", "The lookups that went to the database"},
+                        {RPCResult::Type::NUM, "hitrate", "hits / (hits + misses), 0 before the first lookup"},
+                        {RPCResult::Type::NUM, "inserts", "The nodes added, on a miss or when committed"},
+                        {RPCResult::Type::NUM, "evictions", "The nodes evicted to stay within maxusage"},
+                    }},
+                RPCExamples{
+                    HelpExampleCli("gettrienodecacheinfo", "")
+            + HelpExampleRpc("gettrienodecacheinfo", "")
+                },
+            }.Check(request);
+
+    const TrieNodeCache::Stats stats = g_trie_node_cache.GetStats();
+    if (!request.params[0].isNull() && request.params[0].get_bool())
+        g_trie_node_cache.ResetStats();
+
+    const uint64_t lookups = stats.hits + stats.misses;
+    UniValue result(UniValue::VOBJ);
+    result.pushKV("entries", (uint64_t)stats.entries);
+    result.pushKV("usage", (uint64_t)stats.usage);
+    result.pushKV("maxusage", (uint64_t)stats.max_usage);
+    result.pushKV("hits", stats.hits);
+    result.pushKV("misses", stats.misses);
+    result.pushKV("hitrate", lookups ? (double)stats.hits / lookups : 0.0);
+    result.pushKV("inserts", stats.inserts);
+    result.pushKV("evictions", stats.evictions);
+    return result;
+}
+
 static UniValue pruneblockchain(const JSONRPCRequest& request)
 {
             RPCHelpMan{"pruneblockchain", "",
@@ -2058,6 +2690,24 @@ UniValue getblockchaininfo(const JSONRPCRequest& request)
                         {RPCResult::Type::NUM, "pruneheight", "lowest-height complete block stored (only present if pruning is enabled)"},
                         {RPCResult::Type::BOOL, "automatic_pruning", "whether automatic pruning is enabled (only present if pruning is enabled)"},
                         {RPCResult::Type::NUM, "prune_target_size", "the target size used by pruning (only present if automatic pruning is enabled)"},
+                        {RPCResult::Type::OBJ, "verifydb", "status of the background startup block verification (only present if it was started)",
+                        {
+                            {RPCResult::Type::STR, "status", "one of \"running\", \"done\", \"failed\""},
+                            {RPCResult::Type::NUM, "checklevel", "the -checklevel used"},
+                            {RPCResult::Type::NUM, "snapshotheight", "height of the chain tip the verification was started from"},
+                            {RPCResult::Type::STR_HEX, "snapshothash", "hash of the chain tip the verification was started from"},
+                            {RPCResult::Type::NUM, "blocks", "number of blocks to verify"},
+                            {RPCResult::Type::NUM, "verified", "number of blocks verified so far"},
+                            {RPCResult::Type::NUM, "progress", "verification progress [0..1]"},
+                            {RPCResult::Type::BOOL, "level3skipped", "true if level 3 and 4 checks were skipped because the tip moved"},
+                        }},
+                        {RPCResult::Type::OBJ, "logevents", "receipts and log events kept for searchlogs, waitforlogs and gettransactionreceipt (only present with -logevents)",
+                        {
+                            {RPCResult::Type::BOOL, "pruned", "if the receipts and log events are subject to pruning"},
+                            {RPCResult::Type::NUM, "pruneheight", "lowest height whose receipts and log events are stored"},
+                            {RPCResult::Type::NUM, "retainblocks", "the -logeventsretain number of most recent blocks kept (only present if set)"},
+                            {RPCResult::Type::NUM, "retainheight", "the -logeventsretainheight below which blocks are pruned (only present if set)"},
+                        }},
                         {RPCResult::Type::OBJ_DYN, "softforks", "status of softforks",
                         {
                             {RPCResult::Type::OBJ, "xxxx", "name of the softfork",
@@ -2124,6 +2774,33 @@ UniValue getblockchaininfo(const JSONRPCRequest& request)
         }
     }
 
+    const VerifyDBProgress verifydb = GetVerifyDBProgress();
+    if (verifydb.started) {
+        UniValue verifydb_obj(UniValue::VOBJ);
+        verifydb_obj.pushKV("status",           verifydb.failed ? "failed" : (verifydb.finished ? "done" : "running"));
+        verifydb_obj.pushKV("checklevel",       verifydb.check_level);
+        verifydb_obj.pushKV("snapshotheight",   verifydb.snapshot_height);
+        verifydb_obj.pushKV("snapshothash",     verifydb.snapshot_hash.GetHex());
+        verifydb_obj.pushKV("blocks",           verifydb.blocks_total);
+        verifydb_obj.pushKV("verified",         verifydb.blocks_done);
+        verifydb_obj.pushKV("progress",         verifydb.Progress());
+        verifydb_obj.pushKV("level3skipped",    verifydb.level3_skipped);
+        obj.pushKV("verifydb",              verifydb_obj);
+    }
+
+    if (fLogEvents) {
+        UniValue logevents_obj(UniValue::VOBJ);
+        logevents_obj.pushKV("pruned",          nLogEventsRetain > 0 || nLogEventsRetainHeight > 0);
+        logevents_obj.pushKV("pruneheight",     GetLogEventsPruneHeight());
+        if (nLogEventsRetain > 0) {
+            logevents_obj.pushKV("retainblocks",    nLogEventsRetain);
+        }
+        if (nLogEventsRetainHeight > 0) {
+            logevents_obj.pushKV("retainheight",    nLogEventsRetainHeight);
+        }
+        obj.pushKV("logevents",             logevents_obj);
+    }
+
     const Consensus::Params& consensusParams = Params().GetConsensus();
     UniValue softforks(UniValue::VOBJ);
     BuriedForkDescPushBack(softforks, "bip34", consensusParams.BIP34Height);
@@ -3507,6 +4184,10 @@ static const CRPCCommand commands[] =
     { "blockchain",         "getblockchaininfo",      &getblockchaininfo,      {} },
     { "blockchain",         "getchaintxstats",        &getchaintxstats,        {"nblocks", "blockhash"} },
     { "blockchain",         "getblockstats",          &getblockstats,          {"hash_or_height", "stats"} },
+    { "blockchain",         "getblockprofile",        &getblockprofile,        {"blockhash", "verbose"} },
+    { "blockchain",         "getvalidationprofile",   &getvalidationprofile,   {"count", "verbose"} },
+    { "blockchain",         "getcontractprofile",     &getcontractprofile,     {"count", "sort", "reset"} },
+    { "blockchain",         "gettrienodecacheinfo",   &gettrienodecacheinfo,   {"reset"} },
     { "blockchain",         "getbestblockhash",       &getbestblockhash,       {} },
     { "blockchain",         "getblockcount",          &getblockcount,          {} },
     { "blockchain",         "getblock",               &getblock,               {"blockhash","verbosity|verbose"} },
@@ -3518,14 +4199,15 @@ static const CRPCCommand commands[] =
     { "blockchain",         "getmempooldescendants",  &getmempooldescendants,  {"txid","verbose"} },
     { "blockchain",         "getmempoolentry",        &getmempoolentry,        {"txid"} },
     { "blockchain",         "getmempoolinfo",         &getmempoolinfo,         {} },
-    { "blockchain",         "getrawmempool",          &getrawmempool,          {"verbose"} },
+    { "blockchain",         "getmempooldelta",        &getmempooldelta,        {"since","verbose"} },
+    { "blockchain",         "getrawmempool",          &getrawmempool,          {"verbose","mempool_sequence"} },
     { "blockchain",         "gettxout",               &gettxout,               {"txid","n","include_mempool"} },
     { "blockchain",         "gettxoutsetinfo",        &gettxoutsetinfo,        {} },
     { "blockchain",         "pruneblockchain",        &pruneblockchain,        {"height"} },
     { "blockchain",         "savemempool",            &savemempool,            {} },
     { "blockchain",         "verifychain",            &verifychain,            {"checklevel","nblocks"} },
     { "blockchain",         "getaccountinfo",         &getaccountinfo,         {"contract_address"} },
-    { "blockchain",         "getstorage",             &getstorage,             {"address, index, blockNum"} },
+    { "blockchain",         "getstorage",             &getstorage,             {"address", "blockNum", "index", "options"} },
 
     { "blockchain",         "preciousblock",          &preciousblock,          {"blockhash"} },
     { "blockchain",         "scantxoutset",           &scantxoutset,           {"action", "scanobjects"} },
@@ -3549,7 +4231,7 @@ static const CRPCCommand commands[] =
     { "hidden",             "waitforblockheight",     &waitforblockheight,     {"height","timeout"} },
     { "hidden",             "syncwithvalidationinterfacequeue", &syncwithvalidationinterfacequeue, {} },
     { "hidden",             "dumptxoutset",           &dumptxoutset,           {"path"} },
-    { "blockchain",         "listcontracts",          &listcontracts,          {"start", "maxDisplay"} },
+    { "blockchain",         "listcontracts",          &listcontracts,          {"start", "maxDisplay", "options"} },
     { "blockchain",         "gettransactionreceipt",  &gettransactionreceipt,  {"hash"} },
     { "blockchain",         "searchlogs",             &searchlogs,             {"fromBlock", "toBlock", "address", "topics"} },
 
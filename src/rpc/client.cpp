@@ -172,9 +172,18 @@ static const CRPCConvertParam vRPCConvertParams[] =
     { "verifychain", 1, "nblocks" },
     { "getblockstats", 0, "hash_or_height" },
     { "getblockstats", 1, "stats" },
+    { "getblockprofile", 1, "verbose" },
+    { "getvalidationprofile", 0, "count" },
+    { "getvalidationprofile", 1, "verbose" },
+    { "getcontractprofile", 0, "count" },
+    { "getcontractprofile", 2, "reset" },
+    { "gettrienodecacheinfo", 0, "reset" },
     { "pruneblockchain", 0, "height" },
     { "keypoolrefill", 0, "newsize" },
     { "getrawmempool", 0, "verbose" },
+    { "getrawmempool", 1, "mempool_sequence" },
+    { "getmempooldelta", 0, "since" },
+    { "getmempooldelta", 1, "verbose" },
     { "estimatesmartfee", 0, "conf_target" },
     { "estimaterawfee", 0, "conf_target" },
     { "estimaterawfee", 1, "threshold" },
@@ -187,6 +196,8 @@ static const CRPCConvertParam vRPCConvertParams[] =
     { "getmempoolancestors", 1, "verbose" },
     { "getmempooldescendants", 1, "verbose" },
     { "bumpfee", 1, "options" },
+    { "getlockstats", 0, "enable" },
+    { "getlockstats", 1, "reset" },
     { "logging", 0, "include" },
     { "logging", 1, "exclude" },
     { "disconnectnode", 1, "nodeid" },
@@ -228,8 +239,10 @@ static const CRPCConvertParam vRPCConvertParams[] =
     { "reservebalance", 1, "amount"},
     { "listcontracts", 0, "start" },
     { "listcontracts", 1, "maxDisplay" },
+    { "listcontracts", 2, "options" },
     { "getstorage", 2, "index" },
     { "getstorage", 1, "blockNum" },
+    { "getstorage", 3, "options" },
     // Echo with conversion (For testing only)
     { "echojson", 0, "arg0" },
     { "echojson", 1, "arg1" },
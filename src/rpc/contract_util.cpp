@@ -320,6 +320,11 @@ UniValue SearchLogs(const UniValue& _params)
 
     SearchLogsParams params(_params);
 
+    const int prune_height = GetLogEventsPruneHeight();
+    if ((int)params.fromBlock < prune_height) {
+        throw JSONRPCError(RPC_MISC_ERROR, strprintf("Log events below height %d are not available (pruned data)", prune_height));
+    }
+
     std::vector<std::vector<uint256>> hashesToBlock;
 
     curheight = pblocktree->ReadHeightIndex(params.fromBlock, params.toBlock, params.minconf, hashesToBlock, params.addresses);
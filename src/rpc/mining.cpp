@@ -10,6 +10,7 @@
 #include <consensus/params.h>
 #include <consensus/validation.h>
 #include <core_io.h>
+#include <crypto/rx2.h>
 #include <key_io.h>
 #include <miner.h>
 #include <net.h>
@@ -274,6 +275,12 @@ static UniValue getmininginfo(const JSONRPCRequest& request)
                         {RPCResult::Type::NUM, "difficulty", "The current difficulty"},
                         {RPCResult::Type::NUM, "networkhashps", "The network hashes per second"},
                         {RPCResult::Type::NUM, "pooledtx", "The size of the mempool"},
+                        {RPCResult::Type::OBJ, "powhashcache", "The cache of RandomX hashes computed for validation",
+                        {
+                            {RPCResult::Type::NUM, "entries", "The number of cached hashes"},
+                            {RPCResult::Type::NUM, "hits", "The number of lookups answered from the cache"},
+                            {RPCResult::Type::NUM, "misses", "The number of lookups that ran RandomX"},
+                        }},
                         {RPCResult::Type::STR, "chain", "current network name (main, test, regtest)"},
                         {RPCResult::Type::STR, "warnings", "any network and blockchain warnings"},
                     }},
@@ -327,6 +334,13 @@ static UniValue getmininginfo(const JSONRPCRequest& request)
     weight.pushKV("combined",      (uint64_t)nWeight);
     obj.pushKV("stakeweight",      weight);
 
+    const RandomXHashCacheStats cache_stats = GetRandomXHashCacheStats();
+    UniValue cache(UniValue::VOBJ);
+    cache.pushKV("entries",        (uint64_t)cache_stats.entries);
+    cache.pushKV("hits",           cache_stats.hits);
+    cache.pushKV("misses",         cache_stats.misses);
+    obj.pushKV("powhashcache",     cache);
+
     obj.pushKV("chain",            Params().NetworkIDString());
     obj.pushKV("warnings",         GetWarnings(false));
     return obj;
@@ -467,6 +481,77 @@ static std::string gbt_vb_name(const Consensus::DeploymentPos pos) {
     return s;
 }
 
+/** The parts of a getblocktemplate transaction entry that only depend on the transaction */
+struct TemplateTxEntry
+{
+    std::string data;
+    std::string txid;
+    std::string hash;
+    int64_t weight;
+};
+
+/**
+ * Encoded getblocktemplate transactions by wtxid. Successive templates mostly
+ * contain the same transactions, so only the ones new to a template are
+ * serialized and hex encoded; entries are dropped once they leave the template.
+ */
+static std::map<uint256, TemplateTxEntry> g_template_tx_entries GUARDED_BY(cs_main);
+
+static UniValue TemplateTransactionsToJSON(const CBlockTemplate& tmpl, bool fPreSegWit) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
+{
+    const CBlock& block = tmpl.block;
+    std::map<uint256, TemplateTxEntry> entries;
+    UniValue transactions(UniValue::VARR);
+    std::map<uint256, int64_t> setTxIndex;
+    int i = 0;
+    for (const auto& it : block.vtx) {
+        const CTransaction& tx = *it;
+        uint256 txHash = tx.GetHash();
+        setTxIndex[txHash] = i++;
+
+        if (tx.IsCoinBase())
+            continue;
+
+        const uint256& wtxid = tx.GetWitnessHash();
+        auto cached = g_template_tx_entries.find(wtxid);
+        auto entry_it = entries.end();
+        if (cached != g_template_tx_entries.end()) {
+            entry_it = entries.emplace(wtxid, std::move(cached->second)).first;
+        } else {
+            entry_it = entries.emplace(wtxid, TemplateTxEntry{EncodeHexTx(tx), txHash.GetHex(), wtxid.GetHex(), GetTransactionWeight(tx)}).first;
+        }
+        const TemplateTxEntry& cached_entry = entry_it->second;
+
+        UniValue entry(UniValue::VOBJ);
+
+        entry.pushKV("data", cached_entry.data);
+        entry.pushKV("txid", cached_entry.txid);
+        entry.pushKV("hash", cached_entry.hash);
+
+        UniValue deps(UniValue::VARR);
+        for (const CTxIn &in : tx.vin)
+        {
+            if (setTxIndex.count(in.prevout.hash))
+                deps.push_back(setTxIndex[in.prevout.hash]);
+        }
+        entry.pushKV("depends", deps);
+
+        int index_in_template = i - 1;
+        entry.pushKV("fee", tmpl.vTxFees[index_in_template]);
+        int64_t nTxSigOps = tmpl.vTxSigOpsCost[index_in_template];
+        if (fPreSegWit) {
+            CHECK_NONFATAL(nTxSigOps % WITNESS_SCALE_FACTOR == 0);
+            nTxSigOps /= WITNESS_SCALE_FACTOR;
+        }
+        entry.pushKV("sigops", nTxSigOps);
+        entry.pushKV("weight", cached_entry.weight);
+
+        transactions.push_back(entry);
+    }
+    g_template_tx_entries.swap(entries);
+    return transactions;
+}
+
 static UniValue getblocktemplate(const JSONRPCRequest& request)
 {
             RPCHelpMan{"getblocktemplate",
@@ -688,6 +773,7 @@ static UniValue getblocktemplate(const JSONRPCRequest& request)
     static CBlockIndex* pindexPrev;
     static int64_t nStart;
     static std::unique_ptr<CBlockTemplate> pblocktemplate;
+    static const CBlockTemplate* ptemplateEncoded;
     if (pindexPrev != ::ChainActive().Tip() ||
         (mempool.GetTransactionsUpdated() != nTransactionsUpdatedLast && GetTime() - nStart > 5))
     {
@@ -701,6 +787,7 @@ static UniValue getblocktemplate(const JSONRPCRequest& request)
 
         // Create new block
         CScript scriptDummy = CScript() << OP_TRUE;
+        ptemplateEncoded = nullptr;
         pblocktemplate = BlockAssembler(mempool, Params()).CreateNewBlock(scriptDummy, true, false);
         if (!pblocktemplate)
             throw JSONRPCError(RPC_OUT_OF_MEMORY, "Out of memory");
@@ -721,42 +808,13 @@ static UniValue getblocktemplate(const JSONRPCRequest& request)
 
     UniValue aCaps(UniValue::VARR); aCaps.push_back("proposal");
 
-    UniValue transactions(UniValue::VARR);
-    std::map<uint256, int64_t> setTxIndex;
-    int i = 0;
-    for (const auto& it : pblock->vtx) {
-        const CTransaction& tx = *it;
-        uint256 txHash = tx.GetHash();
-        setTxIndex[txHash] = i++;
-
-        if (tx.IsCoinBase())
-            continue;
-
-        UniValue entry(UniValue::VOBJ);
-
-        entry.pushKV("data", EncodeHexTx(tx));
-        entry.pushKV("txid", txHash.GetHex());
-        entry.pushKV("hash", tx.GetWitnessHash().GetHex());
-
-        UniValue deps(UniValue::VARR);
-        for (const CTxIn &in : tx.vin)
-        {
-            if (setTxIndex.count(in.prevout.hash))
-                deps.push_back(setTxIndex[in.prevout.hash]);
-        }
-        entry.pushKV("depends", deps);
-
-        int index_in_template = i - 1;
-        entry.pushKV("fee", pblocktemplate->vTxFees[index_in_template]);
-        int64_t nTxSigOps = pblocktemplate->vTxSigOpsCost[index_in_template];
-        if (fPreSegWit) {
-            CHECK_NONFATAL(nTxSigOps % WITNESS_SCALE_FACTOR == 0);
-            nTxSigOps /= WITNESS_SCALE_FACTOR;
-        }
-        entry.pushKV("sigops", nTxSigOps);
-        entry.pushKV("weight", GetTransactionWeight(tx));
-
-        transactions.push_back(entry);
+    // The transactions only change with the template, so their encoding is
+    // reused until the next template is made
+    static UniValue transactions;
+    if (ptemplateEncoded != pblocktemplate.get()) {
+        ptemplateEncoded = nullptr;
+        transactions = TemplateTransactionsToJSON(*pblocktemplate, fPreSegWit);
+        ptemplateEncoded = pblocktemplate.get();
     }
 
     UniValue aux(UniValue::VOBJ);
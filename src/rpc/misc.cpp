@@ -13,13 +13,17 @@
 #include <scheduler.h>
 #include <script/descriptor.h>
 #include <util/check.h>
+#include <util/memoryusage.h>
 #include <util/message.h> // For MessageSign(), MessageVerify()
 #include <util/strencodings.h>
+#include <util/string.h>
 #include <util/system.h>
 
 #include <txmempool.h>
 #include <validation.h>
+#include <validationinterface.h>
 
+#include <algorithm>
 #include <stdint.h>
 #include <tuple>
 #ifdef HAVE_MALLOC_INFO
@@ -1189,7 +1193,8 @@ static UniValue getmemoryinfo(const JSONRPCRequest& request)
                 {
                     {"mode", RPCArg::Type::STR, /* default */ "\"stats\"", "determines what kind of information is returned.\n"
             "  - \"stats\" returns general statistics about memory usage in the daemon.\n"
-            "  - \"mallocinfo\" returns an XML string describing low-level heap state (only available if compiled with glibc 2.10+)."},
+            "  - \"mallocinfo\" returns an XML string describing low-level heap state (only available if compiled with glibc 2.10+).\n"
+            "  - \"subsystems\" returns the estimated dynamic memory usage of each subsystem (caches, indexes, mempool)."},
                 },
                 {
                     RPCResult{"mode \"stats\"",
@@ -1209,9 +1214,17 @@ static UniValue getmemoryinfo(const JSONRPCRequest& request)
                     RPCResult{"mode \"mallocinfo\"",
                         RPCResult::Type::STR, "", "\"<malloc version=\"1\">...\""
                     },
+                    RPCResult{"mode \"subsystems\"",
+                        RPCResult::Type::OBJ_DYN, "", "",
+                        {
+                            {RPCResult::Type::NUM, "name", "Estimated number of bytes used by the subsystem"},
+                            {RPCResult::Type::NUM, "total", "Sum of the subsystems"},
+                        }
+                    },
                 },
                 RPCExamples{
                     HelpExampleCli("getmemoryinfo", "")
+            + HelpExampleCli("getmemoryinfo", "\"subsystems\"")
             + HelpExampleRpc("getmemoryinfo", "")
                 },
             }.Check(request);
@@ -1227,11 +1240,145 @@ static UniValue getmemoryinfo(const JSONRPCRequest& request)
 #else
         throw JSONRPCError(RPC_INVALID_PARAMETER, "mallocinfo is only available when compiled with glibc 2.10+");
 #endif
+    } else if (mode == "subsystems") {
+        UniValue obj(UniValue::VOBJ);
+        size_t total = 0;
+        for (const auto& usage : GetMemoryUsage()) {
+            obj.pushKV(usage.first, (uint64_t)usage.second);
+            total += usage.second;
+        }
+        obj.pushKV("total", (uint64_t)total);
+        return obj;
     } else {
         throw JSONRPCError(RPC_INVALID_PARAMETER, "unknown mode " + mode);
     }
 }
 
+static UniValue getvalidationqueueinfo(const JSONRPCRequest& request)
+{
+            RPCHelpMan{"getvalidationqueueinfo",
+                "Returns the state of the per-subscriber validation notification queues.\n"
+                "Each subscriber (wallets, indexes, zmq, ...) processes its notifications in order on its own queue.\n",
+                {},
+                RPCResult{
+                    RPCResult::Type::ARR, "", "",
+                    {
+                        {RPCResult::Type::OBJ, "", "",
+                        {
+                            {RPCResult::Type::STR, "name", "The subscriber name"},
+                            {RPCResult::Type::BOOL, "registered", "False if the subscriber was unregistered and its queue is draining"},
+                            {RPCResult::Type::BOOL, "lossy", "True if the subscriber misses mempool notifications when its queue is full, instead of making the node wait"},
+                            {RPCResult::Type::NUM, "pending", "Number of notifications waiting to be processed"},
+                            {RPCResult::Type::NUM, "max_pending", "Highest number of pending notifications seen"},
+                            {RPCResult::Type::NUM, "processed", "Number of notifications processed"},
+                            {RPCResult::Type::NUM, "exec_time_us", "Total time spent processing notifications, in microseconds"},
+                            {RPCResult::Type::NUM, "over_limit", "Number of notifications queued while the queue was above its limit"},
+                            {RPCResult::Type::NUM, "waits", "Number of times the node waited for the queue to get back within its limit"},
+                            {RPCResult::Type::NUM, "dropped", "Number of mempool notifications the lossy subscriber missed because its queue was full"},
+                        }},
+                    }
+                },
+                RPCExamples{
+                    HelpExampleCli("getvalidationqueueinfo", "")
+            + HelpExampleRpc("getvalidationqueueinfo", "")
+                },
+            }.Check(request);
+
+    UniValue ret(UniValue::VARR);
+    for (const ValidationQueueStats& stats : GetMainSignals().GetQueueStats()) {
+        UniValue obj(UniValue::VOBJ);
+        obj.pushKV("name", stats.name);
+        obj.pushKV("registered", stats.registered);
+        obj.pushKV("lossy", stats.lossy);
+        obj.pushKV("pending", (uint64_t)stats.pending);
+        obj.pushKV("max_pending", (uint64_t)stats.max_pending);
+        obj.pushKV("processed", stats.processed);
+        obj.pushKV("exec_time_us", stats.exec_time_us);
+        obj.pushKV("over_limit", stats.over_limit);
+        obj.pushKV("waits", stats.waits);
+        obj.pushKV("dropped", stats.dropped);
+        ret.push_back(obj);
+    }
+    return ret;
+}
+
+static UniValue LockHistogramToJSON(const std::vector<uint64_t>& histogram)
+{
+    size_t size = histogram.size();
+    while (size > 0 && histogram[size - 1] == 0) size--;
+    UniValue ret(UniValue::VARR);
+    for (size_t i = 0; i < size; i++) ret.push_back(histogram[i]);
+    return ret;
+}
+
+static UniValue getlockstats(const JSONRPCRequest& request)
+{
+            RPCHelpMan{"getlockstats",
+                "Returns lock contention statistics per lock site, the sites that waited longest first.\n"
+                "Statistics are only collected while enabled, with -lockstats or the enable argument.\n"
+                "Every contended acquisition records its wait; one in " + ToString(LOCK_STATS_SAMPLE_INTERVAL) + " acquisitions records how long the lock was then held,\n"
+                "including any time spent waiting on a condition variable with it.\n"
+                "Histogram bucket 0 counts durations under 1 microsecond, bucket i those from 2^(i-1) up to 2^i microseconds. Empty buckets at the end are left out.\n",
+                {
+                    {"enable", RPCArg::Type::BOOL, RPCArg::Optional::OMITTED, "Start (true) or stop (false) collecting statistics"},
+                    {"reset", RPCArg::Type::BOOL, /* default */ "false", "Clear the statistics after returning them"},
+                },
+                RPCResult{
+                    RPCResult::Type::OBJ, "", "",
+                    {
+                        {RPCResult::Type::BOOL, "enabled", "Whether statistics are being collected"},
+                        {RPCResult::Type::ARR, "sites", "",
+                        {
+                            {RPCResult::Type::OBJ, "", "",
+                            {
+                                {RPCResult::Type::STR, "lock", "The locked mutex, as written at the site"},
+                                {RPCResult::Type::STR, "location", "The source file and line of the site"},
+                                {RPCResult::Type::NUM, "contentions", "Number of acquisitions that had to wait"},
+                                {RPCResult::Type::NUM, "wait_us", "Total time spent waiting, in microseconds"},
+                                {RPCResult::Type::ARR, "wait_histogram", "Wait times of the contended acquisitions", {{RPCResult::Type::NUM, "", ""}}},
+                                {RPCResult::Type::NUM, "hold_samples", "Number of sampled acquisitions"},
+                                {RPCResult::Type::NUM, "hold_us", "Total time the sampled acquisitions held the lock, in microseconds"},
+                                {RPCResult::Type::ARR, "hold_histogram", "Hold times of the sampled acquisitions", {{RPCResult::Type::NUM, "", ""}}},
+                            }},
+                        }},
+                    }
+                },
+                RPCExamples{
+                    HelpExampleCli("getlockstats", "true")
+            + HelpExampleCli("getlockstats", "")
+            + HelpExampleRpc("getlockstats", "")
+                },
+            }.Check(request);
+
+    if (!request.params[0].isNull()) {
+        g_lock_stats_enabled = request.params[0].get_bool();
+    }
+
+    std::vector<LockSiteStats> sites = GetLockStats();
+    std::sort(sites.begin(), sites.end(), [](const LockSiteStats& a, const LockSiteStats& b) { return a.wait_us > b.wait_us; });
+    if (!request.params[1].isNull() && request.params[1].get_bool()) {
+        ResetLockStats();
+    }
+
+    UniValue ret(UniValue::VOBJ);
+    ret.pushKV("enabled", g_lock_stats_enabled.load());
+    UniValue arr(UniValue::VARR);
+    for (const LockSiteStats& site : sites) {
+        UniValue obj(UniValue::VOBJ);
+        obj.pushKV("lock", site.name);
+        obj.pushKV("location", strprintf("%s:%d", site.file, site.line));
+        obj.pushKV("contentions", site.contentions);
+        obj.pushKV("wait_us", site.wait_us);
+        obj.pushKV("wait_histogram", LockHistogramToJSON(site.wait_histogram));
+        obj.pushKV("hold_samples", site.hold_samples);
+        obj.pushKV("hold_us", site.hold_us);
+        obj.pushKV("hold_histogram", LockHistogramToJSON(site.hold_histogram));
+        arr.push_back(obj);
+    }
+    ret.pushKV("sites", arr);
+    return ret;
+}
+
 static void EnableOrDisableLogCategories(UniValue cats, bool enable) {
     cats = cats.get_array();
     for (unsigned int i = 0; i < cats.size(); ++i) {
@@ -1346,6 +1493,8 @@ static const CRPCCommand commands[] =
   //  --------------------- ------------------------  -----------------------  ----------
     { "control",            "getmemoryinfo",          &getmemoryinfo,          {"mode"} },
     { "control",            "logging",                &logging,                {"include", "exclude"}},
+    { "control",            "getvalidationqueueinfo", &getvalidationqueueinfo, {} },
+    { "control",            "getlockstats",           &getlockstats,           {"enable", "reset"} },
     { "util",               "validateaddress",        &validateaddress,        {"address"} },
     { "util",               "createmultisig",         &createmultisig,         {"nrequired","keys","address_type"} },
     { "util",               "deriveaddresses",        &deriveaddresses,        {"descriptor", "range"} },
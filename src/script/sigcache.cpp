@@ -26,6 +26,7 @@ private:
     uint256 nonce;
     typedef CuckooCache::cache<uint256, SignatureCacheHasher> map_type;
     map_type setValid;
+    size_t nCapacity = 0;
     boost::shared_mutex cs_sigcache;
 
 public:
@@ -54,7 +55,30 @@ public:
     }
     uint32_t setup_bytes(size_t n)
     {
-        return setValid.setup_bytes(n);
+        nCapacity = setValid.setup_bytes(n);
+        return nCapacity;
+    }
+
+    size_t Capacity() const
+    {
+        return nCapacity;
+    }
+
+    void GetEntries(uint256& nonceOut, std::vector<uint256>& entries)
+    {
+        boost::shared_lock<boost::shared_mutex> lock(cs_sigcache);
+        nonceOut = nonce;
+        setValid.get_elements(entries);
+    }
+
+    void LoadEntries(const uint256& nonceIn, const std::vector<uint256>& entries)
+    {
+        boost::unique_lock<boost::shared_mutex> lock(cs_sigcache);
+        nonce = nonceIn;
+        // Oldest first, so the most recent entries end up in the newest epoch
+        for (auto it = entries.rbegin(); it != entries.rend(); ++it) {
+            setValid.insert(*it);
+        }
     }
 };
 
@@ -79,6 +103,21 @@ void InitSignatureCache()
             (nElems*sizeof(uint256)) >>20, (nMaxCacheSize*2)>>20, nElems);
 }
 
+void GetSignatureCacheEntries(uint256& nonce, std::vector<uint256>& entries)
+{
+    signatureCache.GetEntries(nonce, entries);
+}
+
+size_t GetSignatureCacheCapacity()
+{
+    return signatureCache.Capacity();
+}
+
+void LoadSignatureCacheEntries(const uint256& nonce, const std::vector<uint256>& entries)
+{
+    signatureCache.LoadEntries(nonce, entries);
+}
+
 bool CachingTransactionSignatureChecker::VerifySignature(const std::vector<unsigned char>& vchSig, const CPubKey& pubkey, const uint256& sighash) const
 {
     uint256 entry;
@@ -64,4 +64,15 @@ public:
 
 void InitSignatureCache();
 
+/** Copy the nonce and the entries of the signature cache, most recently added first. */
+void GetSignatureCacheEntries(uint256& nonce, std::vector<uint256>& entries);
+/** Number of entries the signature cache can hold. */
+size_t GetSignatureCacheCapacity();
+/**
+ * Restore entries copied by GetSignatureCacheEntries, together with their nonce.
+ * The entries already in the cache become unreachable, so this must run before
+ * any signature is checked.
+ */
+void LoadSignatureCacheEntries(const uint256& nonce, const std::vector<uint256>& entries);
+
 #endif // BITCOIN_SCRIPT_SIGCACHE_H
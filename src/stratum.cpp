@@ -0,0 +1,536 @@
+// Copyright (c) 2020 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <stratum.h>
+
+#include <arith_uint256.h>
+#include <chainparams.h>
+#include <consensus/merkle.h>
+#include <crypto/common.h>
+#include <key_io.h>
+#include <logging.h>
+#include <miner.h>
+#include <netbase.h>
+#include <pow.h>
+#include <rx2_helper.h>
+#include <script/standard.h>
+#include <support/events.h>
+#include <timedata.h>
+#include <txmempool.h>
+#include <ui_interface.h>
+#include <univalue.h>
+#include <util/error.h>
+#include <util/memory.h>
+#include <util/strencodings.h>
+#include <util/string.h>
+#include <util/system.h>
+#include <util/translation.h>
+#include <validation.h>
+#include <validationinterface.h>
+
+#include <deque>
+#include <map>
+#include <set>
+#include <thread>
+
+#include <event2/buffer.h>
+#include <event2/bufferevent.h>
+#include <event2/listener.h>
+#include <event2/thread.h>
+
+MAKE_RAII(evconnlistener);
+MAKE_RAII(bufferevent);
+
+/** Number of header bytes CBlockHeader::GetHash() runs RandomX on */
+static const size_t STRATUM_BLOB_SIZE = 144;
+/** Maximum length of a request line. Requests are short, so this only stops memory exhaustion */
+static const size_t MAX_STRATUM_LINE_LENGTH = 10000;
+/** Maximum number of connected miners */
+static const size_t MAX_STRATUM_SESSIONS = 1000;
+/** Jobs kept per miner for late shares. Jobs for an older tip are always dropped */
+static const size_t MAX_STRATUM_JOBS = 4;
+/** How often to check the mempool for a new block template, in seconds */
+static const int STRATUM_TEMPLATE_REFRESH = 10;
+
+namespace {
+
+class StratumServer;
+
+/** Work handed to one miner: the template block with its own coinbase */
+struct StratumJob
+{
+    CBlock block;
+    uint256 seed;
+    arith_uint256 target;
+    std::set<uint32_t> nonces; //!< Nonces submitted so far
+};
+
+struct StratumSession
+{
+    StratumServer* server;
+    uint64_t id;
+    raii_bufferevent bev;
+    std::string address;
+    bool logged_in{false};
+    std::map<std::string, StratumJob> jobs;
+    std::deque<std::string> job_order; //!< jobs, oldest first
+    uint64_t accepted{0};
+    uint64_t rejected{0};
+};
+
+/**
+ * The server state. Everything but the tip notification is only touched from
+ * the stratum thread, which runs the event loop.
+ */
+class StratumServer final : public CValidationInterface
+{
+public:
+    StratumServer(CTxMemPool& mempool, const CScript& script, const arith_uint256& share_target);
+
+    bool Bind(const CService& addr);
+    void Run() { event_base_dispatch(m_base.get()); }
+    void Interrupt();
+
+    std::string GetValidationQueueName() const override { return "stratum"; }
+
+protected:
+    void UpdatedBlockTip(const CBlockIndex* pindexNew, const CBlockIndex* pindexFork, bool fInitialDownload) override;
+
+private:
+    CTxMemPool& m_mempool;
+    const CScript m_script;
+    const arith_uint256 m_share_target;
+
+    raii_event_base m_base;
+    raii_evconnlistener m_listener;
+    raii_event m_tip_event;
+    raii_event m_refresh_event;
+
+    std::map<uint64_t, StratumSession> m_sessions;
+    uint64_t m_next_session_id{1};
+    uint64_t m_next_job_id{1};
+    uint64_t m_next_extranonce{1};
+
+    std::unique_ptr<CBlockTemplate> m_template;
+    int m_template_height{0};
+    uint256 m_template_seed;
+    unsigned int m_template_tx_updated{0};
+
+    static void AcceptCallback(struct evconnlistener* listener, evutil_socket_t fd, struct sockaddr* addr, int socklen, void* ctx);
+    static void ReadCallback(struct bufferevent* bev, void* ctx);
+    static void EventCallback(struct bufferevent* bev, short what, void* ctx);
+    static void TipCallback(evutil_socket_t, short, void* ctx);
+    static void RefreshCallback(evutil_socket_t, short, void* ctx);
+
+    void CloseSession(StratumSession& session);
+    void Send(StratumSession& session, const UniValue& message);
+    /** Handle a request line, returning false if the miner should be disconnected */
+    bool HandleRequest(StratumSession& session, const std::string& line);
+    UniValue Submit(StratumSession& session, const UniValue& id, const UniValue& params);
+
+    bool UpdateTemplate();
+    UniValue NewJob(StratumSession& session);
+    void PushJobs(bool clean);
+};
+
+UniValue StratumReply(const UniValue& id, const UniValue& result)
+{
+    UniValue reply(UniValue::VOBJ);
+    reply.pushKV("id", id);
+    reply.pushKV("jsonrpc", "2.0");
+    reply.pushKV("error", NullUniValue);
+    reply.pushKV("result", result);
+    return reply;
+}
+
+UniValue StratumError(const UniValue& id, const std::string& message)
+{
+    UniValue error(UniValue::VOBJ);
+    error.pushKV("code", -1);
+    error.pushKV("message", message);
+    UniValue reply(UniValue::VOBJ);
+    reply.pushKV("id", id);
+    reply.pushKV("jsonrpc", "2.0");
+    reply.pushKV("error", error);
+    return reply;
+}
+
+UniValue StatusOK()
+{
+    UniValue status(UniValue::VOBJ);
+    status.pushKV("status", "OK");
+    return status;
+}
+
+StratumServer::StratumServer(CTxMemPool& mempool, const CScript& script, const arith_uint256& share_target) :
+    m_mempool(mempool), m_script(script), m_share_target(share_target), m_base(obtain_event_base())
+{
+    m_tip_event = obtain_event(m_base.get(), -1, 0, TipCallback, this);
+    m_refresh_event = obtain_event(m_base.get(), -1, EV_PERSIST, RefreshCallback, this);
+    struct timeval tv = {STRATUM_TEMPLATE_REFRESH, 0};
+    event_add(m_refresh_event.get(), &tv);
+}
+
+bool StratumServer::Bind(const CService& addr)
+{
+    struct sockaddr_storage sockaddr;
+    socklen_t len = sizeof(sockaddr);
+    if (!addr.GetSockAddr((struct sockaddr*)&sockaddr, &len)) {
+        return false;
+    }
+    m_listener.reset(evconnlistener_new_bind(m_base.get(), AcceptCallback, this, LEV_OPT_CLOSE_ON_FREE | LEV_OPT_REUSEABLE, -1, (struct sockaddr*)&sockaddr, len));
+    return m_listener != nullptr;
+}
+
+void StratumServer::Interrupt()
+{
+    event_base_once(m_base.get(), -1, EV_TIMEOUT, [](evutil_socket_t, short, void* ctx) {
+        StratumServer* self = static_cast<StratumServer*>(ctx);
+        self->m_listener.reset();
+        self->m_sessions.clear();
+        event_base_loopbreak(self->m_base.get());
+    }, this, nullptr);
+}
+
+void StratumServer::UpdatedBlockTip(const CBlockIndex* pindexNew, const CBlockIndex* pindexFork, bool fInitialDownload)
+{
+    if (fInitialDownload) return;
+    // Runs on a scheduler thread: hand the work over to the stratum thread
+    event_active(m_tip_event.get(), 0, 0);
+}
+
+void StratumServer::AcceptCallback(struct evconnlistener* listener, evutil_socket_t fd, struct sockaddr* addr, int socklen, void* ctx)
+{
+    StratumServer* self = static_cast<StratumServer*>(ctx);
+    CService peer;
+    peer.SetSockAddr(addr);
+    if (self->m_sessions.size() >= MAX_STRATUM_SESSIONS) {
+        LogPrint(BCLog::STRATUM, "stratum: Too many miners, refusing %s\n", peer.ToString());
+        evutil_closesocket(fd);
+        return;
+    }
+
+    raii_bufferevent bev(bufferevent_socket_new(self->m_base.get(), fd, BEV_OPT_CLOSE_ON_FREE));
+    if (!bev) {
+        evutil_closesocket(fd);
+        return;
+    }
+    const uint64_t id = self->m_next_session_id++;
+    StratumSession& session = self->m_sessions[id];
+    bufferevent_setcb(bev.get(), ReadCallback, nullptr, EventCallback, &session);
+    bufferevent_enable(bev.get(), EV_READ | EV_WRITE);
+    session.server = self;
+    session.id = id;
+    session.bev = std::move(bev);
+    session.address = peer.ToString();
+    LogPrint(BCLog::STRATUM, "stratum: Miner %d connected from %s\n", id, session.address);
+}
+
+void StratumServer::CloseSession(StratumSession& session)
+{
+    LogPrint(BCLog::STRATUM, "stratum: Miner %d disconnected (%d shares accepted, %d rejected)\n", session.id, session.accepted, session.rejected);
+    m_sessions.erase(session.id);
+}
+
+void StratumServer::ReadCallback(struct bufferevent* bev, void* ctx)
+{
+    StratumSession* session = static_cast<StratumSession*>(ctx);
+    StratumServer* self = session->server;
+
+    struct evbuffer* input = bufferevent_get_input(bev);
+    size_t length = 0;
+    char* line;
+    while ((line = evbuffer_readln(input, &length, EVBUFFER_EOL_CRLF)) != nullptr) {
+        std::string request(line, length);
+        free(line);
+        if (request.empty()) continue;
+        if (!self->HandleRequest(*session, request)) {
+            self->CloseSession(*session);
+            return;
+        }
+    }
+    // Everything left is an incomplete line
+    if (evbuffer_get_length(input) > MAX_STRATUM_LINE_LENGTH) {
+        LogPrint(BCLog::STRATUM, "stratum: Miner %d sent an overlong request\n", session->id);
+        self->CloseSession(*session);
+    }
+}
+
+void StratumServer::EventCallback(struct bufferevent* bev, short what, void* ctx)
+{
+    StratumSession* session = static_cast<StratumSession*>(ctx);
+    if (what & (BEV_EVENT_EOF | BEV_EVENT_ERROR)) {
+        session->server->CloseSession(*session);
+    }
+}
+
+void StratumServer::TipCallback(evutil_socket_t, short, void* ctx)
+{
+    StratumServer* self = static_cast<StratumServer*>(ctx);
+    if (self->UpdateTemplate()) self->PushJobs(true);
+}
+
+void StratumServer::RefreshCallback(evutil_socket_t, short, void* ctx)
+{
+    StratumServer* self = static_cast<StratumServer*>(ctx);
+    if (self->m_sessions.empty()) return;
+    bool new_tip;
+    {
+        LOCK(cs_main);
+        new_tip = !self->m_template || self->m_template->block.hashPrevBlock != ::ChainActive().Tip()->GetBlockHash();
+    }
+    if (!new_tip && self->m_mempool.GetTransactionsUpdated() == self->m_template_tx_updated) return;
+    if (self->UpdateTemplate()) self->PushJobs(new_tip);
+}
+
+void StratumServer::Send(StratumSession& session, const UniValue& message)
+{
+    std::string line = message.write() + "\n";
+    bufferevent_write(session.bev.get(), line.data(), line.size());
+}
+
+bool StratumServer::HandleRequest(StratumSession& session, const std::string& line)
+{
+    UniValue request;
+    if (!request.read(line) || !request.isObject()) {
+        LogPrint(BCLog::STRATUM, "stratum: Miner %d sent an invalid request\n", session.id);
+        return false;
+    }
+    const UniValue& id = find_value(request, "id");
+    const UniValue& method = find_value(request, "method");
+    const UniValue& params = find_value(request, "params");
+    if (!method.isStr()) {
+        Send(session, StratumError(id, "Missing method"));
+        return true;
+    }
+
+    if (method.get_str() == "login") {
+        if (!m_template && !UpdateTemplate()) {
+            Send(session, StratumError(id, "Node is not ready for mining"));
+            return true;
+        }
+        session.logged_in = true;
+        const UniValue& agent = params.isObject() ? find_value(params, "agent") : NullUniValue;
+        LogPrint(BCLog::STRATUM, "stratum: Miner %d logged in%s\n", session.id, agent.isStr() ? " (" + SanitizeString(agent.get_str()) + ")" : "");
+        UniValue result(UniValue::VOBJ);
+        result.pushKV("id", ToString(session.id));
+        result.pushKV("job", NewJob(session));
+        result.pushKV("extensions", UniValue(UniValue::VARR));
+        result.pushKV("status", "OK");
+        Send(session, StratumReply(id, result));
+    } else if (method.get_str() == "keepalived") {
+        UniValue result(UniValue::VOBJ);
+        result.pushKV("status", "KEEPALIVED");
+        Send(session, StratumReply(id, result));
+    } else if (!session.logged_in) {
+        Send(session, StratumError(id, "Unauthenticated"));
+    } else if (method.get_str() == "getjob") {
+        if (!m_template) {
+            Send(session, StratumError(id, "Node is not ready for mining"));
+        } else {
+            Send(session, StratumReply(id, NewJob(session)));
+        }
+    } else if (method.get_str() == "submit") {
+        Send(session, params.isObject() ? Submit(session, id, params) : StratumError(id, "Invalid params"));
+    } else {
+        Send(session, StratumError(id, "Unknown method"));
+    }
+    return true;
+}
+
+UniValue StratumServer::Submit(StratumSession& session, const UniValue& id, const UniValue& params)
+{
+    const UniValue& job_id = find_value(params, "job_id");
+    const UniValue& nonce_hex = find_value(params, "nonce");
+    if (!job_id.isStr() || !nonce_hex.isStr() || nonce_hex.get_str().size() != 8 || !IsHex(nonce_hex.get_str())) {
+        ++session.rejected;
+        return StratumError(id, "Invalid params");
+    }
+    auto it = session.jobs.find(job_id.get_str());
+    if (it == session.jobs.end()) {
+        ++session.rejected;
+        return StratumError(id, "Block expired");
+    }
+    StratumJob& job = it->second;
+    const uint32_t nonce = ReadLE32(ParseHex(nonce_hex.get_str()).data());
+    if (!job.nonces.insert(nonce).second) {
+        ++session.rejected;
+        return StratumError(id, "Duplicate share");
+    }
+
+    job.block.nNonce = nonce;
+    const uint256 hash = job.block.GetHash(&job.seed, true);
+    if (UintToArith256(hash) > job.target) {
+        ++session.rejected;
+        return StratumError(id, "Low difficulty share");
+    }
+    ++session.accepted;
+
+    if (CheckProofOfWork(hash, job.block.nBits, Params().GetConsensus())) {
+        {
+            // The new tip's job may not have been pushed yet; don't fork our own block
+            LOCK(cs_main);
+            if (job.block.hashPrevBlock != ::ChainActive().Tip()->GetBlockHash()) {
+                return StratumError(id, "Block expired");
+            }
+        }
+        LogPrintf("stratum: Miner %d found block %s at height %d\n", session.id, job.block.GetHash().ToString(), m_template_height);
+        std::shared_ptr<const CBlock> block = std::make_shared<const CBlock>(job.block);
+        if (!ProcessNewBlock(Params(), block, true, nullptr)) {
+            return StratumError(id, "Block rejected");
+        }
+    }
+    return StratumReply(id, StatusOK());
+}
+
+bool StratumServer::UpdateTemplate()
+{
+    if (::ChainstateActive().IsInitialBlockDownload()) {
+        m_template.reset();
+        return false;
+    }
+
+    const unsigned int tx_updated = m_mempool.GetTransactionsUpdated();
+    std::unique_ptr<CBlockTemplate> block_template = BlockAssembler(m_mempool, Params()).CreateNewBlock(m_script, true, false, nullptr, 0, GetAdjustedTime() + POW_MINER_MAX_TIME);
+    if (!block_template) {
+        LogPrintf("stratum: Failed to create a block template\n");
+        return false;
+    }
+    int height;
+    {
+        LOCK(cs_main);
+        const CBlockIndex* pindexPrev = LookupBlockIndex(block_template->block.hashPrevBlock);
+        if (!pindexPrev) return false;
+        height = pindexPrev->nHeight + 1;
+    }
+
+    // The seed that validation checks the block's hash with
+    m_template_seed = GetRandomXSeed(height);
+    m_template_height = height;
+    m_template_tx_updated = tx_updated;
+    m_template = std::move(block_template);
+    return true;
+}
+
+UniValue StratumServer::NewJob(StratumSession& session)
+{
+    const std::string job_id = strprintf("%x", m_next_job_id++);
+    StratumJob& job = session.jobs[job_id];
+    session.job_order.push_back(job_id);
+    while (session.job_order.size() > MAX_STRATUM_JOBS) {
+        session.jobs.erase(session.job_order.front());
+        session.job_order.pop_front();
+    }
+
+    // Every job gets its own extranonce, so miners never search the same nonces twice
+    job.block = m_template->block;
+    CMutableTransaction coinbase(*job.block.vtx[0]);
+    coinbase.vin[0].scriptSig = CScript() << m_template_height << CScriptNum(m_next_extranonce++);
+    job.block.vtx[0] = MakeTransactionRef(std::move(coinbase));
+    job.block.hashMerkleRoot = BlockMerkleRoot(job.block);
+    job.seed = m_template_seed;
+
+    // Blocks are found as shares too, even when they are easier than the share target
+    arith_uint256 block_target;
+    block_target.SetCompact(job.block.nBits);
+    job.target = std::max(m_share_target, block_target);
+    unsigned char target[8];
+    WriteLE64(target, (job.target >> 192).GetLow64());
+
+    const unsigned char* header = reinterpret_cast<const unsigned char*>(static_cast<const CBlockHeader*>(&job.block));
+    const ptrdiff_t nonce_offset = reinterpret_cast<const unsigned char*>(&job.block.nNonce) - header;
+
+    UniValue result(UniValue::VOBJ);
+    result.pushKV("blob", HexStr(header, header + STRATUM_BLOB_SIZE));
+    result.pushKV("job_id", job_id);
+    result.pushKV("target", HexStr(target, target + sizeof(target)));
+    result.pushKV("id", ToString(session.id));
+    result.pushKV("height", m_template_height);
+    result.pushKV("seed_hash", job.seed.GetHex());
+    result.pushKV("nonce_offset", (int64_t)nonce_offset);
+    return result;
+}
+
+void StratumServer::PushJobs(bool clean)
+{
+    for (auto& entry : m_sessions) {
+        StratumSession& session = entry.second;
+        if (!session.logged_in) continue;
+        if (clean) {
+            session.jobs.clear();
+            session.job_order.clear();
+        }
+        UniValue notification(UniValue::VOBJ);
+        notification.pushKV("jsonrpc", "2.0");
+        notification.pushKV("method", "job");
+        notification.pushKV("params", NewJob(session));
+        Send(session, notification);
+    }
+}
+
+} // namespace
+
+static std::unique_ptr<StratumServer> g_stratum;
+static std::thread g_stratum_thread;
+
+static void StratumThread()
+{
+    g_stratum->Run();
+}
+
+bool StartStratumServer(CTxMemPool& mempool)
+{
+    assert(!g_stratum);
+
+    const std::string address = gArgs.GetArg("-stratumaddress", "");
+    const CTxDestination dest = DecodeDestination(address);
+    if (!IsValidDestination(dest)) {
+        return InitError(strprintf(_("Invalid -stratumaddress: '%s'").translated, address));
+    }
+    const int64_t difficulty = gArgs.GetArg("-stratumdifficulty", DEFAULT_STRATUM_DIFFICULTY);
+    if (difficulty < 1) {
+        return InitError(strprintf(_("Invalid -stratumdifficulty: %d").translated, difficulty));
+    }
+    const arith_uint256 share_target = ~arith_uint256() / arith_uint256(difficulty);
+
+    CService bind_addr;
+    const std::string bind = gArgs.GetArg("-stratumbind", DEFAULT_STRATUM_BIND);
+    if (!Lookup(bind, bind_addr, gArgs.GetArg("-stratumport", DEFAULT_STRATUM_PORT), false)) {
+        return InitError(ResolveErrMsg("stratumbind", bind));
+    }
+
+#ifdef WIN32
+    evthread_use_windows_threads();
+#else
+    evthread_use_pthreads();
+#endif
+    g_stratum = MakeUnique<StratumServer>(mempool, GetScriptForDestination(dest), share_target);
+    if (!g_stratum->Bind(bind_addr)) {
+        g_stratum.reset();
+        return InitError(strprintf(_("Unable to bind the stratum server to %s").translated, bind_addr.ToString()));
+    }
+    RegisterValidationInterface(g_stratum.get());
+    LogPrintf("stratum: Listening on %s, share difficulty %d\n", bind_addr.ToString(), difficulty);
+
+    g_stratum_thread = std::thread(std::bind(&TraceThread<void (*)()>, "stratum", &StratumThread));
+    return true;
+}
+
+void InterruptStratumServer()
+{
+    if (g_stratum) {
+        LogPrint(BCLog::STRATUM, "stratum: Thread interrupt\n");
+        g_stratum->Interrupt();
+    }
+}
+
+void StopStratumServer()
+{
+    if (g_stratum) {
+        UnregisterValidationInterface(g_stratum.get());
+        SyncWithValidationInterfaceQueue();
+        g_stratum_thread.join();
+        g_stratum.reset();
+    }
+}
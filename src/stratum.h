@@ -0,0 +1,47 @@
+// Copyright (c) 2020 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+/**
+ * Stratum server for proof-of-work miners.
+ *
+ * Miners connect over TCP and speak the line based JSON-RPC dialect of
+ * Monero style RandomX pools: "login", "getjob", "submit" and "keepalived"
+ * requests, and "job" notifications pushed by the node whenever the tip or
+ * the block template changes. Each job has its own coinbase extranonce, so
+ * no two jobs share nonce space, and carries:
+ *
+ * - blob: the header bytes CBlockHeader::GetHash() runs RandomX on
+ * - nonce_offset: where in the blob the miner writes the 4 byte nonce
+ * - target: 8 byte little endian share target; a share is good when the last
+ *   8 bytes of the RandomX hash, read as a little endian number, are below it
+ * - seed_hash: the RandomX seed block hash, as returned by GetRandomXSeed()
+ * - height: height of the block being mined
+ *
+ * Shares are submitted as {"id", "job_id", "nonce"}, with the nonce as 8 hex
+ * characters in blob byte order. The node hashes every share itself, and
+ * shares that meet the block target are submitted through ProcessNewBlock().
+ * Blocks pay to -stratumaddress.
+ */
+#ifndef BITCOIN_STRATUM_H
+#define BITCOIN_STRATUM_H
+
+#include <stdint.h>
+#include <string>
+
+class CTxMemPool;
+
+static const bool DEFAULT_STRATUM_ENABLE = false;
+static const std::string DEFAULT_STRATUM_BIND = "127.0.0.1";
+static const uint16_t DEFAULT_STRATUM_PORT = 3333;
+/** Default for -stratumdifficulty, about a share every few seconds from a desktop CPU */
+static const uint64_t DEFAULT_STRATUM_DIFFICULTY = 10000;
+
+/** Start the stratum server. Returns false, after reporting the error, if it can't be set up */
+bool StartStratumServer(CTxMemPool& mempool);
+/** Disconnect the miners and stop accepting new ones */
+void InterruptStratumServer();
+/** Stop the stratum server thread and free its resources */
+void StopStratumServer();
+
+#endif // BITCOIN_STRATUM_H
@@ -13,9 +13,11 @@
 #include <util/strencodings.h>
 #include <util/threadnames.h>
 
+#include <chrono>
 #include <map>
 #include <set>
 #include <system_error>
+#include <tuple>
 
 #ifdef DEBUG_LOCKCONTENTION
 #if !defined(HAVE_THREAD_LOCAL)
@@ -28,6 +30,153 @@ void PrintLockContention(const char* pszName, const char* pszFile, int nLine)
 }
 #endif /* DEBUG_LOCKCONTENTION */
 
+std::atomic<bool> g_lock_stats_enabled{false};
+
+/**
+ * Statistics of one LOCK() or ENTER_CRITICAL_SECTION() site. The sites live
+ * in a fixed size open addressing table, so that recording never allocates
+ * or takes a lock, and the entries are never freed.
+ */
+struct LockSite {
+    enum { EMPTY, CLAIMED, READY };
+    std::atomic<int> state{EMPTY};
+    const char* name{nullptr};
+    const char* file{nullptr};
+    int line{0};
+
+    std::atomic<uint64_t> contentions{0};
+    std::atomic<uint64_t> wait_ns{0};
+    std::atomic<uint64_t> wait_histogram[LOCK_STATS_BUCKETS]{};
+    std::atomic<uint64_t> hold_samples{0};
+    std::atomic<uint64_t> hold_ns{0};
+    std::atomic<uint64_t> hold_histogram[LOCK_STATS_BUCKETS]{};
+};
+
+//! Comfortably more than the number of lock sites in the code
+static const size_t LOCK_SITES = 4096;
+static LockSite g_lock_sites[LOCK_SITES];
+//! Recorded when the table is full
+static LockSite g_lock_site_overflow;
+
+int64_t LockStatsTime()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+bool LockStatsSampleHold()
+{
+#if defined(HAVE_THREAD_LOCAL)
+    static thread_local unsigned int counter = 0;
+    return ++counter % LOCK_STATS_SAMPLE_INTERVAL == 0;
+#else
+    static std::atomic<unsigned int> counter{0};
+    return counter.fetch_add(1, std::memory_order_relaxed) % LOCK_STATS_SAMPLE_INTERVAL == 0;
+#endif
+}
+
+LockSite* GetLockSite(const char* pszName, const char* pszFile, int nLine)
+{
+    // The same site has the same file pointer, at least within a compilation unit
+    size_t pos = (reinterpret_cast<uintptr_t>(pszFile) * 31 + nLine) % LOCK_SITES;
+    for (size_t i = 0; i < LOCK_SITES; i++, pos = (pos + 1) % LOCK_SITES) {
+        LockSite& site = g_lock_sites[pos];
+        int state = site.state.load(std::memory_order_acquire);
+        if (state == LockSite::EMPTY && site.state.compare_exchange_strong(state, LockSite::CLAIMED, std::memory_order_acquire)) {
+            site.name = pszName;
+            site.file = pszFile;
+            site.line = nLine;
+            site.state.store(LockSite::READY, std::memory_order_release);
+            return &site;
+        }
+        // Another thread is filling in this entry
+        while (state == LockSite::CLAIMED) {
+            std::this_thread::yield();
+            state = site.state.load(std::memory_order_acquire);
+        }
+        if (site.file == pszFile && site.line == nLine) return &site;
+    }
+    return &g_lock_site_overflow;
+}
+
+static void AddToHistogram(std::atomic<uint64_t>* histogram, int64_t ns)
+{
+    unsigned int bucket = 0;
+    for (int64_t us = ns / 1000; us > 0 && bucket < LOCK_STATS_BUCKETS - 1; us >>= 1) bucket++;
+    histogram[bucket].fetch_add(1, std::memory_order_relaxed);
+}
+
+void RecordLockWait(const char* pszName, const char* pszFile, int nLine, int64_t wait_ns)
+{
+    LockSite* site = GetLockSite(pszName, pszFile, nLine);
+    site->contentions.fetch_add(1, std::memory_order_relaxed);
+    site->wait_ns.fetch_add(wait_ns, std::memory_order_relaxed);
+    AddToHistogram(site->wait_histogram, wait_ns);
+}
+
+void RecordLockHold(LockSite* site, int64_t hold_ns)
+{
+    site->hold_samples.fetch_add(1, std::memory_order_relaxed);
+    site->hold_ns.fetch_add(hold_ns, std::memory_order_relaxed);
+    AddToHistogram(site->hold_histogram, hold_ns);
+}
+
+static void AddLockSiteStats(std::map<std::tuple<std::string, std::string, int>, LockSiteStats>& result, LockSite& site, const std::string& name, const std::string& file, int line)
+{
+    const uint64_t contentions = site.contentions.load(std::memory_order_relaxed);
+    const uint64_t hold_samples = site.hold_samples.load(std::memory_order_relaxed);
+    if (contentions == 0 && hold_samples == 0) return;
+
+    auto inserted = result.emplace(std::make_tuple(name, file, line), LockSiteStats{});
+    LockSiteStats& stats = inserted.first->second;
+    if (inserted.second) {
+        stats.name = name;
+        stats.file = file;
+        stats.line = line;
+        stats.wait_histogram.resize(LOCK_STATS_BUCKETS);
+        stats.hold_histogram.resize(LOCK_STATS_BUCKETS);
+    }
+    stats.contentions += contentions;
+    stats.wait_us += site.wait_ns.load(std::memory_order_relaxed) / 1000;
+    stats.hold_samples += hold_samples;
+    stats.hold_us += site.hold_ns.load(std::memory_order_relaxed) / 1000;
+    for (unsigned int i = 0; i < LOCK_STATS_BUCKETS; i++) {
+        stats.wait_histogram[i] += site.wait_histogram[i].load(std::memory_order_relaxed);
+        stats.hold_histogram[i] += site.hold_histogram[i].load(std::memory_order_relaxed);
+    }
+}
+
+std::vector<LockSiteStats> GetLockStats()
+{
+    std::map<std::tuple<std::string, std::string, int>, LockSiteStats> result;
+    for (LockSite& site : g_lock_sites) {
+        if (site.state.load(std::memory_order_acquire) != LockSite::READY) continue;
+        AddLockSiteStats(result, site, site.name, site.file, site.line);
+    }
+    AddLockSiteStats(result, g_lock_site_overflow, "(other)", "", 0);
+
+    std::vector<LockSiteStats> stats;
+    for (auto& entry : result) stats.push_back(std::move(entry.second));
+    return stats;
+}
+
+static void ResetLockSite(LockSite& site)
+{
+    site.contentions.store(0, std::memory_order_relaxed);
+    site.wait_ns.store(0, std::memory_order_relaxed);
+    site.hold_samples.store(0, std::memory_order_relaxed);
+    site.hold_ns.store(0, std::memory_order_relaxed);
+    for (unsigned int i = 0; i < LOCK_STATS_BUCKETS; i++) {
+        site.wait_histogram[i].store(0, std::memory_order_relaxed);
+        site.hold_histogram[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+void ResetLockStats()
+{
+    for (LockSite& site : g_lock_sites) ResetLockSite(site);
+    ResetLockSite(g_lock_site_overflow);
+}
+
 #ifdef DEBUG_LOCKORDER
 //
 // Early deadlock detection.
@@ -9,10 +9,12 @@
 #include <threadsafety.h>
 #include <util/macros.h>
 
+#include <atomic>
 #include <condition_variable>
 #include <mutex>
 #include <string>
 #include <thread>
+#include <vector>
 
 ////////////////////////////////////////////////
 //                                            //
@@ -116,11 +118,90 @@ typedef AnnotatedMixin<std::mutex> Mutex;
 void PrintLockContention(const char* pszName, const char* pszFile, int nLine);
 #endif
 
+/**
+ * Lock contention statistics, collected per lock site while enabled with
+ * -lockstats or the getlockstats RPC. Every contended acquisition records
+ * how long it waited; one in LOCK_STATS_SAMPLE_INTERVAL acquisitions records
+ * how long the lock was then held. Disabled, the cost is one relaxed load.
+ */
+extern std::atomic<bool> g_lock_stats_enabled;
+
+static const bool DEFAULT_LOCK_STATS = false;
+static const unsigned int LOCK_STATS_SAMPLE_INTERVAL = 16;
+/** Histogram bucket 0 counts durations under 1us, bucket i those in [2^(i-1), 2^i) us */
+static const unsigned int LOCK_STATS_BUCKETS = 24;
+
+struct LockSite;
+
+struct LockSiteStats {
+    std::string name;
+    std::string file;
+    int line;
+    uint64_t contentions;
+    uint64_t wait_us;
+    std::vector<uint64_t> wait_histogram;
+    uint64_t hold_samples;
+    uint64_t hold_us;
+    std::vector<uint64_t> hold_histogram;
+};
+
+/** Monotonic time in nanoseconds */
+int64_t LockStatsTime();
+/** Whether to time how long this thread's next acquisition is held */
+bool LockStatsSampleHold();
+LockSite* GetLockSite(const char* pszName, const char* pszFile, int nLine);
+void RecordLockWait(const char* pszName, const char* pszFile, int nLine, int64_t wait_ns);
+void RecordLockHold(LockSite* site, int64_t hold_ns);
+/** Statistics of every lock site with data, the same sites in different compilation units merged */
+std::vector<LockSiteStats> GetLockStats();
+void ResetLockStats();
+
+/** Lock a mutex, timing the wait if the lock is contended and statistics are enabled */
+template <typename MutexType>
+void LockWithStats(MutexType& mutex, const char* pszName, const char* pszFile, int nLine)
+{
+    if (!g_lock_stats_enabled.load(std::memory_order_relaxed)) {
+        mutex.lock();
+        return;
+    }
+    if (mutex.try_lock()) return;
+    const int64_t start = LockStatsTime();
+    mutex.lock();
+    RecordLockWait(pszName, pszFile, nLine, LockStatsTime() - start);
+}
+
+/** LockWithStats() for ENTER_CRITICAL_SECTION, annotated for the thread safety analysis */
+template <typename MutexType>
+void LockCriticalSection(MutexType& cs, const char* pszName, const char* pszFile, int nLine) EXCLUSIVE_LOCK_FUNCTION(cs) NO_THREAD_SAFETY_ANALYSIS
+{
+    LockWithStats(cs, pszName, pszFile, nLine);
+}
+
 /** Wrapper around std::unique_lock style lock for Mutex. */
 template <typename Mutex, typename Base = typename Mutex::UniqueLock>
 class SCOPED_LOCKABLE UniqueLock : public Base
 {
 private:
+    //! Lock site whose hold time is being sampled, and when the lock was taken
+    LockSite* m_hold_site{nullptr};
+    int64_t m_hold_start{0};
+
+    void SampleHold(const char* pszName, const char* pszFile, int nLine)
+    {
+        if (g_lock_stats_enabled.load(std::memory_order_relaxed) && LockStatsSampleHold()) {
+            m_hold_site = GetLockSite(pszName, pszFile, nLine);
+            m_hold_start = LockStatsTime();
+        }
+    }
+
+    void EndHold()
+    {
+        if (m_hold_site) {
+            RecordLockHold(m_hold_site, LockStatsTime() - m_hold_start);
+            m_hold_site = nullptr;
+        }
+    }
+
     void Enter(const char* pszName, const char* pszFile, int nLine)
     {
         EnterCritical(pszName, pszFile, nLine, (void*)(Base::mutex()));
@@ -128,10 +209,11 @@ private:
         if (!Base::try_lock()) {
             PrintLockContention(pszName, pszFile, nLine);
 #endif
-            Base::lock();
+            LockWithStats(*static_cast<Base*>(this), pszName, pszFile, nLine);
 #ifdef DEBUG_LOCKCONTENTION
         }
 #endif
+        SampleHold(pszName, pszFile, nLine);
     }
 
     bool TryEnter(const char* pszName, const char* pszFile, int nLine)
@@ -140,6 +222,8 @@ private:
         Base::try_lock();
         if (!Base::owns_lock())
             LeaveCritical();
+        else
+            SampleHold(pszName, pszFile, nLine);
         return Base::owns_lock();
     }
 
@@ -165,8 +249,10 @@ public:
 
     ~UniqueLock() UNLOCK_FUNCTION()
     {
-        if (Base::owns_lock())
+        if (Base::owns_lock()) {
+            EndHold();
             LeaveCritical();
+        }
     }
 
     operator bool()
@@ -186,6 +272,7 @@ public:
     public:
         explicit reverse_lock(UniqueLock& _lock, const char* _guardname, const char* _file, int _line) : lock(_lock), file(_file), line(_line) {
             CheckLastCritical((void*)lock.mutex(), lockname, _guardname, _file, _line);
+            lock.EndHold();
             lock.unlock();
             LeaveCritical();
             lock.swap(templock);
@@ -225,7 +312,7 @@ using DebugLock = UniqueLock<typename std::remove_reference<typename std::remove
 #define ENTER_CRITICAL_SECTION(cs)                            \
     {                                                         \
         EnterCritical(#cs, __FILE__, __LINE__, (void*)(&cs)); \
-        (cs).lock();                                          \
+        LockCriticalSection(cs, #cs, __FILE__, __LINE__);     \
     }
 
 #define LEAVE_CRITICAL_SECTION(cs) \
@@ -0,0 +1,180 @@
+// Copyright (c) 2020 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <chainparams.h>
+#include <clientversion.h>
+#include <consensus/validation.h>
+#include <key.h>
+#include <script/interpreter.h>
+#include <streams.h>
+#include <test/util/setup_common.h>
+#include <undo.h>
+#include <util/lz4.h>
+#include <util/strencodings.h>
+#include <validation.h>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(blockcompression_tests, BasicTestingSetup)
+
+static void CheckRoundTrip(const std::vector<unsigned char>& data)
+{
+    std::vector<unsigned char> compressed;
+    LZ4Compress(data.data(), data.size(), compressed);
+    BOOST_CHECK(compressed.size() <= LZ4CompressBound(data.size()));
+
+    std::vector<unsigned char> decompressed(data.size());
+    BOOST_CHECK(LZ4Decompress(compressed.data(), compressed.size(), decompressed.data(), decompressed.size()));
+    BOOST_CHECK(decompressed == data);
+}
+
+BOOST_AUTO_TEST_CASE(lz4_roundtrip)
+{
+    for (size_t size : {0, 1, 12, 13, 100, 4096, 70000}) {
+        CheckRoundTrip(std::vector<unsigned char>(size, 0));
+        CheckRoundTrip(InsecureRandBytes(size));
+        std::vector<unsigned char> data = InsecureRandBytes(size);
+        for (size_t i = 0; i < size; i++) data[i] %= 4;
+        CheckRoundTrip(data);
+    }
+
+    // Matches that overlap their own output, and matches further back than the window
+    std::vector<unsigned char> data = InsecureRandBytes(100);
+    std::vector<unsigned char> repeat = InsecureRandBytes(1000);
+    data.insert(data.end(), 1000, 'x');
+    data.insert(data.end(), repeat.begin(), repeat.end());
+    std::vector<unsigned char> noise = InsecureRandBytes(70000);
+    data.insert(data.end(), noise.begin(), noise.end());
+    data.insert(data.end(), repeat.begin(), repeat.end());
+    CheckRoundTrip(data);
+}
+
+BOOST_AUTO_TEST_CASE(lz4_reference)
+{
+    // Compressed by the reference implementation
+    const std::string text = "Contract bytecode: 6060604052 6060604052 6060604052 6060604052 6060604052 000000000000000000000000";
+    const std::vector<unsigned char> compressed = ParseHex("f006436f6e74726163742062797465636f64653a20363002004f343035320b001a1e300100503030303030");
+    std::vector<unsigned char> decompressed(text.size());
+    BOOST_CHECK(LZ4Decompress(compressed.data(), compressed.size(), decompressed.data(), decompressed.size()));
+    BOOST_CHECK_EQUAL(std::string(decompressed.begin(), decompressed.end()), text);
+
+    // The size has to match exactly
+    decompressed.resize(text.size() + 1);
+    BOOST_CHECK(!LZ4Decompress(compressed.data(), compressed.size(), decompressed.data(), decompressed.size()));
+    decompressed.resize(text.size() - 1);
+    BOOST_CHECK(!LZ4Decompress(compressed.data(), compressed.size(), decompressed.data(), decompressed.size()));
+
+    // Truncated input, and a match before the start of the output
+    decompressed.resize(text.size());
+    BOOST_CHECK(!LZ4Decompress(compressed.data(), compressed.size() - 1, decompressed.data(), decompressed.size()));
+    const std::vector<unsigned char> bad_offset = ParseHex("1041ff0050414141414141");
+    BOOST_CHECK(!LZ4Decompress(bad_offset.data(), bad_offset.size(), decompressed.data(), decompressed.size()));
+}
+
+BOOST_AUTO_TEST_CASE(block_frame)
+{
+    std::vector<unsigned char> raw(10000, 0x60), frame, decompressed;
+    BOOST_CHECK(CompressBlockFrame(raw, frame));
+    BOOST_CHECK(frame.size() < raw.size() / 10);
+    BOOST_CHECK(DecompressBlockFrame(frame, decompressed));
+    BOOST_CHECK(decompressed == raw);
+
+    // Unknown codecs and truncated frames are rejected
+    std::vector<unsigned char> bad = frame;
+    bad[4] = 2;
+    BOOST_CHECK(!DecompressBlockFrame(bad, decompressed));
+    bad = frame;
+    bad.resize(frame.size() - 1);
+    BOOST_CHECK(!DecompressBlockFrame(bad, decompressed));
+    bad.resize(BLOCK_FRAME_HEADER_SIZE - 1);
+    BOOST_CHECK(!DecompressBlockFrame(bad, decompressed));
+
+    // Data that does not compress is stored raw
+    BOOST_CHECK(!CompressBlockFrame(InsecureRandBytes(10000), frame));
+    BOOST_CHECK(frame.empty());
+}
+
+//! Whether the block at pos is stored as a compressed frame
+static bool IsCompressed(const FlatFilePos& pos)
+{
+    FlatFilePos hpos = pos;
+    hpos.nPos -= 8;
+    CAutoFile file(OpenBlockFile(hpos, true), SER_DISK, CLIENT_VERSION);
+    CMessageHeader::MessageStartChars start;
+    unsigned int size;
+    file >> start >> size;
+    return size & BLOCK_FRAME_COMPRESSED;
+}
+
+BOOST_FIXTURE_TEST_CASE(compressed_block_storage, TestChain100Setup)
+{
+    // An output with a long, repetitive script, spent in the same block so it also ends up in the undo data
+    CScript script;
+    for (int i = 0; i < 4; i++) script << std::vector<unsigned char>(500, 0) << OP_DROP;
+    script << OP_TRUE;
+    const CScript coinbase_script = CScript() << ToByteVector(coinbaseKey.GetPubKey()) << OP_CHECKSIG;
+
+    CMutableTransaction create;
+    create.vin.resize(1);
+    create.vin[0].prevout = COutPoint(m_coinbase_txns[0]->GetHash(), 0);
+    create.vout.resize(1);
+    create.vout[0].nValue = m_coinbase_txns[0]->vout[0].nValue - 10 * CENT;
+    create.vout[0].scriptPubKey = script;
+    std::vector<unsigned char> sig;
+    BOOST_CHECK(coinbaseKey.Sign(SignatureHash(coinbase_script, create, 0, SIGHASH_ALL, 0, SigVersion::BASE), sig));
+    sig.push_back((unsigned char)SIGHASH_ALL);
+    create.vin[0].scriptSig << sig;
+
+    CMutableTransaction spend;
+    spend.vin.resize(1);
+    spend.vin[0].prevout = COutPoint(create.GetHash(), 0);
+    spend.vout.resize(1);
+    spend.vout[0].nValue = create.vout[0].nValue - 10 * CENT;
+    spend.vout[0].scriptPubKey = coinbase_script;
+
+    fBlockCompression = true;
+    const CBlock block = CreateAndProcessBlock({create, spend}, coinbase_script);
+    fBlockCompression = DEFAULT_BLOCK_COMPRESSION;
+
+    CBlockIndex* tip;
+    {
+        LOCK(cs_main);
+        tip = ::ChainActive().Tip();
+    }
+    BOOST_REQUIRE(tip->GetBlockHash() == block.GetHash());
+    BOOST_CHECK(IsCompressed(tip->GetBlockPos()));
+    BOOST_CHECK(!IsCompressed(tip->pprev->GetBlockPos()));
+
+    CBlock read;
+    BOOST_CHECK(ReadBlockFromDisk(read, tip, Params().GetConsensus()));
+    BOOST_CHECK(read.GetHash() == block.GetHash());
+    BOOST_CHECK_EQUAL(read.vtx.size(), 3U);
+    std::vector<uint8_t> raw;
+    BOOST_CHECK(ReadRawBlockFromDisk(raw, tip, Params().MessageStart()));
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    ss << block;
+    BOOST_CHECK(raw == std::vector<uint8_t>(ss.begin(), ss.end()));
+
+    // Legacy records are still read
+    BOOST_CHECK(ReadBlockFromDisk(read, tip->pprev, Params().GetConsensus()));
+
+    // A position that is not at a record is rejected on its magic, before any frame size is trusted
+    FlatFilePos misaligned = tip->GetBlockPos();
+    misaligned.nPos += 4;
+    BOOST_CHECK(!ReadBlockFromDisk(read, misaligned, Params().GetConsensus()));
+
+    // The undo data has the spent script, and is checked against its checksum
+    CBlockUndo undo;
+    BOOST_CHECK(UndoReadFromDisk(undo, tip));
+    BOOST_REQUIRE_EQUAL(undo.vtxundo.size(), 2U);
+    BOOST_CHECK(undo.vtxundo[1].vprevout[0].out.scriptPubKey == script);
+
+    // Disconnecting reads the undo data back
+    BlockValidationState state;
+    BOOST_CHECK(InvalidateBlock(state, Params(), tip));
+    LOCK(cs_main);
+    BOOST_CHECK(::ChainActive().Tip() == tip->pprev);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,74 @@
+// Copyright (c) 2020 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <chainparams.h>
+#include <clientversion.h>
+#include <streams.h>
+#include <test/util/setup_common.h>
+#include <validation.h>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_AUTO_TEST_SUITE(blockimport_tests)
+
+//! Blocks 1 to 100 of a TestChain100Setup chain, with every pair swapped
+static std::vector<CBlock> OutOfOrderBlocks()
+{
+    TestChain100Setup setup;
+    std::vector<CBlock> blocks;
+    LOCK(cs_main);
+    for (int height = 1; height <= ::ChainActive().Height(); height++) {
+        CBlock block;
+        BOOST_REQUIRE(ReadBlockFromDisk(block, ::ChainActive()[height], Params().GetConsensus()));
+        blocks.push_back(block);
+    }
+    for (size_t i = 0; i + 1 < blocks.size(); i += 2) {
+        std::swap(blocks[i], blocks[i + 1]);
+    }
+    return blocks;
+}
+
+//! Write the blocks to three external files, as -loadblock would find them
+static std::vector<ExternalBlockFile> WriteBlocks(const std::vector<CBlock>& blocks)
+{
+    std::vector<ExternalBlockFile> files;
+    const size_t per_file = (blocks.size() + 2) / 3;
+    for (size_t i = 0; i < blocks.size(); i += per_file) {
+        const fs::path path = GetDataDir() / strprintf("import%u.dat", files.size());
+        CAutoFile file(fsbridge::fopen(path, "wb"), SER_DISK, CLIENT_VERSION);
+        for (size_t j = i; j < std::min(blocks.size(), i + per_file); j++) {
+            // Zeroed space between blocks, as left by preallocation
+            file << uint32_t{0};
+            unsigned int size = GetSerializeSize(blocks[j], file.GetVersion());
+            file << Params().MessageStart() << size << blocks[j];
+        }
+        files.push_back({path, FlatFilePos()});
+    }
+    return files;
+}
+
+BOOST_AUTO_TEST_CASE(import_out_of_order)
+{
+    const std::vector<CBlock> blocks = OutOfOrderBlocks();
+    BOOST_REQUIRE_EQUAL(blocks.size(), 100U);
+
+    RegTestingSetup setup;
+    BOOST_CHECK(LoadExternalBlockFiles(Params(), WriteBlocks(blocks), DEFAULT_IMPORT_BUFFER << 20));
+    LOCK(cs_main);
+    BOOST_CHECK_EQUAL(::ChainActive().Height(), 100);
+    BOOST_CHECK(::ChainActive().Tip()->GetBlockHash() == blocks[98].GetHash());
+}
+
+BOOST_AUTO_TEST_CASE(import_no_buffer)
+{
+    const std::vector<CBlock> blocks = OutOfOrderBlocks();
+
+    // Without room to park them, out of order blocks from external files are dropped
+    RegTestingSetup setup;
+    BOOST_CHECK(LoadExternalBlockFiles(Params(), WriteBlocks(blocks), 0));
+    LOCK(cs_main);
+    BOOST_CHECK_EQUAL(::ChainActive().Height(), 1);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -358,6 +358,39 @@ static void test_cache_generations()
     // max_rate_less_than_tight_hit_rate of the time
     BOOST_CHECK(double(out_of_tight_tolerance) / double(total) < max_rate_less_than_tight_hit_rate);
 }
+/* Test that get_elements returns the live elements and that inserting them
+ * into a fresh cache restores it, as done when persisting the caches.
+ */
+BOOST_AUTO_TEST_CASE(cuckoocache_get_elements)
+{
+    SeedInsecureRand(SeedRand::ZEROS);
+    CuckooCache::cache<uint256, SignatureCacheHasher> cc{};
+    cc.setup(1 << 12);
+    std::vector<uint256> hashes;
+    for (int x = 0; x < 1000; ++x) {
+        hashes.push_back(InsecureRand256());
+        cc.insert(hashes.back());
+    }
+    // Erased elements are not returned
+    for (int x = 0; x < 100; ++x) {
+        cc.contains(hashes[x], true);
+    }
+
+    std::vector<uint256> elements;
+    cc.get_elements(elements);
+    BOOST_CHECK_EQUAL(elements.size(), 900U);
+
+    CuckooCache::cache<uint256, SignatureCacheHasher> restored{};
+    restored.setup(1 << 12);
+    for (auto it = elements.rbegin(); it != elements.rend(); ++it) {
+        restored.insert(*it);
+    }
+    for (int x = 100; x < 1000; ++x) {
+        BOOST_CHECK(restored.contains(hashes[x], false));
+    }
+    BOOST_CHECK(!restored.contains(hashes[0], false));
+}
+
 BOOST_AUTO_TEST_CASE(cuckoocache_generations)
 {
     test_cache_generations<CuckooCache::cache<uint256, SignatureCacheHasher>>();
@@ -3,10 +3,19 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include <logging.h>
+#include <logging/ringbuffer.h>
 #include <logging/timer.h>
 #include <test/util/setup_common.h>
+#include <util/system.h>
+#include <util/threadnames.h>
 
+#include <atomic>
 #include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
 
 #include <boost/test/unit_test.hpp>
 
@@ -33,4 +42,153 @@ BOOST_AUTO_TEST_CASE(logging_timer)
     SetMockTime(0);
 }
 
+BOOST_AUTO_TEST_CASE(logging_ringbuffer)
+{
+    BCLog::RingBuffer<std::string> queue(3);
+    BOOST_CHECK_EQUAL(queue.Capacity(), 4U);
+    BOOST_CHECK(queue.Empty());
+
+    std::string msg;
+    BOOST_CHECK(!queue.Pop(msg));
+    for (int i = 0; i < 4; ++i) {
+        msg = strprintf("msg%d", i);
+        BOOST_CHECK(queue.Push(msg));
+    }
+    msg = "full";
+    BOOST_CHECK(!queue.Push(msg));
+    BOOST_CHECK_EQUAL(msg, "full");
+
+    for (int i = 0; i < 4; ++i) {
+        BOOST_CHECK(queue.Pop(msg));
+        BOOST_CHECK_EQUAL(msg, strprintf("msg%d", i));
+    }
+    BOOST_CHECK(queue.Empty());
+}
+
+BOOST_AUTO_TEST_CASE(logging_ringbuffer_multi_producer)
+{
+    constexpr int PRODUCERS = 4;
+    constexpr int PER_PRODUCER = 10000;
+    BCLog::RingBuffer<int> queue(64);
+
+    std::vector<std::thread> producers;
+    for (int p = 0; p < PRODUCERS; ++p) {
+        producers.emplace_back([&queue, p] {
+            for (int i = 0; i < PER_PRODUCER; ++i) {
+                int value = p * PER_PRODUCER + i;
+                while (!queue.Push(value)) std::this_thread::yield();
+            }
+        });
+    }
+
+    // Every value arrives exactly once, and each producer's values in order
+    std::vector<int> last(PRODUCERS, -1);
+    int received = 0;
+    while (received < PRODUCERS * PER_PRODUCER) {
+        int value;
+        if (!queue.Pop(value)) {
+            std::this_thread::yield();
+            continue;
+        }
+        const int p = value / PER_PRODUCER;
+        BOOST_REQUIRE(value % PER_PRODUCER == last[p] + 1);
+        last[p] = value % PER_PRODUCER;
+        ++received;
+    }
+    for (auto& producer : producers) producer.join();
+    BOOST_CHECK(queue.Empty());
+}
+
+BOOST_AUTO_TEST_CASE(logging_async_stop)
+{
+    constexpr int PRODUCERS = 4;
+    constexpr int PER_PRODUCER = 20000;
+
+    BCLog::Logger logger;
+    logger.m_print_to_file = true;
+    logger.m_file_path = GetDataDir() / "async_stop.log";
+    logger.m_file_pathVM = GetDataDir() / "async_stop_vm.log";
+    logger.m_log_timestamps = false;
+    logger.m_log_threadnames = false;
+    logger.m_async = true;
+    logger.m_async_buffer = PRODUCERS * PER_PRODUCER;
+    BOOST_REQUIRE(logger.StartLogging());
+
+    // Stop while the producers are logging; messages logged around the stop
+    // go to the queue or to the file directly, but none are lost
+    std::atomic<int> logged{0};
+    std::vector<std::thread> producers;
+    for (int p = 0; p < PRODUCERS; ++p) {
+        producers.emplace_back([&logger, &logged] {
+            for (int i = 0; i < PER_PRODUCER; ++i) {
+                logger.LogPrintStr("async stop test\n");
+                ++logged;
+            }
+        });
+    }
+    while (logged < PRODUCERS * PER_PRODUCER / 2) std::this_thread::yield();
+    logger.StopAsyncLogging();
+    for (auto& producer : producers) producer.join();
+    BOOST_CHECK_EQUAL(logger.GetDroppedMessages(), 0U);
+    logger.DisconnectTestLogger();
+
+    fsbridge::ifstream file(logger.m_file_path);
+    std::string line;
+    int lines = 0;
+    while (std::getline(file, line)) {
+        if (line == "async stop test") ++lines;
+    }
+    BOOST_CHECK_EQUAL(lines, PRODUCERS * PER_PRODUCER);
+}
+
+
+BOOST_AUTO_TEST_CASE(logging_async_prefixes)
+{
+    constexpr int PRODUCERS = 4;
+    constexpr int PER_PRODUCER = 5000;
+
+    BCLog::Logger logger;
+    logger.m_print_to_file = true;
+    logger.m_file_path = GetDataDir() / "async_prefixes.log";
+    logger.m_file_pathVM = GetDataDir() / "async_prefixes_vm.log";
+    logger.m_log_timestamps = true;
+    logger.m_log_threadnames = true;
+    logger.m_async = true;
+    logger.m_async_buffer = 2 * PRODUCERS * PER_PRODUCER;
+    BOOST_REQUIRE(logger.StartLogging());
+
+    // The formatted messages, with the name of the thread that logged them
+    std::mutex mutex;
+    std::vector<std::pair<std::string, std::string>> msgs;
+    logger.PushBackCallback([&](const std::string& msg) {
+        std::lock_guard<std::mutex> lock(mutex);
+        msgs.emplace_back(util::ThreadGetInternalName(), msg);
+    });
+
+    // Every thread logs lines in two parts: only the first part of each line
+    // gets the timestamp and thread name, whatever the other threads log
+    std::vector<std::thread> producers;
+    for (int p = 0; p < PRODUCERS; ++p) {
+        producers.emplace_back([&logger, p] {
+            util::ThreadSetInternalName(strprintf("logtest.%d", p));
+            for (int i = 0; i < PER_PRODUCER; ++i) {
+                logger.LogPrintStr(strprintf("line %d ", i));
+                logger.LogPrintStr("end\n");
+            }
+        });
+    }
+    for (auto& producer : producers) producer.join();
+    logger.StopAsyncLogging();
+    logger.DisconnectTestLogger();
+
+    BOOST_REQUIRE_EQUAL(msgs.size(), size_t{2 * PRODUCERS * PER_PRODUCER});
+    for (const auto& msg : msgs) {
+        if (msg.second == "end\n") continue;
+        // "<timestamp> [<thread name>] line <i> "
+        const std::string prefix = " [" + msg.first + "] line ";
+        const size_t pos = msg.second.find(prefix);
+        BOOST_REQUIRE_MESSAGE(pos != std::string::npos && pos > 0 && msg.second[pos - 1] == 'Z', msg.second);
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
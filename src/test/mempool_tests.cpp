@@ -788,4 +788,84 @@ BOOST_AUTO_TEST_CASE(MempoolAncestryTests)
     BOOST_CHECK_EQUAL(descendants, 4ULL);
 }
 
+BOOST_AUTO_TEST_CASE(MempoolSequenceTest)
+{
+    CTxMemPool pool;
+    LOCK2(cs_main, pool.cs);
+    TestMemPoolEntryHelper entry;
+    std::vector<MempoolChange> changes;
+
+    BOOST_CHECK_EQUAL(pool.GetSequence(), 0U);
+    BOOST_CHECK(pool.GetChangesSince(0, changes));
+    BOOST_CHECK(changes.empty());
+
+    // A parent signalling BIP125, and a child that inherits it
+    CMutableTransaction mtx1;
+    mtx1.vin.resize(1);
+    mtx1.vin[0].nSequence = 0;
+    mtx1.vout.resize(1);
+    mtx1.vout[0].scriptPubKey = CScript() << OP_11 << OP_EQUAL;
+    mtx1.vout[0].nValue = 10 * COIN;
+    CTransactionRef tx1 = MakeTransactionRef(mtx1);
+    CTransactionRef tx2 = make_tx(/* output_values */ {5 * COIN}, /* inputs */ {tx1});
+    CTransactionRef tx3 = make_tx(/* output_values */ {3 * COIN});
+    pool.addUnchecked(entry.Fee(10000LL).FromTx(tx1));
+    pool.addUnchecked(entry.Fee(20000LL).FromTx(tx2));
+    BOOST_CHECK_EQUAL(pool.GetSequence(), 2U);
+
+    std::shared_ptr<const MempoolSnapshot> snapshot = pool.GetSnapshot();
+    BOOST_CHECK_EQUAL(snapshot->sequence, 2U);
+    BOOST_REQUIRE_EQUAL(snapshot->entries.size(), 2U);
+    for (const MempoolEntryInfo& info : snapshot->entries) {
+        BOOST_CHECK(info.bip125_replaceable);
+        if (info.tx->GetHash() == tx2->GetHash()) {
+            BOOST_CHECK_EQUAL(info.fee, 20000LL);
+            BOOST_CHECK_EQUAL(info.count_with_ancestors, 2U);
+            BOOST_CHECK(info.depends == std::vector<uint256>{tx1->GetHash()});
+            BOOST_CHECK(info.spent_by.empty());
+        } else {
+            BOOST_CHECK(info.spent_by == std::vector<uint256>{tx2->GetHash()});
+        }
+    }
+    // The snapshot is shared until the mempool changes
+    BOOST_CHECK(pool.GetSnapshot() == snapshot);
+    pool.PrioritiseTransaction(tx2->GetHash(), 1000LL);
+    std::shared_ptr<const MempoolSnapshot> prioritised = pool.GetSnapshot();
+    BOOST_CHECK(prioritised != snapshot);
+    BOOST_CHECK_EQUAL(prioritised->sequence, 2U);
+    BOOST_CHECK_EQUAL(snapshot->entries.size(), 2U);
+
+    pool.addUnchecked(entry.Fee(10000LL).FromTx(tx3));
+    pool.removeRecursive(*tx1, REMOVAL_REASON_DUMMY);
+    BOOST_CHECK_EQUAL(pool.GetSequence(), 5U);
+    BOOST_CHECK(pool.GetSnapshot() != prioritised);
+    BOOST_CHECK_EQUAL(pool.GetSnapshot()->entries.size(), 1U);
+
+    BOOST_CHECK(pool.GetChangesSince(2, changes));
+    BOOST_REQUIRE_EQUAL(changes.size(), 3U);
+    BOOST_CHECK_EQUAL(changes[0].sequence, 3U);
+    BOOST_CHECK(changes[0].txid == tx3->GetHash());
+    BOOST_CHECK(changes[0].added);
+    for (size_t i = 1; i < changes.size(); ++i) {
+        BOOST_CHECK_EQUAL(changes[i].sequence, 3U + i);
+        BOOST_CHECK(!changes[i].added);
+    }
+    BOOST_CHECK(pool.GetChangesSince(5, changes));
+    BOOST_CHECK(changes.empty());
+    BOOST_CHECK(!pool.GetChangesSince(6, changes));
+
+    // Changes that dropped out of the log can't be followed any more
+    pool.SetChangeLogSize(2);
+    BOOST_CHECK(pool.GetChangesSince(3, changes));
+    BOOST_CHECK_EQUAL(changes.size(), 2U);
+    BOOST_CHECK(!pool.GetChangesSince(2, changes));
+
+    // and neither can a cleared mempool
+    pool.clear();
+    BOOST_CHECK_EQUAL(pool.GetSequence(), 6U);
+    BOOST_CHECK(!pool.GetChangesSince(5, changes));
+    BOOST_CHECK(pool.GetChangesSince(6, changes));
+    BOOST_CHECK(pool.GetSnapshot()->entries.empty());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
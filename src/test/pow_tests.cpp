@@ -4,6 +4,7 @@
 
 #include <chain.h>
 #include <chainparams.h>
+#include <crypto/rx2.h>
 #include <pow.h>
 #include <test/util/setup_common.h>
 
@@ -135,4 +136,155 @@ BOOST_AUTO_TEST_CASE(GetBlockProofEquivalentTime_test)
     }
 }
 
+namespace {
+// Retargeting as implemented before the same-proof links: every window is found by walking pprev.
+std::map<int, int> ReferenceContextLWMA(const CBlockIndex* pindex, int nContextScope, bool fProofOfStake)
+{
+    std::map<int, int> mapRet;
+    int nIdx = 0;
+    while (pindex && pindex->pprev && nIdx <= nContextScope) {
+        if (pindex->IsProofOfStake() == fProofOfStake) {
+            nIdx++;
+            mapRet.insert(std::pair<int, int>(nIdx, pindex->nHeight));
+        }
+        pindex = pindex->pprev;
+    }
+    return mapRet;
+}
+
+const CBlockIndex* ReferenceLastBlockIndex(const CBlockIndex* pindex, bool fProofOfStake)
+{
+    while (pindex && pindex->pprev && (pindex->IsProofOfStake() != fProofOfStake))
+        pindex = pindex->pprev;
+    return pindex;
+}
+
+unsigned int ReferenceLwma(const CBlockIndex* pindexLast, const Consensus::Params& params, bool fProofOfStake)
+{
+    const int64_t T = params.nPowTargetSpacing;
+    const int64_t N = params.lwmaAveragingWindow;
+    const int64_t k = N * (N + 1) * T / 2;
+    const arith_uint256 ProofLimit = UintToArith256(fProofOfStake ? params.posLimit : params.powLimit);
+    if (pindexLast->nHeight < N + 1) return ProofLimit.GetCompact();
+
+    std::map<int, int> mapContext = ReferenceContextLWMA(pindexLast, N + 1, fProofOfStake);
+    if (fProofOfStake && mapContext.size() < (size_t)(N + 1)) {
+        const CBlockIndex* pindexPrev = ReferenceLastBlockIndex(pindexLast, fProofOfStake);
+        if (pindexPrev->pprev == nullptr) return ProofLimit.GetCompact();
+        const CBlockIndex* pindexPrevPrev = ReferenceLastBlockIndex(pindexPrev->pprev, fProofOfStake);
+        if (pindexPrevPrev->pprev == nullptr) return ProofLimit.GetCompact();
+        int64_t nActualSpacing = pindexPrev->GetBlockTime() - pindexPrevPrev->GetBlockTime();
+        if (nActualSpacing < 0) nActualSpacing = 1;
+        if (nActualSpacing > T * 10) nActualSpacing = T * 10;
+        arith_uint256 bnNew;
+        bnNew.SetCompact(pindexLast->nBits);
+        int64_t nInterval = params.nPowTargetSpacing / T;
+        bnNew *= ((nInterval - 1) * T + nActualSpacing + nActualSpacing);
+        bnNew /= ((nInterval + 1) * T);
+        if (bnNew <= 0 || bnNew > ProofLimit) bnNew = ProofLimit;
+        return bnNew.GetCompact();
+    }
+
+    arith_uint256 avgTarget, nextTarget;
+    int64_t previousTimestamp = pindexLast->GetAncestor(mapContext.at(N + 1))->GetBlockTime();
+    int64_t sumWeightedSolvetimes = 0, j = 0;
+    for (int64_t i = N; i > 0; i--) {
+        const CBlockIndex* block = pindexLast->GetAncestor(mapContext.at(i));
+        int64_t thisTimestamp = (block->GetBlockTime() > previousTimestamp) ? block->GetBlockTime() : previousTimestamp + 1;
+        int64_t solvetime = std::min(6 * T, thisTimestamp - previousTimestamp);
+        previousTimestamp = thisTimestamp;
+        j++;
+        sumWeightedSolvetimes += solvetime * j;
+        arith_uint256 target;
+        target.SetCompact(block->nBits);
+        avgTarget += target / N / k;
+    }
+    nextTarget = avgTarget * sumWeightedSolvetimes;
+    if (nextTarget > ProofLimit) nextTarget = ProofLimit;
+    return nextTarget.GetCompact();
+}
+
+unsigned int ReferenceNextWorkRequired(const CBlockIndex* pindexLast, const Consensus::Params& params, bool fProofOfStake, unsigned int nTargetLimit)
+{
+    const CBlockIndex* pindexPrev = ReferenceLastBlockIndex(pindexLast, fProofOfStake);
+    if (pindexPrev->pprev == nullptr) return nTargetLimit;
+    const CBlockIndex* pindexPrevPrev = ReferenceLastBlockIndex(pindexPrev->pprev, fProofOfStake);
+    if (pindexPrevPrev->pprev == nullptr) return nTargetLimit;
+    return ReferenceLwma(pindexPrev, params, fProofOfStake);
+}
+} // namespace
+
+/* Retargeting through the same-proof links must match a plain walk over every block */
+BOOST_AUTO_TEST_CASE(hybrid_lwma_matches_reference)
+{
+    const auto chainParams = CreateChainParams(CBaseChainParams::MAIN);
+    const Consensus::Params& params = chainParams->GetConsensus();
+    const int nBlocks = 1200;
+    // A PoW phase long enough to fill the PoW window, then a stretch where PoS takes over
+    // and PoW blocks become rare, so both the EMA activation rule and long PoW gaps are hit.
+    const int nPoSStart = 150;
+    std::vector<CBlockIndex> blocks(nBlocks);
+    std::vector<uint256> hashes(nBlocks);
+    const arith_uint256 powLimit = UintToArith256(params.powLimit);
+    const arith_uint256 posLimit = UintToArith256(params.posLimit);
+    int64_t nTime = 1269211443;
+    for (int i = 0; i < nBlocks; i++) {
+        hashes[i] = InsecureRand256();
+        blocks[i].phashBlock = &hashes[i];
+        blocks[i].pprev = i ? &blocks[i - 1] : nullptr;
+        blocks[i].nHeight = i;
+        const bool fProofOfStake = i >= nPoSStart && InsecureRandRange(i < 700 ? 4 : 50) != 0;
+        if (fProofOfStake) {
+            blocks[i].prevoutStake = COutPoint(InsecureRand256(), 0);
+        }
+        // Solvetimes around the target, sometimes going backwards or far over the 6*T clamp
+        nTime += (int64_t)InsecureRandRange(20 * params.nPowTargetSpacing) - 2 * params.nPowTargetSpacing;
+        blocks[i].nTime = nTime;
+        arith_uint256 target = fProofOfStake ? posLimit : powLimit;
+        target >>= InsecureRandRange(16);
+        blocks[i].nBits = target.GetCompact();
+        blocks[i].BuildSkip();
+    }
+
+    // Each LWMA evaluation does a few hundred 256-bit divisions, so only sample the chain
+    CBlockHeader header;
+    for (int i = 0; i < nBlocks; i += 1 + InsecureRandRange(8)) {
+        const CBlockIndex* pindex = &blocks[i];
+        for (const bool fProofOfStake : {false, true}) {
+            BOOST_CHECK_EQUAL(GetLastBlockIndex(pindex, fProofOfStake), ReferenceLastBlockIndex(pindex, fProofOfStake));
+            const unsigned int nTargetLimit = GetNextWorkRequired(nullptr, &header, params, fProofOfStake);
+            BOOST_CHECK_EQUAL(GetNextWorkRequired(pindex, &header, params, fProofOfStake),
+                              ReferenceNextWorkRequired(pindex, params, fProofOfStake, nTargetLimit));
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(randomx_hash_cache)
+{
+    CBlockHeader header;
+    header.nVersion = 4;
+    header.hashPrevBlock = InsecureRand256();
+    header.hashMerkleRoot = InsecureRand256();
+    header.nBits = 0x207fffff;
+    uint256 seed = InsecureRand256();
+    uint256 other_seed = InsecureRand256();
+
+    const RandomXHashCacheStats before = GetRandomXHashCacheStats();
+    const uint256 hash = header.GetHash(&seed);
+    BOOST_CHECK(header.GetHash(&seed) == hash);
+    BOOST_CHECK(header.GetHash(&seed, true) == hash);
+
+    // The seed and every hashed byte are part of the key
+    BOOST_CHECK(header.GetHash(&other_seed) != hash);
+    header.nNonce++;
+    BOOST_CHECK(header.GetHash(&seed) != hash);
+    header.nNonce--;
+    BOOST_CHECK(header.GetHash(&seed) == hash);
+
+    const RandomXHashCacheStats after = GetRandomXHashCacheStats();
+    BOOST_CHECK_EQUAL(after.hits - before.hits, 2U);
+    BOOST_CHECK_EQUAL(after.misses - before.misses, 3U);
+    BOOST_CHECK(after.entries <= RANDOMX_HASH_CACHE_ENTRIES);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -1,6 +1,7 @@
 #include <boost/test/unit_test.hpp>
 #include <test/util/setup_common.h>
 #include <qtumtests/test_utils.h>
+#include <limits>
 
 const dev::u256 GASLIMIT = dev::u256(500000);
 const dev::Address SENDERADDRESS = dev::Address("0101010101010101010101010101010101010101");
@@ -135,6 +136,51 @@ BOOST_AUTO_TEST_CASE(bytecodeexec_create_contract){
     checkBCEResult(result.second, 69382, 430618, 1, CAmount(GASLIMIT));
 }
 
+BOOST_AUTO_TEST_CASE(bytecodeexec_storage_range){
+    initState();
+    // Constructor storing k + 1 in slots 0 to 4, deploying a single STOP
+    valtype code = ParseHex("600160005560026001556003600255600460035560056004556000600053600160006000f3");
+    QtumTransaction txEth = createQtumTransaction(code, 0, GASLIMIT, dev::u256(1), HASHTX, dev::Address());
+    std::vector<QtumTransaction> txs(1, txEth);
+    auto result = executeBC(txs);
+    BOOST_REQUIRE(result.first[0].execRes.excepted == dev::eth::TransactionException::None);
+
+    dev::Address addr = createQtumAddress(txs[0].getHashWith(), txs[0].getNVout());
+    std::map<dev::h256, std::pair<dev::u256, dev::u256>> expected = globalState->storage(addr);
+    BOOST_REQUIRE_EQUAL(expected.size(), 5U);
+
+    // Pages of two cover the storage once, in hashed key order
+    const dev::h256 root = globalState->rootHash();
+    std::vector<StorageEntry> all, entries;
+    dev::h256 begin, next;
+    size_t pages = 0;
+    do {
+        BOOST_REQUIRE(globalState->storageRange(root, addr, begin, 2, entries, next));
+        BOOST_CHECK(entries.size() <= 2);
+        all.insert(all.end(), entries.begin(), entries.end());
+        begin = next;
+        pages++;
+    } while (next != dev::h256() && pages < 10);
+    BOOST_CHECK_EQUAL(pages, 3U);
+    BOOST_REQUIRE_EQUAL(all.size(), expected.size());
+    size_t i = 0;
+    for (const auto& slot : expected) {
+        BOOST_CHECK(all[i].hashedKey == slot.first);
+        BOOST_CHECK(all[i].key == slot.second.first);
+        BOOST_CHECK(all[i].value == slot.second.second);
+        BOOST_CHECK(all[i].value == all[i].key + 1);
+        i++;
+    }
+
+    // A cursor starts at its slot, and no limit reads the whole storage
+    BOOST_REQUIRE(globalState->storageRange(root, addr, all[3].hashedKey, std::numeric_limits<size_t>::max(), entries, next));
+    BOOST_REQUIRE_EQUAL(entries.size(), 2U);
+    BOOST_CHECK(entries[0].hashedKey == all[3].hashedKey);
+    BOOST_CHECK(next == dev::h256());
+
+    BOOST_CHECK(!globalState->storageRange(root, dev::Address("0202020202020202020202020202020202020202"), dev::h256(), 2, entries, next));
+}
+
 BOOST_AUTO_TEST_CASE(bytecodeexec_create_contract_OutOfGasIntrinsic){
     initState();
     QtumTransaction txEth = createQtumTransaction(CODE[0], 0, dev::u256(100), dev::u256(1), HASHTX, dev::Address());
@@ -0,0 +1,88 @@
+#include <boost/test/unit_test.hpp>
+#include <test/util/setup_common.h>
+#include <qtum/contractprofile.h>
+
+namespace ContractProfileTest{
+
+const dev::Address contractA("abababababababababababababababababababab");
+const dev::Address contractB("cdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcd");
+
+BOOST_FIXTURE_TEST_SUITE(contractprofile_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(contractprofile_sampling){
+    ContractProfiler profiler;
+    BOOST_CHECK(!profiler.ShouldSample());
+    profiler.SetSampleRate(4);
+    int sampled = 0;
+    for(int i = 0; i < 100; i++){
+        if(profiler.ShouldSample()) sampled++;
+    }
+    BOOST_CHECK_EQUAL(sampled, 25);
+}
+
+BOOST_AUTO_TEST_CASE(contractprofile_top){
+    ContractProfiler profiler;
+    const uint32_t transfer = 0xa9059cbb;
+    profiler.Add(contractA, &transfer, false, 50000, 100);
+    profiler.Add(contractA, &transfer, true, 30000, 50);
+    profiler.Add(contractB, nullptr, false, 10000, 400);
+
+    // contractB is only reached through an inner call, but does the storage writes
+    std::map<dev::Address, ContractOpCounters> ops;
+    ops[contractA].sloads = 3;
+    ops[contractB].sstores = 2;
+    ops[contractB].max_depth = 1;
+    profiler.AddOps(ops);
+
+    std::vector<ContractProfile> top = profiler.GetTop(1, ContractProfiler::SortBy::GAS);
+    BOOST_CHECK_EQUAL(top.size(), 1U);
+    BOOST_CHECK(top[0].address == contractA);
+    BOOST_CHECK_EQUAL(top[0].exec.calls, 2);
+    BOOST_CHECK_EQUAL(top[0].exec.errors, 1);
+    BOOST_CHECK_EQUAL(top[0].exec.gas_used, 80000);
+    BOOST_CHECK_EQUAL(top[0].selectors[transfer].calls, 2);
+    BOOST_CHECK_EQUAL(top[0].ops.sloads, 3);
+
+    top = profiler.GetTop(10, ContractProfiler::SortBy::TIME);
+    BOOST_CHECK_EQUAL(top.size(), 2U);
+    BOOST_CHECK(top[0].address == contractB);
+    BOOST_CHECK_EQUAL(top[0].ops.sstores, 2);
+    BOOST_CHECK_EQUAL(top[0].ops.max_depth, 1);
+
+    uint64_t executions;
+    int64_t since;
+    profiler.GetTotals(executions, since);
+    BOOST_CHECK_EQUAL(executions, 3);
+
+    profiler.Reset();
+    BOOST_CHECK(profiler.GetTop(10, ContractProfiler::SortBy::GAS).empty());
+    profiler.GetTotals(executions, since);
+    BOOST_CHECK_EQUAL(executions, 0);
+}
+
+BOOST_AUTO_TEST_CASE(contractprofile_eviction){
+    ContractProfiler profiler(2);
+    const dev::Address contractC("efefefefefefefefefefefefefefefefefefefef");
+    profiler.Add(contractA, nullptr, false, 50000, 100);
+    profiler.Add(contractB, nullptr, false, 10000, 100);
+
+    // A new contract takes the place of the one with the least gas
+    profiler.Add(contractC, nullptr, false, 20000, 100);
+    std::vector<ContractProfile> top = profiler.GetTop(10, ContractProfiler::SortBy::GAS);
+    BOOST_CHECK_EQUAL(top.size(), 2U);
+    BOOST_CHECK(top[0].address == contractA);
+    BOOST_CHECK(top[1].address == contractC);
+
+    // Known contracts are updated in place
+    std::map<dev::Address, ContractOpCounters> ops;
+    ops[contractA].sloads = 1;
+    profiler.AddOps(ops);
+    top = profiler.GetTop(10, ContractProfiler::SortBy::SLOADS);
+    BOOST_CHECK_EQUAL(top.size(), 2U);
+    BOOST_CHECK(top[0].address == contractA);
+    BOOST_CHECK_EQUAL(top[0].ops.sloads, 1);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+}
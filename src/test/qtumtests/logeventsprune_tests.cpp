@@ -0,0 +1,89 @@
+#include <boost/test/unit_test.hpp>
+#include <test/util/setup_common.h>
+#include <arith_uint256.h>
+#include <qtum/storageresults.h>
+#include <txdb.h>
+#include <util/convert.h>
+#include <validation.h>
+
+namespace LogEventsPruneTest{
+
+const dev::Address contract("abababababababababababababababababababab");
+
+uint256 txHash(unsigned int height){
+    return ArithToUint256(arith_uint256(height + 1));
+}
+
+void addBlock(unsigned int height){
+    TransactionReceiptInfo tri{};
+    tri.blockNumber = height;
+    tri.transactionHash = txHash(height);
+    tri.contractAddress = contract;
+    std::vector<TransactionReceiptInfo> result{tri};
+    pstorageresult->addResult(uintToh256(txHash(height)), result);
+    pblocktree->WriteHeightIndex(CHeightTxIndexKey(height, contract), std::vector<uint256>{txHash(height)});
+}
+
+//! Puts back the -logevents settings the tests change
+struct LogEventsPruneSetup : public TestingSetup {
+    const bool fLogEventsOld{fLogEvents};
+    const int nLogEventsRetainOld{nLogEventsRetain};
+    const int nLogEventsRetainHeightOld{nLogEventsRetainHeight};
+
+    ~LogEventsPruneSetup(){
+        fLogEvents = fLogEventsOld;
+        nLogEventsRetain = nLogEventsRetainOld;
+        nLogEventsRetainHeight = nLogEventsRetainHeightOld;
+    }
+};
+
+BOOST_FIXTURE_TEST_SUITE(logeventsprune_tests, LogEventsPruneSetup)
+
+BOOST_AUTO_TEST_CASE(logeventsprune_range){
+    for(unsigned int height = 0; height < 10; height++){
+        addBlock(height);
+    }
+    pstorageresult->commitResults();
+    BOOST_CHECK_EQUAL(pblocktree->ReadHeightIndexPruned(), 0U);
+
+    std::vector<uint256> hashes;
+    for(unsigned int height = 0; height < 5; height++){
+        hashes.push_back(txHash(height));
+    }
+    pstorageresult->deleteResults(hashes);
+    BOOST_CHECK(pblocktree->PruneHeightIndex(0, 5));
+    BOOST_CHECK_EQUAL(pblocktree->ReadHeightIndexPruned(), 5U);
+
+    std::vector<std::vector<uint256>> blocksOfHashes;
+    pblocktree->ReadHeightIndex(0, -1, 0, blocksOfHashes, std::set<dev::h160>());
+    BOOST_CHECK_EQUAL(blocksOfHashes.size(), 5U);
+    BOOST_CHECK(blocksOfHashes.front()[0] == txHash(5));
+
+    BOOST_CHECK(pstorageresult->getResult(uintToh256(txHash(4))).empty());
+    std::vector<TransactionReceiptInfo> kept = pstorageresult->getResult(uintToh256(txHash(5)));
+    BOOST_CHECK_EQUAL(kept.size(), 1U);
+    BOOST_CHECK_EQUAL(kept[0].blockNumber, 5U);
+
+    // Wiping the index starts the retained window from genesis again
+    BOOST_CHECK(pblocktree->WipeHeightIndex());
+    BOOST_CHECK_EQUAL(pblocktree->ReadHeightIndexPruned(), 0U);
+}
+
+BOOST_AUTO_TEST_CASE(logeventsprune_reorg_safe){
+    addBlock(0);
+    pstorageresult->commitResults();
+    fLogEvents = true;
+    nLogEventsRetainHeight = 100;
+
+    // The chain is shorter than MIN_BLOCKS_TO_KEEP, so nothing may be pruned
+    PruneLogEvents(LOGEVENTS_PRUNE_TIME_MICROS);
+    {
+        LOCK(cs_main);
+        BOOST_CHECK_EQUAL(GetLogEventsPruneHeight(), 0);
+    }
+    BOOST_CHECK_EQUAL(pstorageresult->getResult(uintToh256(txHash(0))).size(), 1U);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+}
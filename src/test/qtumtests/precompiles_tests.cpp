@@ -0,0 +1,164 @@
+#include <boost/test/unit_test.hpp>
+#include <test/util/setup_common.h>
+#include <key.h>
+#include <qtum/precompiles.h>
+#include <util/strencodings.h>
+#include <libdevcore/CommonData.h>
+#include <libdevcore/SHA3.h>
+#include <libethcore/Precompiled.h>
+
+namespace PrecompilesTest{
+
+const std::string pairingInput =
+    "0000000000000000000000000000000000000000000000000000000000000001"
+    "0000000000000000000000000000000000000000000000000000000000000002"
+    "198e9393920d483a7260bfb731fb5d25f1aa493335a9e71297e485b7aef312c2"
+    "1800deef121f1e76426a00665e5c4479674322d4f75edadd46debd5cd992f6ed"
+    "090689d0585ff075ec9e99ad690c3395bc4b313370b38ef355acdadcd122975b"
+    "12c85ea5db8c6deb4aab71808dcb408fe3d1e7690c43d37b4ce6cc0166fa7daa"
+    "0000000000000000000000000000000000000000000000000000000000000001"
+    "30644e72e131a029b85045b68181585d97816a916871ca8d3c208c16d87cfd45"
+    "198e9393920d483a7260bfb731fb5d25f1aa493335a9e71297e485b7aef312c2"
+    "1800deef121f1e76426a00665e5c4479674322d4f75edadd46debd5cd992f6ed"
+    "090689d0585ff075ec9e99ad690c3395bc4b313370b38ef355acdadcd122975b"
+    "12c85ea5db8c6deb4aab71808dcb408fe3d1e7690c43d37b4ce6cc0166fa7daa";
+
+std::pair<bool, dev::bytes> execute(const std::string& name, const dev::bytes& input){
+    return dev::eth::PrecompiledRegistrar::executor(name)(dev::bytesConstRef(&input));
+}
+
+//! Order of the secp256k1 group
+const dev::u256 secp256k1n("0xfffffffffffffffffffffffffffffffebaaedce6af48a03bbfd25e8cd0364141");
+
+//! Run the native and the generic ecrecover on input, check they agree and return the result
+dev::bytes ecrecover(const dev::bytes& input){
+    std::pair<bool, dev::bytes> result = execute("ecrecover", input);
+    std::pair<bool, dev::bytes> generic = GenericPrecompile("ecrecover")(dev::bytesConstRef(&input));
+    BOOST_CHECK(result.first);
+    BOOST_CHECK(result == generic);
+    BOOST_CHECK(PrecompileEcrecover(dev::bytesConstRef(&input)) == generic);
+    return result.second;
+}
+
+//! ecrecover input with r and s replaced
+dev::bytes withRS(const dev::bytes& input, const dev::u256& r, const dev::u256& s){
+    dev::bytes out = input;
+    dev::h256 hr(r), hs(s);
+    std::copy(hr.begin(), hr.end(), out.begin() + 64);
+    std::copy(hs.begin(), hs.end(), out.begin() + 96);
+    return out;
+}
+
+BOOST_FIXTURE_TEST_SUITE(precompiles_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(precompiles_ecrecover){
+    for(int i = 0; i < 16; i++){
+        CKey key;
+        key.MakeNewKey(false);
+        uint256 hash = InsecureRand256();
+        std::vector<unsigned char> sig;
+        BOOST_CHECK(key.SignCompact(hash, sig));
+
+        dev::bytes input(128, 0);
+        std::copy(hash.begin(), hash.end(), input.begin());
+        input[63] = sig[0];
+        std::copy(sig.begin() + 1, sig.end(), input.begin() + 64);
+        const dev::u256 r(dev::h256(input.data() + 64, dev::h256::ConstructFromPointer));
+        const dev::u256 s(dev::h256(input.data() + 96, dev::h256::ConstructFromPointer));
+
+        // The address of the signing key
+        CPubKey pubkey = key.GetPubKey();
+        dev::h256 address = dev::sha3(dev::bytesConstRef(pubkey.begin() + 1, 64));
+        memset(address.data(), 0, 12);
+        BOOST_CHECK(ecrecover(input) == address.asBytes());
+
+        // The high-s form of the signature, with the other recovery id, is accepted and recovers the same key
+        dev::bytes highS = withRS(input, r, secp256k1n - s);
+        highS[63] = sig[0] == 27 ? 28 : 27;
+        BOOST_CHECK(ecrecover(highS) == address.asBytes());
+        // With the same recovery id it recovers another key
+        highS[63] = sig[0];
+        BOOST_CHECK(ecrecover(highS) != address.asBytes());
+
+        // Invalid v
+        dev::bytes badV = input;
+        badV[63] = sig[0] == 27 ? 29 : 26;
+        BOOST_CHECK(ecrecover(badV).empty());
+        badV = input;
+        badV[62] = 1;
+        BOOST_CHECK(ecrecover(badV).empty());
+
+        // r and s out of range
+        BOOST_CHECK(ecrecover(withRS(input, 0, s)).empty());
+        BOOST_CHECK(ecrecover(withRS(input, secp256k1n, s)).empty());
+        BOOST_CHECK(ecrecover(withRS(input, ~dev::u256(0), s)).empty());
+        BOOST_CHECK(ecrecover(withRS(input, r, 0)).empty());
+        BOOST_CHECK(ecrecover(withRS(input, r, secp256k1n)).empty());
+        BOOST_CHECK(ecrecover(withRS(input, r, secp256k1n + 1)).empty());
+        BOOST_CHECK(ecrecover(withRS(input, r, ~dev::u256(0))).empty());
+        // s = n - 1 is in range
+        ecrecover(withRS(input, r, secp256k1n - 1));
+
+        // Short input is zero padded, long input is truncated
+        ecrecover(dev::bytes(input.begin(), input.begin() + 100));
+        dev::bytes longInput = input;
+        longInput.push_back(1);
+        BOOST_CHECK(ecrecover(longInput) == address.asBytes());
+    }
+    BOOST_CHECK(ecrecover(dev::bytes()).empty());
+}
+
+BOOST_AUTO_TEST_CASE(precompiles_hashes){
+    std::pair<bool, dev::bytes> result = execute("sha256", dev::bytes());
+    BOOST_CHECK(result.first);
+    BOOST_CHECK_EQUAL(HexStr(result.second), "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855");
+
+    result = execute("ripemd160", dev::bytes());
+    BOOST_CHECK(result.first);
+    BOOST_CHECK_EQUAL(HexStr(result.second), "0000000000000000000000009c1185a5c5e9fc54612808977ee8f548b2258d31");
+
+    dev::bytes input = dev::asBytes("abc");
+    BOOST_CHECK_EQUAL(HexStr(execute("sha256", input).second), "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+    BOOST_CHECK_EQUAL(HexStr(execute("ripemd160", input).second), "0000000000000000000000008eb208f7e05d987a9b044a8e98c6b087f15a0bfc");
+}
+
+BOOST_AUTO_TEST_CASE(precompiles_pairing_cache){
+    g_pairing_cache.Clear();
+    const uint64_t hits = g_pairing_cache.Hits();
+    const dev::bytes input = ParseHex(pairingInput);
+
+    std::pair<bool, dev::bytes> result = execute("alt_bn128_pairing_product", input);
+    BOOST_CHECK(result.first);
+    BOOST_CHECK(result.second == dev::h256(1).asBytes());
+    BOOST_CHECK_EQUAL(g_pairing_cache.Hits(), hits);
+
+    BOOST_CHECK(execute("alt_bn128_pairing_product", input) == result);
+    BOOST_CHECK_EQUAL(g_pairing_cache.Hits(), hits + 1);
+
+    // A single pair does not check, and is cached separately
+    dev::bytes single(input.begin(), input.begin() + 192);
+    result = execute("alt_bn128_pairing_product", single);
+    BOOST_CHECK(result.first);
+    BOOST_CHECK(result.second == dev::h256(0).asBytes());
+
+    // Malformed inputs fail, from the cache too
+    dev::bytes truncated(input.begin(), input.begin() + 100);
+    BOOST_CHECK(!execute("alt_bn128_pairing_product", truncated).first);
+    BOOST_CHECK(!execute("alt_bn128_pairing_product", truncated).first);
+    BOOST_CHECK_EQUAL(g_pairing_cache.Hits(), hits + 2);
+
+    // Oldest results are evicted first
+    PairingCache cache(2);
+    PairingCache::Result value;
+    cache.Put(uint256S("01"), {true, {1}});
+    cache.Put(uint256S("02"), {true, {2}});
+    BOOST_CHECK(cache.Get(uint256S("01"), value));
+    cache.Put(uint256S("03"), {true, {3}});
+    BOOST_CHECK(!cache.Get(uint256S("02"), value));
+    BOOST_CHECK(cache.Get(uint256S("01"), value));
+    BOOST_CHECK(value.second == dev::bytes{1});
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+}
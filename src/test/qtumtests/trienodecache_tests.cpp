@@ -0,0 +1,90 @@
+#include <boost/test/unit_test.hpp>
+#include <test/util/setup_common.h>
+#include <qtum/trienodecache.h>
+#include <libdevcore/MemoryDB.h>
+#include <libdevcore/SHA3.h>
+
+namespace TrieNodeCacheTest{
+
+std::string node(size_t i){
+    return std::string(64, 'a' + (i % 26));
+}
+
+dev::h256 nodeHash(size_t i){
+    return dev::sha3(dev::h256(i));
+}
+
+dev::db::Slice toSlice(dev::h256 const& hash){
+    return dev::db::Slice((char const*)hash.data(), hash.size);
+}
+
+BOOST_FIXTURE_TEST_SUITE(trienodecache_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(trienodecache_lru){
+    TrieNodeCache cache(1 << 20);
+    for(size_t i = 0; i < 100; i++){
+        cache.Put(nodeHash(i), node(i));
+    }
+    TrieNodeCache::Stats stats = cache.GetStats();
+    BOOST_CHECK_EQUAL(stats.entries, 100U);
+    BOOST_CHECK_EQUAL(stats.inserts, 100U);
+
+    std::string value;
+    BOOST_CHECK(cache.Get(nodeHash(0), value));
+    BOOST_CHECK_EQUAL(value, node(0));
+    BOOST_CHECK(!cache.Get(nodeHash(100), value));
+
+    // Shrinking keeps the most recently used nodes, which now include node 0
+    cache.SetMaxUsage(stats.usage / 10);
+    BOOST_CHECK(cache.Get(nodeHash(0), value));
+    BOOST_CHECK(cache.Get(nodeHash(99), value));
+    BOOST_CHECK(!cache.Get(nodeHash(1), value));
+
+    stats = cache.GetStats();
+    BOOST_CHECK_EQUAL(stats.hits, 3U);
+    BOOST_CHECK_EQUAL(stats.misses, 2U);
+    BOOST_CHECK(stats.evictions > 0);
+    BOOST_CHECK(stats.usage <= stats.max_usage);
+
+    cache.SetMaxUsage(0);
+    BOOST_CHECK_EQUAL(cache.GetStats().entries, 0U);
+    cache.Put(nodeHash(0), node(0));
+    BOOST_CHECK(!cache.Get(nodeHash(0), value));
+}
+
+BOOST_AUTO_TEST_CASE(trienodecache_db){
+    TrieNodeCache cache(1 << 20);
+    dev::db::MemoryDB* memoryDB = new dev::db::MemoryDB();
+    CachedStateDB db(std::unique_ptr<dev::db::DatabaseFace>(memoryDB), cache);
+
+    // Committed nodes are cached
+    std::unique_ptr<dev::db::WriteBatchFace> batch = db.createWriteBatch();
+    for(size_t i = 0; i < 10; i++){
+        std::string value = node(i);
+        batch->insert(toSlice(nodeHash(i)), dev::db::Slice(value.data(), value.size()));
+    }
+    db.commit(std::move(batch));
+    BOOST_CHECK_EQUAL(cache.GetStats().entries, 10U);
+    BOOST_CHECK_EQUAL(db.lookup(toSlice(nodeHash(3))), node(3));
+    BOOST_CHECK_EQUAL(cache.GetStats().hits, 1U);
+
+    // Nodes read from the database are cached on the first lookup
+    cache.Clear();
+    BOOST_CHECK_EQUAL(db.lookup(toSlice(nodeHash(3))), node(3));
+    BOOST_CHECK_EQUAL(db.lookup(toSlice(nodeHash(3))), node(3));
+    BOOST_CHECK_EQUAL(cache.GetStats().hits, 2U);
+
+    // Missing nodes and non-node keys are not cached
+    BOOST_CHECK(db.lookup(toSlice(nodeHash(10))).empty());
+    BOOST_CHECK(!db.exists(toSlice(nodeHash(10))));
+    std::string auxKey = nodeHash(0).hex() + "ff";
+    db.insert(dev::db::Slice(auxKey.data(), auxKey.size()), dev::db::Slice("aux", 3));
+    BOOST_CHECK_EQUAL(cache.GetStats().entries, 1U);
+
+    db.kill(toSlice(nodeHash(3)));
+    BOOST_CHECK(!db.exists(toSlice(nodeHash(3))));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+}
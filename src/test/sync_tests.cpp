@@ -7,6 +7,8 @@
 
 #include <boost/test/unit_test.hpp>
 
+#include <thread>
+
 namespace {
 template <typename MutexType>
 void TestPotentialDeadLockDetected(MutexType& mutex1, MutexType& mutex2)
@@ -27,6 +29,19 @@ void TestPotentialDeadLockDetected(MutexType& mutex1, MutexType& mutex2)
     BOOST_CHECK(!error_thrown);
     #endif
 }
+
+//! Statistics of this file's sites locking the mutex called name
+LockSiteStats SumLockStats(const std::string& name)
+{
+    LockSiteStats sum{};
+    for (const LockSiteStats& site : GetLockStats()) {
+        if (site.name != name || site.file.find("sync_tests.cpp") == std::string::npos) continue;
+        sum.contentions += site.contentions;
+        sum.wait_us += site.wait_us;
+        sum.hold_samples += site.hold_samples;
+    }
+    return sum;
+}
 } // namespace
 
 BOOST_FIXTURE_TEST_SUITE(sync_tests, BasicTestingSetup)
@@ -49,4 +64,47 @@ BOOST_AUTO_TEST_CASE(potential_deadlock_detected)
     #endif
 }
 
+BOOST_AUTO_TEST_CASE(lock_stats)
+{
+    Mutex stats_mutex;
+    ResetLockStats();
+    g_lock_stats_enabled = true;
+
+    // Hold the lock while another thread waits for it
+    std::atomic<bool> started{false};
+    std::thread thread;
+    {
+        LOCK(stats_mutex);
+        thread = std::thread([&] {
+            started = true;
+            LOCK(stats_mutex);
+        });
+        while (!started) std::this_thread::yield();
+        std::this_thread::sleep_for(std::chrono::milliseconds{20});
+    }
+    thread.join();
+    for (unsigned int i = 0; i < LOCK_STATS_SAMPLE_INTERVAL; i++) {
+        ENTER_CRITICAL_SECTION(stats_mutex);
+        LEAVE_CRITICAL_SECTION(stats_mutex);
+        LOCK(stats_mutex);
+    }
+
+    LockSiteStats stats = SumLockStats("stats_mutex");
+    BOOST_CHECK_EQUAL(stats.contentions, 1U);
+    BOOST_CHECK(stats.wait_us >= 10000);
+    BOOST_CHECK(stats.hold_samples >= 1);
+
+    // Nothing is recorded while disabled
+    g_lock_stats_enabled = false;
+    for (unsigned int i = 0; i < 2 * LOCK_STATS_SAMPLE_INTERVAL; i++) {
+        LOCK(stats_mutex);
+    }
+    BOOST_CHECK_EQUAL(SumLockStats("stats_mutex").hold_samples, stats.hold_samples);
+
+    ResetLockStats();
+    stats = SumLockStats("stats_mutex");
+    BOOST_CHECK_EQUAL(stats.contentions, 0U);
+    BOOST_CHECK_EQUAL(stats.hold_samples, 0U);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
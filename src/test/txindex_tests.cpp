@@ -6,7 +6,9 @@
 #include <index/txindex.h>
 #include <script/standard.h>
 #include <test/util/setup_common.h>
+#include <util/system.h>
 #include <util/time.h>
+#include <validation.h>
 
 #include <boost/test/unit_test.hpp>
 
@@ -78,4 +80,42 @@ BOOST_FIXTURE_TEST_CASE(txindex_initial_sync, TestChain100Setup)
     // Rest of shutdown sequence and destructors happen in ~TestingSetup()
 }
 
+BOOST_FIXTURE_TEST_CASE(txindex_parallel_sync, TestChain100Setup)
+{
+    // Blocks are read and prepared by several workers, but must be written in chain order
+    gArgs.ForceSetArg("-indexsyncthreads", "4");
+    TxIndex txindex(1 << 20, true);
+    txindex.Start();
+
+    constexpr int64_t timeout_ms = 10 * 1000;
+    int64_t time_start = GetTimeMillis();
+    while (!txindex.BlockUntilSyncedToCurrentChain()) {
+        BOOST_REQUIRE(time_start + timeout_ms > GetTimeMillis());
+        UninterruptibleSleep(std::chrono::milliseconds{100});
+    }
+
+    // Every transaction is found in its own block, at the position the workers computed
+    {
+        LOCK(cs_main);
+        for (const CBlockIndex* pindex = ::ChainActive()[1]; pindex; pindex = ::ChainActive().Next(pindex)) {
+            CBlock block;
+            BOOST_REQUIRE(ReadBlockFromDisk(block, pindex, Params().GetConsensus()));
+            for (const auto& txn : block.vtx) {
+                CTransactionRef tx_disk;
+                uint256 block_hash;
+                BOOST_REQUIRE(txindex.FindTx(txn->GetHash(), block_hash, tx_disk));
+                BOOST_CHECK(block_hash == pindex->GetBlockHash());
+                BOOST_CHECK(tx_disk->GetHash() == txn->GetHash());
+            }
+        }
+    }
+
+    txindex.Stop();
+    gArgs.ForceSetArg("-indexsyncthreads", strprintf("%d", DEFAULT_INDEX_SYNC_THREADS));
+
+    m_node.scheduler->stop();
+    threadGroup.interrupt_all();
+    threadGroup.join_all();
+}
+
 BOOST_AUTO_TEST_SUITE_END()
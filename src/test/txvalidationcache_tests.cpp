@@ -3,13 +3,19 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include <consensus/validation.h>
+#include <hash.h>
 #include <key.h>
 #include <validation.h>
 #include <txmempool.h>
+#include <script/sigcache.h>
 #include <script/standard.h>
 #include <script/sign.h>
 #include <script/signingprovider.h>
+#include <streams.h>
 #include <test/util/setup_common.h>
+#include <util/system.h>
+
+#include <algorithm>
 
 #include <boost/test/unit_test.hpp>
 
@@ -371,4 +377,130 @@ BOOST_FIXTURE_TEST_CASE(checkinputs_test, TestChain100Setup)
     }
 }
 
+//! Number of script checks CheckInputScripts leaves to do for tx, 0 if its success is cached
+static size_t PendingScriptChecks(const CTransaction& tx)
+{
+    LOCK(cs_main);
+    TxValidationState state;
+    PrecomputedTransactionData txdata(tx);
+    std::vector<CScriptCheck> scriptchecks;
+    BOOST_CHECK(CheckInputScripts(tx, state, &::ChainstateActive().CoinsTip(), SCRIPT_VERIFY_P2SH | SCRIPT_VERIFY_DERSIG, true, true, txdata, &scriptchecks));
+    return scriptchecks.size();
+}
+
+static std::vector<uint256> SortedSignatureCacheEntries(uint256& nonce)
+{
+    std::vector<uint256> entries;
+    GetSignatureCacheEntries(nonce, entries);
+    std::sort(entries.begin(), entries.end());
+    return entries;
+}
+
+//! Write data as sigcache.dat, followed by checksum
+static void WriteValidationCacheFile(const CDataStream& data, const uint256& checksum)
+{
+    CAutoFile file(fsbridge::fopen(GetDataDir() / "sigcache.dat", "wb"), SER_DISK, CLIENT_VERSION);
+    BOOST_REQUIRE(!file.IsNull());
+    file.write(data.data(), data.size());
+    file << checksum;
+}
+
+BOOST_FIXTURE_TEST_CASE(validation_cache_dump, TestChain100Setup)
+{
+    InitSignatureCache();
+    {
+        LOCK(cs_main);
+        InitScriptExecutionCache();
+    }
+
+    CScript p2pk_scriptPubKey = CScript() << ToByteVector(coinbaseKey.GetPubKey()) << OP_CHECKSIG;
+    CMutableTransaction spend_tx;
+    spend_tx.nVersion = 1;
+    spend_tx.vin.resize(1);
+    spend_tx.vin[0].prevout = COutPoint(m_coinbase_txns[0]->GetHash(), 0);
+    spend_tx.vout.resize(1);
+    spend_tx.vout[0].nValue = 11*CENT;
+    spend_tx.vout[0].scriptPubKey = p2pk_scriptPubKey;
+    std::vector<unsigned char> vchSig;
+    uint256 hash = SignatureHash(p2pk_scriptPubKey, spend_tx, 0, SIGHASH_ALL, 0, SigVersion::BASE);
+    BOOST_CHECK(coinbaseKey.Sign(hash, vchSig));
+    vchSig.push_back((unsigned char)SIGHASH_ALL);
+    spend_tx.vin[0].scriptSig << vchSig;
+    const CTransaction tx(spend_tx);
+
+    // Validating the transaction stores it in the script execution cache and its signature in the signature cache
+    {
+        LOCK(cs_main);
+        TxValidationState state;
+        PrecomputedTransactionData txdata(tx);
+        BOOST_CHECK(CheckInputScripts(tx, state, &::ChainstateActive().CoinsTip(), SCRIPT_VERIFY_P2SH | SCRIPT_VERIFY_DERSIG, true, true, txdata, nullptr));
+    }
+    BOOST_CHECK_EQUAL(PendingScriptChecks(tx), 0U);
+    uint256 sig_nonce;
+    const std::vector<uint256> sig_entries = SortedSignatureCacheEntries(sig_nonce);
+    BOOST_CHECK_EQUAL(sig_entries.size(), 1U);
+
+    BOOST_CHECK(DumpValidationCaches());
+
+    // Empty both caches, then restore them from the file
+    InitSignatureCache();
+    {
+        LOCK(cs_main);
+        InitScriptExecutionCache();
+    }
+    uint256 nonce;
+    BOOST_CHECK(SortedSignatureCacheEntries(nonce).empty());
+    BOOST_CHECK_EQUAL(PendingScriptChecks(tx), 1U);
+
+    BOOST_CHECK(LoadValidationCaches());
+    BOOST_CHECK(SortedSignatureCacheEntries(nonce) == sig_entries);
+    BOOST_CHECK(nonce == sig_nonce);
+    BOOST_CHECK_EQUAL(PendingScriptChecks(tx), 0U);
+
+    // Files with another version, a bad checksum or more entries than can be
+    // serialized are rejected, and leave the caches as they are
+    const uint256 other_nonce = InsecureRand256();
+    const std::vector<uint256> other_entries{InsecureRand256(), InsecureRand256(), InsecureRand256()};
+    CDataStream data(SER_DISK, CLIENT_VERSION);
+    data << uint64_t{2} << other_nonce << other_entries << other_nonce << other_entries;
+    WriteValidationCacheFile(data, Hash(data.begin(), data.end()));
+    BOOST_CHECK(!LoadValidationCaches());
+
+    data.clear();
+    data << uint64_t{1} << other_nonce << other_entries << other_nonce << other_entries;
+    WriteValidationCacheFile(data, InsecureRand256());
+    BOOST_CHECK(!LoadValidationCaches());
+
+    data.clear();
+    data << uint64_t{1} << other_nonce;
+    WriteCompactSize(data, MAX_SIZE + 1);
+    data << other_entries << other_nonce << other_entries;
+    WriteValidationCacheFile(data, Hash(data.begin(), data.end()));
+    BOOST_CHECK(!LoadValidationCaches());
+
+    BOOST_CHECK(SortedSignatureCacheEntries(nonce) == sig_entries);
+    BOOST_CHECK(nonce == sig_nonce);
+    BOOST_CHECK_EQUAL(PendingScriptChecks(tx), 0U);
+
+    // A valid file with more entries than the cache holds only restores its newest entries
+    gArgs.ForceSetArg("-maxsigcachesize", "0");
+    InitSignatureCache();
+    data.clear();
+    data << uint64_t{1} << other_nonce << other_entries << other_nonce << other_entries;
+    WriteValidationCacheFile(data, Hash(data.begin(), data.end()));
+    BOOST_CHECK(LoadValidationCaches());
+    const std::vector<uint256> loaded = SortedSignatureCacheEntries(nonce);
+    BOOST_CHECK(nonce == other_nonce);
+    BOOST_CHECK(!loaded.empty());
+    BOOST_CHECK(loaded.size() <= GetSignatureCacheCapacity());
+    BOOST_CHECK(std::find(loaded.begin(), loaded.end(), other_entries.back()) == loaded.end());
+
+    gArgs.ForceSetArg("-maxsigcachesize", std::to_string(DEFAULT_MAX_SIG_CACHE_SIZE));
+    InitSignatureCache();
+    {
+        LOCK(cs_main);
+        InitScriptExecutionCache();
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -16,6 +16,7 @@
 #include <net_processing.h>
 #include <noui.h>
 #include <pow.h>
+#include <qtum/precompiles.h>
 #include <rpc/blockchain.h>
 #include <rpc/register.h>
 #include <rpc/server.h>
@@ -78,6 +79,7 @@ BasicTestingSetup::BasicTestingSetup(const std::string& chainName)
     LogInstance().StartLogging();
     SHA256AutoDetect();
     ECC_Start();
+    RegisterNativePrecompiles();
     SetupEnvironment();
     SetupNetworking();
     InitSignatureCache();
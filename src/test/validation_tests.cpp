@@ -3,7 +3,10 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include <chainparams.h>
+#include <clientversion.h>
 #include <net.h>
+#include <shutdown.h>
+#include <streams.h>
 #include <validation.h>
 
 #include <test/util/setup_common.h>
@@ -110,4 +113,48 @@ BOOST_AUTO_TEST_CASE(test_combiner_all)
     Test.disconnect(&ReturnTrue);
     BOOST_CHECK(Test());
 }
+
+//! Overwrite the first byte of a block's header on disk, returning the old value
+static unsigned char ChangeBlockFileByte(const CBlockIndex* pindex, unsigned char value)
+{
+    CAutoFile file(OpenBlockFile(pindex->GetBlockPos()), SER_DISK, CLIENT_VERSION);
+    unsigned char old;
+    file >> old;
+    BOOST_REQUIRE(fseek(file.Get(), pindex->GetBlockPos().nPos, SEEK_SET) == 0);
+    file << value;
+    return old;
+}
+
+BOOST_FIXTURE_TEST_CASE(background_verifydb, TestChain100Setup)
+{
+    CBlockIndex* tip;
+    {
+        LOCK(cs_main);
+        tip = ::ChainActive().Tip();
+    }
+
+    // An intact chain verifies at every level and leaves the tip alone
+    BOOST_CHECK(BackgroundVerifyDB(Params(), 4, 10));
+    VerifyDBProgress progress = GetVerifyDBProgress();
+    BOOST_CHECK(progress.started && progress.finished && !progress.failed);
+    BOOST_CHECK_EQUAL(progress.check_level, 4);
+    BOOST_CHECK_EQUAL(progress.snapshot_height, tip->nHeight);
+    BOOST_CHECK_EQUAL(progress.blocks_done, 10);
+    BOOST_CHECK(!progress.level3_skipped);
+    {
+        LOCK(cs_main);
+        BOOST_CHECK(::ChainActive().Tip() == tip);
+    }
+
+    // A block that can no longer be read is reported as a failure
+    const CBlockIndex* pindex = tip->GetAncestor(tip->nHeight - 2);
+    const unsigned char old = ChangeBlockFileByte(pindex, 0xff);
+    BOOST_CHECK(!BackgroundVerifyDB(Params(), 1, 10));
+    progress = GetVerifyDBProgress();
+    BOOST_CHECK(progress.finished && progress.failed);
+    BOOST_CHECK_EQUAL(progress.blocks_done, 2);
+    BOOST_CHECK(ShutdownRequested());
+    AbortShutdown();
+    ChangeBlockFileByte(pindex, old);
+}
 BOOST_AUTO_TEST_SUITE_END()
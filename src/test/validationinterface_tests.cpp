@@ -3,6 +3,7 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include <boost/test/unit_test.hpp>
+#include <chain.h>
 #include <consensus/validation.h>
 #include <primitives/block.h>
 #include <scheduler.h>
@@ -10,6 +11,8 @@
 #include <util/check.h>
 #include <validationinterface.h>
 
+#include <future>
+
 BOOST_FIXTURE_TEST_SUITE(validationinterface_tests, TestingSetup)
 
 struct TestSubscriberNoop final : public CValidationInterface {
@@ -91,4 +94,150 @@ BOOST_AUTO_TEST_CASE(unregister_all_during_call)
     BOOST_CHECK(destroyed);
 }
 
+class TestTipSubscriber : public CValidationInterface
+{
+public:
+    explicit TestTipSubscriber(std::function<void()> on_tip) : m_on_tip(std::move(on_tip)) {}
+    void UpdatedBlockTip(const CBlockIndex*, const CBlockIndex*, bool) override { m_on_tip(); }
+    std::function<void()> m_on_tip;
+};
+
+// A subscriber that is stuck processing a notification must not hold up the
+// notifications of other subscribers, and SyncWithValidationInterfaceQueue
+// must still wait for every subscriber.
+BOOST_AUTO_TEST_CASE(slow_subscriber_does_not_block_others)
+{
+    // The fixture only runs one scheduler thread, add a second one
+    threadGroup.create_thread([&] { m_node.scheduler->serviceQueue(); });
+
+    std::promise<void> release_slow;
+    std::shared_future<void> slow_released = release_slow.get_future().share();
+    std::atomic<int> slow_calls{0};
+    std::atomic<int> fast_calls{0};
+    auto slow = std::make_shared<TestTipSubscriber>([&] { slow_released.wait(); ++slow_calls; });
+    auto fast = std::make_shared<TestTipSubscriber>([&] { ++fast_calls; });
+    RegisterSharedValidationInterface(slow);
+    RegisterSharedValidationInterface(fast);
+
+    CBlockIndex index;
+    uint256 hash;
+    index.phashBlock = &hash;
+    for (int i = 0; i < 3; ++i) {
+        GetMainSignals().UpdatedBlockTip(&index, nullptr, false);
+    }
+
+    // The fast subscriber gets all its notifications while the slow one is blocked
+    for (int i = 0; i < 1000 && fast_calls < 3; ++i) {
+        UninterruptibleSleep(std::chrono::milliseconds{5});
+    }
+    BOOST_CHECK_EQUAL(fast_calls, 3);
+    BOOST_CHECK_EQUAL(slow_calls, 0);
+    BOOST_CHECK_EQUAL(GetMainSignals().CallbacksPending(), 2U);
+
+    release_slow.set_value();
+    SyncWithValidationInterfaceQueue();
+    BOOST_CHECK_EQUAL(slow_calls, 3);
+    BOOST_CHECK_EQUAL(GetMainSignals().CallbacksPending(), 0U);
+
+    for (const ValidationQueueStats& stats : GetMainSignals().GetQueueStats()) {
+        BOOST_CHECK_EQUAL(stats.pending, 0U);
+    }
+
+    UnregisterSharedValidationInterface(slow);
+    UnregisterSharedValidationInterface(fast);
+}
+
+class TestMempoolSubscriber : public CValidationInterface
+{
+public:
+    TestMempoolSubscriber(bool lossy, std::function<void()> on_tx) : m_lossy(lossy), m_on_tx(std::move(on_tx)) {}
+    std::string GetValidationQueueName() const override { return m_lossy ? "test lossy" : "test"; }
+    bool IsValidationQueueLossy() const override { return m_lossy; }
+    void TransactionAddedToMempool(const CTransactionRef&) override { m_on_tx(); }
+    const bool m_lossy;
+    std::function<void()> m_on_tx;
+};
+
+static ValidationQueueStats GetQueueStats(const std::string& name)
+{
+    for (const ValidationQueueStats& stats : GetMainSignals().GetQueueStats()) {
+        if (stats.name == name) return stats;
+    }
+    BOOST_ERROR("no queue named " + name);
+    return {};
+}
+
+// A stuck lossy subscriber misses mempool notifications instead of making
+// LimitValidationInterfaceQueue wait for it.
+BOOST_AUTO_TEST_CASE(lossy_subscriber_drops_notifications)
+{
+    std::promise<void> release;
+    std::shared_future<void> released = release.get_future().share();
+    std::atomic<int> calls{0};
+    auto lossy = std::make_shared<TestMempoolSubscriber>(true, [&] { released.wait(); ++calls; });
+    RegisterSharedValidationInterface(lossy);
+
+    const CTransactionRef tx = MakeTransactionRef(CMutableTransaction());
+    const int notifications = MAX_PENDING_VALIDATION_CALLBACKS * 3;
+    for (int i = 0; i < notifications; ++i) {
+        GetMainSignals().TransactionAddedToMempool(tx);
+    }
+    LimitValidationInterfaceQueue();
+
+    ValidationQueueStats stats = GetQueueStats("test lossy");
+    BOOST_CHECK(stats.lossy);
+    BOOST_CHECK_LE(stats.pending, MAX_PENDING_VALIDATION_CALLBACKS);
+    BOOST_CHECK_GE(stats.dropped, notifications - MAX_PENDING_VALIDATION_CALLBACKS - 1);
+    BOOST_CHECK_EQUAL(stats.waits, 0U);
+
+    release.set_value();
+    SyncWithValidationInterfaceQueue();
+    BOOST_CHECK_EQUAL(calls + GetQueueStats("test lossy").dropped, (uint64_t)notifications);
+
+    UnregisterSharedValidationInterface(lossy);
+}
+
+// LimitValidationInterfaceQueue waits for a subscriber that is behind until it
+// is back within the limit, not until its queue drained.
+BOOST_AUTO_TEST_CASE(limit_waits_for_subscriber_within_limit)
+{
+    std::promise<void> release_first, release_seventh;
+    std::shared_future<void> first_released = release_first.get_future().share();
+    std::shared_future<void> seventh_released = release_seventh.get_future().share();
+    std::atomic<int> calls{0};
+    auto sub = std::make_shared<TestMempoolSubscriber>(false, [&] {
+        int call = ++calls;
+        if (call == 1) first_released.wait();
+        if (call == 7) seventh_released.wait();
+    });
+    RegisterSharedValidationInterface(sub);
+
+    const CTransactionRef tx = MakeTransactionRef(CMutableTransaction());
+    const int notifications = MAX_PENDING_VALIDATION_CALLBACKS + 7;
+    for (int i = 0; i < notifications; ++i) {
+        GetMainSignals().TransactionAddedToMempool(tx);
+    }
+
+    auto limited = std::async(std::launch::async, [] { LimitValidationInterfaceQueue(); });
+    BOOST_CHECK(limited.wait_for(std::chrono::milliseconds{50}) == std::future_status::timeout);
+
+    // Taking the seventh notification brings the queue back to the limit,
+    // while it is still stuck on it
+    release_first.set_value();
+    BOOST_CHECK(limited.wait_for(std::chrono::seconds{10}) == std::future_status::ready);
+    BOOST_CHECK_LE(calls, 7);
+
+    ValidationQueueStats stats = GetQueueStats("test");
+    BOOST_CHECK(!stats.lossy);
+    BOOST_CHECK_EQUAL(stats.pending, MAX_PENDING_VALIDATION_CALLBACKS);
+    BOOST_CHECK_EQUAL(stats.waits, 1U);
+    BOOST_CHECK_EQUAL(stats.dropped, 0U);
+
+    release_seventh.set_value();
+    SyncWithValidationInterfaceQueue();
+    BOOST_CHECK_EQUAL(calls, notifications);
+
+    UnregisterSharedValidationInterface(sub);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,54 @@
+// Copyright (c) 2020 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <arith_uint256.h>
+#include <validationprofile.h>
+
+#include <test/util/setup_common.h>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(validationprofile_tests, BasicTestingSetup)
+
+static BlockProfile MakeProfile(int height)
+{
+    BlockProfile profile;
+    profile.hash = ArithToUint256(arith_uint256(height + 1));
+    profile.height = height;
+    profile.Add(BlockPhase::INPUTS, height);
+    profile.Add(BlockPhase::INPUTS, 1);
+    return profile;
+}
+
+BOOST_AUTO_TEST_CASE(block_profiler_ring)
+{
+    BlockProfiler profiler(3);
+    for (int height = 0; height < 5; ++height) {
+        profiler.Add(MakeProfile(height));
+    }
+
+    // Only the last three blocks are kept, newest first
+    std::vector<BlockProfile> recent = profiler.GetRecent(10);
+    BOOST_REQUIRE_EQUAL(recent.size(), 3U);
+    BOOST_CHECK_EQUAL(recent[0].height, 4);
+    BOOST_CHECK_EQUAL(recent[2].height, 2);
+    BOOST_CHECK_EQUAL(recent[0].phase_us[(size_t)BlockPhase::INPUTS], 5);
+    BOOST_CHECK_EQUAL(profiler.GetRecent(1).size(), 1U);
+
+    BlockProfile profile;
+    BOOST_CHECK(!profiler.Find(MakeProfile(1).hash, profile));
+    BOOST_CHECK(profiler.Find(MakeProfile(3).hash, profile));
+    BOOST_CHECK_EQUAL(profile.height, 3);
+
+    // Shrinking drops the oldest profiles, zero disables profiling
+    profiler.SetCapacity(1);
+    BOOST_CHECK_EQUAL(profiler.GetRecent(10).size(), 1U);
+    BOOST_CHECK_EQUAL(profiler.GetRecent(10)[0].height, 4);
+    profiler.SetCapacity(0);
+    BOOST_CHECK(!profiler.Enabled());
+    profiler.Add(MakeProfile(5));
+    BOOST_CHECK(profiler.GetRecent(10).empty());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -29,6 +29,7 @@ static const char DB_BLOCK_INDEX = 'b';
 static const char DB_HEIGHTINDEX = 'h';
 static const char DB_STAKEINDEX = 's';
 static const char DB_DELEGATEINDEX = 'd';
+static const char DB_HEIGHTINDEX_PRUNED = 'L';
 //////////////////////////////////////////
 
 static const char DB_BEST_BLOCK = 'B';
@@ -43,6 +44,8 @@ static const char DB_ADDRESSUNSPENTINDEX = 'u';
 static const char DB_TIMESTAMPINDEX = 'S';
 static const char DB_BLOCKHASHINDEX = 'z';
 static const char DB_SPENTINDEX = 'p';
+static const char DB_CONTRACTINDEX = 'k';
+static const char DB_CONTRACTINDEXUNDO = 'K';
 //////////////////////////////////////////
 
 namespace {
@@ -382,10 +385,44 @@ bool CBlockTreeDB::WipeHeightIndex() {
             break;
         }
     }
+    batch.Erase(DB_HEIGHTINDEX_PRUNED);
 
     return WriteBatch(batch);
 }
 
+bool CBlockTreeDB::PruneHeightIndex(unsigned int low, unsigned int high) {
+
+    std::unique_ptr<CDBIterator> pcursor(NewIterator());
+    CDBBatch batch(*this);
+
+    pcursor->Seek(std::make_pair(DB_HEIGHTINDEX, CHeightTxIndexIteratorKey(low)));
+
+    while (pcursor->Valid()) {
+        boost::this_thread::interruption_point();
+        std::pair<char, CHeightTxIndexKey> key;
+        if (pcursor->GetKey(key) && key.first == DB_HEIGHTINDEX && key.second.height < high) {
+            batch.Erase(key);
+            pcursor->Next();
+        } else {
+            break;
+        }
+    }
+    // Erase the range and move the window start in one write
+    batch.Write(DB_HEIGHTINDEX_PRUNED, high);
+
+    return WriteBatch(batch);
+}
+
+bool CBlockTreeDB::WriteHeightIndexPruned(unsigned int height) {
+    return Write(DB_HEIGHTINDEX_PRUNED, height);
+}
+
+unsigned int CBlockTreeDB::ReadHeightIndexPruned() {
+    unsigned int height = 0;
+    Read(DB_HEIGHTINDEX_PRUNED, height);
+    return height;
+}
+
 
 bool CBlockTreeDB::WriteStakeIndex(unsigned int height, uint160 address) {
     CDBBatch batch(*this);
@@ -662,6 +699,85 @@ bool CBlockTreeDB::blockOnchainActive(const uint256 &hash) {
     CBlockIndex* pblockindex = (*mi).second;
     return pblockindex && ::ChainActive().Contains(pblockindex);
 }
+
+bool CBlockTreeDB::WriteContractIndex(int nHeight, const std::map<uint160, CContractIndexValue> &contracts) {
+    if (contracts.empty())
+        return true;
+
+    // Keep the values from before the block. If the block is connected again
+    // (e.g. replayed after an unclean shutdown) the existing undo entries win.
+    std::vector<std::pair<uint160, CContractIndexValue> > undo;
+    Read(std::make_pair(DB_CONTRACTINDEXUNDO, nHeight), undo);
+    std::set<uint160> undone;
+    for (const auto& entry : undo)
+        undone.insert(entry.first);
+
+    CDBBatch batch(*this);
+    for (const auto& it : contracts) {
+        if (!undone.count(it.first)) {
+            CContractIndexValue prev;
+            Read(std::make_pair(DB_CONTRACTINDEX, it.first), prev);
+            undo.push_back(std::make_pair(it.first, prev));
+        }
+        if (it.second.IsNull())
+            batch.Erase(std::make_pair(DB_CONTRACTINDEX, it.first));
+        else
+            batch.Write(std::make_pair(DB_CONTRACTINDEX, it.first), it.second);
+    }
+    batch.Write(std::make_pair(DB_CONTRACTINDEXUNDO, nHeight), undo);
+    return WriteBatch(batch);
+}
+
+bool CBlockTreeDB::EraseContractIndex(int nHeight) {
+    std::vector<std::pair<uint160, CContractIndexValue> > undo;
+    if (!Read(std::make_pair(DB_CONTRACTINDEXUNDO, nHeight), undo))
+        return true;
+
+    CDBBatch batch(*this);
+    for (const auto& entry : undo) {
+        if (entry.second.IsNull())
+            batch.Erase(std::make_pair(DB_CONTRACTINDEX, entry.first));
+        else
+            batch.Write(std::make_pair(DB_CONTRACTINDEX, entry.first), entry.second);
+    }
+    batch.Erase(std::make_pair(DB_CONTRACTINDEXUNDO, nHeight));
+    return WriteBatch(batch);
+}
+
+bool CBlockTreeDB::ReadContractIndex(const uint160 &address, CContractIndexValue &value) {
+    return Read(std::make_pair(DB_CONTRACTINDEX, address), value);
+}
+
+bool CBlockTreeDB::ReadContractIndex(const uint160 &start, size_t limit,
+        const std::function<bool(const uint160&, const CContractIndexValue&)> &filter,
+        std::vector<std::pair<uint160, CContractIndexValue> > &contracts, uint160 &next) {
+
+    next.SetNull();
+    std::unique_ptr<CDBIterator> pcursor(NewIterator());
+    pcursor->Seek(std::make_pair(DB_CONTRACTINDEX, start));
+
+    while (pcursor->Valid()) {
+        boost::this_thread::interruption_point();
+        std::pair<char, uint160> key;
+        if (!pcursor->GetKey(key) || key.first != DB_CONTRACTINDEX)
+            break;
+
+        CContractIndexValue value;
+        if (!pcursor->GetValue(value))
+            return error("failed to get contract index value");
+
+        if (!filter || filter(key.second, value)) {
+            if (contracts.size() == limit) {
+                next = key.second;
+                break;
+            }
+            contracts.push_back(std::make_pair(key.second, value));
+        }
+        pcursor->Next();
+    }
+
+    return true;
+}
 ///////////////////////////////////////////////////////
 
 bool CBlockTreeDB::LoadBlockIndexGuts(const Consensus::Params& consensusParams, std::function<CBlockIndex*(const uint256&)> insertBlockIndex)
@@ -13,6 +13,8 @@
 #include <libdevcore/Common.h>
 #include <libdevcore/FixedHash.h>
 
+#include <functional>
+#include <map>
 #include <memory>
 #include <string>
 #include <utility>
@@ -31,6 +33,7 @@ struct CMempoolAddressDeltaKey;
 struct CTimestampIndexKey;
 struct CTimestampBlockIndexKey;
 struct CTimestampBlockIndexValue;
+struct CContractIndexValue;
 ////////////////////////////////////
 
 using valtype = std::vector<unsigned char>;
@@ -104,6 +107,8 @@ public:
     //! Attempt to update from an older database format. Returns whether an error occurred.
     bool Upgrade();
     size_t EstimateSize() const override;
+    //! Memory used by the database's own caches and write buffers
+    size_t DynamicMemoryUsage() const { return db.DynamicMemoryUsage(); }
 };
 
 /** Specialization of CCoinsViewCursor to iterate over a CCoinsViewDB */
@@ -162,6 +167,11 @@ public:
             std::set<dev::h160> const &addresses);
     bool EraseHeightIndex(const unsigned int &height);
     bool WipeHeightIndex();
+    /** Erase the entries of the blocks in [low, high) and record high as the lowest indexed height */
+    bool PruneHeightIndex(unsigned int low, unsigned int high);
+    bool WriteHeightIndexPruned(unsigned int height);
+    /** Lowest height still in the height index, 0 if it was never pruned */
+    unsigned int ReadHeightIndexPruned();
 
 
     bool WriteStakeIndex(unsigned int height, uint160 address);
@@ -192,6 +202,29 @@ public:
     bool UpdateSpentIndex(const std::vector<std::pair<CSpentIndexKey, CSpentIndexValue> >&vect);
     bool blockOnchainActive(const uint256 &hash);
 
+    /**
+     * Contract registry. Entries changed by the block at nHeight are written
+     * together with their previous values, so EraseContractIndex(nHeight)
+     * can roll the block back when it is disconnected. Null entries are
+     * contracts the block destroyed, and are erased.
+     */
+    bool WriteContractIndex(int nHeight, const std::map<uint160, CContractIndexValue> &contracts);
+    bool EraseContractIndex(int nHeight);
+    bool ReadContractIndex(const uint160 &address, CContractIndexValue &value);
+
+    /**
+     * Iterates through the registry in address order.
+     *
+     * @param start start iterating from this address (inclusive)
+     * @param limit maximum number of matching entries to collect
+     * @param filter entries are skipped unless this returns true for them (ignored if empty)
+     * @param contracts matching entries are collected into this vector.
+     * @param next set to the address of the next matching entry, or null if there is none.
+     */
+    bool ReadContractIndex(const uint160 &start, size_t limit,
+            const std::function<bool(const uint160&, const CContractIndexValue&)> &filter,
+            std::vector<std::pair<uint160, CContractIndexValue> > &contracts, uint160 &next);
+
     //////////////////////////////////////////////////////////////////////////////
 };
 
@@ -594,6 +627,44 @@ struct CAddressIndexIteratorKey {
         hashBytes.SetNull();
     }
 };
+
+struct CContractIndexValue {
+    int creationHeight;
+    uint256 creationTxid;
+    uint160 creator;
+    uint256 codeHash;
+    uint32_t codeSize;
+    int lastTouchedHeight;
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(creationHeight);
+        READWRITE(creationTxid);
+        READWRITE(creator);
+        READWRITE(codeHash);
+        READWRITE(codeSize);
+        READWRITE(lastTouchedHeight);
+    }
+
+    CContractIndexValue() {
+        SetNull();
+    }
+
+    void SetNull() {
+        creationHeight = -1;
+        creationTxid.SetNull();
+        creator.SetNull();
+        codeHash.SetNull();
+        codeSize = 0;
+        lastTouchedHeight = -1;
+    }
+
+    bool IsNull() const {
+        return (creationHeight == -1);
+    }
+};
 ////////////////////////////////////////////////////////////
 
 #endif // BITCOIN_TXDB_H
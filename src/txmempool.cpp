@@ -17,6 +17,7 @@
 #include <reverse_iterator.h>
 #include <util/system.h>
 #include <util/moneystr.h>
+#include <util/rbf.h>
 #include <util/time.h>
 #include <validationinterface.h>
 #include <script/sign.h>
@@ -110,6 +111,7 @@ void CTxMemPool::UpdateForDescendants(txiter updateIt, cacheMap &cachedDescendan
 void CTxMemPool::UpdateTransactionsFromBlock(const std::vector<uint256> &vHashesToUpdate)
 {
     AssertLockHeld(cs);
+    m_snapshot.reset();
     // For each entry in vHashesToUpdate, store the set of in-mempool, but not
     // in-vHashesToUpdate transactions, so that we don't have to recalculate
     // descendants when we come across a previously seen entry.
@@ -404,6 +406,7 @@ void CTxMemPool::addUnchecked(const CTxMemPoolEntry &entry, setEntries &setAnces
 
     vTxHashes.emplace_back(tx.GetWitnessHash(), newit);
     newit->vTxHashesIdx = vTxHashes.size() - 1;
+    RecordChange(tx.GetHash(), true);
 }
 
 void CTxMemPool::removeUnchecked(txiter it, MemPoolRemovalReason reason)
@@ -436,6 +439,81 @@ void CTxMemPool::removeUnchecked(txiter it, MemPoolRemovalReason reason)
     mapTx.erase(it);
     nTransactionsUpdated++;
     if (minerPolicyEstimator) {minerPolicyEstimator->removeTx(hash, false);}
+    RecordChange(hash, false);
+}
+
+void CTxMemPool::RecordChange(const uint256& txid, bool added)
+{
+    AssertLockHeld(cs);
+    m_snapshot.reset();
+    ++m_sequence_number;
+    if (m_max_change_log == 0) return;
+    if (m_change_log.size() >= m_max_change_log) m_change_log.pop_front();
+    m_change_log.push_back(MempoolChange{m_sequence_number, txid, added});
+}
+
+void CTxMemPool::SetChangeLogSize(size_t entries)
+{
+    LOCK(cs);
+    m_max_change_log = entries;
+    while (m_change_log.size() > m_max_change_log) m_change_log.pop_front();
+}
+
+bool CTxMemPool::GetChangesSince(uint64_t since, std::vector<MempoolChange>& changes) const
+{
+    AssertLockHeld(cs);
+    changes.clear();
+    if (since > m_sequence_number || m_sequence_number - since > m_change_log.size()) return false;
+    changes.assign(m_change_log.end() - (m_sequence_number - since), m_change_log.end());
+    return true;
+}
+
+MempoolEntryInfo CTxMemPool::GetEntryInfo(txiter it) const
+{
+    AssertLockHeld(cs);
+    const CTransaction& tx = it->GetTx();
+    MempoolEntryInfo info{it->GetSharedTx(), vTxHashes[it->vTxHashesIdx].first, it->GetFee(), it->GetModifiedFee(),
+        it->GetTime(), it->GetHeight(), it->GetTxSize(), it->GetTxWeight(),
+        it->GetCountWithDescendants(), it->GetSizeWithDescendants(), it->GetModFeesWithDescendants(),
+        it->GetCountWithAncestors(), it->GetSizeWithAncestors(), it->GetModFeesWithAncestors(),
+        {}, {}, SignalsOptInRBF(tx)};
+
+    for (const CTxIn& txin : tx.vin) {
+        if (mapTx.count(txin.prevout.hash)) info.depends.push_back(txin.prevout.hash);
+    }
+    for (txiter child : GetMemPoolChildren(it)) {
+        info.spent_by.push_back(child->GetTx().GetHash());
+    }
+
+    // Replaceable if the transaction or any of its in-mempool ancestors signals BIP125
+    if (!info.bip125_replaceable && !info.depends.empty()) {
+        setEntries ancestors;
+        uint64_t noLimit = std::numeric_limits<uint64_t>::max();
+        std::string dummy;
+        CalculateMemPoolAncestors(*it, ancestors, noLimit, noLimit, noLimit, noLimit, dummy, false);
+        for (txiter ancestor : ancestors) {
+            if (SignalsOptInRBF(ancestor->GetTx())) {
+                info.bip125_replaceable = true;
+                break;
+            }
+        }
+    }
+    return info;
+}
+
+std::shared_ptr<const MempoolSnapshot> CTxMemPool::GetSnapshot() const
+{
+    LOCK(cs);
+    if (!m_snapshot) {
+        auto snapshot = std::make_shared<MempoolSnapshot>();
+        snapshot->sequence = m_sequence_number;
+        snapshot->entries.reserve(mapTx.size());
+        for (txiter it = mapTx.begin(); it != mapTx.end(); ++it) {
+            snapshot->entries.push_back(GetEntryInfo(it));
+        }
+        m_snapshot = std::move(snapshot);
+    }
+    return m_snapshot;
 }
 
 // Calculates descendants of entry that are not already in setDescendants, and adds to
@@ -589,6 +667,12 @@ void CTxMemPool::removeForBlock(const std::vector<CTransactionRef>& vtx, unsigne
 
 void CTxMemPool::_clear()
 {
+    // The removals are not logged, so changes from before can no longer be followed
+    if (!mapTx.empty()) {
+        ++m_sequence_number;
+        m_change_log.clear();
+    }
+    m_snapshot.reset();
     mapLinks.clear();
     mapTx.clear();
     mapNextTx.clear();
@@ -850,6 +934,7 @@ void CTxMemPool::PrioritiseTransaction(const uint256& hash, const CAmount& nFeeD
                 mapTx.modify(descendantIt, update_ancestor_state(0, nFeeDelta, 0, 0));
             }
             ++nTransactionsUpdated;
+            m_snapshot.reset();
         }
     }
     LogPrintf("PrioritiseTransaction: %s feerate += %s\n", hash.ToString(), FormatMoney(nFeeDelta));
@@ -930,6 +1015,14 @@ size_t CTxMemPool::DynamicMemoryUsage() const {
     return memusage::MallocUsage(sizeof(CTxMemPoolEntry) + 12 * sizeof(void*)) * mapTx.size() + memusage::DynamicUsage(mapNextTx) + memusage::DynamicUsage(mapDeltas) + memusage::DynamicUsage(mapLinks) + memusage::DynamicUsage(vTxHashes) + cachedInnerUsage;
 }
 
+size_t CTxMemPool::IndexDynamicMemoryUsage() const {
+    LOCK(cs);
+    size_t usage = memusage::DynamicUsage(mapAddress) + memusage::DynamicUsage(mapAddressInserted) + memusage::DynamicUsage(mapSpent) + memusage::DynamicUsage(mapSpentInserted);
+    for (const auto& entry : mapAddressInserted) usage += memusage::DynamicUsage(entry.second);
+    for (const auto& entry : mapSpentInserted) usage += memusage::DynamicUsage(entry.second);
+    return usage + m_change_log.size() * sizeof(MempoolChange);
+}
+
 void CTxMemPool::RemoveStaged(setEntries &stage, bool updateDescendants, MemPoolRemovalReason reason) {
     AssertLockHeld(cs);
     UpdateForRemoveFromMempool(stage, updateDescendants);
@@ -7,7 +7,9 @@
 #define BITCOIN_TXMEMPOOL_H
 
 #include <atomic>
+#include <deque>
 #include <map>
+#include <memory>
 #include <set>
 #include <string>
 #include <utility>
@@ -34,6 +36,9 @@ extern RecursiveMutex cs_main;
 /** Fake height value used in Coin to signify they are only in the memory pool (since 0.8) */
 static const uint32_t MEMPOOL_HEIGHT = 0x0FFFFFFF;
 
+/** Default for -mempoolchangelog, the number of mempool additions and removals kept for getmempooldelta */
+static const unsigned int DEFAULT_MEMPOOL_CHANGE_LOG = 100000;
+
 struct LockPoints
 {
     // Will be set to the blockchain height and median time past
@@ -479,6 +484,47 @@ struct TxMempoolInfo
     int64_t nFeeDelta;
 };
 
+/** An addition to or removal from the mempool, numbered by the mempool sequence */
+struct MempoolChange
+{
+    uint64_t sequence;
+    uint256 txid;
+    bool added;
+};
+
+/** Copy of a mempool entry and its in-mempool links, with what the mempool RPCs report */
+struct MempoolEntryInfo
+{
+    CTransactionRef tx;
+    uint256 wtxid;
+    CAmount fee;
+    CAmount modified_fee;
+    std::chrono::seconds time;
+    unsigned int height;
+    size_t vsize;
+    size_t weight;
+    uint64_t count_with_descendants;
+    uint64_t size_with_descendants;
+    CAmount mod_fees_with_descendants;
+    uint64_t count_with_ancestors;
+    uint64_t size_with_ancestors;
+    CAmount mod_fees_with_ancestors;
+    std::vector<uint256> depends;  //!< In-mempool parents
+    std::vector<uint256> spent_by; //!< In-mempool children
+    bool bip125_replaceable;
+};
+
+/**
+ * Copy of every mempool entry at one mempool sequence. Snapshots are never
+ * modified: the mempool hands out the same one until it changes, so readers
+ * can encode it without holding the mempool lock.
+ */
+struct MempoolSnapshot
+{
+    uint64_t sequence;
+    std::vector<MempoolEntryInfo> entries;
+};
+
 /** Reason why a transaction was removed from the mempool,
  * this is passed to the notification signal.
  */
@@ -597,6 +643,16 @@ private:
 
     bool m_is_loaded GUARDED_BY(cs){false};
 
+    //! Number of additions and removals so far
+    uint64_t m_sequence_number GUARDED_BY(cs){0};
+    //! The most recent additions and removals, oldest first
+    std::deque<MempoolChange> m_change_log GUARDED_BY(cs);
+    size_t m_max_change_log GUARDED_BY(cs){DEFAULT_MEMPOOL_CHANGE_LOG};
+    //! Snapshot of the current contents, built on demand
+    mutable std::shared_ptr<const MempoolSnapshot> m_snapshot GUARDED_BY(cs);
+
+    void RecordChange(const uint256& txid, bool added) EXCLUSIVE_LOCKS_REQUIRED(cs);
+
 public:
 
     static const int ROLLING_FEE_HALFLIFE = 60 * 60 * 12; // public only for testing
@@ -871,7 +927,23 @@ public:
     TxMempoolInfo info(const uint256& hash) const;
     std::vector<TxMempoolInfo> infoAll() const;
 
+    /** The mempool sequence, which goes up by one for every transaction added or removed */
+    uint64_t GetSequence() const EXCLUSIVE_LOCKS_REQUIRED(cs) { return m_sequence_number; }
+    /** Set how many additions and removals are kept for GetChangesSince() */
+    void SetChangeLogSize(size_t entries);
+    /**
+     * Get the additions and removals after sequence since, oldest first.
+     * Returns false if some of them have already been dropped from the change
+     * log, or since is ahead of the mempool.
+     */
+    bool GetChangesSince(uint64_t since, std::vector<MempoolChange>& changes) const EXCLUSIVE_LOCKS_REQUIRED(cs);
+    MempoolEntryInfo GetEntryInfo(txiter it) const EXCLUSIVE_LOCKS_REQUIRED(cs);
+    /** The current contents, copied only once per change of the mempool */
+    std::shared_ptr<const MempoolSnapshot> GetSnapshot() const;
+
     size_t DynamicMemoryUsage() const;
+    /** Memory used by the address and spent indexes and the change log, which DynamicMemoryUsage() leaves out */
+    size_t IndexDynamicMemoryUsage() const;
 
 private:
     /** UpdateForDescendants is used by UpdateTransactionsFromBlock to update
@@ -0,0 +1,158 @@
+// Copyright (c) 2020 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <util/lz4.h>
+
+#include <crypto/common.h>
+
+#include <algorithm>
+#include <string.h>
+
+namespace {
+
+/** Matches are at least this long */
+constexpr size_t MIN_MATCH = 4;
+/** The last match starts at least this many bytes before the end of the input */
+constexpr size_t MF_LIMIT = 12;
+/** The last this many bytes of the input are always literals */
+constexpr size_t LAST_LITERALS = 5;
+/** Matches are at most this many bytes back */
+constexpr size_t MAX_DISTANCE = 65535;
+/** Positions are hashed into a table of 1 << HASH_LOG entries, 16 KiB on the stack */
+constexpr int HASH_LOG = 12;
+/** After every 1 << SKIP_TRIGGER failed probes the search step grows, to get through incompressible data quickly */
+constexpr int SKIP_TRIGGER = 6;
+
+inline uint32_t Hash(uint32_t sequence)
+{
+    return (sequence * 2654435761U) >> (32 - HASH_LOG);
+}
+
+inline void WriteLength(std::vector<unsigned char>& out, size_t length)
+{
+    for (; length >= 255; length -= 255) out.push_back(255);
+    out.push_back(length);
+}
+
+void WriteSequence(std::vector<unsigned char>& out, const unsigned char* literals, size_t literal_length, size_t offset, size_t match_length)
+{
+    const size_t match_code = match_length - MIN_MATCH;
+    out.push_back((std::min<size_t>(literal_length, 15) << 4) | std::min<size_t>(match_code, 15));
+    if (literal_length >= 15) WriteLength(out, literal_length - 15);
+    out.insert(out.end(), literals, literals + literal_length);
+    out.push_back(offset & 0xff);
+    out.push_back(offset >> 8);
+    if (match_code >= 15) WriteLength(out, match_code - 15);
+}
+
+/** Read an extended length, which continues while the bytes are 255 */
+inline bool ReadLength(const unsigned char* src, size_t size, size_t& pos, size_t& length)
+{
+    unsigned char byte;
+    do {
+        if (pos >= size) return false;
+        byte = src[pos++];
+        length += byte;
+    } while (byte == 255);
+    return true;
+}
+
+} // namespace
+
+size_t LZ4CompressBound(size_t size)
+{
+    return size + size / 255 + 16;
+}
+
+void LZ4Compress(const unsigned char* src, size_t size, std::vector<unsigned char>& out)
+{
+    out.clear();
+    out.reserve(LZ4CompressBound(size));
+
+    size_t anchor = 0;
+    if (size > MF_LIMIT) {
+        uint32_t table[1 << HASH_LOG] = {0};
+        const size_t match_limit = size - MF_LIMIT;
+        const size_t end_limit = size - LAST_LITERALS;
+        size_t pos = 1;
+        size_t misses = 0;
+        while (pos < match_limit) {
+            const uint32_t sequence = ReadLE32(src + pos);
+            const uint32_t hash = Hash(sequence);
+            size_t ref = table[hash];
+            table[hash] = pos;
+            if (pos - ref > MAX_DISTANCE || ReadLE32(src + ref) != sequence) {
+                pos += 1 + (misses++ >> SKIP_TRIGGER);
+                continue;
+            }
+            misses = 0;
+
+            // Extend the match forwards, eight bytes at a time while possible
+            size_t length = MIN_MATCH;
+            while (pos + length + 8 <= end_limit) {
+                uint64_t diff = ReadLE64(src + pos + length) ^ ReadLE64(src + ref + length);
+                if (diff != 0) {
+                    for (; (diff & 0xff) == 0; diff >>= 8) ++length;
+                    break;
+                }
+                length += 8;
+            }
+            while (pos + length < end_limit && src[pos + length] == src[ref + length]) ++length;
+            // and backwards into the pending literals
+            while (pos > anchor && ref > 0 && src[pos - 1] == src[ref - 1]) {
+                --pos;
+                --ref;
+                ++length;
+            }
+
+            WriteSequence(out, src + anchor, pos - anchor, pos - ref, length);
+            pos += length;
+            anchor = pos;
+            if (pos < match_limit) table[Hash(ReadLE32(src + pos - 2))] = pos - 2;
+        }
+    }
+
+    // The last sequence only has literals
+    const size_t literal_length = size - anchor;
+    out.push_back(std::min<size_t>(literal_length, 15) << 4);
+    if (literal_length >= 15) WriteLength(out, literal_length - 15);
+    out.insert(out.end(), src + anchor, src + size);
+}
+
+bool LZ4Decompress(const unsigned char* src, size_t size, unsigned char* dst, size_t raw_size)
+{
+    size_t in = 0;
+    size_t out = 0;
+    while (true) {
+        if (in >= size) return false;
+        const unsigned char token = src[in++];
+
+        size_t literal_length = token >> 4;
+        if (literal_length == 15 && !ReadLength(src, size, in, literal_length)) return false;
+        if (literal_length > size - in || literal_length > raw_size - out) return false;
+        if (literal_length > 0) memcpy(dst + out, src + in, literal_length);
+        in += literal_length;
+        out += literal_length;
+        if (in == size) break;
+
+        if (size - in < 2) return false;
+        const size_t offset = src[in] | (src[in + 1] << 8);
+        in += 2;
+        if (offset == 0 || offset > out) return false;
+
+        size_t match_length = token & 15;
+        if (match_length == 15 && !ReadLength(src, size, in, match_length)) return false;
+        match_length += MIN_MATCH;
+        if (match_length > raw_size - out) return false;
+        unsigned char* match = dst + out - offset;
+        if (offset >= match_length) {
+            memcpy(dst + out, match, match_length);
+        } else {
+            // Overlapping matches repeat the last offset bytes
+            for (size_t i = 0; i < match_length; ++i) dst[out + i] = match[i];
+        }
+        out += match_length;
+    }
+    return out == raw_size;
+}
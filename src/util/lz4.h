@@ -0,0 +1,35 @@
+// Copyright (c) 2020 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_UTIL_LZ4_H
+#define BITCOIN_UTIL_LZ4_H
+
+#include <stddef.h>
+#include <vector>
+
+/**
+ * Compressor and decompressor for the LZ4 block format
+ * (https://github.com/lz4/lz4/blob/dev/doc/lz4_Block_format.md).
+ *
+ * Only single blocks are handled, without the LZ4 frame format around them:
+ * the caller records the uncompressed size. The compressor is a greedy
+ * single-probe matcher, which trades some ratio for speed; its output can be
+ * read by any LZ4 implementation, and LZ4Decompress() accepts the output of
+ * any conforming compressor.
+ */
+
+/** Upper bound of the compressed size of size bytes */
+size_t LZ4CompressBound(size_t size);
+
+/** Compress size bytes at src, replacing the contents of out */
+void LZ4Compress(const unsigned char* src, size_t size, std::vector<unsigned char>& out);
+
+/**
+ * Decompress size bytes at src into exactly raw_size bytes at dst. Returns
+ * false if the input is malformed, refers outside of the output, or does not
+ * decompress to exactly raw_size bytes.
+ */
+bool LZ4Decompress(const unsigned char* src, size_t size, unsigned char* dst, size_t raw_size);
+
+#endif // BITCOIN_UTIL_LZ4_H
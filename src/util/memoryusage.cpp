@@ -0,0 +1,39 @@
+// Copyright (c) 2020 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <util/memoryusage.h>
+
+#include <sync.h>
+
+#include <map>
+
+static Mutex g_memory_usage_mutex;
+static std::map<std::string, std::function<size_t()>> g_memory_usage GUARDED_BY(g_memory_usage_mutex);
+
+void RegisterMemoryUsage(const std::string& name, std::function<size_t()> usage)
+{
+    LOCK(g_memory_usage_mutex);
+    g_memory_usage[name] = std::move(usage);
+}
+
+void UnregisterMemoryUsage(const std::string& name)
+{
+    LOCK(g_memory_usage_mutex);
+    g_memory_usage.erase(name);
+}
+
+std::vector<std::pair<std::string, size_t>> GetMemoryUsage()
+{
+    // Called outside the registry lock, as they take other locks
+    std::vector<std::pair<std::string, std::function<size_t()>>> functions;
+    {
+        LOCK(g_memory_usage_mutex);
+        functions.assign(g_memory_usage.begin(), g_memory_usage.end());
+    }
+    std::vector<std::pair<std::string, size_t>> usage;
+    for (const auto& function : functions) {
+        usage.emplace_back(function.first, function.second());
+    }
+    return usage;
+}
@@ -0,0 +1,27 @@
+// Copyright (c) 2020 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_UTIL_MEMORYUSAGE_H
+#define BITCOIN_UTIL_MEMORYUSAGE_H
+
+#include <stddef.h>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * Registry of the subsystems that report their dynamic memory usage, for
+ * getmemoryinfo "subsystems". Subsystems estimate their usage with the
+ * memusage.h functions. The usage functions are called without any lock
+ * held, and take the locks they need themselves.
+ */
+
+/** Add or replace the usage function of a subsystem */
+void RegisterMemoryUsage(const std::string& name, std::function<size_t()> usage);
+void UnregisterMemoryUsage(const std::string& name);
+/** The current usage of every registered subsystem, by name */
+std::vector<std::pair<std::string, size_t>> GetMemoryUsage();
+
+#endif // BITCOIN_UTIL_MEMORYUSAGE_H
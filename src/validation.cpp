@@ -15,6 +15,7 @@
 #include <consensus/tx_check.h>
 #include <consensus/tx_verify.h>
 #include <consensus/validation.h>
+#include <core_memusage.h>
 #include <cuckoocache.h>
 #include <flatfile.h>
 #include <hash.h>
@@ -41,12 +42,15 @@
 #include <ui_interface.h>
 #include <uint256.h>
 #include <undo.h>
+#include <util/lz4.h>
 #include <util/moneystr.h>
 #include <util/rbf.h>
 #include <util/strencodings.h>
 #include <util/system.h>
+#include <util/threadnames.h>
 #include <util/translation.h>
 #include <validationinterface.h>
+#include <validationprofile.h>
 #include <warnings.h>
 #include <libethcore/ABI.h>
 #include <util/signstr.h>
@@ -59,9 +63,13 @@
 #include <util/convert.h>
 #include <util/signstr.h>
 #include <qtum/qtumledger.h>
+#include <qtum/contractprofile.h>
 
 #include <algorithm>
+#include <condition_variable>
+#include <deque>
 #include <string>
+#include <thread>
 
 #include <boost/algorithm/string/replace.hpp>
 #include <boost/thread.hpp>
@@ -141,11 +149,15 @@ std::atomic_bool fImporting(false);
 std::atomic_bool fReindex(false);
 bool fAddressIndex = false; // lux
 bool fLogEvents = false;
+int nLogEventsRetain = DEFAULT_LOGEVENTS_RETAIN;
+int nLogEventsRetainHeight = 0;
+bool fContractIndex = false;
 bool fHavePruned = false;
 bool fPruneMode = false;
 bool fRequireStandard = true;
 bool fCheckBlockIndex = false;
 bool fCheckpointsEnabled = DEFAULT_CHECKPOINTS_ENABLED;
+bool fBlockCompression = DEFAULT_BLOCK_COMPRESSION;
 size_t nCoinCacheUsage = 5000 * 300;
 uint64_t nPruneTarget = 0;
 int64_t nMaxTipAge = DEFAULT_MAX_TIP_AGE;
@@ -1319,7 +1331,66 @@ bool CheckHeaderProof(const CBlockHeader& block, const Consensus::Params& consen
 // CBlock and CBlockIndex
 //
 
-static bool WriteBlockToDisk(const CBlock& block, FlatFilePos& pos, const CMessageHeader::MessageStartChars& messageStart)
+/** Codecs of compressed block and undo frames */
+enum BlockFrameCodec : uint8_t {
+    BLOCK_FRAME_LZ4 = 1,
+};
+
+bool CompressBlockFrame(const std::vector<unsigned char>& raw, std::vector<unsigned char>& frame)
+{
+    frame.clear();
+    if (raw.size() > MAX_BLOCK_FRAME_RAW_SIZE) return false;
+
+    std::vector<unsigned char> compressed;
+    LZ4Compress(raw.data(), raw.size(), compressed);
+    if (BLOCK_FRAME_HEADER_SIZE + compressed.size() >= raw.size()) return false;
+
+    CVectorWriter(SER_DISK, CLIENT_VERSION, frame, 0, (uint32_t)raw.size(), (uint8_t)BLOCK_FRAME_LZ4);
+    frame.insert(frame.end(), compressed.begin(), compressed.end());
+    return true;
+}
+
+bool DecompressBlockFrame(const std::vector<unsigned char>& frame, std::vector<unsigned char>& raw)
+{
+    if (frame.size() < BLOCK_FRAME_HEADER_SIZE) return false;
+    const uint32_t raw_size = ReadLE32(frame.data());
+    if (frame[4] != BLOCK_FRAME_LZ4 || raw_size > MAX_BLOCK_FRAME_RAW_SIZE) return false;
+
+    raw.resize(raw_size);
+    return LZ4Decompress(frame.data() + BLOCK_FRAME_HEADER_SIZE, frame.size() - BLOCK_FRAME_HEADER_SIZE, raw.data(), raw_size);
+}
+
+/**
+ * Read the header of the block or undo record at the start of file. If the
+ * record is a compressed frame, read it and decompress its data into raw;
+ * otherwise leave file positioned at the data and return false.
+ */
+static bool ReadBlockFrame(CAutoFile& file, std::vector<unsigned char>& raw, const CMessageHeader::MessageStartChars& message_start)
+{
+    CMessageHeader::MessageStartChars start;
+    unsigned int nSize;
+    file >> start >> nSize;
+    if (memcmp(start, message_start, CMessageHeader::MESSAGE_START_SIZE)) {
+        throw std::ios_base::failure(strprintf("frame magic mismatch: %s versus expected %s",
+                HexStr(start, start + CMessageHeader::MESSAGE_START_SIZE),
+                HexStr(message_start, message_start + CMessageHeader::MESSAGE_START_SIZE)));
+    }
+    if (!(nSize & BLOCK_FRAME_COMPRESSED)) return false;
+
+    nSize &= ~BLOCK_FRAME_COMPRESSED;
+    if (nSize > MAX_BLOCK_FRAME_RAW_SIZE) {
+        throw std::ios_base::failure("compressed frame too large");
+    }
+    std::vector<unsigned char> frame(nSize);
+    file.read((char*)frame.data(), frame.size());
+    if (!DecompressBlockFrame(frame, raw)) {
+        throw std::ios_base::failure("corrupt compressed frame");
+    }
+    return true;
+}
+
+/** Write block to disk, as the compressed frame if one is given */
+static bool WriteBlockToDisk(const CBlock& block, const std::vector<unsigned char>& frame, FlatFilePos& pos, const CMessageHeader::MessageStartChars& messageStart)
 {
     // Open history file to append
     CAutoFile fileout(OpenBlockFile(pos), SER_DISK, CLIENT_VERSION);
@@ -1327,7 +1398,7 @@ static bool WriteBlockToDisk(const CBlock& block, FlatFilePos& pos, const CMessa
         return error("WriteBlockToDisk: OpenBlockFile failed");
 
     // Write index header
-    unsigned int nSize = GetSerializeSize(block, fileout.GetVersion());
+    unsigned int nSize = frame.empty() ? GetSerializeSize(block, fileout.GetVersion()) : BLOCK_FRAME_COMPRESSED | frame.size();
     fileout << messageStart << nSize;
 
     // Write block
@@ -1335,7 +1406,11 @@ static bool WriteBlockToDisk(const CBlock& block, FlatFilePos& pos, const CMessa
     if (fileOutPos < 0)
         return error("WriteBlockToDisk: ftell failed");
     pos.nPos = (unsigned int)fileOutPos;
-    fileout << block;
+    if (frame.empty()) {
+        fileout << block;
+    } else {
+        fileout.write((const char*)frame.data(), frame.size());
+    }
 
     return true;
 }
@@ -1345,14 +1420,21 @@ bool ReadBlockFromDisk(Block& block, const FlatFilePos& pos, const Consensus::Pa
 {
     block.SetNull();
 
-    // Open history file to read
-    CAutoFile filein(OpenBlockFile(pos, true), SER_DISK, CLIENT_VERSION);
+    // Open history file to read, at the header to tell compressed frames apart
+    FlatFilePos hpos = pos;
+    hpos.nPos -= 8;
+    CAutoFile filein(OpenBlockFile(hpos, true), SER_DISK, CLIENT_VERSION);
     if (filein.IsNull())
         return error("ReadBlockFromDisk: OpenBlockFile failed for %s", pos.ToString());
 
     // Read block
     try {
-        filein >> block;
+        std::vector<unsigned char> raw;
+        if (ReadBlockFrame(filein, raw, Params().MessageStart())) {
+            VectorReader(SER_DISK, CLIENT_VERSION, raw, 0) >> block;
+        } else {
+            filein >> block;
+        }
     }
     catch (const std::exception& e) {
         return error("%s: Deserialize or I/O error - %s at %s", __func__, e.what(), pos.ToString());
@@ -1407,6 +1489,19 @@ bool ReadRawBlockFromDisk(std::vector<uint8_t>& block, const FlatFilePos& pos, c
                     HexStr(message_start, message_start + CMessageHeader::MESSAGE_START_SIZE));
         }
 
+        if (blk_size & BLOCK_FRAME_COMPRESSED) {
+            blk_size &= ~BLOCK_FRAME_COMPRESSED;
+            if (blk_size > MAX_BLOCK_FRAME_RAW_SIZE) {
+                return error("%s: Compressed block data is too large for %s", __func__, pos.ToString());
+            }
+            std::vector<uint8_t> frame(blk_size);
+            filein.read((char*)frame.data(), blk_size);
+            if (!DecompressBlockFrame(frame, block)) {
+                return error("%s: Corrupt compressed block data for %s", __func__, pos.ToString());
+            }
+            return true;
+        }
+
         if (blk_size > MAX_SIZE) {
             return error("%s: Block data is larger than maximum deserialization size for %s: %s versus %s", __func__, pos.ToString(),
                     blk_size, MAX_SIZE);
@@ -1702,16 +1797,23 @@ int GetSpendHeight(const CCoinsViewCache& inputs)
 
 static CuckooCache::cache<uint256, SignatureCacheHasher> scriptExecutionCache;
 static uint256 scriptExecutionCacheNonce(GetRandHash());
+static size_t scriptExecutionCacheCapacity = 0;
 
 void InitScriptExecutionCache() {
     // nMaxCacheSize is unsigned. If -maxsigcachesize is set to zero,
     // setup_bytes creates the minimum possible cache (2 elements).
     size_t nMaxCacheSize = std::min(std::max((int64_t)0, gArgs.GetArg("-maxsigcachesize", DEFAULT_MAX_SIG_CACHE_SIZE) / 2), MAX_MAX_SIG_CACHE_SIZE) * ((size_t) 1 << 20);
     size_t nElems = scriptExecutionCache.setup_bytes(nMaxCacheSize);
+    scriptExecutionCacheCapacity = nElems;
     LogPrintf("Using %zu MiB out of %zu/2 requested for script execution cache, able to store %zu elements\n",
             (nElems*sizeof(uint256)) >>20, (nMaxCacheSize*2)>>20, nElems);
 }
 
+size_t GetScriptExecutionCacheCapacity()
+{
+    return scriptExecutionCacheCapacity;
+}
+
 /**
  * Check whether all of this transaction's input scripts succeed.
  *
@@ -1822,7 +1924,8 @@ bool CheckInputScripts(const CTransaction& tx, TxValidationState &state, const C
     return true;
 }
 
-static bool UndoWriteToDisk(const CBlockUndo& blockundo, FlatFilePos& pos, const uint256& hashBlock, const CMessageHeader::MessageStartChars& messageStart)
+/** Write undo data to disk, as the compressed frame if one is given */
+static bool UndoWriteToDisk(const CBlockUndo& blockundo, const std::vector<unsigned char>& frame, FlatFilePos& pos, const uint256& hashBlock, const CMessageHeader::MessageStartChars& messageStart)
 {
     // Open history file to append
     CAutoFile fileout(OpenUndoFile(pos), SER_DISK, CLIENT_VERSION);
@@ -1830,7 +1933,7 @@ static bool UndoWriteToDisk(const CBlockUndo& blockundo, FlatFilePos& pos, const
         return error("%s: OpenUndoFile failed", __func__);
 
     // Write index header
-    unsigned int nSize = GetSerializeSize(blockundo, fileout.GetVersion());
+    unsigned int nSize = frame.empty() ? GetSerializeSize(blockundo, fileout.GetVersion()) : BLOCK_FRAME_COMPRESSED | frame.size();
     fileout << messageStart << nSize;
 
     // Write undo data
@@ -1838,9 +1941,13 @@ static bool UndoWriteToDisk(const CBlockUndo& blockundo, FlatFilePos& pos, const
     if (fileOutPos < 0)
         return error("%s: ftell failed", __func__);
     pos.nPos = (unsigned int)fileOutPos;
-    fileout << blockundo;
+    if (frame.empty()) {
+        fileout << blockundo;
+    } else {
+        fileout.write((const char*)frame.data(), frame.size());
+    }
 
-    // calculate & write checksum
+    // calculate & write checksum, which is of the uncompressed data
     CHashWriter hasher(SER_GETHASH, PROTOCOL_VERSION);
     hasher << hashBlock;
     hasher << blockundo;
@@ -1856,17 +1963,30 @@ bool UndoReadFromDisk(CBlockUndo& blockundo, const CBlockIndex* pindex)
         return error("%s: no undo data available", __func__);
     }
 
-    // Open history file to read
-    CAutoFile filein(OpenUndoFile(pos, true), SER_DISK, CLIENT_VERSION);
+    // Open history file to read, at the header to tell compressed frames apart
+    FlatFilePos hpos = pos;
+    hpos.nPos -= 8;
+    CAutoFile filein(OpenUndoFile(hpos, true), SER_DISK, CLIENT_VERSION);
     if (filein.IsNull())
         return error("%s: OpenUndoFile failed", __func__);
 
     // Read block
     uint256 hashChecksum;
-    CHashVerifier<CAutoFile> verifier(&filein); // We need a CHashVerifier as reserializing may lose data
+    uint256 hash;
     try {
-        verifier << pindex->pprev->GetBlockHash();
-        verifier >> blockundo;
+        std::vector<unsigned char> raw;
+        if (ReadBlockFrame(filein, raw, Params().MessageStart())) {
+            CHashWriter hasher(SER_GETHASH, PROTOCOL_VERSION);
+            hasher << pindex->pprev->GetBlockHash();
+            hasher.write((const char*)raw.data(), raw.size());
+            hash = hasher.GetHash();
+            VectorReader(SER_DISK, CLIENT_VERSION, raw, 0) >> blockundo;
+        } else {
+            CHashVerifier<CAutoFile> verifier(&filein); // We need a CHashVerifier as reserializing may lose data
+            verifier << pindex->pprev->GetBlockHash();
+            verifier >> blockundo;
+            hash = verifier.GetHash();
+        }
         filein >> hashChecksum;
     }
     catch (const std::exception& e) {
@@ -1874,7 +1994,7 @@ bool UndoReadFromDisk(CBlockUndo& blockundo, const CBlockIndex* pindex)
     }
 
     // Verify checksum
-    if (hashChecksum != verifier.GetHash())
+    if (hashChecksum != hash)
         return error("%s: Checksum mismatch", __func__);
 
     return true;
@@ -2051,6 +2171,13 @@ DisconnectResult CChainState::DisconnectBlock(const CBlock& block, const CBlockI
         pblocktree->EraseHeightIndex(pindex->nHeight);
     }
 
+    if(pfClean == NULL && fContractIndex){
+        if (!pblocktree->EraseContractIndex(pindex->nHeight)) {
+            error("Failed to delete contract index");
+            return DISCONNECT_FAILED;
+        }
+    }
+
     // The stake and delegate index is needed for MPoS, update it while MPoS is active
     const CChainParams& chainparams = Params();
     if(pindex->nHeight <= chainparams.GetConsensus().nLastMPoSBlock)
@@ -2097,10 +2224,17 @@ static bool WriteUndoDataForBlock(const CBlockUndo& blockundo, BlockValidationSt
 {
     // Write undo information to disk
     if (pindex->GetUndoPos().IsNull()) {
+        unsigned int nUndoSize = ::GetSerializeSize(blockundo, CLIENT_VERSION);
+        std::vector<unsigned char> frame;
+        if (fBlockCompression) {
+            std::vector<unsigned char> raw;
+            CVectorWriter(SER_DISK, CLIENT_VERSION, raw, 0, blockundo);
+            if (CompressBlockFrame(raw, frame)) nUndoSize = frame.size();
+        }
         FlatFilePos _pos;
-        if (!FindUndoPos(state, pindex->nFile, _pos, ::GetSerializeSize(blockundo, CLIENT_VERSION) + 40))
+        if (!FindUndoPos(state, pindex->nFile, _pos, nUndoSize + 40))
             return error("ConnectBlock(): FindUndoPos failed");
-        if (!UndoWriteToDisk(blockundo, _pos, pindex->pprev->GetBlockHash(), chainparams.MessageStart()))
+        if (!UndoWriteToDisk(blockundo, frame, _pos, pindex->pprev->GetBlockHash(), chainparams.MessageStart()))
             return AbortNode(state, "Failed to write undo data");
 
         // update nUndoPos in block index
@@ -2428,7 +2562,7 @@ std::vector<ResultExecute> CallContract(const dev::Address& addrContract, std::v
     callTransaction.setVersion(VersionVM::GetEVMDefault());
 
     
-    ByteCodeExec exec(block, std::vector<QtumTransaction>(1, callTransaction), blockGasLimit, pblockindex);
+    ByteCodeExec exec(block, std::vector<QtumTransaction>(1, callTransaction), blockGasLimit, pblockindex, true);
     exec.performByteCode(dev::eth::Permanence::Reverted);
     return exec.getResult();
 }
@@ -2660,6 +2794,7 @@ void LastHashes::clear()
 }
 
 bool ByteCodeExec::performByteCode(dev::eth::Permanence type){
+    int64_t nTimeStart = GetTimeMicros();
     for(QtumTransaction& tx : txs){
         //validate VM version
         if(tx.getVersion().toRaw() != VersionVM::GetEVMDefault().toRaw()){
@@ -2672,11 +2807,21 @@ bool ByteCodeExec::performByteCode(dev::eth::Permanence type){
             result.push_back(ResultExecute{execRes, QtumTransactionReceipt(dev::h256(), dev::h256(), dev::u256(), dev::eth::LogEntries()), CTransaction()});
             continue;
         }
+        if(fProfile && g_contract_profiler.ShouldSample()){
+            ContractOpTracer tracer;
+            int64_t nTimeTx = GetTimeMicros();
+            result.push_back(globalState->execute(envInfo, *globalSealEngine.get(), tx, type, tracer.Func()));
+            g_contract_profiler.Add(tx, result.back(), GetTimeMicros() - nTimeTx, tracer);
+            continue;
+        }
         result.push_back(globalState->execute(envInfo, *globalSealEngine.get(), tx, type, OnOpFunc()));
     }
+    int64_t nTimeExecuted = GetTimeMicros();
     globalState->db().commit();
     globalState->dbUtxo().commit();
     globalSealEngine.get()->deleteAddresses.clear();
+    nTimeCommit = GetTimeMicros() - nTimeExecuted;
+    nTimeExec = nTimeExecuted - nTimeStart;
     return true;
 }
 
@@ -2911,16 +3056,32 @@ bool CheckDelegationOutput(const CBlock& block, bool& delegateOutputExist, CCoin
     return true;
 }
 
+/** Add the accounts of the genesis state, which no transaction created, to the contract index */
+static bool WriteGenesisContractIndex(int nHeight)
+{
+    std::map<uint160, CContractIndexValue> contracts;
+    for (const auto& entry : globalState->addresses()) {
+        CContractIndexValue value;
+        value.creationHeight = nHeight;
+        value.codeHash = h256Touint(globalState->codeHash(entry.first));
+        value.codeSize = globalState->codeSize(entry.first);
+        value.lastTouchedHeight = nHeight;
+        contracts.emplace(h160Touint(entry.first), value);
+    }
+    return pblocktree->WriteContractIndex(nHeight, contracts);
+}
+
 /** Apply the effects of this block (with given index) on the UTXO set represented by coins.
  *  Validity checks that depend on the UTXO set are also done; ConnectBlock()
  *  can fail if those validity checks fail (among other reasons). */
 bool CChainState::ConnectBlock(const CBlock& block, BlockValidationState& state, CBlockIndex* pindex,
-                  CCoinsViewCache& view, const CChainParams& chainparams, bool fJustCheck)
+                  CCoinsViewCache& view, const CChainParams& chainparams, bool fJustCheck, BlockProfile* profile)
 {
     AssertLockHeld(cs_main);
     assert(pindex);
     assert(*pindex->phashBlock == block.GetHash());
     int64_t nTimeStart = GetTimeMicros();
+    PhaseTimer timer(profile);
 
     ///////////////////////////////////////////////// // lux
     QtumDGP qtumDGP(globalState.get(), fGettingValuesDGP);
@@ -2990,8 +3151,11 @@ bool CChainState::ConnectBlock(const CBlock& block, BlockValidationState& state,
     // Special case for the genesis block, skipping connection of its transactions
     // (its coinbase is unspendable)
     if (block.GetHash() == chainparams.GetConsensus().hashGenesisBlock) {
-        if (!fJustCheck)
+        if (!fJustCheck) {
             view.SetBestBlock(pindex->GetBlockHash());
+            if (fContractIndex && !WriteGenesisContractIndex(pindex->nHeight))
+                return AbortNode(state, "Failed to write contract index");
+        }
         return true;
     }
 
@@ -3134,6 +3298,7 @@ bool CChainState::ConnectBlock(const CBlock& block, BlockValidationState& state,
 
     int64_t nTime2 = GetTimeMicros(); nTimeForks += nTime2 - nTime1;
     LogPrint(BCLog::BENCH, "    - Fork checks: %.2fms [%.2fs (%.2fms/blk)]\n", MILLI * (nTime2 - nTime1), nTimeForks * MICRO, nTimeForks * MILLI / nBlocksTotal);
+    timer.Lap(BlockPhase::CHECKS);
 
     CBlockUndo blockundo;
 
@@ -3152,6 +3317,7 @@ bool CChainState::ConnectBlock(const CBlock& block, BlockValidationState& state,
     std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > addressUnspentIndex;
     std::vector<std::pair<CSpentIndexKey, CSpentIndexValue> > spentIndex;
     std::map<dev::Address, std::pair<CHeightTxIndexKey, std::vector<uint256>>> heightIndexes;
+    std::map<uint160, CContractIndexValue> contractIndexes;
     /////////////////////////////////////////////////////////
 
     std::vector<PrecomputedTransactionData> txdata;
@@ -3205,6 +3371,7 @@ bool CChainState::ConnectBlock(const CBlock& block, BlockValidationState& state,
                 LogPrintf("ERROR: %s: contains a non-BIP68-final transaction\n", __func__);
                 return state.Invalid(BlockValidationResult::BLOCK_CONSENSUS, "bad-txns-nonfinal");
             }
+            timer.Lap(BlockPhase::INPUTS);
 
             ////////////////////////////////////////////////////////////////// // lux
             if (fAddressIndex)
@@ -3228,6 +3395,7 @@ bool CChainState::ConnectBlock(const CBlock& block, BlockValidationState& state,
                         spentIndex.push_back(std::make_pair(CSpentIndexKey(input.prevout.hash, input.prevout.n), CSpentIndexValue(tx.GetHash(), j, pindex->nHeight, prevout.nValue, dest.which(), uint256(addressBytes))));
                     }
                 }
+                timer.Lap(BlockPhase::INDEX);
             }
             //////////////////////////////////////////////////////////////////
         }
@@ -3254,6 +3422,7 @@ bool CChainState::ConnectBlock(const CBlock& block, BlockValidationState& state,
             std::vector<CScriptCheck> vChecks;
             bool fCacheResults = fJustCheck; /* Don't cache results if we're actually connecting blocks (still consult the cache, though) */
             TxValidationState tx_state;
+            timer.Lap(BlockPhase::INPUTS);
             if (fScriptChecks && !CheckInputScripts(tx, tx_state, view, flags, fCacheResults, fCacheResults, txdata[i], (hasOpSpend || tx.HasCreateOrCall()) ? nullptr : (g_parallel_script_checks ? &vChecks : nullptr))) {
                 // Any transaction validation failure in ConnectBlock is a block consensus failure
                 state.Invalid(BlockValidationResult::BLOCK_CONSENSUS,
@@ -3262,6 +3431,7 @@ bool CChainState::ConnectBlock(const CBlock& block, BlockValidationState& state,
                     tx.GetHash().ToString(), state.ToString());
             }
             control.Add(vChecks);
+            timer.Lap(BlockPhase::SCRIPT_CHECKS);
 
             for(const CTxIn& j : tx.vin){
                 if(!j.scriptSig.HasOpSpend()){
@@ -3290,6 +3460,7 @@ bool CChainState::ConnectBlock(const CBlock& block, BlockValidationState& state,
             checkBlock.vtx.push_back(block.vtx[i]);
         }
         if(tx.HasCreateOrCall() && !hasOpSpend){
+            timer.Lap(BlockPhase::INPUTS);
 
             if(!CheckSenderScript(view, tx)){
                 return state.Invalid(BlockValidationResult::BLOCK_CONSENSUS, "bad-txns-invalid-sender-script");
@@ -3306,7 +3477,8 @@ bool CChainState::ConnectBlock(const CBlock& block, BlockValidationState& state,
 
 
             dev::u256 gasAllTxs = dev::u256(0);
-            ByteCodeExec exec(block, resultConvertQtumTX.first, blockGasLimit, pindex->pprev);
+            // Not profiled when only checking, TestBlockValidity runs the block again when it is connected
+            ByteCodeExec exec(block, resultConvertQtumTX.first, blockGasLimit, pindex->pprev, !fJustCheck);
             //validate VM version and other ETH params before execution
             //Reject anything unknown (could be changed later by DGP)
             //TODO evaluate if this should be relaxed for soft-fork purposes
@@ -3374,6 +3546,12 @@ bool CChainState::ConnectBlock(const CBlock& block, BlockValidationState& state,
             if(!exec.processingResults(bcer)){
                 return state.Invalid(BlockValidationResult::BLOCK_CONSENSUS, "bad-vm-exec-processing", "ConnectBlock(): Error processing VM execution results");
             }
+            timer.Lap(BlockPhase::CONTRACT_EXEC);
+            if (profile) {
+                profile->Add(BlockPhase::CONTRACT_EXEC, -exec.getCommitTime());
+                profile->Add(BlockPhase::STATE_COMMIT, exec.getCommitTime());
+                profile->contract_execs.push_back(ContractExecProfile{tx.GetHash(), (unsigned int)resultExec.size(), bcer.usedGas, exec.getExecTime(), exec.getCommitTime()});
+            }
 
             std::vector<TransactionReceiptInfo> tri;
             if (fLogEvents && !fJustCheck)
@@ -3409,6 +3587,56 @@ bool CChainState::ConnectBlock(const CBlock& block, BlockValidationState& state,
                 }
 
                 pstorageresult->addResult(uintToh256(tx.GetHash()), tri);
+                timer.Lap(BlockPhase::RECEIPTS);
+            }
+
+            if (fContractIndex && !fJustCheck)
+            {
+                // Entries of the block are looked up in contractIndexes first;
+                // a null entry stands for a destroyed contract
+                auto findContract = [&](const dev::Address& address) {
+                    uint160 key = h160Touint(address);
+                    auto it = contractIndexes.find(key);
+                    if (it == contractIndexes.end()) {
+                        CContractIndexValue value;
+                        if (!pblocktree->ReadContractIndex(key, value))
+                            return contractIndexes.end();
+                        it = contractIndexes.emplace(key, value).first;
+                    }
+                    return it;
+                };
+                auto touchContract = [&](const dev::Address& address) {
+                    auto it = findContract(address);
+                    if (it != contractIndexes.end() && !it->second.IsNull())
+                        it->second.lastTouchedHeight = pindex->nHeight;
+                };
+                for(size_t k = 0; k < resultConvertQtumTX.first.size(); k ++){
+                    if(resultExec[k].execRes.excepted != dev::eth::TransactionException::None)
+                        continue;
+                    const QtumTransaction& qtx = resultConvertQtumTX.first[k];
+                    if(!qtx.isCreation()){
+                        touchContract(qtx.to());
+                    }
+                    for(auto& log : resultExec[k].txRec.log()) {
+                        touchContract(log.address);
+                    }
+                    // Contracts made by an internal CREATE are credited to the transaction sender
+                    for(const dev::Address& address : resultExec[k].createdContracts){
+                        CContractIndexValue& value = contractIndexes[h160Touint(address)];
+                        value.creationHeight = pindex->nHeight;
+                        value.creationTxid = tx.GetHash();
+                        value.creator = h160Touint(qtx.from());
+                        value.codeHash = h256Touint(globalState->codeHash(address));
+                        value.codeSize = globalState->codeSize(address);
+                        value.lastTouchedHeight = pindex->nHeight;
+                    }
+                    for(const dev::Address& address : resultExec[k].destroyedAccounts){
+                        auto it = findContract(address);
+                        if (it != contractIndexes.end())
+                            it->second.SetNull();
+                    }
+                }
+                timer.Lap(BlockPhase::INDEX);
             }
 
             blockGasUsed += bcer.usedGas;
@@ -3430,6 +3658,7 @@ bool CChainState::ConnectBlock(const CBlock& block, BlockValidationState& state,
                 if(re.execRes.newAddress != dev::Address() && !fJustCheck)
                     dev::g_logPost(std::string("Address : " + re.execRes.newAddress.hex()), NULL);
             }
+            timer.Lap(BlockPhase::CONTRACT_EXEC);
         }
 /////////////////////////////////////////////////////////////////////////////////////////
 
@@ -3454,6 +3683,7 @@ bool CChainState::ConnectBlock(const CBlock& block, BlockValidationState& state,
                     addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(dest.which(), uint256(addressBytes), tx.GetHash(), k), CAddressUnspentValue(out.nValue, out.scriptPubKey, pindex->nHeight, isTxCoinStake)));
                 }
             }
+            timer.Lap(BlockPhase::INDEX);
         }
         ///////////////////////////////////////////////////////////////////////////////////
 
@@ -3462,6 +3692,7 @@ bool CChainState::ConnectBlock(const CBlock& block, BlockValidationState& state,
             blockundo.vtxundo.push_back(CTxUndo());
         }
         UpdateCoins(tx, view, i == 0 ? undoDummy : blockundo.vtxundo.back(), pindex->nHeight);
+        timer.Lap(BlockPhase::INPUTS);
     }
     int64_t nTime3 = GetTimeMicros(); nTimeConnect += nTime3 - nTime2;
     LogPrint(BCLog::BENCH, "      - Connect %u transactions: %.2fms (%.3fms/tx, %.3fms/txin) [%.2fs (%.2fms/blk)]\n", (unsigned)block.vtx.size(), MILLI * (nTime3 - nTime2), MILLI * (nTime3 - nTime2) / block.vtx.size(), nInputs <= 1 ? 0 : MILLI * (nTime3 - nTime2) / (nInputs-1), nTimeConnect * MICRO, nTimeConnect * MILLI / nBlocksTotal);
@@ -3476,12 +3707,26 @@ bool CChainState::ConnectBlock(const CBlock& block, BlockValidationState& state,
         LogPrintf("ERROR: %s: CheckQueue failed\n", __func__);
         return state.Invalid(BlockValidationResult::BLOCK_CONSENSUS, "block-validation-failed");
     }
+    timer.Lap(BlockPhase::SCRIPT_CHECKS);
     int64_t nTime4 = GetTimeMicros(); nTimeVerify += nTime4 - nTime2;
     LogPrint(BCLog::BENCH, "    - Verify %u txins: %.2fms (%.3fms/txin) [%.2fs (%.2fms/blk)]\n", nInputs - 1, MILLI * (nTime4 - nTime2), nInputs <= 1 ? 0 : MILLI * (nTime4 - nTime2) / (nInputs-1), nTimeVerify * MICRO, nTimeVerify * MILLI / nBlocksTotal);
 
 ////////////////////////////////////////////////////////////////// // lux
     if(pindex->nHeight == chainparams.GetConsensus().nOfflineStakeHeight){
         globalState->deployDelegationsContract();
+        if (fContractIndex && !fJustCheck) {
+            // Deployed without a transaction
+            uint160 key = chainparams.GetConsensus().delegationsAddress;
+            CContractIndexValue value;
+            if (!contractIndexes.count(key) && !pblocktree->ReadContractIndex(key, value)) {
+                dev::Address address = uintToh160(key);
+                value.creationHeight = pindex->nHeight;
+                value.codeHash = h256Touint(globalState->codeHash(address));
+                value.codeSize = globalState->codeSize(address);
+                value.lastTouchedHeight = pindex->nHeight;
+                contractIndexes.emplace(key, value);
+            }
+        }
     }
     checkBlock.hashMerkleRoot = BlockMerkleRoot(checkBlock);
     checkBlock.hashStateRoot = h256Touint(globalState->rootHash());
@@ -3540,6 +3785,7 @@ bool CChainState::ConnectBlock(const CBlock& block, BlockValidationState& state,
 
         return state.Invalid(BlockValidationResult::BLOCK_CONSENSUS, "incorrect-transactions-or-hashes-block", "ConnectBlock(): Incorrect AAL transactions or hashes (hashStateRoot, hashUTXORoot)");
     }
+    timer.Lap(BlockPhase::CHECKS);
 
     if (fJustCheck)
     {
@@ -3579,6 +3825,11 @@ bool CChainState::ConnectBlock(const CBlock& block, BlockValidationState& state,
                 return AbortNode(state, "Failed to write height index");
         }
     }
+    if (fContractIndex)
+    {
+        if (!pblocktree->WriteContractIndex(pindex->nHeight, contractIndexes))
+            return AbortNode(state, "Failed to write contract index");
+    }
 
     // The stake and delegate index is needed for MPoS, update it while MPoS is active
     if(pindex->nHeight <= chainparams.GetConsensus().nLastMPoSBlock)
@@ -3646,12 +3897,14 @@ bool CChainState::ConnectBlock(const CBlock& block, BlockValidationState& state,
 
     int64_t nTime5 = GetTimeMicros(); nTimeIndex += nTime5 - nTime4;
     LogPrint(BCLog::BENCH, "    - Index writing: %.2fms [%.2fs (%.2fms/blk)]\n", MILLI * (nTime5 - nTime4), nTimeIndex * MICRO, nTimeIndex * MILLI / nBlocksTotal);
+    timer.Lap(BlockPhase::INDEX);
 
     int64_t nTime6 = GetTimeMicros(); nTimeCallbacks += nTime6 - nTime5;
     LogPrint(BCLog::BENCH, "    - Callbacks: %.2fms [%.2fs (%.2fms/blk)]\n", MILLI * (nTime6 - nTime5), nTimeCallbacks * MICRO, nTimeCallbacks * MILLI / nBlocksTotal);
 
     if (fLogEvents)
         pstorageresult->commitResults();
+    timer.Lap(BlockPhase::RECEIPTS);
 
     return true;
 }
@@ -4029,6 +4282,8 @@ bool CChainState::ConnectTip(BlockValidationState& state, const CChainParams& ch
     // Apply the block atomically to the chain state.
     int64_t nTime2 = GetTimeMicros(); nTimeReadFromDisk += nTime2 - nTime1;
     int64_t nTime3;
+    BlockProfile profile;
+    BlockProfile* pprofile = g_block_profiler.Enabled() ? &profile : nullptr;
     LogPrint(BCLog::BENCH, "  - Load block from disk: %.2fms [%.2fs]\n", (nTime2 - nTime1) * MILLI, nTimeReadFromDisk * MICRO);
     {
         CCoinsViewCache view(&CoinsTip());
@@ -4036,7 +4291,7 @@ bool CChainState::ConnectTip(BlockValidationState& state, const CChainParams& ch
         dev::h256 oldHashStateRoot(globalState->rootHash()); // lux
         dev::h256 oldHashUTXORoot(globalState->rootHashUTXO()); // lux
 
-        bool rv = ConnectBlock(blockConnecting, state, pindexNew, view, chainparams);
+        bool rv = ConnectBlock(blockConnecting, state, pindexNew, view, chainparams, false, pprofile);
         GetMainSignals().BlockChecked(blockConnecting, state);
         if (!rv) {
             if (state.IsInvalid())
@@ -4071,6 +4326,20 @@ bool CChainState::ConnectTip(BlockValidationState& state, const CChainParams& ch
     LogPrint(BCLog::BENCH, "  - Connect postprocess: %.2fms [%.2fs (%.2fms/blk)]\n", (nTime6 - nTime5) * MILLI, nTimePostConnect * MICRO, nTimePostConnect * MILLI / nBlocksTotal);
     LogPrint(BCLog::BENCH, "- Connect block: %.2fms [%.2fs (%.2fms/blk)]\n", (nTime6 - nTime1) * MILLI, nTimeTotal * MICRO, nTimeTotal * MILLI / nBlocksTotal);
 
+    if (pprofile) {
+        profile.hash = pindexNew->GetBlockHash();
+        profile.height = pindexNew->nHeight;
+        profile.time = GetTime();
+        profile.n_tx = blockConnecting.vtx.size();
+        for (const auto& tx : blockConnecting.vtx) profile.n_inputs += tx->vin.size();
+        profile.Add(BlockPhase::LOAD_BLOCK, nTime2 - nTime1);
+        profile.Add(BlockPhase::FLUSH, nTime4 - nTime3);
+        profile.Add(BlockPhase::CHAINSTATE, nTime5 - nTime4);
+        profile.Add(BlockPhase::POST_CONNECT, nTime6 - nTime5);
+        profile.total_us = nTime6 - nTime1;
+        g_block_profiler.Add(std::move(profile));
+    }
+
     connectTrace.BlockConnected(pindexNew, std::move(pthisBlock));
     return true;
 }
@@ -4262,14 +4531,6 @@ static bool NotifyHeaderTip() LOCKS_EXCLUDED(cs_main) {
     return fNotify;
 }
 
-static void LimitValidationInterfaceQueue() LOCKS_EXCLUDED(cs_main) {
-    AssertLockNotHeld(cs_main);
-
-    if (GetMainSignals().CallbacksPending() > 10) {
-        SyncWithValidationInterfaceQueue();
-    }
-}
-
 bool CChainState::ActivateBestChain(BlockValidationState &state, const CChainParams& chainparams, std::shared_ptr<const CBlock> pblock) {
     // Note that while we're often called here from ProcessNewBlock, this is
     // far from a guarantee. Things in the P2P/RPC will often end up calling
@@ -5056,21 +5317,14 @@ static bool CheckBlockHeader(const CBlockHeader& block, BlockValidationState& st
     return true;
 }
 
-bool CheckBlock(const CBlock& block, BlockValidationState& state, const Consensus::Params& consensusParams, bool fCheckPOW, bool fCheckMerkleRoot, bool fCheckSig)
+/**
+ * The checks of CheckBlock() that only depend on the block itself: merkle root,
+ * coinbase and coinstake layout, and the block signature. They touch no chain
+ * state, so the block import readers run them without cs_main, on blocks no
+ * other thread can see yet.
+ */
+static bool CheckBlockContextFree(const CBlock& block, BlockValidationState& state, bool fCheckMerkleRoot, bool fCheckSig)
 {
-    // These are checks that are independent of context.
-
-    if (block.fChecked)
-        return true;
-
-    // Check that the header is valid (particularly PoW).  This is mostly
-    // redundant with the call in AcceptBlockHeader.
-    if (!CheckBlockHeader(block, state, consensusParams, fCheckPOW, false, ::ChainActive().Height() + 1))
-        return false;
-
-    if (block.IsProofOfStake() &&  block.GetBlockTime() > FutureDrift(GetAdjustedTime(), ::ChainActive().Height() + 1, consensusParams))
-        return error("CheckBlock() : block timestamp too far in the future");
-
     // Check the merkle root.
     if (fCheckMerkleRoot) {
         bool mutated;
@@ -5137,6 +5391,30 @@ bool CheckBlock(const CBlock& block, BlockValidationState& state, const Consensu
     if (fCheckSig && !CheckBlockSignature(block))
         return state.Invalid(BlockValidationResult::BLOCK_CONSENSUS, "bad-blk-signature", "bad proof-of-stake block signature");
 
+    if (fCheckMerkleRoot && fCheckSig)
+        block.fCheckedContextFree = true;
+
+    return true;
+}
+
+bool CheckBlock(const CBlock& block, BlockValidationState& state, const Consensus::Params& consensusParams, bool fCheckPOW, bool fCheckMerkleRoot, bool fCheckSig)
+{
+    // These are checks that are independent of context.
+
+    if (block.fChecked)
+        return true;
+
+    // Check that the header is valid (particularly PoW).  This is mostly
+    // redundant with the call in AcceptBlockHeader.
+    if (!CheckBlockHeader(block, state, consensusParams, fCheckPOW, false, ::ChainActive().Height() + 1))
+        return false;
+
+    if (block.IsProofOfStake() &&  block.GetBlockTime() > FutureDrift(GetAdjustedTime(), ::ChainActive().Height() + 1, consensusParams))
+        return error("CheckBlock() : block timestamp too far in the future");
+
+    if (!block.fCheckedContextFree && !CheckBlockContextFree(block, state, fCheckMerkleRoot, fCheckSig))
+        return false;
+
     bool lastWasContract=false;
     // Check transactions
     // Must check for duplicate inputs (see CVE-2018-17144)
@@ -5627,6 +5905,12 @@ bool ProcessNewBlockHeaders(const std::vector<CBlockHeader>& headers, BlockValid
 /** Store block on disk. If dbp is non-nullptr, the file is known to already reside on disk */
 static FlatFilePos SaveBlockToDisk(const CBlock& block, int nHeight, const CChainParams& chainparams, const FlatFilePos* dbp) {
     unsigned int nBlockSize = ::GetSerializeSize(block, CLIENT_VERSION);
+    std::vector<unsigned char> frame;
+    if (dbp == nullptr && fBlockCompression) {
+        std::vector<unsigned char> raw;
+        CVectorWriter(SER_DISK, CLIENT_VERSION, raw, 0, block);
+        if (CompressBlockFrame(raw, frame)) nBlockSize = frame.size();
+    }
     FlatFilePos blockPos;
     if (dbp != nullptr)
         blockPos = *dbp;
@@ -5635,7 +5919,7 @@ static FlatFilePos SaveBlockToDisk(const CBlock& block, int nHeight, const CChai
         return FlatFilePos();
     }
     if (dbp == nullptr) {
-        if (!WriteBlockToDisk(block, blockPos, chainparams.MessageStart())) {
+        if (!WriteBlockToDisk(block, frame, blockPos, chainparams.MessageStart())) {
             AbortNode("Failed to write block");
             return FlatFilePos();
         }
@@ -6192,6 +6476,8 @@ bool static LoadBlockIndexDB(const CChainParams& chainparams) EXCLUSIVE_LOCKS_RE
     // Check whether we have a transaction index
     pblocktree->ReadFlag("logevents", fLogEvents);
     LogPrintf("%s: log events index %s\n", __func__, fLogEvents ? "enabled" : "disabled");
+    pblocktree->ReadFlag("contractindex", fContractIndex);
+    LogPrintf("%s: contract index %s\n", __func__, fContractIndex ? "enabled" : "disabled");
 
     return true;
 }
@@ -6361,6 +6647,198 @@ bool CVerifyDB::VerifyDB(const CChainParams& chainparams, CCoinsView *coinsview,
     return true;
 }
 
+static Mutex g_verifydb_mutex;
+static VerifyDBProgress g_verifydb_progress GUARDED_BY(g_verifydb_mutex);
+
+VerifyDBProgress GetVerifyDBProgress()
+{
+    LOCK(g_verifydb_mutex);
+    return g_verifydb_progress;
+}
+
+static bool BackgroundVerifyDBFailed(const std::string& strMessage)
+{
+    {
+        LOCK(g_verifydb_mutex);
+        g_verifydb_progress.failed = true;
+        g_verifydb_progress.finished = true;
+    }
+    AbortNode(strMessage, _("Corrupted block database detected").translated);
+    return false;
+}
+
+bool BackgroundVerifyDB(const CChainParams& chainparams, int nCheckLevel, int nCheckDepth)
+{
+    AssertLockNotHeld(cs_main);
+
+    // Snapshot the blocks to verify. Block index entries are never freed while
+    // the node runs, so the pointers stay valid after cs_main is released.
+    std::vector<CBlockIndex*> vBlocks;
+    CBlockIndex* pindexSnapshot;
+    CCoinsView* coinstip;
+    {
+        LOCK(cs_main);
+        pindexSnapshot = ::ChainActive().Tip();
+        if (pindexSnapshot == nullptr || pindexSnapshot->pprev == nullptr)
+            return true;
+        if (nCheckDepth <= 0 || nCheckDepth > pindexSnapshot->nHeight)
+            nCheckDepth = pindexSnapshot->nHeight;
+        for (CBlockIndex* pindex = pindexSnapshot; pindex && pindex->pprev && pindex->nHeight > pindexSnapshot->nHeight - nCheckDepth; pindex = pindex->pprev) {
+            if (fPruneMode && !(pindex->nStatus & BLOCK_HAVE_DATA)) {
+                // If pruning, only go back as far as we have data.
+                LogPrintf("VerifyDB(): block verification stopping at height %d (pruning, no data)\n", pindex->nHeight);
+                break;
+            }
+            vBlocks.push_back(pindex);
+        }
+        coinstip = &::ChainstateActive().CoinsTip();
+    }
+    nCheckLevel = std::max(0, std::min(4, nCheckLevel));
+
+    {
+        LOCK(g_verifydb_mutex);
+        g_verifydb_progress = VerifyDBProgress();
+        g_verifydb_progress.started = true;
+        g_verifydb_progress.check_level = nCheckLevel;
+        g_verifydb_progress.snapshot_height = pindexSnapshot->nHeight;
+        g_verifydb_progress.snapshot_hash = pindexSnapshot->GetBlockHash();
+        g_verifydb_progress.blocks_total = vBlocks.size();
+    }
+    LogPrintf("Verifying last %i blocks at level %i in the background (snapshot tip %s)\n", vBlocks.size(), nCheckLevel, pindexSnapshot->GetBlockHash().ToString());
+
+    // Level 3 and 4 checks disconnect blocks from the coins tip in memory, which
+    // is only meaningful while the tip still matches the snapshot.
+    bool fCheckDisconnect = nCheckLevel >= 3;
+    CCoinsViewCache coins(coinstip);
+    const CBlockIndex* pindexFailure = nullptr;
+    CBlockIndex* pindexLast = pindexSnapshot;
+    int nGoodTransactions = 0;
+    BlockValidationState state;
+
+    for (CBlockIndex* pindex : vBlocks) {
+        boost::this_thread::interruption_point();
+        if (ShutdownRequested())
+            return true;
+
+        CBlock block;
+        // check level 0: read from disk
+        if (!ReadBlockFromDisk(block, pindex, chainparams.GetConsensus())) {
+            LOCK(cs_main);
+            if (!(pindex->nStatus & BLOCK_HAVE_DATA)) {
+                LogPrintf("VerifyDB(): block verification stopping at height %d (pruned while verifying)\n", pindex->nHeight);
+                fCheckDisconnect = false;
+                break;
+            }
+            return BackgroundVerifyDBFailed(strprintf("VerifyDB(): *** ReadBlockFromDisk failed at %d, hash=%s", pindex->nHeight, pindex->GetBlockHash().ToString()));
+        }
+        // check level 1: verify block validity
+        if (nCheckLevel >= 1) {
+            LOCK(cs_main);
+            // Check against the block size limits at the block's height, and put the
+            // tip's limits back before other cs_main holders see them
+            uint32_t nOldMaxBlockSize = dgpMaxBlockSize; // lux
+            QtumDGP qtumDGP(globalState.get(), fGettingValuesDGP); // lux
+            uint32_t sizeBlockDGP = qtumDGP.getBlockSize(pindex->nHeight); // lux
+            updateBlockSizeParams(sizeBlockDGP ? sizeBlockDGP : dgpMaxBlockSize); // lux
+            bool fValid = CheckBlock(block, state, chainparams.GetConsensus(), false);
+            updateBlockSizeParams(nOldMaxBlockSize); // lux
+            if (!fValid)
+                return BackgroundVerifyDBFailed(strprintf("VerifyDB(): *** found bad block at %d, hash=%s (%s)", pindex->nHeight, pindex->GetBlockHash().ToString(), state.ToString()));
+        }
+        // check level 2: verify undo validity
+        if (nCheckLevel >= 2 && !pindex->GetUndoPos().IsNull()) {
+            CBlockUndo undo;
+            if (!UndoReadFromDisk(undo, pindex))
+                return BackgroundVerifyDBFailed(strprintf("VerifyDB(): *** found bad undo data at %d, hash=%s", pindex->nHeight, pindex->GetBlockHash().ToString()));
+        }
+        // check level 3: check for inconsistencies during memory-only disconnect of tip blocks
+        if (fCheckDisconnect) {
+            LOCK(cs_main);
+            if (::ChainActive().Tip() != pindexSnapshot) {
+                LogPrintf("VerifyDB(): chain tip moved away from the snapshot, skipping level 3+ checks below height %d\n", pindex->nHeight + 1);
+                fCheckDisconnect = false;
+                LOCK(g_verifydb_mutex);
+                g_verifydb_progress.level3_skipped = true;
+            } else if ((coins.DynamicMemoryUsage() + ::ChainstateActive().CoinsTip().DynamicMemoryUsage()) <= nCoinCacheUsage) {
+                assert(coins.GetBestBlock() == pindex->GetBlockHash());
+                // DisconnectBlock moves the EVM state roots, put them back for the active chain
+                dev::h256 oldHashStateRoot(globalState->rootHash()); // lux
+                dev::h256 oldHashUTXORoot(globalState->rootHashUTXO()); // lux
+                bool fClean = true;
+                DisconnectResult res = ::ChainstateActive().DisconnectBlock(block, pindex, coins, &fClean);
+                globalState->setRoot(oldHashStateRoot); // lux
+                globalState->setRootUTXO(oldHashUTXORoot); // lux
+                if (res == DISCONNECT_FAILED)
+                    return BackgroundVerifyDBFailed(strprintf("VerifyDB(): *** irrecoverable inconsistency in block data at %d, hash=%s", pindex->nHeight, pindex->GetBlockHash().ToString()));
+                if (res == DISCONNECT_UNCLEAN) {
+                    nGoodTransactions = 0;
+                    pindexFailure = pindex;
+                } else {
+                    nGoodTransactions += block.vtx.size();
+                }
+                pindexLast = pindex->pprev;
+            }
+        }
+
+        LOCK(g_verifydb_mutex);
+        g_verifydb_progress.blocks_done++;
+    }
+    if (pindexFailure)
+        return BackgroundVerifyDBFailed(strprintf("VerifyDB(): *** coin database inconsistencies found (last %i blocks, %i good transactions before that)", pindexSnapshot->nHeight - pindexFailure->nHeight + 1, nGoodTransactions));
+
+    // check level 4: try reconnecting blocks. This moves the global EVM state,
+    // so it runs as one critical section and only if the tip is still the snapshot.
+    if (fCheckDisconnect && nCheckLevel >= 4 && pindexLast != pindexSnapshot) {
+        LOCK(cs_main);
+        if (::ChainActive().Tip() != pindexSnapshot) {
+            LogPrintf("VerifyDB(): chain tip moved away from the snapshot, skipping level 4 checks\n");
+            LOCK(g_verifydb_mutex);
+            g_verifydb_progress.level3_skipped = true;
+        } else {
+            dev::h256 oldHashStateRoot(globalState->rootHash()); // lux
+            dev::h256 oldHashUTXORoot(globalState->rootHashUTXO()); // lux
+            uint32_t nOldMaxBlockSize = dgpMaxBlockSize; // lux
+            globalState->setRoot(uintToh256(pindexLast->hashStateRoot)); // lux
+            globalState->setRootUTXO(uintToh256(pindexLast->hashUTXORoot)); // lux
+
+            bool fConnected = true;
+            CBlockIndex* pindex = pindexLast;
+            while (pindex != pindexSnapshot) {
+                boost::this_thread::interruption_point();
+                pindex = ::ChainActive().Next(pindex);
+                CBlock block;
+                if (!ReadBlockFromDisk(block, pindex, chainparams.GetConsensus())) {
+                    fConnected = false;
+                    break;
+                }
+                if (!::ChainstateActive().ConnectBlock(block, state, pindex, coins, chainparams)) {
+                    fConnected = false;
+                    break;
+                }
+            }
+
+            globalState->setRoot(oldHashStateRoot); // lux
+            globalState->setRootUTXO(oldHashUTXORoot); // lux
+            dgpMaxBlockSize = nOldMaxBlockSize; // lux
+            updateBlockSizeParams(dgpMaxBlockSize); // lux
+            QtumDGP qtumDGP(globalState.get(), fGettingValuesDGP);
+            globalSealEngine->setQtumSchedule(qtumDGP.getGasSchedule(::ChainActive().Height() + (::ChainActive().Height()+1 >= chainparams.GetConsensus().QIP7Height ? 0 : 1)));
+            if (!fConnected) {
+                pstorageresult->clearCacheResult();
+                return BackgroundVerifyDBFailed(strprintf("VerifyDB(): *** found unconnectable block at %d, hash=%s (%s)", pindex->nHeight, pindex->GetBlockHash().ToString(), state.ToString()));
+            }
+        }
+    }
+
+    {
+        LOCK(g_verifydb_mutex);
+        g_verifydb_progress.finished = true;
+    }
+    LogPrintf("Background block verification done: no inconsistencies in last %i blocks (%i transactions)\n", vBlocks.size(), nGoodTransactions);
+
+    return true;
+}
+
 /** Apply the effects of a block on the utxo cache, ignoring that it may already have been applied. */
 bool CChainState::RollforwardBlock(const CBlockIndex* pindex, CCoinsViewCache& inputs, const CChainParams& params)
 {
@@ -6652,6 +7130,8 @@ bool LoadBlockIndex(const CChainParams& chainparams)
         /////////////////////////////////////////////////////////////// // lux
         fAddressIndex = gArgs.GetBoolArg("-addrindex", DEFAULT_ADDRINDEX);
         pblocktree->WriteFlag("addrindex", fAddressIndex);
+        fContractIndex = gArgs.GetBoolArg("-contractindex", DEFAULT_CONTRACTINDEX);
+        pblocktree->WriteFlag("contractindex", fContractIndex);
         ///////////////////////////////////////////////////////////////
     }
     return true;
@@ -6688,35 +7168,182 @@ bool LoadGenesisBlock(const CChainParams& chainparams)
     return ::ChainstateActive().LoadGenesisBlock(chainparams);
 }
 
-bool LoadExternalBlockFile(const CChainParams& chainparams, FILE* fileIn, FlatFilePos *dbp)
+namespace {
+
+/** A block found in an import file, deserialized and checked ahead of its acceptance */
+struct ImportedBlock {
+    std::shared_ptr<CBlock> block;
+    uint256 hash;
+    //! Position in our own block files, null for external files
+    FlatFilePos pos;
+    size_t usage{0};
+};
+
+/**
+ * Block import pipeline for -reindex and -loadblock.
+ *
+ * Reader threads each take the next file, find the blocks in it, deserialize
+ * them and run CheckBlockContextFree() on them, up to a memory budget ahead of
+ * the acceptor. The calling thread accepts the blocks strictly in file order,
+ * so the result is the same as reading the files one after the other. Blocks
+ * whose parent is not known yet are parked in memory within the same budget,
+ * and only once it is used up are they read from disk again later. Blocks of
+ * our own files still parked at the end are handed to the next import by
+ * position, as -loadblock files may hold their parents.
+ */
+class BlockImporter
 {
-    // Map of disk positions for blocks with unknown parent (only used for reindex)
-    static std::multimap<uint256, FlatFilePos> mapBlocksUnknownParent;
-    int64_t nStart = GetTimeMillis();
+public:
+    BlockImporter(const CChainParams& chainparams, const std::vector<ExternalBlockFile>& files, size_t buffer_size,
+                  std::multimap<uint256, ImportedBlock>& parked)
+        : m_chainparams(chainparams), m_files(files), m_buffer_size(buffer_size),
+          m_max_block_ser_size(WITH_LOCK(cs_main, return dgpMaxBlockSerSize)), m_queues(files.size()), m_parked(parked) {}
+    ~BlockImporter() { Stop(); }
+
+    //! Accept the blocks of all files, and return how many were loaded
+    int Run();
+
+private:
+    struct FileQueue {
+        std::deque<ImportedBlock> blocks;
+        bool done{false};
+        //! Set when accepting a block failed, the rest of the file is not imported
+        bool skip{false};
+    };
+
+    void ThreadRead(int worker_num);
+    void ReadFile(size_t index);
+    bool Push(size_t index, ImportedBlock&& imported);
+    bool Pop(ImportedBlock& imported, size_t& index);
+    //! Drop the rest of a file, as reading a single file used to stop on an error
+    void SkipFile(size_t index);
+    void Stop();
+
+    //! Accept a block and any parked descendants, false to skip the rest of its file
+    bool Accept(ImportedBlock&& imported);
+    void Park(ImportedBlock&& imported);
+
+    const CChainParams& m_chainparams;
+    const std::vector<ExternalBlockFile>& m_files;
+    const size_t m_buffer_size;
+    //! dgpMaxBlockSerSize when the import started, read once as ConnectBlock() changes it under cs_main
+    const unsigned int m_max_block_ser_size;
+
+    Mutex m_mutex;
+    std::condition_variable m_cond;
+    std::vector<FileQueue> m_queues GUARDED_BY(m_mutex);
+    //! Next file for a reader to take
+    size_t m_next_file GUARDED_BY(m_mutex){0};
+    //! File the acceptor takes blocks from
+    size_t m_current_file GUARDED_BY(m_mutex){0};
+    size_t m_queued_usage GUARDED_BY(m_mutex){0};
+    //! Only set with m_mutex held, but read without it by the readers between blocks
+    std::atomic<bool> m_stop{false};
+    std::vector<std::thread> m_threads;
+
+    // Only used by the accepting thread
+    std::multimap<uint256, ImportedBlock>& m_parked;
+    size_t m_parked_usage{0};
+    int m_loaded{0};
+};
+
+void LogImportFile(const ExternalBlockFile& file)
+{
+    if (file.pos.IsNull()) {
+        LogPrintf("Importing blocks file %s...\n", file.path.string());
+    } else {
+        LogPrintf("Reindexing block file blk%05u.dat...\n", (unsigned int)file.pos.nFile);
+    }
+}
+
+int BlockImporter::Run()
+{
+    const int threads = std::max(1, std::min({GetNumCores(), MAX_IMPORT_THREADS, (int)m_files.size()}));
+    for (int i = 0; i < threads; i++) {
+        m_threads.emplace_back(&BlockImporter::ThreadRead, this, i);
+    }
+
+    LogImportFile(m_files[0]);
+    ImportedBlock imported;
+    size_t index;
+    while (Pop(imported, index)) {
+        try {
+            if (!Accept(std::move(imported))) SkipFile(index);
+        } catch (const std::exception& e) {
+            LogPrintf("%s: Deserialize or I/O error - %s\n", __func__, e.what());
+        }
+    }
+    Stop();
+
+    // Keep only the positions of the blocks still parked, for the next import
+    for (auto it = m_parked.begin(); it != m_parked.end();) {
+        if (it->second.pos.IsNull()) {
+            it = m_parked.erase(it);
+        } else {
+            it->second.block.reset();
+            it->second.usage = 0;
+            ++it;
+        }
+    }
+    return m_loaded;
+}
+
+void BlockImporter::ThreadRead(int worker_num)
+{
+    util::ThreadRename(strprintf("loadblk.%i", worker_num));
+    ScheduleBatchPriority();
+    while (true) {
+        size_t index;
+        {
+            LOCK(m_mutex);
+            if (m_stop || m_next_file == m_files.size()) return;
+            index = m_next_file++;
+        }
+        ReadFile(index);
+        {
+            LOCK(m_mutex);
+            m_queues[index].done = true;
+        }
+        m_cond.notify_all();
+    }
+}
 
-    int nLoaded = 0;
+void BlockImporter::ReadFile(size_t index)
+{
+    const ExternalBlockFile& file = m_files[index];
+    FILE* fileIn = fsbridge::fopen(file.path, "rb");
+    if (!fileIn) {
+        LogPrintf("Warning: Could not open blocks file %s\n", file.path.string());
+        return;
+    }
+
+    // The block size limit can go up while the files ahead of the chain are read, so
+    // only reject sizes no block can have; the buffer only bounds how far we can rewind
+    const unsigned int nMaxSize = WITNESS_SCALE_FACTOR * MAX_BLOCK_SIZE_DGP;
+    const unsigned int nBufSize = m_max_block_ser_size;
     try {
         // This takes over fileIn and calls fclose() on it in the CBufferedFile destructor
-        CBufferedFile blkdat(fileIn, 2*dgpMaxBlockSerSize, dgpMaxBlockSerSize+8, SER_DISK, CLIENT_VERSION);
+        CBufferedFile blkdat(fileIn, 2*nBufSize, nBufSize+8, SER_DISK, CLIENT_VERSION);
         uint64_t nRewind = blkdat.GetPos();
-        while (!blkdat.eof()) {
-            boost::this_thread::interruption_point();
-
+        while (!blkdat.eof() && !m_stop) {
             blkdat.SetPos(nRewind);
             nRewind++; // start one byte further next time, in case of failure
             blkdat.SetLimit(); // remove former limit
             unsigned int nSize = 0;
+            bool fCompressed = false;
             try {
                 // locate a header
                 unsigned char buf[CMessageHeader::MESSAGE_START_SIZE];
-                blkdat.FindByte(chainparams.MessageStart()[0]);
+                blkdat.FindByte(m_chainparams.MessageStart()[0]);
                 nRewind = blkdat.GetPos()+1;
                 blkdat >> buf;
-                if (memcmp(buf, chainparams.MessageStart(), CMessageHeader::MESSAGE_START_SIZE))
+                if (memcmp(buf, m_chainparams.MessageStart(), CMessageHeader::MESSAGE_START_SIZE))
                     continue;
                 // read size
                 blkdat >> nSize;
-                if (nSize < 80 || nSize > dgpMaxBlockSerSize)
+                fCompressed = nSize & BLOCK_FRAME_COMPRESSED;
+                nSize &= ~BLOCK_FRAME_COMPRESSED;
+                if (nSize < (fCompressed ? BLOCK_FRAME_HEADER_SIZE : 80) || nSize > nMaxSize)
                     continue;
             } catch (const std::exception&) {
                 // no valid block header found; don't complain
@@ -6725,81 +7352,30 @@ bool LoadExternalBlockFile(const CChainParams& chainparams, FILE* fileIn, FlatFi
             try {
                 // read block
                 uint64_t nBlockPos = blkdat.GetPos();
-                if (dbp)
-                    dbp->nPos = nBlockPos;
                 blkdat.SetLimit(nBlockPos + nSize);
                 blkdat.SetPos(nBlockPos);
-                std::shared_ptr<CBlock> pblock = std::make_shared<CBlock>();
-                CBlock& block = *pblock;
-                blkdat >> block;
-                nRewind = blkdat.GetPos();
-
-                uint256 hash = block.GetHash();
-                {
-                    LOCK(cs_main);
-                    // detect out of order blocks, and store them for later
-                    if (hash != chainparams.GetConsensus().hashGenesisBlock && !LookupBlockIndex(block.hashPrevBlock)) {
-                        LogPrint(BCLog::REINDEX, "%s: Out of order block %s, parent %s not known\n", __func__, hash.ToString(),
-                                block.hashPrevBlock.ToString());
-                        if (dbp)
-                            mapBlocksUnknownParent.insert(std::make_pair(block.hashPrevBlock, *dbp));
-                        continue;
-                    }
-
-                    // process in case the block isn't known yet
-                    CBlockIndex* pindex = LookupBlockIndex(hash);
-                    if (!pindex || (pindex->nStatus & BLOCK_HAVE_DATA) == 0) {
-                      BlockValidationState state;
-                      if (::ChainstateActive().AcceptBlock(pblock, state, chainparams, nullptr, true, dbp, nullptr)) {
-                          nLoaded++;
-                      }
-                      if (state.IsError()) {
-                          break;
-                      }
-                    } else if (hash != chainparams.GetConsensus().hashGenesisBlock && pindex->nHeight % 1000 == 0) {
-                      LogPrint(BCLog::REINDEX, "Block Import: already had block %s at height %d\n", hash.ToString(), pindex->nHeight);
+                ImportedBlock imported;
+                imported.block = std::make_shared<CBlock>();
+                if (fCompressed) {
+                    std::vector<unsigned char> frame(nSize), raw;
+                    blkdat.read((char*)frame.data(), nSize);
+                    if (!DecompressBlockFrame(frame, raw)) {
+                        throw std::ios_base::failure("corrupt compressed frame");
                     }
+                    VectorReader(SER_DISK, CLIENT_VERSION, raw, 0) >> *imported.block;
+                } else {
+                    blkdat >> *imported.block;
                 }
+                nRewind = blkdat.GetPos();
 
-                // In Bitcoin this only needed to be done for genesis and at the end of block indexing
-                // But for Qtum PoS we need to sync this after every block to ensure txdb is populated for
-                // validating PoS proofs
-                {
-                    BlockValidationState state;
-                    if (!ActivateBestChain(state, chainparams)) {
-                        break;
-                    }
-                }
+                imported.hash = imported.block->GetHash();
+                if (!file.pos.IsNull()) imported.pos = FlatFilePos(file.pos.nFile, nBlockPos);
+                imported.usage = sizeof(CBlock) + RecursiveDynamicUsage(*imported.block);
 
-                NotifyHeaderTip();
-
-                // Recursively process earlier encountered successors of this block
-                std::deque<uint256> queue;
-                queue.push_back(hash);
-                while (!queue.empty()) {
-                    uint256 head = queue.front();
-                    queue.pop_front();
-                    std::pair<std::multimap<uint256, FlatFilePos>::iterator, std::multimap<uint256, FlatFilePos>::iterator> range = mapBlocksUnknownParent.equal_range(head);
-                    while (range.first != range.second) {
-                        std::multimap<uint256, FlatFilePos>::iterator it = range.first;
-                        std::shared_ptr<CBlock> pblockrecursive = std::make_shared<CBlock>();
-                        if (ReadBlockFromDisk(*pblockrecursive, it->second, chainparams.GetConsensus()))
-                        {
-                            LogPrint(BCLog::REINDEX, "%s: Processing out of order child %s of %s\n", __func__, pblockrecursive->GetHash().ToString(),
-                                    head.ToString());
-                            LOCK(cs_main);
-                            BlockValidationState dummy;
-                            if (::ChainstateActive().AcceptBlock(pblockrecursive, dummy, chainparams, nullptr, true, &it->second, nullptr))
-                            {
-                                nLoaded++;
-                                queue.push_back(pblockrecursive->GetHash());
-                            }
-                        }
-                        range.first++;
-                        mapBlocksUnknownParent.erase(it);
-                        NotifyHeaderTip();
-                    }
-                }
+                // Blocks failing the checks are still passed on, for AcceptBlock() to reject them
+                BlockValidationState state;
+                CheckBlockContextFree(*imported.block, state, true, true);
+                if (!Push(index, std::move(imported))) break;
             } catch (const std::exception& e) {
                 LogPrintf("%s: Deserialize or I/O error - %s\n", __func__, e.what());
             }
@@ -6807,8 +7383,182 @@ bool LoadExternalBlockFile(const CChainParams& chainparams, FILE* fileIn, FlatFi
     } catch (const std::runtime_error& e) {
         AbortNode(std::string("System error: ") + e.what());
     }
+}
+
+bool BlockImporter::Push(size_t index, ImportedBlock&& imported)
+{
+    WAIT_LOCK(m_mutex, lock);
+    // The acceptor drains a non-empty queue of the current file, but may be waiting on an empty one
+    while (!m_stop && !m_queues[index].skip && m_queued_usage + imported.usage > m_buffer_size &&
+           (index != m_current_file || !m_queues[index].blocks.empty())) {
+        m_cond.wait(lock);
+    }
+    if (m_stop || m_queues[index].skip) return false;
+    m_queued_usage += imported.usage;
+    m_queues[index].blocks.push_back(std::move(imported));
+    m_cond.notify_all();
+    return true;
+}
+
+bool BlockImporter::Pop(ImportedBlock& imported, size_t& index)
+{
+    WAIT_LOCK(m_mutex, lock);
+    while (m_current_file < m_queues.size()) {
+        FileQueue& queue = m_queues[m_current_file];
+        if (!queue.blocks.empty()) {
+            imported = std::move(queue.blocks.front());
+            queue.blocks.pop_front();
+            m_queued_usage -= imported.usage;
+            index = m_current_file;
+            m_cond.notify_all();
+            return true;
+        }
+        if (queue.done) {
+            // The reader of the next file may be waiting for memory
+            if (++m_current_file < m_queues.size()) LogImportFile(m_files[m_current_file]);
+            m_cond.notify_all();
+            continue;
+        }
+        m_cond.wait_for(lock, std::chrono::milliseconds(100));
+        boost::this_thread::interruption_point();
+    }
+    return false;
+}
+
+void BlockImporter::SkipFile(size_t index)
+{
+    {
+        LOCK(m_mutex);
+        FileQueue& queue = m_queues[index];
+        queue.skip = true;
+        for (const ImportedBlock& imported : queue.blocks) {
+            m_queued_usage -= imported.usage;
+        }
+        queue.blocks.clear();
+    }
+    m_cond.notify_all();
+}
+
+void BlockImporter::Stop()
+{
+    {
+        LOCK(m_mutex);
+        m_stop = true;
+    }
+    m_cond.notify_all();
+    for (std::thread& thread : m_threads) {
+        thread.join();
+    }
+    m_threads.clear();
+}
+
+bool BlockImporter::Accept(ImportedBlock&& imported)
+{
+    boost::this_thread::interruption_point();
+
+    const uint256 hash = imported.hash;
+    {
+        LOCK(cs_main);
+        // detect out of order blocks, and park them until their parent is known
+        if (hash != m_chainparams.GetConsensus().hashGenesisBlock && !LookupBlockIndex(imported.block->hashPrevBlock)) {
+            LogPrint(BCLog::REINDEX, "%s: Out of order block %s, parent %s not known\n", __func__, hash.ToString(),
+                    imported.block->hashPrevBlock.ToString());
+            Park(std::move(imported));
+            return true;
+        }
+
+        // process in case the block isn't known yet
+        CBlockIndex* pindex = LookupBlockIndex(hash);
+        if (!pindex || (pindex->nStatus & BLOCK_HAVE_DATA) == 0) {
+          BlockValidationState state;
+          if (::ChainstateActive().AcceptBlock(imported.block, state, m_chainparams, nullptr, true, imported.pos.IsNull() ? nullptr : &imported.pos, nullptr)) {
+              m_loaded++;
+          }
+          if (state.IsError()) {
+              return false;
+          }
+        } else if (hash != m_chainparams.GetConsensus().hashGenesisBlock && pindex->nHeight % 1000 == 0) {
+          LogPrint(BCLog::REINDEX, "Block Import: already had block %s at height %d\n", hash.ToString(), pindex->nHeight);
+        }
+    }
+
+    // In Bitcoin this only needed to be done for genesis and at the end of block indexing
+    // But for Qtum PoS we need to sync this after every block to ensure txdb is populated for
+    // validating PoS proofs
+    {
+        BlockValidationState state;
+        if (!ActivateBestChain(state, m_chainparams)) {
+            return false;
+        }
+    }
+
+    NotifyHeaderTip();
+
+    // Recursively process earlier encountered successors of this block
+    std::deque<uint256> queue;
+    queue.push_back(hash);
+    while (!queue.empty()) {
+        uint256 head = queue.front();
+        queue.pop_front();
+        std::pair<std::multimap<uint256, ImportedBlock>::iterator, std::multimap<uint256, ImportedBlock>::iterator> range = m_parked.equal_range(head);
+        while (range.first != range.second) {
+            std::multimap<uint256, ImportedBlock>::iterator it = range.first;
+            ImportedBlock& child = it->second;
+            if (child.block) {
+                m_parked_usage -= child.usage;
+            } else {
+                // Parked by position only, once the buffer was full
+                child.block = std::make_shared<CBlock>();
+                if (!ReadBlockFromDisk(*child.block, child.pos, m_chainparams.GetConsensus())) child.block.reset();
+            }
+            if (child.block) {
+                LogPrint(BCLog::REINDEX, "%s: Processing out of order child %s of %s\n", __func__, child.hash.ToString(),
+                        head.ToString());
+                LOCK(cs_main);
+                BlockValidationState dummy;
+                if (::ChainstateActive().AcceptBlock(child.block, dummy, m_chainparams, nullptr, true, child.pos.IsNull() ? nullptr : &child.pos, nullptr))
+                {
+                    m_loaded++;
+                    queue.push_back(child.hash);
+                }
+            }
+            range.first++;
+            m_parked.erase(it);
+            NotifyHeaderTip();
+        }
+    }
+    return true;
+}
+
+void BlockImporter::Park(ImportedBlock&& imported)
+{
+    const uint256 parent = imported.block->hashPrevBlock;
+    if (m_parked_usage + imported.usage <= m_buffer_size) {
+        m_parked_usage += imported.usage;
+    } else if (!imported.pos.IsNull()) {
+        // Keep the position only, and read the block again once its parent is accepted
+        imported.block.reset();
+    } else {
+        LogPrint(BCLog::REINDEX, "%s: Out of order block %s dropped, import buffer full\n", __func__, imported.hash.ToString());
+        return;
+    }
+    m_parked.emplace(parent, std::move(imported));
+}
+
+} // namespace
+
+bool LoadExternalBlockFiles(const CChainParams& chainparams, const std::vector<ExternalBlockFile>& files, size_t buffer_size)
+{
+    if (files.empty()) return false;
+    int64_t nStart = GetTimeMillis();
+
+    // Blocks with unknown parent, by position in our own block files, kept from
+    // the -reindex pass for the -loadblock files
+    static std::multimap<uint256, ImportedBlock> blocks_unknown_parent;
+
+    int nLoaded = BlockImporter(chainparams, files, buffer_size, blocks_unknown_parent).Run();
     if (nLoaded > 0)
-        LogPrintf("Loaded %i blocks from external file in %dms\n", nLoaded, GetTimeMillis() - nStart);
+        LogPrintf("Loaded %i blocks from %u external files in %dms\n", nLoaded, files.size(), GetTimeMillis() - nStart);
     return nLoaded > 0;
 }
 
@@ -7111,6 +7861,8 @@ bool LoadMempool(CTxMemPool& pool)
             }
             TxValidationState state;
             if (nTime + nExpiryTimeout > nNow) {
+                // Every accepted transaction is queued for each subscriber
+                LimitValidationInterfaceQueue();
                 LOCK(cs_main);
                 AcceptToMemoryPoolWithTime(chainparams, pool, state, tx, nTime,
                                            nullptr /* plTxnReplaced */, false /* bypass_limits */, 0 /* nAbsurdFee */,
@@ -7202,6 +7954,170 @@ bool DumpMempool(const CTxMemPool& pool)
     return true;
 }
 
+static const uint64_t VALIDATION_CACHE_DUMP_VERSION = 1;
+
+static void ReadCacheEntries(CHashVerifier<CAutoFile>& verifier, size_t capacity, std::vector<uint256>& entries)
+{
+    // Entries are stored most recent first: keep those that fit, but read all
+    // of them for the checksum
+    uint64_t count = ReadCompactSize(verifier);
+    entries.reserve(std::min<uint64_t>(count, capacity));
+    uint256 entry;
+    for (uint64_t i = 0; i < count; ++i) {
+        verifier >> entry;
+        if (entries.size() < capacity) {
+            entries.push_back(entry);
+        }
+    }
+}
+
+bool LoadValidationCaches()
+{
+    FILE* filestr = fsbridge::fopen(GetDataDir() / "sigcache.dat", "rb");
+    CAutoFile file(filestr, SER_DISK, CLIENT_VERSION);
+    if (file.IsNull()) {
+        LogPrintf("Failed to open signature cache file from disk. Continuing anyway.\n");
+        return false;
+    }
+
+    uint256 sigNonce, scriptNonce;
+    std::vector<uint256> sigEntries, scriptEntries;
+    try {
+        CHashVerifier<CAutoFile> verifier(&file);
+        uint64_t version;
+        verifier >> version;
+        if (version != VALIDATION_CACHE_DUMP_VERSION) {
+            return false;
+        }
+        verifier >> sigNonce;
+        ReadCacheEntries(verifier, GetSignatureCacheCapacity(), sigEntries);
+        verifier >> scriptNonce;
+        ReadCacheEntries(verifier, scriptExecutionCacheCapacity, scriptEntries);
+
+        uint256 hashTmp;
+        file >> hashTmp;
+        if (hashTmp != verifier.GetHash()) {
+            LogPrintf("Signature cache file checksum mismatch, data corrupted. Continuing anyway.\n");
+            return false;
+        }
+    } catch (const std::exception& e) {
+        LogPrintf("Failed to deserialize signature cache data on disk: %s. Continuing anyway.\n", e.what());
+        return false;
+    }
+
+    LoadSignatureCacheEntries(sigNonce, sigEntries);
+    {
+        LOCK(cs_main);
+        scriptExecutionCacheNonce = scriptNonce;
+        for (auto it = scriptEntries.rbegin(); it != scriptEntries.rend(); ++it) {
+            scriptExecutionCache.insert(*it);
+        }
+    }
+
+    LogPrintf("Imported validation caches from disk: %u signature cache entries, %u script execution cache entries\n", sigEntries.size(), scriptEntries.size());
+    return true;
+}
+
+bool DumpValidationCaches()
+{
+    int64_t start = GetTimeMicros();
+
+    uint256 sigNonce, scriptNonce;
+    std::vector<uint256> sigEntries, scriptEntries;
+    GetSignatureCacheEntries(sigNonce, sigEntries);
+    {
+        LOCK(cs_main);
+        scriptNonce = scriptExecutionCacheNonce;
+        scriptExecutionCache.get_elements(scriptEntries);
+    }
+
+    try {
+        FILE* filestr = fsbridge::fopen(GetDataDir() / "sigcache.dat.new", "wb");
+        if (!filestr) {
+            return false;
+        }
+
+        CAutoFile file(filestr, SER_DISK, CLIENT_VERSION);
+        CHashWriter hasher(SER_DISK, CLIENT_VERSION);
+
+        uint64_t version = VALIDATION_CACHE_DUMP_VERSION;
+        file << version << sigNonce << sigEntries << scriptNonce << scriptEntries;
+        hasher << version << sigNonce << sigEntries << scriptNonce << scriptEntries;
+        file << hasher.GetHash();
+
+        if (!FileCommit(file.Get()))
+            throw std::runtime_error("FileCommit failed");
+        file.fclose();
+        RenameOver(GetDataDir() / "sigcache.dat.new", GetDataDir() / "sigcache.dat");
+        LogPrintf("Dumped validation caches: %u signature cache entries, %u script execution cache entries, %gs\n", sigEntries.size(), scriptEntries.size(), (GetTimeMicros() - start) * MICRO);
+    } catch (const std::exception& e) {
+        LogPrintf("Failed to dump validation caches: %s. Continuing anyway.\n", e.what());
+        return false;
+    }
+    return true;
+}
+
+int GetLogEventsPruneHeight()
+{
+    AssertLockHeld(cs_main);
+    return fLogEvents ? (int)pblocktree->ReadHeightIndexPruned() : 0;
+}
+
+void PruneLogEvents(int64_t max_time_micros)
+{
+    if (!fLogEvents || (nLogEventsRetain <= 0 && nLogEventsRetainHeight <= 0)) return;
+
+    const int64_t start = GetTimeMicros();
+    while (!ShutdownRequested() && GetTimeMicros() - start < max_time_micros) {
+        int low, high;
+        std::vector<const CBlockIndex*> blocks;
+        {
+            LOCK(cs_main);
+            const int tip_height = ::ChainActive().Height();
+            int target = nLogEventsRetainHeight;
+            if (nLogEventsRetain > 0) {
+                target = std::max(target, tip_height - nLogEventsRetain + 1);
+            }
+            target = std::min(target, tip_height - (int)MIN_BLOCKS_TO_KEEP);
+
+            low = GetLogEventsPruneHeight();
+            high = std::min(target, low + LOGEVENTS_PRUNE_BATCH);
+            if (high <= low) return;
+            for (int height = low; height < high; height++) {
+                const CBlockIndex* pindex = ::ChainActive()[height];
+                if (pindex->nStatus & BLOCK_HAVE_DATA) blocks.push_back(pindex);
+            }
+        }
+
+        // Every contract transaction has a receipt, but the log events index
+        // only lists those with logs, so the receipts are found from the blocks
+        std::set<uint256> hashes;
+        for (const CBlockIndex* pindex : blocks) {
+            CBlock block;
+            if (!ReadBlockFromDisk(block, pindex, Params().GetConsensus())) continue;
+            for (const CTransactionRef& tx : block.vtx) {
+                if (tx->HasCreateOrCall()) hashes.insert(tx->GetHash());
+            }
+        }
+
+        LOCK(cs_main);
+        // Blocks pruned from disk are only known through the index
+        std::vector<std::vector<uint256>> blocksOfHashes;
+        pblocktree->ReadHeightIndex(low, high - 1, 0, blocksOfHashes, std::set<dev::h160>());
+        for (const std::vector<uint256>& blockHashes : blocksOfHashes) {
+            hashes.insert(blockHashes.begin(), blockHashes.end());
+        }
+
+        // Receipts go first: if interrupted, the batch is redone on the next run
+        pstorageresult->deleteResults(std::vector<uint256>(hashes.begin(), hashes.end()));
+        if (!pblocktree->PruneHeightIndex(low, high)) {
+            LogPrintf("%s: failed to prune the log events index at height %d\n", __func__, low);
+            return;
+        }
+        LogPrint(BCLog::PRUNE, "Pruned receipts and log events of blocks %d to %d (%u transactions)\n", low, high - 1, hashes.size());
+    }
+}
+
 //! Guess how far we are in the verification process at the given block index
 //! require cs_main if pindex has not been validated yet (because nChainTx might be unset)
 double GuessVerificationProgress(const ChainTxData& data, const CBlockIndex *pindex) {
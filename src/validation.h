@@ -13,6 +13,7 @@
 #include <amount.h>
 #include <coins.h>
 #include <crypto/common.h> // for ReadLE64
+#include <flatfile.h>
 #include <fs.h>
 #include <policy/feerate.h>
 #include <protocol.h> // For CMessageHeader::MessageStartChars
@@ -24,6 +25,7 @@
 #include <serialize.h>
 
 #include <atomic>
+#include <chrono>
 #include <map>
 #include <memory>
 #include <set>
@@ -75,6 +77,7 @@ struct ChainTxData;
 struct DisconnectedBlockTransactions;
 struct PrecomputedTransactionData;
 struct LockPoints;
+struct BlockProfile;
 
 /** Minimum gas limit that is allowed in a transaction within a block - prevent various types of tx and mempool spam **/
 static const uint64_t MINIMUM_GAS_LIMIT = 10000;
@@ -144,10 +147,31 @@ static const int64_t DEFAULT_MAX_TIP_AGE = 12 * 60 * 60; //Changed to 12 hours s
 /** Maximum age of our tip in seconds for us to be considered current for fee estimation */
 static const int64_t MAX_FEE_ESTIMATION_TIP_AGE = 3 * 60 * 60;
 
+/** Default for -importbuffer, in MiB */
+static const int64_t DEFAULT_IMPORT_BUFFER = 256;
+/** Maximum number of threads reading block files for -reindex and -loadblock */
+static const int MAX_IMPORT_THREADS = 4;
+/** Default for -blockcompression */
+static const bool DEFAULT_BLOCK_COMPRESSION = false;
+/** Set in the size field of a block or undo record that holds a compressed frame */
+static const unsigned int BLOCK_FRAME_COMPRESSED = 0x80000000;
+/** Size of the frame header: the uncompressed size as uint32 and the codec as uint8 */
+static const unsigned int BLOCK_FRAME_HEADER_SIZE = 5;
+/** Records larger than this are never compressed, which bounds what a frame can decompress to */
+static const unsigned int MAX_BLOCK_FRAME_RAW_SIZE = MAX_BLOCKFILE_SIZE;
 static const bool DEFAULT_CHECKPOINTS_ENABLED = true;
 static const bool DEFAULT_TXINDEX = false;
 static const bool DEFAULT_ADDRINDEX = false;
 static const bool DEFAULT_LOGEVENTS = false;
+/** Default for -logeventsretain, 0 keeps the receipts and log events of all blocks */
+static const int DEFAULT_LOGEVENTS_RETAIN = 0;
+/** Number of blocks whose receipts and log events are deleted per batch */
+static const int LOGEVENTS_PRUNE_BATCH = 1000;
+/** Time spent deleting receipts and log events per run of the background pruner */
+static const int64_t LOGEVENTS_PRUNE_TIME_MICROS = 1000000;
+/** Interval between runs of the background receipt and log events pruner */
+static constexpr std::chrono::seconds LOGEVENTS_PRUNE_INTERVAL{10};
+static const bool DEFAULT_CONTRACTINDEX = false;
 static const char* const DEFAULT_BLOCKFILTERINDEX = "0";
 static const unsigned int DEFAULT_BANSCORE_THRESHOLD = 100;
 /** Default for -persistmempool */
@@ -200,9 +224,16 @@ extern std::atomic_bool fReindex;
 extern bool g_parallel_script_checks;
 extern bool fAddressIndex;
 extern bool fLogEvents;
+/** Number of most recent blocks whose receipts and log events are kept, 0 = all */
+extern int nLogEventsRetain;
+/** Height below which receipts and log events are deleted, 0 = none */
+extern int nLogEventsRetainHeight;
+extern bool fContractIndex;
 extern bool fRequireStandard;
 extern bool fCheckBlockIndex;
 extern bool fCheckpointsEnabled;
+/** Whether new block and undo records are written compressed (-blockcompression) */
+extern bool fBlockCompression;
 extern size_t nCoinCacheUsage;
 /** A fee rate smaller than this is considered zero fee (for relaying, mining and transaction creation) */
 extern CFeeRate minRelayTxFee;
@@ -232,6 +263,8 @@ static const unsigned int NODE_NETWORK_LIMITED_MIN_BLOCKS = 288;
 
 static const signed int DEFAULT_CHECKBLOCKS = 6;
 static const unsigned int DEFAULT_CHECKLEVEL = 3;
+/** Default for -backgroundverifydb */
+static const bool DEFAULT_BACKGROUND_VERIFYDB = true;
 
 // Require that user allocate at least 550 MiB for block & undo files (blk???.dat and rev???.dat)
 // At 1MB per block, 288 blocks = 288MB.
@@ -284,8 +317,18 @@ bool ProcessNewBlockHeaders(const std::vector<CBlockHeader>& block, BlockValidat
 FILE* OpenBlockFile(const FlatFilePos &pos, bool fReadOnly = false);
 /** Translation to a filesystem path */
 fs::path GetBlockPosFilename(const FlatFilePos &pos);
-/** Import blocks from an external file */
-bool LoadExternalBlockFile(const CChainParams& chainparams, FILE* fileIn, FlatFilePos *dbp = nullptr);
+/** A block file to import: one of our own blk?????.dat files when reindexing, or an external one */
+struct ExternalBlockFile {
+    fs::path path;
+    //! Start of the file among our own block files, null for external files
+    FlatFilePos pos;
+};
+/**
+ * Import blocks from a list of block files. Reader threads find, deserialize
+ * and run the context-free checks on the blocks of the next files, up to
+ * buffer_size bytes ahead, while the calling thread accepts them in file order.
+ */
+bool LoadExternalBlockFiles(const CChainParams& chainparams, const std::vector<ExternalBlockFile>& files, size_t buffer_size);
 /** Ensures we have a genesis block in the block tree, possibly writing one to disk. */
 bool LoadGenesisBlock(const CChainParams& chainparams);
 /** Load the block tree and coins database from disk,
@@ -419,6 +462,8 @@ public:
 
 /** Initializes the script-execution cache */
 void InitScriptExecutionCache();
+/** Number of entries the script-execution cache can hold */
+size_t GetScriptExecutionCacheCapacity();
 
 ///////////////////////////////////////////////////////////////// // lux
 bool GetAddressIndex(uint256 addressHash, int type,
@@ -447,6 +492,20 @@ bool ReadRawBlockFromDisk(std::vector<uint8_t>& block, const CBlockIndex* pindex
 
 bool UndoReadFromDisk(CBlockUndo& blockundo, const CBlockIndex* pindex);
 
+/**
+ * A compressed block or undo record keeps the message start and size header
+ * of a raw one, with BLOCK_FRAME_COMPRESSED set in the size, which is then the
+ * size of the frame: the uncompressed size, the codec, and the compressed
+ * data. Records are only compressed when that saves space, so a file can mix
+ * both kinds, and files written without -blockcompression read as before.
+ * ReadBlockFromDisk(), ReadRawBlockFromDisk() and UndoReadFromDisk() handle
+ * both kinds.
+ *
+ * CompressBlockFrame() returns false if the record should be stored raw.
+ */
+bool CompressBlockFrame(const std::vector<unsigned char>& raw, std::vector<unsigned char>& frame);
+bool DecompressBlockFrame(const std::vector<unsigned char>& frame, std::vector<unsigned char>& raw);
+
 /** Functions for validating blocks and updating the block tree */
 
 /** Context-independent validity checks */
@@ -483,6 +542,36 @@ public:
     bool VerifyDB(const CChainParams& chainparams, CCoinsView *coinsview, int nCheckLevel, int nCheckDepth);
 };
 
+/** Progress of the startup block database verification when it runs in the background */
+struct VerifyDBProgress
+{
+    bool started{false};
+    bool finished{false};
+    bool failed{false};
+    int check_level{0};
+    /** Height of the chain tip the verification snapshot was taken at */
+    int snapshot_height{-1};
+    uint256 snapshot_hash;
+    int blocks_total{0};
+    int blocks_done{0};
+    /** Set once the tip moved away from the snapshot and level 3+ checks were skipped */
+    bool level3_skipped{false};
+
+    double Progress() const { return blocks_total > 0 ? (double)blocks_done / blocks_total : (finished ? 1.0 : 0.0); }
+};
+
+/**
+ * Verify the last nCheckDepth blocks of the active chain without blocking validation.
+ * Blocks are taken from a snapshot of the chain tip; cs_main is only held for the
+ * individual steps that need it. Level 3 and 4 checks are run against the snapshot
+ * only for as long as the tip does not move. Corruption aborts the node.
+ * Returns false if corruption was detected.
+ */
+bool BackgroundVerifyDB(const CChainParams& chainparams, int nCheckLevel, int nCheckDepth) LOCKS_EXCLUDED(cs_main);
+
+/** Return the progress of the background block database verification */
+VerifyDBProgress GetVerifyDBProgress();
+
 CBlockIndex* LookupBlockIndex(const uint256& hash) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 
 extern std::unique_ptr<StorageResults> pstorageresult;
@@ -510,6 +599,19 @@ void writeVMlog(const std::vector<ResultExecute>& res, const CTransaction& tx =
 
 std::string exceptedMessage(const dev::eth::TransactionException& excepted, const dev::bytes& output);
 
+/** Lowest block height whose receipts and log events are stored */
+int GetLogEventsPruneHeight() EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+
+/**
+ * Delete the receipts and log events of the blocks below the window kept by
+ * -logeventsretain and -logeventsretainheight, LOGEVENTS_PRUNE_BATCH blocks at
+ * a time until caught up or max_time_micros has passed. cs_main is not held
+ * while a batch's blocks are read for their contract transactions, and blocks
+ * within MIN_BLOCKS_TO_KEEP of the tip are never pruned so that disconnecting
+ * them still finds their receipts.
+ */
+void PruneLogEvents(int64_t max_time_micros);
+
 struct EthTransactionParams{
     VersionVM version;
     dev::u256 gasLimit;
@@ -580,7 +682,8 @@ class ByteCodeExec {
 
 public:
 
-    ByteCodeExec(const CBlock& _block, std::vector<QtumTransaction> _txs, const uint64_t _blockGasLimit, CBlockIndex* _pindex) : txs(_txs), block(_block), blockGasLimit(_blockGasLimit), pindex(_pindex) {}
+    /** _profile lets g_contract_profiler sample the executions, only set where they are not run again (connecting a block, callcontract) */
+    ByteCodeExec(const CBlock& _block, std::vector<QtumTransaction> _txs, const uint64_t _blockGasLimit, CBlockIndex* _pindex, bool _profile = false) : txs(_txs), block(_block), blockGasLimit(_blockGasLimit), pindex(_pindex), fProfile(_profile) {}
 
     bool performByteCode(dev::eth::Permanence type = dev::eth::Permanence::Committed);
 
@@ -588,6 +691,10 @@ public:
 
     std::vector<ResultExecute>& getResult(){ return result; }
 
+    /** Time spent in the last performByteCode, executing and committing the state tries */
+    int64_t getExecTime() const { return nTimeExec; }
+    int64_t getCommitTime() const { return nTimeCommit; }
+
 private:
 
     dev::eth::EnvInfo BuildEVMEnvironment();
@@ -604,7 +711,13 @@ private:
 
     CBlockIndex* pindex;
 
+    const bool fProfile;
+
     LastHashes lastHashes;
+
+    int64_t nTimeExec = 0;
+
+    int64_t nTimeCommit = 0;
 };
 
 /** Find the last common block between the parameter chain and a locator. */
@@ -909,7 +1022,7 @@ public:
     // Block (dis)connection on a given view:
     DisconnectResult DisconnectBlock(const CBlock& block, const CBlockIndex* pindex, CCoinsViewCache& view, bool* pfClean);
     bool ConnectBlock(const CBlock& block, BlockValidationState& state, CBlockIndex* pindex,
-                      CCoinsViewCache& view, const CChainParams& chainparams, bool fJustCheck = false) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+                      CCoinsViewCache& view, const CChainParams& chainparams, bool fJustCheck = false, BlockProfile* profile = nullptr) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
     bool UpdateHashProof(const CBlock& block, BlockValidationState& state, const Consensus::Params& consensusParams, CBlockIndex* pindex, CCoinsViewCache& view);
 
     // Apply the effects of a block disconnection on the UTXO set.
@@ -1022,6 +1135,12 @@ bool DumpMempool(const CTxMemPool& pool);
 /** Load the mempool from disk. */
 bool LoadMempool(CTxMemPool& pool);
 
+/** Dump the signature and script execution caches to disk. */
+bool DumpValidationCaches();
+
+/** Load the signature and script execution caches from disk. Must be called before any validation. */
+bool LoadValidationCaches();
+
 //! Check whether the block associated with this index entry is pruned or not.
 inline bool IsBlockPruned(const CBlockIndex* pblockindex)
 {
@@ -11,43 +11,243 @@
 #include <primitives/block.h>
 #include <primitives/transaction.h>
 #include <scheduler.h>
+#include <util/time.h>
 
+#include <atomic>
+#include <condition_variable>
+#include <deque>
 #include <future>
+#include <list>
 #include <unordered_map>
 #include <utility>
 
-//! The MainSignalsInstance manages a list of shared_ptr<CValidationInterface>
-//! callbacks.
+//! SubscriberQueue is the serial executor of a single subscriber.
+//!
+//! Callbacks are run on the CScheduler threads, one at a time and in the
+//! order they were enqueued, so a subscriber still sees its callbacks as if
+//! they ran on a single thread. Queues of different subscribers are
+//! independent and run in parallel when the scheduler has several threads.
+//!
+//! Queued callbacks receive the subscriber, or nullptr once it has been
+//! unregistered. The subscriber's shared_ptr is released as soon as it is
+//! unregistered and not executing, even if callbacks are still queued.
+//!
+//! A lossy queue drops droppable callbacks while it is above
+//! MAX_PENDING_VALIDATION_CALLBACKS, the others wake up producers waiting in
+//! WaitForSpace() as they shrink back below it.
+class SubscriberQueue : public std::enable_shared_from_this<SubscriberQueue>
+{
+public:
+    using Callback = std::function<void (CValidationInterface*)>;
+
+    SubscriberQueue(CScheduler* pscheduler, std::shared_ptr<CValidationInterface> callbacks, std::string name, bool lossy)
+        : m_pscheduler(pscheduler), m_name(std::move(name)), m_lossy(lossy), m_callbacks(std::move(callbacks)) {}
+
+    bool IsLossy() const { return m_lossy; }
+
+    void Add(Callback func, bool droppable = false)
+    {
+        bool schedule = false;
+        {
+            LOCK(m_mutex);
+            if (m_lossy && droppable && m_pending.size() >= MAX_PENDING_VALIDATION_CALLBACKS) {
+                ++m_dropped;
+                return;
+            }
+            m_pending.emplace_back(std::move(func));
+            m_max_pending = std::max(m_max_pending, m_pending.size());
+            if (m_pending.size() > MAX_PENDING_VALIDATION_CALLBACKS) ++m_over_limit;
+            if (!m_scheduled) schedule = m_scheduled = true;
+        }
+        if (schedule) Schedule();
+    }
+
+    //! Run the oldest pending callback, then reschedule if more are waiting
+    void Process()
+    {
+        Callback callback;
+        std::shared_ptr<CValidationInterface> callbacks;
+        {
+            LOCK(m_mutex);
+            if (m_pending.empty()) {
+                m_scheduled = false;
+                return;
+            }
+            callback = std::move(m_pending.front());
+            m_pending.pop_front();
+            callbacks = m_callbacks;
+        }
+        m_space.notify_all();
+
+        // RAII the rescheduling to ensure it happens even if callback() throws.
+        struct RAIIReschedule {
+            SubscriberQueue* instance;
+            int64_t start{GetTimeMicros()};
+            explicit RAIIReschedule(SubscriberQueue* _instance) : instance(_instance) {}
+            ~RAIIReschedule() {
+                bool schedule;
+                {
+                    LOCK(instance->m_mutex);
+                    ++instance->m_processed;
+                    instance->m_exec_time_us += GetTimeMicros() - start;
+                    schedule = instance->m_scheduled = !instance->m_pending.empty();
+                }
+                if (schedule) instance->Schedule();
+            }
+        } raiireschedule(this);
+
+        callback(callbacks.get());
+    }
+
+    //! Process all pending callbacks on the calling thread
+    void EmptyQueue()
+    {
+        assert(!m_pscheduler->AreThreadsServicingQueue());
+        while (true) {
+            Callback callback;
+            std::shared_ptr<CValidationInterface> callbacks;
+            {
+                LOCK(m_mutex);
+                if (m_pending.empty()) {
+                    m_scheduled = false;
+                    return;
+                }
+                callback = std::move(m_pending.front());
+                m_pending.pop_front();
+                callbacks = m_callbacks;
+            }
+            m_space.notify_all();
+            callback(callbacks.get());
+        }
+    }
+
+    std::shared_ptr<CValidationInterface> GetCallbacks()
+    {
+        LOCK(m_mutex);
+        return m_callbacks;
+    }
+
+    void SetCallbacks(std::shared_ptr<CValidationInterface> callbacks)
+    {
+        LOCK(m_mutex);
+        m_callbacks = std::move(callbacks);
+    }
+
+    size_t Pending()
+    {
+        LOCK(m_mutex);
+        return m_pending.size();
+    }
+
+    //! Block until at most MAX_PENDING_VALIDATION_CALLBACKS callbacks are pending
+    void WaitForSpace()
+    {
+        WAIT_LOCK(m_mutex, lock);
+        if (m_pending.size() <= MAX_PENDING_VALIDATION_CALLBACKS) return;
+        ++m_waits;
+        while (m_pending.size() > MAX_PENDING_VALIDATION_CALLBACKS) {
+            m_space.wait(lock);
+        }
+    }
+
+    //! True if nothing is queued or running, so an unregistered queue can be dropped
+    bool Idle()
+    {
+        LOCK(m_mutex);
+        return !m_scheduled && m_pending.empty();
+    }
+
+    ValidationQueueStats GetStats()
+    {
+        LOCK(m_mutex);
+        ValidationQueueStats stats;
+        stats.name = m_name;
+        stats.registered = m_callbacks != nullptr;
+        stats.lossy = m_lossy;
+        stats.pending = m_pending.size();
+        stats.max_pending = m_max_pending;
+        stats.processed = m_processed;
+        stats.exec_time_us = m_exec_time_us;
+        stats.over_limit = m_over_limit;
+        stats.waits = m_waits;
+        stats.dropped = m_dropped;
+        return stats;
+    }
+
+private:
+    CScheduler* const m_pscheduler;
+    const std::string m_name;
+    const bool m_lossy;
+
+    Mutex m_mutex;
+    //! Notified whenever a pending callback is taken off the queue
+    std::condition_variable m_space;
+    std::shared_ptr<CValidationInterface> m_callbacks GUARDED_BY(m_mutex);
+    std::deque<Callback> m_pending GUARDED_BY(m_mutex);
+    //! Set while a Process() task is scheduled or running, so at most one is
+    bool m_scheduled GUARDED_BY(m_mutex){false};
+    size_t m_max_pending GUARDED_BY(m_mutex){0};
+    uint64_t m_processed GUARDED_BY(m_mutex){0};
+    int64_t m_exec_time_us GUARDED_BY(m_mutex){0};
+    uint64_t m_over_limit GUARDED_BY(m_mutex){0};
+    uint64_t m_waits GUARDED_BY(m_mutex){0};
+    uint64_t m_dropped GUARDED_BY(m_mutex){0};
+
+    void Schedule()
+    {
+        auto self = shared_from_this();
+        m_pscheduler->schedule([self] { self->Process(); }, std::chrono::system_clock::now());
+    }
+};
+
+//! The MainSignalsInstance manages one SubscriberQueue per registered
+//! CValidationInterface.
 //!
 //! A std::unordered_map is used to track what callbacks are currently
-//! registered, and a std::list is to used to store the callbacks that are
-//! currently registered as well as any callbacks that are just unregistered
-//! and about to be deleted when they are done executing.
+//! registered, and a std::list is used to keep the queues in registration
+//! order. Queues of unregistered callbacks are kept in m_retired until they
+//! have finished executing what was already queued.
 struct MainSignalsInstance {
 private:
+    CScheduler* const m_pscheduler;
+
     Mutex m_mutex;
-    //! List entries consist of a callback pointer and reference count. The
-    //! count is equal to the number of current executions of that entry, plus 1
-    //! if it's registered. It cannot be 0 because that would imply it is
-    //! unregistered and also not being executed (so shouldn't exist).
-    struct ListEntry { std::shared_ptr<CValidationInterface> callbacks; int count = 1; };
-    std::list<ListEntry> m_list GUARDED_BY(m_mutex);
-    std::unordered_map<CValidationInterface*, std::list<ListEntry>::iterator> m_map GUARDED_BY(m_mutex);
+    std::list<std::shared_ptr<SubscriberQueue>> m_queues GUARDED_BY(m_mutex);
+    std::list<std::shared_ptr<SubscriberQueue>> m_retired GUARDED_BY(m_mutex);
+    std::unordered_map<CValidationInterface*, std::shared_ptr<SubscriberQueue>> m_map GUARDED_BY(m_mutex);
+    //! Queue for functions passed to CallFunctionInValidationInterfaceQueue
+    const std::shared_ptr<SubscriberQueue> m_functions;
 
-public:
-    // We are not allowed to assume the scheduler only runs in one thread,
-    // but must ensure all callbacks happen in-order, so we end up creating
-    // our own queue here :(
-    SingleThreadedSchedulerClient m_schedulerClient;
+    void Retire(std::shared_ptr<SubscriberQueue> queue) EXCLUSIVE_LOCKS_REQUIRED(m_mutex)
+    {
+        queue->SetCallbacks(nullptr);
+        m_queues.remove(queue);
+        m_retired.push_back(std::move(queue));
+    }
 
-    explicit MainSignalsInstance(CScheduler *pscheduler) : m_schedulerClient(pscheduler) {}
+    void ReapRetired() EXCLUSIVE_LOCKS_REQUIRED(m_mutex)
+    {
+        m_retired.remove_if([](const std::shared_ptr<SubscriberQueue>& queue) { return queue->Idle(); });
+    }
+
+public:
+    explicit MainSignalsInstance(CScheduler *pscheduler)
+        : m_pscheduler(pscheduler), m_functions(std::make_shared<SubscriberQueue>(pscheduler, nullptr, "functions", false)) {}
 
     void Register(std::shared_ptr<CValidationInterface> callbacks)
     {
         LOCK(m_mutex);
-        auto inserted = m_map.emplace(callbacks.get(), m_list.end());
-        if (inserted.second) inserted.first->second = m_list.emplace(m_list.end());
-        inserted.first->second->callbacks = std::move(callbacks);
+        ReapRetired();
+        auto it = m_map.find(callbacks.get());
+        if (it != m_map.end()) {
+            it->second->SetCallbacks(std::move(callbacks));
+            return;
+        }
+        std::string name = callbacks->GetValidationQueueName();
+        bool lossy = callbacks->IsValidationQueueLossy();
+        auto queue = std::make_shared<SubscriberQueue>(m_pscheduler, callbacks, std::move(name), lossy);
+        m_map.emplace(callbacks.get(), queue);
+        m_queues.push_back(std::move(queue));
     }
 
     void Unregister(CValidationInterface* callbacks)
@@ -55,35 +255,121 @@ public:
         LOCK(m_mutex);
         auto it = m_map.find(callbacks);
         if (it != m_map.end()) {
-            if (!--it->second->count) m_list.erase(it->second);
+            Retire(it->second);
             m_map.erase(it);
         }
+        ReapRetired();
     }
 
     //! Clear unregisters every previously registered callback, erasing every
-    //! map entry. After this call, the list may still contain callbacks that
-    //! are currently executing, but it will be cleared when they are done
-    //! executing.
+    //! map entry. After this call, callbacks that are currently executing
+    //! still hold a reference to their subscriber until they are done.
     void Clear()
     {
         LOCK(m_mutex);
         for (const auto& entry : m_map) {
-            if (!--entry.second->count) m_list.erase(entry.second);
+            Retire(entry.second);
         }
         m_map.clear();
+        ReapRetired();
     }
 
+    //! Queue f on every registered subscriber's queue. Lossy subscribers
+    //! that are behind skip it if it is droppable.
+    template<typename F> void Enqueue(F&& f, bool droppable)
+    {
+        LOCK(m_mutex);
+        for (const auto& queue : m_queues) {
+            queue->Add([f](CValidationInterface* callbacks) {
+                if (callbacks) f(*callbacks);
+            }, droppable);
+        }
+    }
+
+    //! Call f synchronously for every registered subscriber
     template<typename F> void Iterate(F&& f)
     {
-        WAIT_LOCK(m_mutex, lock);
-        for (auto it = m_list.begin(); it != m_list.end();) {
-            ++it->count;
-            {
-                REVERSE_LOCK(lock);
-                f(*it->callbacks);
+        std::vector<std::shared_ptr<SubscriberQueue>> queues;
+        {
+            LOCK(m_mutex);
+            queues.assign(m_queues.begin(), m_queues.end());
+        }
+        for (const auto& queue : queues) {
+            // Skips subscribers that were unregistered since the snapshot
+            if (auto callbacks = queue->GetCallbacks()) f(*callbacks);
+        }
+    }
+
+    //! Run func once every callback queued before it, on every queue, is done
+    void AddBarrier(std::function<void ()> func)
+    {
+        LOCK(m_mutex);
+        auto remaining = std::make_shared<std::atomic<size_t>>(m_queues.size() + m_retired.size() + 1);
+        auto shared_func = std::make_shared<std::function<void ()>>(std::move(func));
+        SubscriberQueue::Callback arrive = [remaining, shared_func](CValidationInterface*) {
+            if (--*remaining == 0) (*shared_func)();
+        };
+        for (const auto& queue : m_queues) queue->Add(arrive);
+        for (const auto& queue : m_retired) queue->Add(arrive);
+        m_functions->Add(arrive);
+    }
+
+    void EmptyQueues()
+    {
+        std::vector<std::shared_ptr<SubscriberQueue>> queues;
+        {
+            LOCK(m_mutex);
+            queues.assign(m_queues.begin(), m_queues.end());
+            queues.insert(queues.end(), m_retired.begin(), m_retired.end());
+        }
+        queues.push_back(m_functions);
+        for (const auto& queue : queues) queue->EmptyQueue();
+        // A barrier may only complete on a later queue, so drain again until
+        // nothing new was queued while flushing.
+        bool pending;
+        do {
+            pending = false;
+            for (const auto& queue : queues) {
+                if (queue->Pending()) {
+                    queue->EmptyQueue();
+                    pending = true;
+                }
+            }
+        } while (pending);
+        LOCK(m_mutex);
+        ReapRetired();
+    }
+
+    //! Wait until no registered subscriber that is not lossy is over its limit
+    void WaitForSpace()
+    {
+        std::vector<std::shared_ptr<SubscriberQueue>> queues;
+        {
+            LOCK(m_mutex);
+            for (const auto& queue : m_queues) {
+                if (!queue->IsLossy()) queues.push_back(queue);
             }
-            it = --it->count ? std::next(it) : m_list.erase(it);
         }
+        for (const auto& queue : queues) queue->WaitForSpace();
+    }
+
+    size_t MaxPending()
+    {
+        LOCK(m_mutex);
+        size_t pending = m_functions->Pending();
+        for (const auto& queue : m_queues) pending = std::max(pending, queue->Pending());
+        for (const auto& queue : m_retired) pending = std::max(pending, queue->Pending());
+        return pending;
+    }
+
+    std::vector<ValidationQueueStats> GetStats()
+    {
+        LOCK(m_mutex);
+        std::vector<ValidationQueueStats> stats;
+        for (const auto& queue : m_queues) stats.push_back(queue->GetStats());
+        for (const auto& queue : m_retired) stats.push_back(queue->GetStats());
+        stats.push_back(m_functions->GetStats());
+        return stats;
     }
 };
 
@@ -100,13 +386,18 @@ void CMainSignals::UnregisterBackgroundSignalScheduler() {
 
 void CMainSignals::FlushBackgroundCallbacks() {
     if (m_internals) {
-        m_internals->m_schedulerClient.EmptyQueue();
+        m_internals->EmptyQueues();
     }
 }
 
 size_t CMainSignals::CallbacksPending() {
     if (!m_internals) return 0;
-    return m_internals->m_schedulerClient.CallbacksPending();
+    return m_internals->MaxPending();
+}
+
+std::vector<ValidationQueueStats> CMainSignals::GetQueueStats() {
+    if (!m_internals) return {};
+    return m_internals->GetStats();
 }
 
 CMainSignals& GetMainSignals()
@@ -146,7 +437,7 @@ void UnregisterAllValidationInterfaces() {
 }
 
 void CallFunctionInValidationInterfaceQueue(std::function<void ()> func) {
-    g_signals.m_internals->m_schedulerClient.AddToProcessQueue(std::move(func));
+    g_signals.m_internals->AddBarrier(std::move(func));
 }
 
 void SyncWithValidationInterfaceQueue() {
@@ -159,18 +450,28 @@ void SyncWithValidationInterfaceQueue() {
     promise.get_future().wait();
 }
 
+void LimitValidationInterfaceQueue() {
+    AssertLockNotHeld(cs_main);
+
+    if (g_signals.m_internals) {
+        g_signals.m_internals->WaitForSpace();
+    }
+}
+
 // Use a macro instead of a function for conditional logging to prevent
 // evaluating arguments when logging is not enabled.
 //
-// NOTE: The lambda captures all local variables by value.
-#define ENQUEUE_AND_LOG_EVENT(event, fmt, name, ...)           \
-    do {                                                       \
-        auto local_name = (name);                              \
-        LOG_EVENT("Enqueuing " fmt, local_name, __VA_ARGS__);  \
-        m_internals->m_schedulerClient.AddToProcessQueue([=] { \
-            LOG_EVENT(fmt, local_name, __VA_ARGS__);           \
-            event();                                           \
-        });                                                    \
+// NOTE: The lambda captures all local variables by value. The event is
+// queued once per subscriber and receives that subscriber as argument.
+#define ENQUEUE_AND_LOG_EVENT(event, droppable, fmt, name, ...)                   \
+    do {                                                                          \
+        auto local_name = (name);                                                 \
+        LOG_EVENT("Enqueuing " fmt, local_name, __VA_ARGS__);                     \
+        m_internals->Enqueue([=](CValidationInterface& callbacks) {               \
+            LOG_EVENT(fmt " (%s)", local_name, __VA_ARGS__,                       \
+                      callbacks.GetValidationQueueName());                        \
+            event(callbacks);                                                     \
+        }, droppable);                                                            \
     } while (0)
 
 #define LOG_EVENT(fmt, ...) \
@@ -181,57 +482,57 @@ void CMainSignals::UpdatedBlockTip(const CBlockIndex *pindexNew, const CBlockInd
     // the chain actually updates. One way to ensure this is for the caller to invoke this signal
     // in the same critical section where the chain is updated
 
-    auto event = [pindexNew, pindexFork, fInitialDownload, this] {
-        m_internals->Iterate([&](CValidationInterface& callbacks) { callbacks.UpdatedBlockTip(pindexNew, pindexFork, fInitialDownload); });
+    auto event = [pindexNew, pindexFork, fInitialDownload](CValidationInterface& callbacks) {
+        callbacks.UpdatedBlockTip(pindexNew, pindexFork, fInitialDownload);
     };
-    ENQUEUE_AND_LOG_EVENT(event, "%s: new block hash=%s fork block hash=%s (in IBD=%s)", __func__,
+    ENQUEUE_AND_LOG_EVENT(event, false, "%s: new block hash=%s fork block hash=%s (in IBD=%s)", __func__,
                           pindexNew->GetBlockHash().ToString(),
                           pindexFork ? pindexFork->GetBlockHash().ToString() : "null",
                           fInitialDownload);
 }
 
 void CMainSignals::TransactionAddedToMempool(const CTransactionRef& tx) {
-    auto event = [tx, this] {
-        m_internals->Iterate([&](CValidationInterface& callbacks) { callbacks.TransactionAddedToMempool(tx); });
+    auto event = [tx](CValidationInterface& callbacks) {
+        callbacks.TransactionAddedToMempool(tx);
     };
-    ENQUEUE_AND_LOG_EVENT(event, "%s: txid=%s wtxid=%s", __func__,
+    ENQUEUE_AND_LOG_EVENT(event, true, "%s: txid=%s wtxid=%s", __func__,
                           tx->GetHash().ToString(),
                           tx->GetWitnessHash().ToString());
 }
 
 void CMainSignals::TransactionRemovedFromMempool(const CTransactionRef& tx, MemPoolRemovalReason reason) {
-    auto event = [tx, reason, this] {
-        m_internals->Iterate([&](CValidationInterface& callbacks) { callbacks.TransactionRemovedFromMempool(tx, reason); });
+    auto event = [tx, reason](CValidationInterface& callbacks) {
+        callbacks.TransactionRemovedFromMempool(tx, reason);
     };
-    ENQUEUE_AND_LOG_EVENT(event, "%s: txid=%s wtxid=%s", __func__,
+    ENQUEUE_AND_LOG_EVENT(event, true, "%s: txid=%s wtxid=%s", __func__,
                           tx->GetHash().ToString(),
                           tx->GetWitnessHash().ToString());
 }
 
 void CMainSignals::BlockConnected(const std::shared_ptr<const CBlock> &pblock, const CBlockIndex *pindex) {
-    auto event = [pblock, pindex, this] {
-        m_internals->Iterate([&](CValidationInterface& callbacks) { callbacks.BlockConnected(pblock, pindex); });
+    auto event = [pblock, pindex](CValidationInterface& callbacks) {
+        callbacks.BlockConnected(pblock, pindex);
     };
-    ENQUEUE_AND_LOG_EVENT(event, "%s: block hash=%s block height=%d", __func__,
+    ENQUEUE_AND_LOG_EVENT(event, false, "%s: block hash=%s block height=%d", __func__,
                           pblock->GetHash().ToString(),
                           pindex->nHeight);
 }
 
 void CMainSignals::BlockDisconnected(const std::shared_ptr<const CBlock>& pblock, const CBlockIndex* pindex)
 {
-    auto event = [pblock, pindex, this] {
-        m_internals->Iterate([&](CValidationInterface& callbacks) { callbacks.BlockDisconnected(pblock, pindex); });
+    auto event = [pblock, pindex](CValidationInterface& callbacks) {
+        callbacks.BlockDisconnected(pblock, pindex);
     };
-    ENQUEUE_AND_LOG_EVENT(event, "%s: block hash=%s block height=%d", __func__,
+    ENQUEUE_AND_LOG_EVENT(event, false, "%s: block hash=%s block height=%d", __func__,
                           pblock->GetHash().ToString(),
                           pindex->nHeight);
 }
 
 void CMainSignals::ChainStateFlushed(const CBlockLocator &locator) {
-    auto event = [locator, this] {
-        m_internals->Iterate([&](CValidationInterface& callbacks) { callbacks.ChainStateFlushed(locator); });
+    auto event = [locator](CValidationInterface& callbacks) {
+        callbacks.ChainStateFlushed(locator);
     };
-    ENQUEUE_AND_LOG_EVENT(event, "%s: block hash=%s", __func__,
+    ENQUEUE_AND_LOG_EVENT(event, false, "%s: block hash=%s", __func__,
                           locator.IsNull() ? "null" : locator.vHave.front().ToString());
 }
 
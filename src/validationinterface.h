@@ -11,6 +11,8 @@
 
 #include <functional>
 #include <memory>
+#include <string>
+#include <vector>
 
 extern RecursiveMutex cs_main;
 class BlockValidationState;
@@ -23,6 +25,33 @@ class uint256;
 class CScheduler;
 enum class MemPoolRemovalReason;
 
+/**
+ * Number of callbacks a subscriber may have queued before producers that can
+ * afford to wait (see LimitValidationInterfaceQueue) block until it caught
+ * up, or before a lossy subscriber misses mempool notifications.
+ */
+static const size_t MAX_PENDING_VALIDATION_CALLBACKS = 10;
+
+/** Queue depth and throughput counters of one validation interface subscriber */
+struct ValidationQueueStats {
+    std::string name;
+    //! False once the subscriber was unregistered and the queue is draining
+    bool registered{false};
+    //! See CValidationInterface::IsValidationQueueLossy
+    bool lossy{false};
+    size_t pending{0};
+    //! High-water mark of pending
+    size_t max_pending{0};
+    uint64_t processed{0};
+    int64_t exec_time_us{0};
+    //! Number of callbacks queued while the queue was above MAX_PENDING_VALIDATION_CALLBACKS
+    uint64_t over_limit{0};
+    //! Number of times a producer waited for the queue to get back within the limit
+    uint64_t waits{0};
+    //! Number of mempool notifications a lossy subscriber missed because its queue was full
+    uint64_t dropped{0};
+};
+
 // These functions dispatch to one or all registered wallets
 
 /** Register a wallet to receive updates from core */
@@ -42,6 +71,8 @@ void UnregisterSharedValidationInterface(std::shared_ptr<CValidationInterface> c
 /**
  * Pushes a function to callback onto the notification queue, guaranteeing any
  * callbacks generated prior to now are finished when the function is called.
+ * This holds across all subscriber queues: the function runs after every
+ * subscriber has processed the callbacks that were queued for it before.
  *
  * Be very careful blocking on func to be called if any locks are held -
  * validation interface clients may not be able to make progress as they often
@@ -59,6 +90,15 @@ void CallFunctionInValidationInterfaceQueue(std::function<void ()> func);
  *     promise.get_future().wait();
  */
 void SyncWithValidationInterfaceQueue() LOCKS_EXCLUDED(cs_main);
+/**
+ * Wait until every subscriber that is not lossy has at most
+ * MAX_PENDING_VALIDATION_CALLBACKS callbacks queued. Producers of
+ * notifications that hold no locks call this before producing more, so the
+ * queues do not grow without bound. Only the subscribers over the limit are
+ * waited for, and only until they are back within it, not until every queue
+ * drained.
+ */
+void LimitValidationInterfaceQueue() LOCKS_EXCLUDED(cs_main);
 
 /**
  * Implement this to subscribe to events generated in validation
@@ -74,8 +114,21 @@ void SyncWithValidationInterfaceQueue() LOCKS_EXCLUDED(cs_main);
  * the BlockConnected() callback without worrying about explicit
  * synchronization. No ordering should be assumed across
  * ValidationInterface() subscribers.
+ *
+ * Each subscriber has its own queue of pending callbacks, serviced by the
+ * CScheduler threads, so a slow subscriber only delays its own callbacks.
+ * Callbacks of different subscribers may run concurrently.
  */
 class CValidationInterface {
+public:
+    /** Name used for this subscriber's queue in logs and queue statistics */
+    virtual std::string GetValidationQueueName() const { return "unnamed"; }
+    /**
+     * Lossy subscribers do not hold up producers in LimitValidationInterfaceQueue.
+     * Instead, mempool notifications are dropped for them while their queue is
+     * over MAX_PENDING_VALIDATION_CALLBACKS. Block notifications are never dropped.
+     */
+    virtual bool IsValidationQueueLossy() const { return false; }
 protected:
     /**
      * Protected destructor so that instances can only be deleted by derived classes.
@@ -184,6 +237,7 @@ private:
     friend void ::UnregisterValidationInterface(CValidationInterface*);
     friend void ::UnregisterAllValidationInterfaces();
     friend void ::CallFunctionInValidationInterfaceQueue(std::function<void ()> func);
+    friend void ::LimitValidationInterfaceQueue();
 
 public:
     /** Register a CScheduler to give callbacks which should run in the background (may only be called once) */
@@ -193,8 +247,10 @@ public:
     /** Call any remaining callbacks on the calling thread */
     void FlushBackgroundCallbacks();
 
+    /** Largest number of callbacks pending in any subscriber queue */
     size_t CallbacksPending();
-
+    /** Per-subscriber queue statistics */
+    std::vector<ValidationQueueStats> GetQueueStats();
 
     void UpdatedBlockTip(const CBlockIndex *, const CBlockIndex *, bool fInitialDownload);
     void TransactionAddedToMempool(const CTransactionRef&);
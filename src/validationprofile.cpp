@@ -0,0 +1,98 @@
+// Copyright (c) 2020 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <validationprofile.h>
+
+#include <univalue.h>
+
+#include <algorithm>
+#include <assert.h>
+
+BlockProfiler g_block_profiler;
+
+const char* BlockPhaseName(BlockPhase phase)
+{
+    switch (phase) {
+    case BlockPhase::LOAD_BLOCK: return "loadblock";
+    case BlockPhase::CHECKS: return "checks";
+    case BlockPhase::INPUTS: return "inputs";
+    case BlockPhase::SCRIPT_CHECKS: return "scriptchecks";
+    case BlockPhase::CONTRACT_EXEC: return "contractexec";
+    case BlockPhase::STATE_COMMIT: return "statecommit";
+    case BlockPhase::RECEIPTS: return "receipts";
+    case BlockPhase::INDEX: return "index";
+    case BlockPhase::FLUSH: return "flush";
+    case BlockPhase::CHAINSTATE: return "chainstate";
+    case BlockPhase::POST_CONNECT: return "postconnect";
+    case BlockPhase::COUNT: break;
+    }
+    assert(false);
+}
+
+UniValue BlockProfile::ToJSON(bool verbose) const
+{
+    UniValue result(UniValue::VOBJ);
+    result.pushKV("hash", hash.GetHex());
+    result.pushKV("height", height);
+    result.pushKV("time", time);
+    result.pushKV("txs", (uint64_t)n_tx);
+    result.pushKV("inputs", (uint64_t)n_inputs);
+    result.pushKV("total_us", total_us);
+
+    UniValue phases(UniValue::VOBJ);
+    for (size_t i = 0; i < phase_us.size(); ++i) {
+        phases.pushKV(BlockPhaseName((BlockPhase)i), phase_us[i]);
+    }
+    result.pushKV("phases_us", phases);
+
+    if (verbose) {
+        UniValue execs(UniValue::VARR);
+        for (const ContractExecProfile& exec : contract_execs) {
+            UniValue entry(UniValue::VOBJ);
+            entry.pushKV("txid", exec.txid.GetHex());
+            entry.pushKV("outputs", (uint64_t)exec.n_outputs);
+            entry.pushKV("gas_used", exec.gas_used);
+            entry.pushKV("exec_us", exec.exec_us);
+            entry.pushKV("commit_us", exec.commit_us);
+            execs.push_back(entry);
+        }
+        result.pushKV("contract_execs", execs);
+    }
+    return result;
+}
+
+void BlockProfiler::SetCapacity(size_t capacity)
+{
+    LOCK(m_mutex);
+    m_capacity = capacity;
+    while (m_profiles.size() > capacity) m_profiles.pop_front();
+}
+
+void BlockProfiler::Add(BlockProfile profile)
+{
+    LOCK(m_mutex);
+    const size_t capacity = m_capacity;
+    if (capacity == 0) return;
+    while (m_profiles.size() >= capacity) m_profiles.pop_front();
+    m_profiles.push_back(std::move(profile));
+}
+
+bool BlockProfiler::Find(const uint256& hash, BlockProfile& profile) const
+{
+    LOCK(m_mutex);
+    for (auto it = m_profiles.rbegin(); it != m_profiles.rend(); ++it) {
+        if (it->hash == hash) {
+            profile = *it;
+            return true;
+        }
+    }
+    return false;
+}
+
+std::vector<BlockProfile> BlockProfiler::GetRecent(size_t count) const
+{
+    LOCK(m_mutex);
+    count = std::min(count, m_profiles.size());
+    return std::vector<BlockProfile>(m_profiles.rbegin(), m_profiles.rbegin() + count);
+}
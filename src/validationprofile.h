@@ -0,0 +1,108 @@
+// Copyright (c) 2020 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_VALIDATIONPROFILE_H
+#define BITCOIN_VALIDATIONPROFILE_H
+
+#include <sync.h>
+#include <uint256.h>
+#include <util/time.h>
+
+#include <array>
+#include <atomic>
+#include <deque>
+#include <stdint.h>
+#include <vector>
+
+class UniValue;
+
+/** Default number of connected blocks kept by the validation profiler */
+static const unsigned int DEFAULT_BLOCK_PROFILE_SIZE = 144;
+
+/** Phases of connecting a block to the tip, in the order they run */
+enum class BlockPhase {
+    LOAD_BLOCK,     //!< Read the block from disk
+    CHECKS,         //!< Context-free and fork checks
+    INPUTS,         //!< Fetch and check the coins spent by the block
+    SCRIPT_CHECKS,  //!< Script verification, including waiting for the check queue
+    CONTRACT_EXEC,  //!< EVM execution of contract transactions
+    STATE_COMMIT,   //!< Commit of the state and UTXO tries after execution
+    RECEIPTS,       //!< Transaction receipts and log events
+    INDEX,          //!< Undo data, block index and optional indexes
+    FLUSH,          //!< Flush of the coins view into the tip cache
+    CHAINSTATE,     //!< Writing the chain state to disk, if needed
+    POST_CONNECT,   //!< Mempool update and tip change
+    COUNT
+};
+
+const char* BlockPhaseName(BlockPhase phase);
+
+/** Timing of one ByteCodeExec run (the contract outputs of one transaction) */
+struct ContractExecProfile {
+    uint256 txid;
+    unsigned int n_outputs{0};
+    uint64_t gas_used{0};
+    int64_t exec_us{0};
+    int64_t commit_us{0};
+};
+
+/** Per-phase timings of connecting one block */
+struct BlockProfile {
+    uint256 hash;
+    int height{-1};
+    int64_t time{0};
+    unsigned int n_tx{0};
+    unsigned int n_inputs{0};
+    int64_t total_us{0};
+    std::array<int64_t, (size_t)BlockPhase::COUNT> phase_us{};
+    std::vector<ContractExecProfile> contract_execs;
+
+    void Add(BlockPhase phase, int64_t us) { phase_us[(size_t)phase] += us; }
+
+    UniValue ToJSON(bool verbose) const;
+};
+
+/** Attributes the time between successive Lap() calls to the phases of a profile */
+class PhaseTimer
+{
+public:
+    explicit PhaseTimer(BlockProfile* profile) : m_profile(profile), m_last(profile ? GetTimeMicros() : 0) {}
+
+    void Lap(BlockPhase phase)
+    {
+        if (!m_profile) return;
+        int64_t now = GetTimeMicros();
+        m_profile->Add(phase, now - m_last);
+        m_last = now;
+    }
+
+private:
+    BlockProfile* m_profile;
+    int64_t m_last;
+};
+
+/** Ring buffer of the profiles of the most recently connected blocks */
+class BlockProfiler
+{
+public:
+    explicit BlockProfiler(size_t capacity = DEFAULT_BLOCK_PROFILE_SIZE) : m_capacity(capacity) {}
+
+    /** A capacity of zero disables profiling */
+    void SetCapacity(size_t capacity);
+    bool Enabled() const { return m_capacity.load(std::memory_order_relaxed) > 0; }
+
+    void Add(BlockProfile profile);
+    bool Find(const uint256& hash, BlockProfile& profile) const;
+    /** The count most recent profiles, newest first */
+    std::vector<BlockProfile> GetRecent(size_t count) const;
+
+private:
+    mutable Mutex m_mutex;
+    std::atomic<size_t> m_capacity;
+    std::deque<BlockProfile> m_profiles GUARDED_BY(m_mutex);
+};
+
+extern BlockProfiler g_block_profiler;
+
+#endif // BITCOIN_VALIDATIONPROFILE_H
@@ -7,6 +7,7 @@
 
 #include <interfaces/chain.h>
 #include <scheduler.h>
+#include <util/memoryusage.h>
 #include <util/string.h>
 #include <util/system.h>
 #include <util/translation.h>
@@ -94,6 +95,14 @@ void StartWallets(CScheduler& scheduler)
     // Schedule periodic wallet flushes and tx rebroadcasts
     scheduler.scheduleEvery(MaybeCompactWalletDB, std::chrono::milliseconds{500});
     scheduler.scheduleEvery(MaybeResendWalletTxs, std::chrono::milliseconds{1000});
+
+    RegisterMemoryUsage("wallet_stake_caches", [] {
+        size_t usage = 0;
+        for (const std::shared_ptr<CWallet>& pwallet : GetWallets()) {
+            usage += pwallet->StakeCacheMemoryUsage();
+        }
+        return usage;
+    });
 }
 
 void FlushWallets()
@@ -106,6 +115,7 @@ void FlushWallets()
 
 void StopWallets()
 {
+    UnregisterMemoryUsage("wallet_stake_caches");
     for (const std::shared_ptr<CWallet>& pwallet : GetWallets()) {
         pwallet->Flush(true);
     }
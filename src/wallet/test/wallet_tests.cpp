@@ -4,11 +4,14 @@
 
 #include <wallet/wallet.h>
 
+#include <algorithm>
+#include <limits>
 #include <memory>
 #include <stdint.h>
 #include <vector>
 
 #include <interfaces/chain.h>
+#include <interfaces/wallet.h>
 #include <node/context.h>
 #include <policy/policy.h>
 #include <rpc/server.h>
@@ -635,4 +638,49 @@ BOOST_FIXTURE_TEST_CASE(dummy_input_size_test, TestChain100Setup)
     BOOST_CHECK_EQUAL(CalculateNestedKeyhashInputSize(true), DUMMY_NESTED_P2WPKH_INPUT_SIZE);
 }
 
+//! Page through the token transactions the way the Qt model does, newest first
+static std::vector<uint256> FetchTokenTxs(interfaces::Wallet& wallet, size_t page)
+{
+    std::vector<uint256> hashes;
+    int64_t time = std::numeric_limits<int64_t>::max();
+    uint256 hash;
+    while (true) {
+        std::vector<interfaces::TokenTx> txs = wallet.getTokenTxsBefore(time, hash, page);
+        for (const interfaces::TokenTx& tx : txs) hashes.push_back(tx.hash);
+        if (txs.size() < page) return hashes;
+        time = txs.back().time;
+        hash = txs.back().hash;
+    }
+}
+
+BOOST_AUTO_TEST_CASE(token_tx_paging)
+{
+    std::unique_ptr<interfaces::Wallet> wallet = interfaces::MakeWallet(std::shared_ptr<CWallet>(&m_wallet, [](CWallet*) {}));
+
+    // Several entries share a time, so the pages have to break ties by hash
+    std::vector<std::pair<int64_t, uint256>> entries;
+    for (int i = 0; i < 10; i++) {
+        CTokenTx tokenTx;
+        tokenTx.transactionHash = InsecureRand256();
+        tokenTx.nCreateTime = 1000 + i / 3;
+        m_wallet.LoadTokenTx(tokenTx);
+        entries.emplace_back(tokenTx.nCreateTime, tokenTx.GetHash());
+    }
+    std::sort(entries.rbegin(), entries.rend());
+    std::vector<uint256> expected;
+    for (const auto& entry : entries) expected.push_back(entry.second);
+    for (size_t page : {1, 3, 4, 10, 11}) {
+        BOOST_CHECK(FetchTokenTxs(*wallet, page) == expected);
+    }
+
+    // Changing the time of the oldest entry moves it to the front of the pages, once
+    const uint256 moved = expected.back();
+    BOOST_CHECK(m_wallet.AddTokenTxEntry(m_wallet.mapTokenTx.at(moved), false));
+    BOOST_CHECK(m_wallet.mapTokenTx.at(moved).nCreateTime > 1000 + 3);
+    expected.pop_back();
+    expected.insert(expected.begin(), moved);
+    BOOST_CHECK(FetchTokenTxs(*wallet, 3) == expected);
+    BOOST_CHECK_EQUAL(m_wallet.setTokenTxByTime.size(), m_wallet.mapTokenTx.size());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
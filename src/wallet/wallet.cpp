@@ -13,6 +13,7 @@
 #include <interfaces/wallet.h>
 #include <key.h>
 #include <key_io.h>
+#include <memusage.h>
 #include <optional.h>
 #include <policy/fees.h>
 #include <policy/policy.h>
@@ -5034,7 +5035,13 @@ bool CWallet::LoadToken(const CTokenInfo &token)
 bool CWallet::LoadTokenTx(const CTokenTx &tokenTx)
 {
     uint256 hash = tokenTx.GetHash();
+    auto it = mapTokenTx.find(hash);
+    if(it != mapTokenTx.end())
+    {
+        setTokenTxByTime.erase(std::make_pair(it->second.nCreateTime, hash));
+    }
     mapTokenTx[hash] = tokenTx;
+    setTokenTxByTime.emplace(tokenTx.nCreateTime, hash);
 
     return true;
 }
@@ -5116,7 +5123,12 @@ bool CWallet::AddTokenTxEntry(const CTokenTx &tokenTx, bool fFlushOnClose)
     if (!batch.WriteTokenTx(wtokenTx))
         return false;
 
+    if(!fInsertedNew)
+    {
+        setTokenTxByTime.erase(std::make_pair(it->second.nCreateTime, hash));
+    }
     mapTokenTx[hash] = wtokenTx;
+    setTokenTxByTime.emplace(wtokenTx.nCreateTime, hash);
 
     NotifyTokenTransactionChanged(this, hash, fInsertedNew ? CT_NEW : CT_UPDATED);
 
@@ -5536,6 +5548,7 @@ bool CWallet::CleanTokenTxEntries(bool fFlushOnClose)
             if (!batch.EraseTokenTx(hashTx))
                 return false;
 
+            setTokenTxByTime.erase(std::make_pair(itTx->second.nCreateTime, hashTx));
             mapTokenTx.erase(itTx);
 
             NotifyTokenTransactionChanged(this, hashTx, CT_DELETED);
@@ -6008,6 +6021,14 @@ void CWallet::UpdateMinerStakeCache(bool fStakeCache, const std::vector<COutPoin
     }
 }
 
+size_t CWallet::StakeCacheMemoryUsage() const
+{
+    auto locked_chain = chain().lock();
+    LOCK(cs_wallet);
+    return memusage::DynamicUsage(stakeCache) + memusage::DynamicUsage(stakeDelegateCache) + memusage::DynamicUsage(minerStakeCache) +
+           memusage::DynamicUsage(prevoutScriptCache) + memusage::DynamicUsage(mapAddressUnspentCache);
+}
+
 void CWallet::CleanCoinStake()
 {
     auto locked_chain = chain().lock();
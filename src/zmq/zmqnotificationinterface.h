@@ -20,6 +20,10 @@ public:
 
     static CZMQNotificationInterface* Create();
 
+    std::string GetValidationQueueName() const override { return "zmq"; }
+    //! zmq publishing is best effort, a slow notifier misses transactions instead of holding up the node
+    bool IsValidationQueueLossy() const override { return true; }
+
 protected:
     bool Initialize();
     void Shutdown();
@@ -0,0 +1,72 @@
+#!/usr/bin/env python3
+# Copyright (c) 2020 The Bitcoin Core developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+"""Test following the mempool with getrawmempool mempool_sequence and getmempooldelta."""
+
+from test_framework.test_framework import BitcoinTestFramework
+from test_framework.util import *
+
+
+class MempoolDeltaTest(BitcoinTestFramework):
+    def set_test_params(self):
+        self.num_nodes = 1
+        self.setup_clean_chain = True
+
+    def skip_test_if_missing_module(self):
+        self.skip_if_no_wallet()
+
+    def run_test(self):
+        node = self.nodes[0]
+        node.generate(COINBASE_MATURITY + 10)
+        address = node.getnewaddress()
+
+        self.log.info("Take a snapshot with the mempool sequence")
+        snapshot = node.getrawmempool(False, True)
+        assert_equal(snapshot['txids'], [])
+        start = snapshot['mempool_sequence']
+
+        self.log.info("Added transactions show up in the delta")
+        txids = [node.sendtoaddress(address, 1) for _ in range(3)]
+        delta = node.getmempooldelta(start)
+        assert_equal(sorted(delta['added']), sorted(txids))
+        assert_equal(delta['removed'], [])
+        assert_equal(delta['mempool_sequence'], start + 3)
+
+        # The verbose delta has the same entries as the verbose mempool, at the same sequence
+        verbose_delta = node.getmempooldelta(start, True)
+        verbose_pool = node.getrawmempool(True, True)
+        assert_equal(verbose_delta['mempool_sequence'], verbose_pool['mempool_sequence'])
+        assert_equal(verbose_delta['added'], verbose_pool['entries'])
+        assert_equal(node.getrawmempool(False, True)['mempool_sequence'], delta['mempool_sequence'])
+
+        # Nothing changed since
+        delta = node.getmempooldelta(delta['mempool_sequence'])
+        assert_equal(delta, {'mempool_sequence': start + 3, 'removed': [], 'added': []})
+
+        self.log.info("Mined transactions show up as removed")
+        added = node.sendtoaddress(address, 1)
+        node.generate(1)
+        delta = node.getmempooldelta(start + 3)
+        assert_equal(sorted(delta['removed']), sorted(txids))
+        # Added and removed again within the range, so left out
+        assert_equal(delta['added'], [])
+        assert added not in delta['removed']
+        assert_equal(node.getrawmempool(), [])
+
+        self.log.info("Invalid sequences")
+        assert_raises_rpc_error(-8, "Negative mempool sequence", node.getmempooldelta, -1)
+        current = delta['mempool_sequence']
+        assert_raises_rpc_error(-1, "take a new snapshot with getrawmempool", node.getmempooldelta, current + 1)
+
+        self.log.info("Changes beyond -mempoolchangelog need a new snapshot")
+        self.restart_node(0, ['-mempoolchangelog=2'])
+        start = node.getrawmempool(False, True)['mempool_sequence']
+        for _ in range(3):
+            node.sendtoaddress(address, 1)
+        assert_raises_rpc_error(-1, "Mempool changes after sequence %d are not available" % start, node.getmempooldelta, start)
+        assert_equal(len(node.getmempooldelta(start + 1)['added']), 2)
+
+
+if __name__ == '__main__':
+    MempoolDeltaTest().main()
@@ -10,6 +10,7 @@
 
 import copy
 from decimal import Decimal
+import time
 
 from test_framework.blocktools import (
     create_coinbase,
@@ -17,7 +18,8 @@ from test_framework.blocktools import (
 )
 from test_framework.messages import (
     CBlock,
-    CBlockHeader
+    CBlockHeader,
+    COIN,
 )
 from test_framework.mininode import (
     P2PDataStore,
@@ -38,6 +40,19 @@ def assert_template(node, block, expect, rehash=True):
     rsp = node.getblocktemplate(template_request={'data': block.serialize().hex(), 'mode': 'proposal', 'rules': ['segwit']})
     assert_equal(rsp, expect)
 
+def assert_template_transactions(node, tmpl):
+    """Check the transactions of a template against a fresh encoding of the mempool transactions"""
+    txids = [tx['txid'] for tx in tmpl['transactions']]
+    for tx in tmpl['transactions']:
+        raw = node.getrawtransaction(tx['txid'])
+        decoded = node.decoderawtransaction(raw)
+        assert_equal(tx['data'], raw)
+        assert_equal(tx['hash'], decoded['hash'])
+        assert_equal(tx['weight'], decoded['weight'])
+        assert_equal(tx['fee'], int(node.getmempoolentry(tx['txid'])['fees']['base'] * COIN))
+        # Index 0 is the coinbase
+        assert_equal(tx['depends'], [txids.index(vin['txid']) + 1 for vin in decoded['vin'] if vin['txid'] in txids])
+
 
 class MiningTest(BitcoinTestFramework):
     def set_test_params(self):
@@ -246,6 +261,32 @@ class MiningTest(BitcoinTestFramework):
         node.submitheader(hexdata=CBlockHeader(bad_block_root).serialize().hex())
         assert_equal(node.submitblock(hexdata=block.serialize().hex()), 'duplicate')  # valid
 
+        if self.is_wallet_compiled():
+            self.log.info("getblocktemplate: Reused transaction entries match a fresh encoding")
+            address = node.getnewaddress()
+            txid1 = node.sendtoaddress(address, 1)
+            tmpl = node.getblocktemplate({'rules': ['segwit']})
+            assert_equal([tx['txid'] for tx in tmpl['transactions']], [txid1])
+            assert_template_transactions(node, tmpl)
+
+            # Change the mempool and let the template be rebuilt, it is kept for 5 seconds otherwise
+            txid2 = node.sendtoaddress(address, 2)
+            node.setmocktime(int(time.time()) + 10)
+            tmpl2 = node.getblocktemplate({'rules': ['segwit']})
+            assert_equal(sorted(tx['txid'] for tx in tmpl2['transactions']), sorted([txid1, txid2]))
+            assert_template_transactions(node, tmpl2)
+            entry1 = next(tx for tx in tmpl2['transactions'] if tx['txid'] == txid1)
+            for key in ['data', 'txid', 'hash', 'weight', 'fee', 'sigops']:
+                assert_equal(entry1[key], tmpl['transactions'][0][key])
+
+            # Transactions leave the template once mined, new ones are encoded afresh
+            node.generatetoaddress(1, node.get_deterministic_priv_key().address)
+            txid3 = node.sendtoaddress(address, 3)
+            tmpl3 = node.getblocktemplate({'rules': ['segwit']})
+            assert_equal([tx['txid'] for tx in tmpl3['transactions']], [txid3])
+            assert_template_transactions(node, tmpl3)
+            node.setmocktime(0)
+
 
 if __name__ == '__main__':
     MiningTest().main()
@@ -0,0 +1,113 @@
+#!/usr/bin/env python3
+# Copyright (c) 2020 The Bitcoin Core developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+"""Test mining through the Stratum server.
+
+With -stratumdifficulty=1 every share is accepted, and on regtest about half
+of them meet the block target, so the test can mine without hashing itself.
+"""
+
+import json
+import socket
+
+from test_framework.test_framework import BitcoinTestFramework
+from test_framework.util import (
+    assert_equal,
+    p2p_port,
+)
+
+
+class StratumMiner:
+    def __init__(self, port):
+        self.sock = socket.create_connection(('127.0.0.1', port), timeout=60)
+        self.reader = self.sock.makefile('r')
+        self.next_id = 1
+        self.notifications = []
+
+    def request(self, method, params):
+        request_id = self.next_id
+        self.next_id += 1
+        self.sock.sendall((json.dumps({'id': request_id, 'method': method, 'params': params}) + '\n').encode())
+        while True:
+            message = json.loads(self.reader.readline())
+            if message.get('method') == 'job':
+                self.notifications.append(message['params'])
+                continue
+            assert_equal(message['id'], request_id)
+            return message
+
+    def read_notification(self):
+        if not self.notifications:
+            message = json.loads(self.reader.readline())
+            assert_equal(message['method'], 'job')
+            self.notifications.append(message['params'])
+        return self.notifications.pop(0)
+
+
+class MiningStratumTest(BitcoinTestFramework):
+    def set_test_params(self):
+        self.num_nodes = 1
+        self.setup_clean_chain = True
+
+    def stratum_args(self):
+        return [
+            '-stratum',
+            '-stratumaddress={}'.format(self.address),
+            '-stratumport={}'.format(p2p_port(self.num_nodes)),
+            '-stratumdifficulty=1',
+        ]
+
+    def run_test(self):
+        node = self.nodes[0]
+        self.address = node.get_deterministic_priv_key().address
+        node.generatetoaddress(10, self.address)
+
+        self.log.info("Check the -stratum arguments")
+        self.stop_node(0)
+        node.assert_start_raises_init_error(['-stratum', '-stratumaddress=notanaddress'], "Error: Invalid -stratumaddress: 'notanaddress'")
+        node.assert_start_raises_init_error(self.stratum_args() + ['-stratumdifficulty=0'], 'Error: Invalid -stratumdifficulty: 0')
+        self.start_node(0, extra_args=self.stratum_args())
+
+        self.log.info("Log in and get a job for the next block")
+        miner = StratumMiner(p2p_port(self.num_nodes))
+        login = miner.request('login', {'login': 'x', 'pass': 'x', 'agent': 'test'})
+        assert login['error'] is None
+        session = login['result']['id']
+        job = login['result']['job']
+        assert_equal(job['height'], 11)
+        assert_equal(len(job['blob']), 2 * 144)
+        assert_equal(job['target'], 'ff' * 8)
+        assert_equal(len(job['seed_hash']), 64)
+        assert_equal(miner.request('keepalived', {'id': session})['result']['status'], 'KEEPALIVED')
+
+        self.log.info("Check that bad shares are rejected")
+        submit = lambda job_id, nonce: miner.request('submit', {'id': session, 'job_id': job_id, 'nonce': nonce, 'result': ''})
+        assert_equal(submit('unknown', '00000000')['error']['message'], 'Block expired')
+        assert_equal(submit(job['job_id'], 'xyz')['error']['message'], 'Invalid params')
+
+        self.log.info("Submit shares until one of them is a block")
+        # Blocks are submitted before the share is answered
+        nonce = 0
+        while node.getblockcount() == 10:
+            assert nonce < 1000
+            assert submit(job['job_id'], '{:08x}'.format(nonce))['error'] is None
+            if node.getblockcount() == 10:
+                assert_equal(submit(job['job_id'], '{:08x}'.format(nonce))['error']['message'], 'Duplicate share')
+            nonce += 1
+        tip = node.getblock(node.getbestblockhash(), 2)
+        assert_equal(tip['tx'][0]['vout'][0]['scriptPubKey']['addresses'], [self.address])
+
+        self.log.info("Check that the new block's job was pushed")
+        job = miner.read_notification()
+        assert_equal(job['height'], 12)
+        assert_equal(submit(login['result']['job']['job_id'], '00000000')['error']['message'], 'Block expired')
+
+        self.log.info("Check that blocks from elsewhere push a new job")
+        node.generatetoaddress(1, self.address)
+        job = miner.read_notification()
+        assert_equal(job['height'], 13)
+
+
+if __name__ == '__main__':
+    MiningStratumTest().main()
@@ -35,6 +35,13 @@ class QtumBlockNumberCorruptionTest(BitcoinTestFramework):
         self.node.sendtocontract(contract_address, '00')
         self.node.generate(1)
         self.restart_node(0, ['-checklevel=4'])
+        # The verification runs in the background, wait for it to reconnect the blocks
+        wait_until(lambda: self.node.getblockchaininfo()['verifydb']['status'] != 'running')
+        verifydb = self.node.getblockchaininfo()['verifydb']
+        assert_equal(verifydb['status'], 'done')
+        assert_equal(verifydb['checklevel'], 4)
+        assert_equal(verifydb['verified'], verifydb['blocks'])
+        assert not verifydb['level3skipped']
 
 
 if __name__ == '__main__':
@@ -0,0 +1,104 @@
+#!/usr/bin/env python3
+# Copyright (c) 2020 The Bitcoin Core developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+"""Test listcontracts with and without -contractindex.
+
+Node 0 runs without the index, node 1 with it. The plain listcontracts output
+and errors must not depend on the index, and must include contracts created by
+other contracts. The options form pages through the index with the cursor, and
+the index follows self destructs and disconnected blocks.
+"""
+
+from test_framework.test_framework import BitcoinTestFramework
+from test_framework.util import *
+from test_framework.qtum import *
+
+# Factory contract from qtum_create_eth_op_code.py, create() deploys a Test contract
+FACTORY_BYTECODE = "6060604052341561000f57600080fd5b5b6104028061001f6000396000f3006060604052361561004a576000357c0100000000000000000000000000000000000000000000000000000000900463ffffffff168063ccdb3f451461004e578063efc81a8c146100a3575b5b5b005b341561005957600080fd5b6100616100ad565b604051808273ffffffffffffffffffffffffffffffffffffffff1673ffffffffffffffffffffffffffffffffffffffff16815260200191505060405180910390f35b6100ab6100d2565b005b6000809054906101000a900473ffffffffffffffffffffffffffffffffffffffff1681565b6100da610132565b604051809103906000f08015156100f057600080fd5b6000806101000a81548173ffffffffffffffffffffffffffffffffffffffff021916908373ffffffffffffffffffffffffffffffffffffffff1602179055505b565b6040516102948061014383390190560060606040525b5b5b61027e806100166000396000f30060606040523615610060576000357c0100000000000000000000000000000000000000000000000000000000900463ffffffff168063541227e11461006457806383197ef01461009d578063919840ad146100a75780639e1a00aa146100d0575b5b5b005b341561006f57600080fd5b61009b600480803573ffffffffffffffffffffffffffffffffffffffff16906020019091905050610112565b005b6100a56101ec565b005b34156100b257600080fd5b6100ba610207565b6040518082815260200191505060405180910390f35b34156100db57600080fd5b610110600480803573ffffffffffffffffffffffffffffffffffffffff1690602001909190803590602001909190505061020d565b005b60008173ffffffffffffffffffffffffffffffffffffffff1663ccdb3f456000604051602001526040518163ffffffff167c0100000000000000000000000000000000000000000000000000000000028152600401602060405180830381600087803b151561018057600080fd5b6102c65a03f1151561019157600080fd5b5050506040518051905090503073ffffffffffffffffffffffffffffffffffffffff168173ffffffffffffffffffffffffffffffffffffffff1614156101de5760016000819055506101e7565b60026000819055505b5b5050565b3373ffffffffffffffffffffffffffffffffffffffff16ff5b565b60005481565b8173ffffffffffffffffffffffffffffffffffffffff166108fc829081150290604051600060405180830381858888f19350505050151561024d57600080fd5b5b50505600a165627a7a72305820fa7432274a811bb14b3a9182e51715a333ce275636c08ab171c44fa197f20d6c0029a165627a7a723058201d26b91d6e884c90c5d2582dc21c991a7552a6538030c5599f555fb0b7eacd450029"
+
+class QtumListContractsIndexTest(BitcoinTestFramework):
+    def set_test_params(self):
+        self.setup_clean_chain = True
+        self.num_nodes = 2
+        self.extra_args = [[], ['-contractindex']]
+
+    def skip_test_if_missing_module(self):
+        self.skip_if_no_wallet()
+
+    def run_test(self):
+        node = self.nodes[0]
+        generatesynchronized(node, COINBASE_MATURITY+100, None, self.nodes)
+        self.sync_all()
+
+        # Deploy the factory and let it create a contract internally
+        result = node.createcontract(FACTORY_BYTECODE)
+        factory_address = result['address']
+        factory_txid = result['txid']
+        node.generate(1)
+        creation_height = node.getblockcount()
+        create_result = node.sendtocontract(factory_address, "efc81a8c", 0, 1000000, "0.000001")
+        node.generate(1)
+        second_address = node.createcontract(FACTORY_BYTECODE)['address']
+        node.generate(1)
+        self.sync_all()
+        created_address = node.callcontract(factory_address, "ccdb3f45")['executionResult']['output'][24:]
+
+        self.log.info("Plain listcontracts does not depend on the index")
+        contracts = self.nodes[0].listcontracts(1, 1000)
+        assert_equal(self.nodes[1].listcontracts(1, 1000), contracts)
+        assert_equal(self.nodes[1].listcontracts(), self.nodes[0].listcontracts())
+        assert factory_address in contracts
+        assert created_address in contracts
+        # Node 1 lists the index in address order
+        addresses = sorted(contracts)
+        assert_equal(list(self.nodes[1].listcontracts(2, 3)), addresses[1:4])
+        for n in self.nodes:
+            assert_raises_rpc_error(-3, "start greater than max index %d" % len(contracts), n.listcontracts, len(contracts) + 1)
+
+        self.log.info("Options require the index")
+        assert_raises_rpc_error(-1, "Contract index not enabled", self.nodes[0].listcontracts, 1, 20, {})
+
+        self.log.info("Options list the index entries")
+        indexed = self.nodes[1].listcontracts(1, 1000, {'minheight': creation_height, 'maxheight': creation_height})
+        assert 'next' not in indexed
+        assert_equal(len(indexed['contracts']), 1)
+        entry = indexed['contracts'][0]
+        assert_equal(entry['address'], factory_address)
+        assert_equal(entry['balance'], 0)
+        assert_equal(entry['creationheight'], creation_height)
+        assert_equal(entry['creationtxid'], factory_txid)
+        assert_equal(entry['lasttouchedheight'], creation_height + 1)
+        assert_equal(self.nodes[1].getaccountinfo(factory_address)['creationtxid'], factory_txid)
+        assert_raises_rpc_error(-8, "start is not supported with options", self.nodes[1].listcontracts, 2, 20, {})
+
+        self.log.info("Contracts created by other contracts are credited to the transaction sender")
+        created = self.nodes[1].listcontracts(1, 1, {'cursor': created_address})['contracts'][0]
+        assert_equal(created['address'], created_address)
+        assert_equal(created['creationheight'], creation_height + 1)
+        assert_equal(created['creationtxid'], create_result['txid'])
+        assert_equal(created['creator'], create_result['hash160'])
+
+        self.log.info("Page through the index with the cursor")
+        all_indexed = self.nodes[1].listcontracts(1, 1000, {})['contracts']
+        assert_equal([c['address'] for c in all_indexed], addresses)
+        page = self.nodes[1].listcontracts(1, 1, {})
+        assert_equal(page['contracts'], all_indexed[:1])
+        assert_equal(page['next'], all_indexed[1]['address'])
+        page = self.nodes[1].listcontracts(1, 1000, {'cursor': page['next']})
+        assert_equal(page['contracts'], all_indexed[1:])
+
+        self.log.info("Self destructed contracts leave the index, and come back when the block is disconnected")
+        node.sendtocontract(created_address, "83197ef0", 0, 1000000, "0.000001")
+        destruct_block = node.generate(1)[0]
+        self.sync_all()
+        assert created_address not in self.nodes[0].listcontracts(1, 1000)
+        assert_equal(self.nodes[1].listcontracts(1, 1000), self.nodes[0].listcontracts(1, 1000))
+        assert created_address not in [c['address'] for c in self.nodes[1].listcontracts(1, 1000, {})['contracts']]
+        for n in self.nodes:
+            n.invalidateblock(destruct_block)
+        assert_equal(self.nodes[1].listcontracts(1, 1000), contracts)
+        assert_equal(self.nodes[1].listcontracts(1, 1, {'cursor': created_address})['contracts'][0], created)
+
+if __name__ == '__main__':
+    QtumListContractsIndexTest().main()
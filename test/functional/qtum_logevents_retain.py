@@ -0,0 +1,50 @@
+#!/usr/bin/env python3
+# Copyright (c) 2020 The Bitcoin Core developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+"""Test that -logeventsretainheight deletes the receipts of old contract calls, with and without logs."""
+
+from test_framework.test_framework import BitcoinTestFramework
+from test_framework.util import *
+from test_framework.qtumconfig import *
+
+# Blocks this close to the tip are never pruned
+MIN_BLOCKS_TO_KEEP = 288
+
+class QtumLogEventsRetainTest(BitcoinTestFramework):
+    def set_test_params(self):
+        self.setup_clean_chain = True
+        self.num_nodes = 1
+        self.extra_args = [['-logevents']]
+
+    def skip_test_if_missing_module(self):
+        self.skip_if_no_wallet()
+
+    def run_test(self):
+        node = self.nodes[0]
+        node.generate(100+COINBASE_MATURITY)
+        # 027c1aaf() doubles a storage value, 5b9af12b(uint256) also emits two events
+        contract_address = node.createcontract("6060604052600d600055341561001457600080fd5b61017e806100236000396000f30060606040526004361061004c576000357c0100000000000000000000000000000000000000000000000000000000900463ffffffff168063027c1aaf1461004e5780635b9af12b14610058575b005b61005661008f565b005b341561006357600080fd5b61007960048080359060200190919050506100a1565b6040518082815260200191505060405180910390f35b60026000808282540292505081905550565b60007fc5c442325655248f6bccf5c6181738f8755524172cea2a8bd1e38e43f833e7f282600054016000548460405180848152602001838152602001828152602001935050505060405180910390a17fc5c442325655248f6bccf5c6181738f8755524172cea2a8bd1e38e43f833e7f282600054016000548460405180848152602001838152602001828152602001935050505060405180910390a1816000540160008190555060005490509190505600a165627a7a7230582015732bfa66bdede47ecc05446bf4c1e8ed047efac25478cb13b795887df70f290029")['address']
+        node.generate(1)
+
+        self.log.info("Call the contract with and without logs")
+        nolog_txid = node.sendtocontract(contract_address, "027c1aaf")['txid']
+        log_txid = node.sendtocontract(contract_address, "5b9af12b")['txid']
+        node.generate(1)
+        height = node.getblockcount()
+        assert_equal(node.gettransactionreceipt(nolog_txid)[0]['log'], [])
+        assert_equal(len(node.gettransactionreceipt(log_txid)[0]['log']), 2)
+        kept_txid = node.sendtocontract(contract_address, "027c1aaf")['txid']
+        node.generate(1)
+
+        self.log.info("Keep only the receipts from the block after the calls")
+        self.restart_node(0, ['-logevents', '-logeventsretainheight=%d' % (height + 1)])
+        node.generate(MIN_BLOCKS_TO_KEEP + 1)
+        wait_until(lambda: node.getblockchaininfo()['logevents']['pruneheight'] == height + 1)
+        assert_equal(node.gettransactionreceipt(nolog_txid), [])
+        assert_equal(node.gettransactionreceipt(log_txid), [])
+        assert_equal(len(node.gettransactionreceipt(kept_txid)), 1)
+
+
+if __name__ == '__main__':
+    QtumLogEventsRetainTest().main()
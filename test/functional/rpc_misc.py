@@ -52,6 +52,12 @@ class RpcMiscTest(BitcoinTestFramework):
             self.log.info('getmemoryinfo(mode="mallocinfo") not available')
             assert_raises_rpc_error(-8, 'mallocinfo is only available when compiled with glibc 2.10+', node.getmemoryinfo, mode="mallocinfo")
 
+        subsystems = node.getmemoryinfo(mode="subsystems")
+        assert_greater_than(subsystems['block_index'], 0)
+        assert_greater_than(subsystems['coins_cache'], 0)
+        assert_greater_than(subsystems['signature_cache'], 0)
+        assert_equal(subsystems['total'], sum(usage for name, usage in subsystems.items() if name != 'total'))
+
         assert_raises_rpc_error(-8, "unknown mode foobar", node.getmemoryinfo, mode="foobar")
 
         self.log.info("test logging")
@@ -169,6 +169,7 @@ BASE_SCRIPTS = [
     'rpc_invalidateblock.py',
     'feature_rbf.py',
     'mempool_packages.py',
+    'mempool_delta.py',
     'mempool_package_onemore.py',
     'rpc_createmultisig.py',
     'feature_versionbits_warning.py',
@@ -186,6 +187,7 @@ BASE_SCRIPTS = [
     'rpc_bind.py --ipv6',
     'rpc_bind.py --nonloopback',
     'mining_basic.py',
+    'mining_stratum.py',
     'wallet_bumpfee.py',
     'wallet_implicitsegwit.py',
     'rpc_named_arguments.py',
@@ -250,6 +252,7 @@ BASE_SCRIPTS = [
     'qtum_create_eth_op_code.py',
     'qtum_gas_limit_overflow.py',
     'qtum_call_empty_contract.py',
+    'qtum_listcontracts_index.py',
     'qtum_dgp_block_size_sync.py',
     'qtum_pos_conflicting_txs.py',
     'qtum_globals_state_changer.py',
@@ -274,6 +277,7 @@ BASE_SCRIPTS = [
     'qtum_callcontract_timestamp.py',
     'qtum_transaction_receipt_origin_contract_address.py',
     'qtum_block_number_corruption.py',
+    'qtum_logevents_retain.py',
     'qtum_duplicate_stake.py',
     'qtum_rpc_bitcore.py',
     'qtum_faulty_header_chain.py',
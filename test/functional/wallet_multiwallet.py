@@ -102,6 +102,10 @@ class MultiWalletTest(BitcoinTestFramework):
 
         assert_equal(set(node.listwallets()), set(wallet_names))
 
+        # each wallet has its own, named notification queue
+        queue_names = [q['name'] for q in node.getvalidationqueueinfo() if q['name'].startswith('wallet ')]
+        assert_equal(sorted(queue_names), sorted('wallet [{}]'.format(n or 'default wallet') for n in wallet_names))
+
         # check that all requested wallets were created
         self.stop_node(0)
         for wallet_name in wallet_names: